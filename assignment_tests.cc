@@ -36,6 +36,13 @@
 
 // C++ headers.
 #include <algorithm>  // For std::reverse.
+#include <cstdio>  // For std::remove.
+#include <cstring>  // For std::memcmp.
+#include <fstream>
+#include <iterator>  // For std::istreambuf_iterator.
+#include <sstream>
+#include <memory>
+#include <new>  // For placement new.
 #include <numeric>  // For std::accumulate.
 #include <random>  // For random operations.
 #include <unordered_set>
@@ -47,8 +54,38 @@
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 
+#include "camera.h"
+#include "camera_utils.h"
+#include "camera_uniform_buffer.h"
+#include "damage_tracker.h"
+#include "dynamic_batcher.h"
+#include "dynamic_resolution.h"
+#include "frame_pacer.h"
+#include "gl_command_stream.h"
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "hardware_occlusion_culler.h"
+#include "image_writer.h"
+#include "input_latency_tracker.h"
+#include "math_kernels.h"
+#include "mesh.h"
+#include "mesh_pack.h"
 #include "transformations.h"
 #include "model.h"
+#include "model_bounds.h"
+#include "multi_view_renderer.h"
+#include "occlusion_culler.h"
+#include "quaternion_kernels.h"
+#include "redraw_scheduler.h"
+#include "render_order.h"
+#include "residency_manager.h"
+#include "shader_program.h"
+#include "software_renderer.h"
+#include "static_batcher.h"
+#include "thread_pool.h"
+#include "transform_buffer.h"
+#include "vertex_pulling_renderer.h"
+#include "wireframe_renderer.h"
 
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -135,6 +172,24 @@ struct ModelTest : public ::testing::Test {
 
 GLFWwindow* ModelTest::window = nullptr;
 
+// Returns the vertices of an axis-aligned box centered at the origin.
+Eigen::MatrixXf BoxVertices(const Eigen::Vector3f& half_extents) {
+  Eigen::MatrixXf vertices(3, 8);
+  for (int corner = 0; corner < 8; ++corner) {
+    vertices.col(corner) <<
+        ((corner & 1) ? half_extents.x() : -half_extents.x()),
+        ((corner & 2) ? half_extents.y() : -half_extents.y()),
+        ((corner & 4) ? half_extents.z() : -half_extents.z());
+  }
+  return vertices;
+}
+
+// Triangle indices for the vertices returned by BoxVertices().
+const std::vector<GLuint> kBoxIndices = {
+  0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+  2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5
+};
+
 }  // namespace
 
 TEST(TransformationsTest, TranslationMatrixCorrectness) {
@@ -199,6 +254,218 @@ TEST(TransformationsTest, ScalingMatrixInverse) {
   EXPECT_NEAR((scaling1 * scaling2).sum(), 4.0f, 1e-3);
 }
 
+TEST(TransformationsTest, RodriguesQuaternionRoundTrip) {
+  const Eigen::Vector3f rodrigues(0.3f, -1.2f, 0.8f);
+  const Eigen::Quaternionf quaternion = ConvertRodriguesToQuaternion(rodrigues);
+  EXPECT_NEAR(quaternion.norm(), 1.0f, 1e-5);
+  const float angle = rodrigues.norm();
+  const Eigen::Matrix4f rotation =
+      ComputeRotationMatrix(rodrigues / angle, angle);
+  const Eigen::Matrix3f rotation_block = rotation.block<3, 3>(0, 0);
+  EXPECT_TRUE(rotation_block.isApprox(quaternion.toRotationMatrix(), 1e-5f));
+  EXPECT_TRUE(ConvertQuaternionToRodrigues(quaternion).isApprox(rodrigues,
+                                                                1e-5f));
+  // -q is the same rotation.
+  const Eigen::Quaternionf negated(-quaternion.coeffs());
+  EXPECT_TRUE(ConvertQuaternionToRodrigues(negated).isApprox(rodrigues,
+                                                             1e-5f));
+  EXPECT_TRUE(ConvertQuaternionToRodrigues(
+      ConvertRodriguesToQuaternion(Eigen::Vector3f::Zero())).isZero());
+
+  // The model matrices of both storages match.
+  const Eigen::MatrixXf vertices = Eigen::MatrixXf::Zero(3, 3);
+  Model model(rodrigues, Eigen::Vector3f(1, 2, 3), vertices);
+  const Eigen::Matrix4f model_matrix = model.ComputeModelMatrix();
+  model.set_orientation_quaternion(quaternion);
+  EXPECT_TRUE(model.has_quaternion_orientation());
+  EXPECT_TRUE(model.ComputeModelMatrix().isApprox(model_matrix, 1e-5f));
+  EXPECT_TRUE(model.orientation().isApprox(rodrigues, 1e-5f));
+}
+
+TEST(QuaternionKernelsTest, MatchEigen) {
+  // Two batches of four and a remainder.
+  constexpr int kNumQuaternions = 11;
+  std::default_random_engine engine(5);
+  std::normal_distribution<float> normal;
+  QuaternionArray from(kNumQuaternions);
+  QuaternionArray to(kNumQuaternions);
+  for (int i = 0; i < kNumQuaternions; ++i) {
+    from.Set(i, Eigen::Quaternionf(normal(engine), normal(engine),
+                                   normal(engine), normal(engine)));
+    to.Set(i, Eigen::Quaternionf(normal(engine), normal(engine),
+                                 normal(engine), normal(engine)));
+  }
+  NormalizeQuaternions(&from);
+  NormalizeQuaternions(&to);
+  QuaternionArray products;
+  ASSERT_TRUE(MultiplyQuaternions(from, to, &products));
+  QuaternionArray slerped;
+  ASSERT_TRUE(SlerpQuaternions(from, to, 0.3f, &slerped));
+  QuaternionArray nlerped;
+  ASSERT_TRUE(NlerpQuaternions(from, to, 0.3f, &nlerped));
+  std::vector<float> matrices(16 * kNumQuaternions);
+  ConvertQuaternionsToRotationMatrices(from, matrices.data());
+  for (int i = 0; i < kNumQuaternions; ++i) {
+    const Eigen::Quaternionf q0 = from.Get(i);
+    const Eigen::Quaternionf q1 = to.Get(i);
+    EXPECT_NEAR(q0.norm(), 1.0f, 1e-5);
+    EXPECT_TRUE(products.Get(i).isApprox(q0 * q1, 1e-5f));
+    // Eigen also takes the shortest path, but may return -q.
+    EXPECT_NEAR(std::abs(slerped.Get(i).dot(q0.slerp(0.3f, q1))), 1.0f,
+                1e-4);
+    const Eigen::Quaternionf nlerp = nlerped.Get(i);
+    EXPECT_NEAR(nlerp.norm(), 1.0f, 1e-5);
+    // The normalized linear interpolation lies on the same arc.
+    EXPECT_GT(std::abs(nlerp.dot(q0.slerp(0.3f, q1))), 0.99f);
+    Eigen::Matrix4f rotation = Eigen::Matrix4f::Identity();
+    rotation.block<3, 3>(0, 0) = q0.toRotationMatrix();
+    EXPECT_TRUE(Eigen::Map<const Eigen::Matrix4f>(&matrices[16 * i])
+                .isApprox(rotation, 1e-5f));
+  }
+}
+
+TEST(QuaternionKernelsTest, MismatchedSizes) {
+  const QuaternionArray from(9);
+  const QuaternionArray to(5);
+  // The kernels reject the mismatch and leave the output as it was.
+  QuaternionArray result(2);
+  EXPECT_FALSE(MultiplyQuaternions(from, to, &result));
+  EXPECT_EQ(result.size(), 2);
+  EXPECT_FALSE(SlerpQuaternions(to, from, 0.5f, &result));
+  EXPECT_EQ(result.size(), 2);
+  EXPECT_FALSE(NlerpQuaternions(from, to, 0.5f, &result));
+  EXPECT_EQ(result.size(), 2);
+  EXPECT_TRUE(NlerpQuaternions(to, to, 0.5f, &result));
+  EXPECT_EQ(result.size(), 5);
+}
+
+TEST(MathKernelsTest, VariantsMatchEigen) {
+  // Several vectors of every width and a remainder.
+  constexpr int kNumItems = 37;
+  std::default_random_engine engine(9);
+  std::normal_distribution<float> normal;
+  QuaternionArray orientations(kNumItems);
+  std::vector<float> positions(3 * kNumItems);
+  std::vector<float> box_min(3 * kNumItems);
+  std::vector<float> box_max(3 * kNumItems);
+  for (int i = 0; i < kNumItems; ++i) {
+    orientations.Set(i, Eigen::Quaternionf(normal(engine), normal(engine),
+                                           normal(engine), normal(engine))
+                     .normalized());
+    for (int j = 0; j < 3; ++j) {
+      positions[3 * i + j] = 4.0f * normal(engine) - (j == 2 ? 5.0f : 0.0f);
+      box_min[3 * i + j] = 0.2f * normal(engine) - 0.5f;
+      box_max[3 * i + j] = box_min[3 * i + j] + 1.0f;
+    }
+  }
+  Camera camera;
+  camera.SetPerspective(ConvertDegreesToRadians(45.0f), 1.0f, 0.1f, 10.0f);
+  const Eigen::Matrix4f view_projection = camera.view_projection_matrix();
+  std::vector<float> matrices(16 * kNumItems);
+  std::vector<float> products(16 * kNumItems);
+  std::vector<float> world_min(3 * kNumItems);
+  std::vector<float> world_max(3 * kNumItems);
+  std::vector<uint8_t> visible(kNumItems);
+  std::vector<float> transformed(3 * kNumItems);
+  // The later tests run on the level in use before this one.
+  const SimdLevel initial_level = GetSimdLevel();
+  for (int j = 0; j < static_cast<int>(SimdLevel::NUM_LEVELS); ++j) {
+    const SimdLevel level = static_cast<SimdLevel>(j);
+    SimdLevel parsed_level;
+    EXPECT_TRUE(ParseSimdLevel(SimdLevelName(level), &parsed_level));
+    EXPECT_EQ(parsed_level, level);
+    if (!IsSimdLevelSupported(level)) continue;
+    SCOPED_TRACE(SimdLevelName(level));
+    EXPECT_TRUE(ForceSimdLevel(level));
+    EXPECT_EQ(GetSimdLevel(), level);
+    ComposeTransforms(orientations, positions.data(), matrices.data());
+    MultiplyMatrices(view_projection, matrices.data(), kNumItems,
+                     products.data());
+    TransformBoxes(matrices.data(), box_min.data(), box_max.data(), kNumItems,
+                   world_min.data(), world_max.data());
+    TestBoxesInFrustum(camera.frustum_planes(), world_min.data(),
+                       world_max.data(), kNumItems, visible.data());
+    TransformVertices(view_projection, positions.data(), kNumItems,
+                      transformed.data(), nullptr);
+    for (int i = 0; i < kNumItems; ++i) {
+      const Eigen::Vector3f position(&positions[3 * i]);
+      Eigen::Matrix4f model = ComputeTranslationMatrix(position);
+      model.block<3, 3>(0, 0) = orientations.Get(i).toRotationMatrix();
+      EXPECT_TRUE(Eigen::Map<const Eigen::Matrix4f>(&matrices[16 * i])
+                  .isApprox(model, 1e-5f));
+      EXPECT_TRUE(Eigen::Map<const Eigen::Matrix4f>(&products[16 * i])
+                  .isApprox(view_projection * model, 1e-4f));
+      // The world box encloses the transformed corners of the box.
+      const Eigen::Vector3f min_corner(&world_min[3 * i]);
+      const Eigen::Vector3f max_corner(&world_max[3 * i]);
+      for (int corner = 0; corner < 8; ++corner) {
+        const Eigen::Vector3f point(
+            (corner & 1) ? box_max[3 * i] : box_min[3 * i],
+            (corner & 2) ? box_max[3 * i + 1] : box_min[3 * i + 1],
+            (corner & 4) ? box_max[3 * i + 2] : box_min[3 * i + 2]);
+        const Eigen::Vector3f world_point =
+            (model * point.homogeneous()).head<3>();
+        EXPECT_GE((world_point - min_corner).minCoeff(), -1e-4f);
+        EXPECT_GE((max_corner - world_point).minCoeff(), -1e-4f);
+      }
+      EXPECT_EQ(visible[i] != 0,
+                camera.IsBoxInFrustum(Eigen::Matrix4f::Identity(),
+                                      min_corner, max_corner));
+      EXPECT_TRUE(Eigen::Vector3f(&transformed[3 * i]).isApprox(
+          (view_projection * position.homogeneous()).head<3>(), 1e-4f));
+    }
+  }
+  EXPECT_FALSE(ForceSimdLevel(SimdLevel::NUM_LEVELS));
+  EXPECT_TRUE(ForceSimdLevel(initial_level));
+}
+
+TEST(MathKernelsTest, ProjectVerticesInParallel) {
+  // Several tasks and a remainder.
+  const int num_vertices = 2 * kVerticesPerTask + 5;
+  const Eigen::Matrix3Xf vertices =
+      4.0f * Eigen::Matrix3Xf::Random(3, num_vertices);
+  Camera camera;
+  camera.SetPerspective(ConvertDegreesToRadians(45.0f), 1.0f, 0.1f, 10.0f);
+  camera.set_position(Eigen::Vector3f(0.0f, 0.0f, 5.0f));
+  const Eigen::Matrix4f view_projection = camera.view_projection_matrix();
+  const Eigen::Matrix<float, 3, 4> affine = view_projection.topRows<3>();
+  ThreadPool thread_pool(4);
+  Eigen::Matrix4Xf clip(4, num_vertices);
+  Eigen::Matrix4Xf ndc(4, num_vertices);
+  Eigen::Matrix3Xf transformed(3, num_vertices);
+  std::vector<uint8_t> clip_flags(num_vertices);
+  ProjectVertices(view_projection, vertices.data(), num_vertices, false,
+                  clip.data(), clip_flags.data(), &thread_pool);
+  ProjectVertices(view_projection, vertices.data(), num_vertices, true,
+                  ndc.data(), nullptr, &thread_pool);
+  TransformVertices(affine, vertices.data(), num_vertices, transformed.data(),
+                    &thread_pool);
+  int num_inside = 0;
+  for (int i = 0; i < num_vertices; ++i) {
+    const Eigen::Vector4f expected_clip =
+        view_projection * vertices.col(i).homogeneous();
+    ASSERT_TRUE(clip.col(i).isApprox(expected_clip, 1e-5f)) << i;
+    const float w = expected_clip.w();
+    int expected_flags = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      if (expected_clip[axis] < -w) expected_flags |= 1 << (2 * axis);
+      if (expected_clip[axis] > w) expected_flags |= 1 << (2 * axis + 1);
+    }
+    ASSERT_EQ(clip_flags[i], expected_flags) << i;
+    num_inside += expected_flags == 0 ? 1 : 0;
+    if (w > 0.0f) {
+      const Eigen::Vector4f expected_ndc(expected_clip.x() / w,
+                                         expected_clip.y() / w,
+                                         expected_clip.z() / w, 1.0f / w);
+      ASSERT_TRUE(ndc.col(i).isApprox(expected_ndc, 1e-4f)) << i;
+    }
+    ASSERT_TRUE(transformed.col(i).isApprox(expected_clip.head<3>(), 1e-5f))
+        << i;
+  }
+  EXPECT_GT(num_inside, 0);
+  EXPECT_LT(num_inside, num_vertices);
+}
+
 TEST_F(ModelTest, ComputeModelMatrix) {
   const float angle = M_PI / 8.0f;
   Eigen::Vector3f angle_axis = Eigen::Vector3f::Random();
@@ -243,4 +510,1309 @@ TEST_F(ModelTest, VerifyNonZeroVaoVboAndEboIds) {
   EXPECT_GT(model.element_buffer_object_id(), 0);
 }
 
+TEST(OcclusionCullerTest, CullsModelsBehindOccluders) {
+  ThreadPool thread_pool(2);
+  OcclusionCuller occlusion_culler(160, 120, &thread_pool);
+  Model wall(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.0f, 0.0f, -4.0f),
+             BoxVertices(Eigen::Vector3f(2.0f, 2.0f, 0.1f)), kBoxIndices);
+  Model hidden(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.5f, 0.0f, -7.0f),
+               BoxVertices(Eigen::Vector3f::Constant(0.3f)), kBoxIndices);
+  Model beside(Eigen::Vector3f::Zero(), Eigen::Vector3f(4.0f, 0.0f, -7.0f),
+               BoxVertices(Eigen::Vector3f::Constant(0.3f)), kBoxIndices);
+  Model in_front(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.0f, 0.0f, -2.0f),
+                 BoxVertices(Eigen::Vector3f::Constant(0.3f)), kBoxIndices);
+  occlusion_culler.AddOccluder(&wall);
+  const Eigen::Matrix4f projection = ComputePerspectiveProjectionMatrix(
+      ConvertDegreesToRadians(45.0f), 4.0f / 3.0f, 0.1f, 10.0f);
+  occlusion_culler.RenderOccluders(projection, Eigen::Matrix4f::Identity());
+  std::vector<Model*> models = { &wall, &hidden, &beside, &in_front };
+  std::vector<Model*> visible_models;
+  occlusion_culler.CullModels(models, &visible_models);
+  EXPECT_EQ(visible_models.size(), 3u);
+  EXPECT_TRUE(std::find(visible_models.begin(), visible_models.end(),
+                        &hidden) == visible_models.end());
+  EXPECT_EQ(occlusion_culler.stats().num_models_tested, 3);
+  EXPECT_EQ(occlusion_culler.stats().num_models_culled, 1);
+  // The same with the model matrices of a batch.
+  ModelBounds model_bounds;
+  model_bounds.Update(models);
+  std::vector<Model*> batch_visible_models;
+  occlusion_culler.CullModels(models, model_bounds.model_matrices(),
+                              &batch_visible_models);
+  EXPECT_EQ(batch_visible_models, visible_models);
+}
+
+TEST(WireframeRendererTest, DrawsEveryEdgeOnce) {
+  WireframeMode mode;
+  EXPECT_TRUE(ParseWireframeMode("edge_lines", &mode));
+  EXPECT_EQ(mode, WireframeMode::EDGE_LINES);
+  EXPECT_TRUE(ParseWireframeMode("barycentric", &mode));
+  EXPECT_EQ(mode, WireframeMode::BARYCENTRIC);
+  EXPECT_FALSE(ParseWireframeMode("lines", &mode));
+  EXPECT_EQ(mode, WireframeMode::BARYCENTRIC);
+
+  // The diagonal of a quad is shared by its two triangles.
+  const std::vector<GLuint> quad_indices = { 0, 1, 2, 0, 2, 3 };
+  EXPECT_EQ(ComputeUniqueEdgeIndices(quad_indices, 4).size(), 2u * 5u);
+  // Every edge of a closed box is shared by two triangles.
+  EXPECT_EQ(ComputeUniqueEdgeIndices(kBoxIndices, 8).size(), 2u * 18u);
+  // The triangles of an unindexed list share no vertex, and the incomplete
+  // triangle at the end is ignored.
+  EXPECT_EQ(ComputeUniqueEdgeIndices(std::vector<GLuint>(), 7).size(),
+            2u * 6u);
+}
+
+// The software backend renders without a GPU, so its frames are checked
+// pixel by pixel.
+TEST(SoftwareRendererTest, DrawsABoxAndSavesTheFrame) {
+  constexpr int kSize = 64;
+  ThreadPool thread_pool(2);
+  SoftwareRenderer software_renderer(kSize, kSize, &thread_pool);
+  Model box(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.0f, 0.0f, -3.0f),
+            BoxVertices(Eigen::Vector3f::Constant(0.5f)), kBoxIndices);
+  const Eigen::Matrix4f projection = ComputePerspectiveProjectionMatrix(
+      ConvertDegreesToRadians(90.0f), 1.0f, 0.1f, 10.0f);
+  software_renderer.BeginFrame();
+  software_renderer.Draw(&box, projection, Eigen::Matrix4f::Identity());
+  software_renderer.EndFrame();
+  EXPECT_EQ(software_renderer.stats().num_triangles, 12);
+
+  // The box covers the center with the front face at z = -2.5, and the
+  // corners keep the clear color and depth. The colors are RGBA bytes.
+  const SoftwareRasterizer& rasterizer = software_renderer.rasterizer();
+  const uint32_t box_color = 0xFF3380FFu;
+  const uint32_t clear_color = 0xFF000000u;
+  const Eigen::Vector4f front_clip =
+      projection * Eigen::Vector4f(0.0f, 0.0f, -2.5f, 1.0f);
+  const int center = kSize / 2;
+  EXPECT_EQ(rasterizer.color_buffer()[center * rasterizer.row_stride() +
+                                      center], box_color);
+  EXPECT_NEAR(rasterizer.depth(center, center),
+              0.5f * front_clip.z() / front_clip.w() + 0.5f, 1e-4f);
+  EXPECT_EQ(rasterizer.color_buffer()[0], clear_color);
+  EXPECT_EQ(rasterizer.depth(0, 0), 1.0f);
+  EXPECT_EQ(rasterizer.depth(kSize - 1, kSize - 1), 1.0f);
+
+  // The PPM file stores the top row first.
+  const std::string filepath = "software_renderer_test.ppm";
+  ASSERT_TRUE(software_renderer.SaveFrameAsPpm(filepath));
+  std::ifstream file(filepath, std::ios::binary);
+  std::string magic;
+  int width = 0;
+  int height = 0;
+  int max_value = 0;
+  file >> magic >> width >> height >> max_value;
+  file.get();
+  std::vector<unsigned char> pixels(3 * kSize * kSize);
+  file.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+  EXPECT_TRUE(file.good());
+  file.close();
+  std::remove(filepath.c_str());
+  EXPECT_EQ(magic, "P6");
+  EXPECT_EQ(width, kSize);
+  EXPECT_EQ(height, kSize);
+  EXPECT_EQ(max_value, 255);
+  const unsigned char* center_pixel =
+      &pixels[3 * ((kSize - 1 - center) * kSize + center)];
+  EXPECT_EQ(center_pixel[0], 255);
+  EXPECT_EQ(center_pixel[1], 128);
+  EXPECT_EQ(center_pixel[2], 51);
+  const unsigned char* bottom_left_pixel = &pixels[3 * (kSize - 1) * kSize];
+  EXPECT_EQ(bottom_left_pixel[0], 0);
+  EXPECT_EQ(bottom_left_pixel[1], 0);
+  EXPECT_EQ(bottom_left_pixel[2], 0);
+}
+
+TEST(ModelBoundsTest, MatchesPerModelCulling) {
+  const Eigen::MatrixXf vertices =
+      BoxVertices(Eigen::Vector3f(0.5f, 0.2f, 0.3f));
+  std::default_random_engine engine(3);
+  std::normal_distribution<float> normal;
+  std::vector<std::unique_ptr<Model> > models;
+  std::vector<Model*> model_pointers;
+  for (int i = 0; i < 40; ++i) {
+    const Eigen::Vector3f position(4.0f * normal(engine),
+                                   4.0f * normal(engine),
+                                   4.0f * normal(engine) - 5.0f);
+    models.emplace_back(new Model(Eigen::Vector3f::Random(), position,
+                                  vertices, kBoxIndices));
+    // Both storages of the orientation.
+    if (i % 2 == 0) {
+      models.back()->set_orientation_quaternion(Eigen::Quaternionf(
+          normal(engine), normal(engine), normal(engine), normal(engine)));
+    }
+    model_pointers.push_back(models.back().get());
+  }
+  Camera camera;
+  camera.SetPerspective(ConvertDegreesToRadians(45.0f), 1.0f, 0.1f, 10.0f);
+  ModelBounds model_bounds;
+  model_bounds.Update(model_pointers);
+  ASSERT_EQ(model_bounds.size(), 40);
+  std::vector<uint8_t> in_frustum;
+  model_bounds.TestInFrustum(camera, &in_frustum);
+  int num_in_frustum = 0;
+  for (int i = 0; i < model_bounds.size(); ++i) {
+    Model* model = model_bounds.model(i);
+    const Eigen::Matrix4f model_matrix = model->ComputeModelMatrix();
+    EXPECT_TRUE(model_bounds.model_matrix(i).isApprox(model_matrix, 1e-5f));
+    // The world boxes are conservative.
+    if (camera.IsBoxInFrustum(model_matrix, model->bounding_box_min(),
+                              model->bounding_box_max())) {
+      EXPECT_EQ(in_frustum[i], 1);
+      ++num_in_frustum;
+    }
+  }
+  EXPECT_GT(num_in_frustum, 0);
+  EXPECT_LT(num_in_frustum, 40);
+}
+
+TEST(RenderOrderTest, SortsModelsFrontToBack) {
+  const Eigen::MatrixXf vertices =
+      BoxVertices(Eigen::Vector3f::Constant(0.1f));
+  Model far(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.0f, 0.0f, -8.0f),
+            vertices, kBoxIndices);
+  Model middle(Eigen::Vector3f::Zero(), Eigen::Vector3f(1.0f, 0.0f, -4.0f),
+               vertices, kBoxIndices);
+  Model near(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.0f, 1.0f, -1.0f),
+             vertices, kBoxIndices);
+  std::vector<Model*> models = { &far, &near, &middle };
+  SortModelsFrontToBack(Eigen::Matrix4f::Identity(), &models);
+  EXPECT_EQ(models[0], &near);
+  EXPECT_EQ(models[1], &middle);
+  EXPECT_EQ(models[2], &far);
+}
+
+TEST(CameraTest, CachedMatricesAreConsistent) {
+  Camera camera;
+  camera.SetPerspective(ConvertDegreesToRadians(60.0f), 1.5f, 0.5f, 20.0f);
+  camera.set_orientation(Eigen::Vector3f(0.0f, 0.3f, 0.1f));
+  camera.set_position(Eigen::Vector3f(1.0f, 2.0f, 3.0f));
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  EXPECT_TRUE((camera.view_matrix() * camera.inverse_view_matrix())
+              .isApprox(identity, 1e-5f));
+  EXPECT_TRUE((camera.projection_matrix() *
+               camera.inverse_projection_matrix()).isApprox(identity, 1e-5f));
+  EXPECT_TRUE(camera.view_projection_matrix().isApprox(
+      camera.projection_matrix() * camera.view_matrix()));
+  EXPECT_TRUE((camera.view_projection_matrix() *
+               camera.inverse_view_projection_matrix())
+              .isApprox(identity, 1e-4f));
+  // Changing the pose updates the cache.
+  camera.set_position(Eigen::Vector3f::Zero());
+  EXPECT_NEAR(camera.view_matrix().col(3).head<3>().norm(), 0.0f, 1e-6f);
+}
+
+TEST(CameraTest, FrustumCulling) {
+  const Eigen::Vector3f box_min = Eigen::Vector3f::Constant(-0.5f);
+  const Eigen::Vector3f box_max = Eigen::Vector3f::Constant(0.5f);
+  Camera camera;
+  camera.SetPerspective(ConvertDegreesToRadians(45.0f), 1.0f, 0.1f, 10.0f);
+  EXPECT_TRUE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(0.0f, 0.0f, -5.0f)),
+      box_min, box_max));
+  EXPECT_FALSE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(0.0f, 0.0f, 5.0f)),
+      box_min, box_max));
+  EXPECT_FALSE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(10.0f, 0.0f, -5.0f)),
+      box_min, box_max));
+  EXPECT_FALSE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(0.0f, 0.0f, -20.0f)),
+      box_min, box_max));
+  // The reverse-Z projection has no far plane.
+  camera.SetReverseZInfinitePerspective(ConvertDegreesToRadians(45.0f), 1.0f,
+                                        0.1f);
+  EXPECT_TRUE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(0.0f, 0.0f, -1000.0f)),
+      box_min, box_max));
+  EXPECT_FALSE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(0.0f, 0.0f, 5.0f)),
+      box_min, box_max));
+  // The orthographic volume is a box.
+  camera.SetOrthographic(2.0f, 1.0f, 0.1f, 10.0f);
+  EXPECT_TRUE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(1.2f, 0.0f, -5.0f)),
+      box_min, box_max));
+  EXPECT_FALSE(camera.IsBoxInFrustum(
+      ComputeTranslationMatrix(Eigen::Vector3f(2.0f, 0.0f, -5.0f)),
+      box_min, box_max));
+}
+
+TEST(CameraTest, ComputeRayThroughImageCenter) {
+  Camera camera;
+  camera.set_orientation(Eigen::Vector3f(0.0f, 0.5f * M_PI, 0.0f));
+  camera.set_position(Eigen::Vector3f(1.0f, 0.0f, 0.0f));
+  Eigen::Vector3f origin;
+  Eigen::Vector3f direction;
+  camera.ComputeRay(Eigen::Vector2f::Zero(), &origin, &direction);
+  // Rotating -z by 90 degrees about y gives -x.
+  EXPECT_TRUE(direction.isApprox(Eigen::Vector3f(-1.0f, 0.0f, 0.0f), 1e-5f));
+  EXPECT_NEAR(camera.ComputeViewDepth(origin), camera.near_plane(), 1e-5f);
+  EXPECT_NEAR(camera.ComputeViewDepth(Eigen::Vector3f(-4.0f, 0.0f, 0.0f)),
+              5.0f, 1e-5f);
+}
+
+// Every model is culled once for all the views, and its mask lists the views
+// that see it.
+TEST(MultiViewRendererTest, CullsTheModelsOnceForAllViews) {
+  Camera left_camera;
+  left_camera.SetPerspective(ConvertDegreesToRadians(45.0f), 1.0f, 0.1f,
+                             10.0f);
+  Camera right_camera = left_camera;
+  right_camera.set_position(Eigen::Vector3f(2.0f, 0.0f, 0.0f));
+  std::vector<RenderView> views(2);
+  views[0].camera = &left_camera;
+  views[1].camera = &right_camera;
+  const Eigen::MatrixXf vertices =
+      BoxVertices(Eigen::Vector3f::Constant(0.1f));
+  Model both(Eigen::Vector3f::Zero(), Eigen::Vector3f(1.0f, 0.0f, -5.0f),
+             vertices, kBoxIndices);
+  Model left(Eigen::Vector3f::Zero(), Eigen::Vector3f(-1.5f, 0.0f, -5.0f),
+             vertices, kBoxIndices);
+  Model right(Eigen::Vector3f::Zero(), Eigen::Vector3f(3.5f, 0.0f, -5.0f),
+              vertices, kBoxIndices);
+  Model behind(Eigen::Vector3f::Zero(), Eigen::Vector3f(0.0f, 0.0f, 5.0f),
+               vertices, kBoxIndices);
+  const std::vector<Model*> models = { &both, &left, &right, &behind };
+  MultiViewRenderer multi_view_renderer;
+  std::vector<uint8_t> view_masks;
+  multi_view_renderer.CullModels(views, models, &view_masks);
+  const std::vector<uint8_t> expected_view_masks = { 3, 1, 2, 0 };
+  EXPECT_EQ(view_masks, expected_view_masks);
+  // The masks agree with the frustum tests of the cameras.
+  for (int i = 0; i < static_cast<int>(models.size()); ++i) {
+    for (int view = 0; view < 2; ++view) {
+      EXPECT_EQ((view_masks[i] >> view) & 1,
+                views[view].camera->IsBoxInFrustum(
+                    models[i]->ComputeModelMatrix(),
+                    models[i]->bounding_box_min(),
+                    models[i]->bounding_box_max()) ? 1 : 0);
+    }
+  }
+  const MultiViewStats& stats = multi_view_renderer.stats();
+  EXPECT_EQ(stats.num_views, 2);
+  EXPECT_EQ(stats.num_models_tested, 4);
+  EXPECT_EQ(stats.num_visible_model_views, 4);
+  EXPECT_EQ(stats.num_draw_calls, 0);
+}
+
+TEST(RedrawSchedulerTest, RedrawsOnlyWhenDirty) {
+  Model model(Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero(),
+              BoxVertices(Eigen::Vector3f::Constant(0.1f)), kBoxIndices);
+  const std::vector<Model*> models = { &model };
+  Camera camera;
+  RedrawScheduler redraw_scheduler;
+  // The first frame is always dirty.
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(models),
+                                           camera.version()));
+  redraw_scheduler.FrameRendered(ComputeSceneVersion(models),
+                                 camera.version());
+  EXPECT_FALSE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(models),
+                                            camera.version()));
+  // Moving a model, moving the camera and invalidating dirty the frame.
+  model.set_position(Eigen::Vector3f(1.0f, 0.0f, 0.0f));
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(models),
+                                           camera.version()));
+  redraw_scheduler.FrameRendered(ComputeSceneVersion(models),
+                                 camera.version());
+  camera.set_position(Eigen::Vector3f(0.0f, 0.0f, 1.0f));
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(models),
+                                           camera.version()));
+  redraw_scheduler.FrameRendered(ComputeSceneVersion(models),
+                                 camera.version());
+  redraw_scheduler.Invalidate();
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(models),
+                                           camera.version()));
+  redraw_scheduler.FrameRendered(ComputeSceneVersion(models),
+                                 camera.version());
+  // Adding a new model, or removing a model while another one moves, dirty
+  // the frame too.
+  Model other_model(Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones(),
+                    BoxVertices(Eigen::Vector3f::Constant(0.1f)),
+                    kBoxIndices);
+  std::vector<Model*> more_models = { &model, &other_model };
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(more_models),
+                                           camera.version()));
+  redraw_scheduler.FrameRendered(ComputeSceneVersion(more_models),
+                                 camera.version());
+  more_models.pop_back();
+  model.set_position(Eigen::Vector3f::Zero());
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(more_models),
+                                           camera.version()));
+  redraw_scheduler.FrameRendered(ComputeSceneVersion(more_models),
+                                 camera.version());
+  // Animations keep every frame dirty.
+  redraw_scheduler.set_animating(true);
+  EXPECT_TRUE(redraw_scheduler.NeedsRedraw(ComputeSceneVersion(models),
+                                           camera.version()));
+  EXPECT_EQ(redraw_scheduler.num_frames_rendered(), 6);
+}
+
+TEST(DamageTrackerTest, DamagesOldAndNewRectanglesOfMovedModels) {
+  const Eigen::MatrixXf vertices =
+      BoxVertices(Eigen::Vector3f::Constant(0.1f));
+  Model moving(Eigen::Vector3f::Zero(), Eigen::Vector3f(-1.0f, 0.0f, -5.0f),
+               vertices, kBoxIndices);
+  Model still(Eigen::Vector3f::Zero(), Eigen::Vector3f(1.5f, 0.0f, -5.0f),
+              vertices, kBoxIndices);
+  const std::vector<Model*> models = { &moving, &still };
+  Camera camera;
+  DamageTracker damage_tracker(640, 480, 1);
+  // The first frame is fully damaged.
+  ScreenRect damage = damage_tracker.Update(camera.view_projection_matrix(),
+                                            camera.version(), models);
+  EXPECT_EQ(damage.width(), 640);
+  EXPECT_EQ(damage.height(), 480);
+  // Nothing changed.
+  damage = damage_tracker.Update(camera.view_projection_matrix(),
+                                 camera.version(), models);
+  EXPECT_TRUE(damage.IsEmpty());
+  EXPECT_FALSE(damage_tracker.Overlaps(&still, damage));
+  // The damage covers the old and the new positions, but not the still box.
+  moving.set_position(Eigen::Vector3f(-0.5f, 0.0f, -5.0f));
+  damage = damage_tracker.Update(camera.view_projection_matrix(),
+                                 camera.version(), models);
+  EXPECT_FALSE(damage.IsEmpty());
+  EXPECT_LT(damage.width(), 320);
+  EXPECT_LT(damage.x_max, 320);
+  EXPECT_TRUE(damage_tracker.Overlaps(&moving, damage));
+  EXPECT_FALSE(damage_tracker.Overlaps(&still, damage));
+  EXPECT_EQ(damage_tracker.stats().num_changed_models, 1);
+  // Moving the camera damages everything.
+  camera.set_position(Eigen::Vector3f(0.0f, 0.0f, 1.0f));
+  damage = damage_tracker.Update(camera.view_projection_matrix(),
+                                 camera.version(), models);
+  EXPECT_EQ(damage.width() * damage.height(), 640 * 480);
+}
+
+TEST(FramePacerTest, StartsFramesRightBeforeTheRefresh) {
+  typedef FramePacer::Clock Clock;
+  const std::chrono::milliseconds period(16);
+  FramePacer frame_pacer(0.016, 0.002, 4);
+  const Clock::time_point start = Clock::now();
+  // Nothing is known before the first present.
+  EXPECT_EQ(frame_pacer.ComputeWaitSeconds(start), 0.0);
+  frame_pacer.BeginFrame(start);
+  frame_pacer.EndFrame(start + std::chrono::milliseconds(4));
+  frame_pacer.FramePresented(start + period);
+  EXPECT_NEAR(frame_pacer.PredictRenderSeconds(), 0.006, 1e-6);
+  // Right after the present, wait for 16 - 6 ms.
+  EXPECT_NEAR(frame_pacer.ComputeWaitSeconds(start + period), 0.010, 1e-6);
+  // Too late for the next refresh: aim for the one after.
+  EXPECT_NEAR(frame_pacer.ComputeWaitSeconds(
+      start + period + std::chrono::milliseconds(12)), 0.014, 1e-6);
+  // A frame that skipped a refresh is a missed deadline.
+  frame_pacer.InputSampled(start + 2 * period);
+  frame_pacer.FramePresented(start + 4 * period);
+  EXPECT_EQ(frame_pacer.stats().num_missed_deadlines, 1);
+  EXPECT_NEAR(frame_pacer.stats().max_latency_seconds, 0.032, 1e-6);
+}
+
+TEST(InputLatencyTrackerTest, MeasuresUpToTheLaterOfSwapAndGpu) {
+  InputLatencyTracker tracker(true, 4, 0.001, 100);
+  tracker.RecordEvent(InputEventType::KEY, 1.000);
+  tracker.RecordEvent(InputEventType::CURSOR_MOTION, 1.004);
+  const int64_t first_frame = tracker.FrameSubmitted();
+  EXPECT_EQ(tracker.num_pending_events(), 0);
+  // A frame without events is not followed.
+  const int64_t second_frame = tracker.FrameSubmitted();
+  EXPECT_EQ(tracker.num_frames_in_flight(), 1);
+  tracker.FrameSwapped(second_frame, 1.030);
+  // The swap returned before the GPU finished the frame.
+  tracker.FrameSwapped(first_frame, 1.016);
+  EXPECT_EQ(tracker.ComputeStats().num_events, 0);
+  tracker.FrameFinishedOnGpu(first_frame, 1.0205);
+  const InputLatencyStats stats = tracker.ComputeStats();
+  EXPECT_EQ(stats.num_events, 2);
+  EXPECT_NEAR(stats.max_seconds, 0.0205, 1e-9);
+  EXPECT_NEAR(stats.average_seconds, 0.0185, 1e-9);
+  const InputEventType key = InputEventType::KEY;
+  EXPECT_EQ(tracker.Histogram(&key)[20], 1);
+  EXPECT_EQ(tracker.Histogram(nullptr)[16], 1);
+  EXPECT_EQ(tracker.num_frames_in_flight(), 0);
+}
+
+TEST(InputLatencyTrackerTest, InjectsSyntheticEventsAtAFixedRate) {
+  InputLatencyTracker tracker(false, 2, 0.001, 100);
+  SyntheticInputInjector injector(100.0);
+  EXPECT_EQ(injector.Poll(0.0, &tracker), 1);
+  EXPECT_EQ(injector.Poll(0.035, &tracker), 3);
+  tracker.FrameSwapped(tracker.FrameSubmitted(), 0.0405);
+  const InputLatencyStats stats = tracker.ComputeStats();
+  EXPECT_EQ(stats.num_events, 4);
+  EXPECT_NEAR(stats.max_seconds, 0.0405, 1e-9);
+  EXPECT_NEAR(stats.p50_seconds, 0.021, 1e-9);
+  // Frames beyond the limit in flight drop their events.
+  for (int i = 0; i < 3; ++i) {
+    tracker.RecordEvent(InputEventType::SCROLL, 0.05);
+    tracker.FrameSubmitted();
+  }
+  EXPECT_EQ(tracker.ComputeStats().num_dropped_events, 1);
+}
+
+TEST(ResolutionScaleControllerTest, ScalesTheResolutionToTheTarget) {
+  // Target 10 ms, scales in [0.5, 1], grows below 8 ms, settles 2 frames.
+  ResolutionScaleController controller(0.010, 0.5, 1.0, 0.2, 2);
+  EXPECT_EQ(controller.scale(), 1.0);
+  // Twice as slow as the middle of the band: shrink by sqrt(2).
+  EXPECT_TRUE(controller.Update(0.018));
+  EXPECT_NEAR(controller.scale(), 1.0 / std::sqrt(2.0), 1e-9);
+  // The frames rendered at the old scale are ignored.
+  EXPECT_FALSE(controller.Update(0.050));
+  EXPECT_FALSE(controller.Update(0.050));
+  // Within the band, the scale holds.
+  EXPECT_FALSE(controller.Update(0.009));
+  EXPECT_NEAR(controller.scale(), 1.0 / std::sqrt(2.0), 1e-9);
+  // Far too slow: clamped to the smallest scale.
+  ResolutionScaleController slow_controller(0.010, 0.5, 1.0, 0.2, 0);
+  EXPECT_TRUE(slow_controller.Update(0.100));
+  EXPECT_EQ(slow_controller.scale(), 0.5);
+  // Far too fast: grows by 10% at most per change.
+  EXPECT_TRUE(slow_controller.Update(0.001));
+  EXPECT_NEAR(slow_controller.scale(), 0.55, 1e-9);
+
+  int width;
+  int height;
+  ComputeScaledSize(640, 480, 0.5, &width, &height);
+  EXPECT_EQ(width, 320);
+  EXPECT_EQ(height, 240);
+}
+
+TEST(ImageWriterTest, ConvertsRgbaToYuv420) {
+  // A 2x2 white block and a 2x2 red block, bottom row first. Little-endian
+  // RGBA bytes.
+  const uint32_t white = 0xFFFFFFFFu;
+  const uint32_t red = 0xFF0000FFu;
+  const std::vector<uint32_t> pixels = {
+    white, white, red, red,
+    white, white, red, red
+  };
+  std::vector<uint8_t> y_plane;
+  std::vector<uint8_t> u_plane;
+  std::vector<uint8_t> v_plane;
+  ConvertRgbaToYuv420(4, 2, 4, pixels.data(), true, &y_plane, &u_plane,
+                      &v_plane);
+  ASSERT_EQ(y_plane.size(), 8u);
+  ASSERT_EQ(u_plane.size(), 2u);
+  EXPECT_EQ(y_plane[0], 255);
+  EXPECT_EQ(y_plane[3], 76);
+  EXPECT_EQ(u_plane[0], 128);
+  EXPECT_EQ(v_plane[0], 128);
+  EXPECT_EQ(u_plane[1], 85);
+  EXPECT_EQ(v_plane[1], 255);
+}
+
+TEST(GlCommandStreamTest, ReadsBackTheRecordedFrames) {
+  const std::string filepath = "gl_command_stream_test.glcap";
+  GlCommandWriter writer;
+  std::string error_info_log;
+  ASSERT_TRUE(writer.Open(filepath, 64, 32, &error_info_log));
+  // Setup, then two frames.
+  const float matrix[2] = {1.5f, -2.0f};
+  writer.BeginCommand(GlOpcode::BUFFER_DATA);
+  writer.WriteUint32(7);
+  writer.WriteInt64(-3);
+  writer.WriteBytes(matrix, sizeof(matrix));
+  writer.EndCommand();
+  for (int frame = 0; frame < 2; ++frame) {
+    writer.BeginFrame();
+    writer.BeginCommand(GlOpcode::CLEAR_DEPTH);
+    writer.WriteDouble(0.25 * frame);
+    writer.EndCommand();
+    writer.BeginCommand(GlOpcode::DRAW_ARRAYS);
+    writer.WriteInt32(frame);
+    writer.EndCommand();
+    writer.EndFrame();
+  }
+  EXPECT_EQ(writer.num_frames(), 2);
+  writer.Close();
+
+  GlCommandReader reader;
+  ASSERT_TRUE(reader.Load(filepath, &error_info_log));
+  std::remove(filepath.c_str());
+  EXPECT_EQ(reader.width(), 64);
+  EXPECT_EQ(reader.height(), 32);
+  ASSERT_EQ(reader.commands().size(), 5u);
+  ASSERT_EQ(reader.frames().size(), 2u);
+  EXPECT_EQ(reader.frames()[1], std::make_pair(3, 5));
+
+  GlArgumentReader setup(reader.commands()[0]);
+  EXPECT_EQ(reader.commands()[0].opcode, GlOpcode::BUFFER_DATA);
+  EXPECT_EQ(setup.ReadUint32(), 7u);
+  EXPECT_EQ(setup.ReadInt64(), -3);
+  uint32_t size;
+  const uint8_t* bytes = setup.ReadBytes(&size);
+  ASSERT_EQ(size, sizeof(matrix));
+  EXPECT_EQ(std::memcmp(bytes, matrix, size), 0);
+  EXPECT_TRUE(setup.ok());
+
+  GlArgumentReader clear(reader.commands()[3]);
+  EXPECT_EQ(clear.ReadDouble(), 0.25);
+  // Reading past the end of the arguments fails.
+  clear.ReadInt32();
+  EXPECT_FALSE(clear.ok());
+}
+
+TEST(GlResourceRegistryTest, AccountsMemoryByOwnerAndReportsLeaks) {
+  GlResourceRegistry registry;
+  registry.Register(GlObjectType::BUFFER, 1, "model", "model.cc:1");
+  registry.SetSize(GlObjectType::BUFFER, 1, 100);
+  // The same name of another type is another object.
+  registry.Register(GlObjectType::TEXTURE, 1, "render_target", "target.cc:2");
+  registry.SetSize(GlObjectType::TEXTURE, 1, 300);
+  registry.Register(GlObjectType::BUFFER, 2, "model", "model.cc:1");
+  registry.SetSize(GlObjectType::BUFFER, 2, 50);
+  registry.Register(GlObjectType::BUFFER, 0, "model", "model.cc:1");
+  EXPECT_EQ(registry.num_live_objects(), 3);
+  EXPECT_EQ(registry.live_bytes(), 450);
+
+  const std::vector<GlResourceUsage> usages = registry.UsageByOwner();
+  ASSERT_EQ(usages.size(), 2u);
+  EXPECT_EQ(usages[0].owner_tag, "render_target");
+  EXPECT_EQ(usages[1].num_objects, 2);
+  EXPECT_EQ(usages[1].num_bytes, 150);
+
+  registry.Unregister(GlObjectType::TEXTURE, 1);
+  registry.Unregister(GlObjectType::BUFFER, 1);
+  EXPECT_EQ(registry.live_bytes(), 50);
+  EXPECT_EQ(registry.peak_bytes(), 450);
+  std::ostringstream leaks;
+  EXPECT_EQ(registry.ReportLeaks(&leaks), 1);
+  EXPECT_NE(leaks.str().find("model.cc:1"), std::string::npos);
+}
+
+TEST(MeshCacheTest, SharesTheMeshesWithTheSameGeometry) {
+  MeshCache mesh_cache;
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  Model first_box(Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero(),
+                  mesh_cache.Get(vertices, kBoxIndices));
+  Model second_box(Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones(),
+                   mesh_cache.Get(vertices, kBoxIndices));
+  EXPECT_EQ(first_box.mesh(), second_box.mesh());
+  std::shared_ptr<Mesh> large_box =
+      mesh_cache.Get(2.0f * vertices, kBoxIndices);
+  EXPECT_NE(large_box, first_box.mesh());
+  EXPECT_EQ(mesh_cache.num_hits(), 1);
+  EXPECT_EQ(mesh_cache.num_misses(), 2);
+  EXPECT_EQ(mesh_cache.num_live_meshes(), 2);
+
+  // The loader only runs on a miss, and an asset with a known geometry
+  // shares its mesh.
+  int num_loads = 0;
+  const MeshCache::GeometryLoader load_box =
+      [&](Eigen::MatrixXf* loaded_vertices, std::vector<GLuint>* indices) {
+        ++num_loads;
+        *loaded_vertices = vertices;
+        *indices = kBoxIndices;
+        return true;
+      };
+  EXPECT_EQ(mesh_cache.GetByAssetId("box", load_box), first_box.mesh());
+  EXPECT_EQ(mesh_cache.GetByAssetId("box", load_box), first_box.mesh());
+  EXPECT_EQ(num_loads, 1);
+
+  // The cache does not keep the meshes alive.
+  const std::weak_ptr<Mesh> large_box_reference = large_box;
+  large_box.reset();
+  EXPECT_TRUE(large_box_reference.expired());
+  EXPECT_EQ(mesh_cache.num_live_meshes(), 1);
+}
+
+TEST(MeshPackTest, ReadsBackTheGeometryOfEveryMesh) {
+  const Eigen::MatrixXf small_vertices =
+      BoxVertices(Eigen::Vector3f::Ones());
+  const Eigen::MatrixXf large_vertices =
+      BoxVertices(Eigen::Vector3f(4.0f, 2.0f, 1.0f));
+  Mesh small_mesh(small_vertices, kBoxIndices);
+  const Mesh large_mesh(large_vertices, kBoxIndices);
+  const std::string filepath = "mesh_pack_test.pack";
+  std::string error_info_log;
+  ASSERT_TRUE(MeshPack::Write(filepath, {&small_mesh, &large_mesh},
+                              &error_info_log));
+  MeshPack mesh_pack;
+  ASSERT_TRUE(mesh_pack.Open(filepath, &error_info_log));
+  std::remove(filepath.c_str());
+  ASSERT_EQ(mesh_pack.num_meshes(), 2);
+
+  // Read out of order, like the evicted meshes come back.
+  Eigen::MatrixXf vertices;
+  std::vector<GLuint> indices;
+  ASSERT_TRUE(mesh_pack.Read(1, &vertices, &indices));
+  EXPECT_TRUE(vertices == large_vertices);
+  EXPECT_EQ(indices, kBoxIndices);
+  ASSERT_TRUE(mesh_pack.Read(0, &vertices, &indices));
+  EXPECT_TRUE(vertices == small_vertices);
+  EXPECT_FALSE(mesh_pack.Read(2, &vertices, &indices));
+
+  // Without the CPU copy, a mesh cannot be written or uploaded, and only its
+  // own geometry restores it.
+  small_mesh.ReleaseCpuGeometry();
+  EXPECT_FALSE(small_mesh.has_cpu_geometry());
+  EXPECT_FALSE(small_mesh.SetIntoGpu());
+  EXPECT_FALSE(small_mesh.is_in_gpu());
+  EXPECT_EQ(small_mesh.num_indices(), static_cast<int>(kBoxIndices.size()));
+  EXPECT_FALSE(MeshPack::Write(filepath, {&small_mesh}, &error_info_log));
+  std::remove(filepath.c_str());
+  EXPECT_FALSE(small_mesh.RestoreCpuGeometry(large_vertices, kBoxIndices));
+  EXPECT_TRUE(small_mesh.RestoreCpuGeometry(vertices, indices));
+  EXPECT_TRUE(small_mesh.has_cpu_geometry());
+}
+
+// The counts of a corrupt pack are checked against the size of the file
+// before they size anything.
+TEST(MeshPackTest, RejectsCorruptPacks) {
+  const Mesh mesh(BoxVertices(Eigen::Vector3f::Ones()), kBoxIndices);
+  const std::string filepath = "corrupt_mesh_pack_test.pack";
+  std::string error_info_log;
+  ASSERT_TRUE(MeshPack::Write(filepath, {&mesh}, &error_info_log));
+  std::string bytes;
+  {
+    std::ifstream in(filepath, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+  }
+  // The header is 8 bytes of magic and the number of meshes, followed by the
+  // offset, the number of vertices and the number of indices of every mesh.
+  const auto write_corrupt_pack = [&](const size_t position,
+                                      const uint32_t value) {
+    std::string corrupt_bytes = bytes;
+    std::memcpy(&corrupt_bytes[position], &value, sizeof(value));
+    std::ofstream out(filepath, std::ios::binary);
+    out.write(corrupt_bytes.data(), corrupt_bytes.size());
+  };
+  MeshPack mesh_pack;
+  write_corrupt_pack(8, 0xffffffffu);
+  EXPECT_FALSE(mesh_pack.Open(filepath, &error_info_log));
+  EXPECT_NE(error_info_log.find("truncated"), std::string::npos);
+  write_corrupt_pack(20, 0x40000000u);
+  EXPECT_FALSE(mesh_pack.Open(filepath, &error_info_log));
+  EXPECT_EQ(mesh_pack.num_meshes(), 0);
+  write_corrupt_pack(8, 1u);
+  EXPECT_TRUE(mesh_pack.Open(filepath, &error_info_log));
+  std::remove(filepath.c_str());
+}
+
+#ifdef WVU_ENABLE_GL_HOOKS
+// The hooks count the calls without a context, so the budgets of the
+// renderer can be checked without a GPU. The fixture turns the forwarding
+// back on and deletes the files of the test even when an assertion fails.
+class GlHooksWithoutDriverTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    gl_hooks::SetForwardToDriver(false);
+  }
+
+  void TearDown() override {
+    gl_hooks::SetFakeQueryResult(true, 1);
+    gl_hooks::PolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    gl_hooks::SetForwardToDriver(true);
+    for (const std::string& filepath : temp_filepaths_) {
+      std::remove(filepath.c_str());
+    }
+  }
+
+  // Returns the path of a file that is deleted after the test.
+  std::string TempFilepath(const std::string& filename) {
+    temp_filepaths_.push_back(filename);
+    return filename;
+  }
+
+ private:
+  std::vector<std::string> temp_filepaths_;
+};
+
+TEST_F(GlHooksWithoutDriverTest, CountsTheCallsOfTheModels) {
+  constexpr int kNumModels = 100;
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  GlCallCounters upload_counters;
+  GlCallCounters draw_counters;
+  const int64_t live_bytes = GlResourceRegistry::Instance()->live_bytes();
+  for (int i = 0; i < kNumModels; ++i) {
+    Model model(Eigen::Vector3f::Zero(), Eigen::Vector3f(i, 0, 0), vertices,
+                kBoxIndices);
+    gl_hooks::ResetCallCounters();
+    model.SetVerticesIntoGpu();
+    upload_counters.Add(gl_hooks::GetCallCounters());
+    gl_hooks::ResetCallCounters();
+    model.Draw(shader_program, identity, identity);
+    draw_counters.Add(gl_hooks::GetCallCounters());
+  }
+  // The models deleted their buffers.
+  EXPECT_EQ(GlResourceRegistry::Instance()->live_bytes(), live_bytes);
+
+  // A vertex and an element buffer per model, uploaded once.
+  EXPECT_EQ(upload_counters.num_buffers_created, 2 * kNumModels);
+  const int64_t model_size =
+      vertices.size() * sizeof(float) + kBoxIndices.size() * sizeof(GLuint);
+  EXPECT_EQ(upload_counters.num_bytes_uploaded, kNumModels * model_size);
+  EXPECT_EQ(upload_counters.num_draw_calls(), 0);
+  // At most one draw call and two vertex array binds per model.
+  EXPECT_LE(draw_counters.num_draw_calls(), kNumModels);
+  EXPECT_LE(draw_counters.num_binds(), 2 * kNumModels);
+  EXPECT_EQ(draw_counters.num_bytes_uploaded, 0);
+  EXPECT_EQ(draw_counters.num_textures_created, 0);
+}
+
+// The queries follow the visibility of the previous frames, and the models
+// that are no longer rendered are forgotten.
+TEST_F(GlHooksWithoutDriverTest, QueriesTheModelsHiddenInThePreviousFrame) {
+  constexpr int kNumModels = 4;
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  std::vector<std::unique_ptr<Model>> models;
+  std::vector<Model*> models_to_render;
+  for (int i = 0; i < kNumModels; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f(i, 0, -5), vertices,
+                                  kBoxIndices));
+    models.back()->SetVerticesIntoGpu();
+    models_to_render.push_back(models.back().get());
+  }
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f projection = ComputePerspectiveProjectionMatrix(
+      ConvertDegreesToRadians(45.0f), 1.0f, 0.1f, 100.0f);
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  // The visible models are queried every frame. The box shader needs the
+  // driver, so the culler is not initialized.
+  HardwareOcclusionCuller occlusion_culler(1);
+  const HardwareOcclusionStats& stats = occlusion_culler.stats();
+  glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+  // The new models are visible, and the wireframes fill the depth buffer.
+  gl_hooks::ResetCallCounters();
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                models_to_render);
+  EXPECT_EQ(stats.num_visible_draws, kNumModels);
+  EXPECT_EQ(stats.num_geometry_queries, kNumModels);
+  EXPECT_EQ(stats.num_depth_fill_models, kNumModels);
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_calls_of(GlOpcode::BEGIN_QUERY),
+            kNumModels);
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_draw_calls(), 2 * kNumModels);
+
+  // No sample passed, so their boxes are queried and they are drawn on the
+  // results of those queries.
+  gl_hooks::SetFakeQueryResult(true, 0);
+  gl_hooks::ResetCallCounters();
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                models_to_render);
+  EXPECT_EQ(stats.num_visible_draws, 0);
+  EXPECT_EQ(stats.num_box_queries, kNumModels);
+  EXPECT_EQ(stats.num_conditional_draws, kNumModels);
+  EXPECT_EQ(stats.num_depth_fill_models, 0);
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_calls_of(
+      GlOpcode::BEGIN_CONDITIONAL_RENDER), kNumModels);
+
+  // The results are not ready, so the pending queries are not issued again.
+  gl_hooks::SetFakeQueryResult(false, 0);
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                models_to_render);
+  EXPECT_EQ(stats.num_pending_results, kNumModels);
+  EXPECT_EQ(stats.num_box_queries, 0);
+  EXPECT_EQ(stats.num_conditional_draws, kNumModels);
+
+  // Visible again.
+  gl_hooks::SetFakeQueryResult(true, 1);
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                models_to_render);
+  EXPECT_EQ(stats.num_visible_draws, kNumModels);
+  EXPECT_EQ(stats.num_geometry_queries, kNumModels);
+
+  // The queries of the models that are not rendered are deleted.
+  const std::vector<Model*> first_model(1, models[0].get());
+  gl_hooks::ResetCallCounters();
+  for (int frame = 0; frame < 2 * 64; ++frame) {
+    occlusion_culler.RenderModels(shader_program, projection, identity,
+                                  first_model);
+  }
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_calls_of(
+      GlOpcode::DELETE_QUERIES), kNumModels - 1);
+  gl_hooks::ResetCallCounters();
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                models_to_render);
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_calls_of(GlOpcode::GEN_QUERIES),
+            kNumModels - 1);
+  EXPECT_EQ(stats.num_visible_draws, kNumModels);
+  EXPECT_EQ(stats.num_depth_fill_models, 0);
+
+  // A model created where a hidden one was deleted does not inherit its
+  // visibility, so it is drawn without a query.
+  gl_hooks::SetFakeQueryResult(true, 0);
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                first_model);
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                first_model);
+  EXPECT_EQ(stats.num_conditional_draws, 1);
+  Model* address = models[0].get();
+  address->~Model();
+  new (address) Model(Eigen::Vector3f::Zero(), Eigen::Vector3f(0, 0, -5),
+                      vertices, kBoxIndices);
+  address->SetVerticesIntoGpu();
+  occlusion_culler.RenderModels(shader_program, projection, identity,
+                                first_model);
+  EXPECT_EQ(stats.num_visible_draws, 1);
+  EXPECT_EQ(stats.num_box_queries, 0);
+  EXPECT_EQ(stats.num_conditional_draws, 0);
+}
+
+// The subsystems register their objects, so their memory is accounted for.
+TEST_F(GlHooksWithoutDriverTest, RegistryAccountsTheCameraUniformBuffer) {
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  const int64_t live_bytes = registry->live_bytes();
+  {
+    CameraUniformBuffer camera_uniform_buffer;
+    std::string error_info_log;
+    ASSERT_TRUE(camera_uniform_buffer.Initialize(&error_info_log));
+    EXPECT_EQ(registry->live_bytes(),
+              live_bytes + static_cast<int64_t>(2 * 16 * sizeof(float)));
+    bool has_owner = false;
+    for (const GlResourceUsage& usage : registry->UsageByOwner()) {
+      has_owner |= usage.owner_tag == "camera_uniform_buffer";
+    }
+    EXPECT_TRUE(has_owner);
+  }
+  EXPECT_EQ(registry->live_bytes(), live_bytes);
+}
+
+TEST_F(GlHooksWithoutDriverTest, EvictsTheLeastRecentlyVisibleModels) {
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  std::vector<std::unique_ptr<Model>> models;
+  for (int i = 0; i < 4; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f(i, 0, 0), vertices,
+                                  kBoxIndices));
+  }
+  const std::string filepath = TempFilepath("residency_test.pack");
+  std::string error_info_log;
+  ASSERT_TRUE(MeshPack::Write(filepath,
+                              {models[0]->mesh().get(),
+                               models[1]->mesh().get(),
+                               models[2]->mesh().get(),
+                               models[3]->mesh().get()},
+                              &error_info_log));
+  MeshPack mesh_pack;
+  ASSERT_TRUE(mesh_pack.Open(filepath, &error_info_log));
+  std::remove(filepath.c_str());
+
+  // Room for two meshes.
+  const int64_t mesh_size = models[0]->mesh()->gpu_size_in_bytes();
+  ModelResidencyManager residency(2 * mesh_size, true, &mesh_pack);
+  for (int i = 0; i < 4; ++i) {
+    residency.AddMesh(models[i]->mesh().get(), i);
+  }
+  std::vector<Model*> visible = {models[0].get(), models[1].get()};
+  residency.MakeResident(&visible);
+  EXPECT_EQ(visible.size(), 2u);
+  EXPECT_FALSE(models[0]->mesh()->has_cpu_geometry());
+  visible = {models[1].get()};
+  residency.MakeResident(&visible);
+  // Model 0 is the least recently visible one.
+  visible = {models[2].get()};
+  residency.MakeResident(&visible);
+  EXPECT_FALSE(models[0]->mesh()->is_in_gpu());
+  EXPECT_TRUE(models[1]->mesh()->is_in_gpu());
+  EXPECT_EQ(residency.resident_bytes(), 2 * mesh_size);
+
+  // Model 0 comes back from the pack, once for the two models with its mesh.
+  models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                Eigen::Vector3f::Ones(), models[0]->mesh()));
+  visible = {models[0].get(), models[4].get()};
+  residency.MakeResident(&visible);
+  EXPECT_EQ(visible.size(), 2u);
+  EXPECT_TRUE(models[0]->mesh()->is_in_gpu());
+  EXPECT_FALSE(models[1]->mesh()->is_in_gpu());
+  // The visible models stay even over the budget.
+  visible = {models[0].get(), models[2].get(), models[3].get()};
+  residency.MakeResident(&visible);
+  EXPECT_EQ(residency.num_resident_meshes(), 3);
+
+  const ResidencyStats& stats = residency.stats();
+  EXPECT_EQ(stats.num_hits, 3);
+  EXPECT_EQ(stats.num_misses, 5);
+  EXPECT_EQ(stats.num_evictions, 2);
+  EXPECT_EQ(stats.num_pack_reads, 1);
+  EXPECT_EQ(stats.num_bytes_uploaded, 5 * mesh_size);
+  EXPECT_EQ(stats.num_frames_over_budget, 1);
+  models.clear();
+}
+
+TEST_F(GlHooksWithoutDriverTest, UploadsASharedMeshOnce) {
+  constexpr int kNumModels = 100;
+  MeshCache mesh_cache;
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  std::vector<std::unique_ptr<Model>> models;
+  gl_hooks::ResetCallCounters();
+  for (int i = 0; i < kNumModels; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f(i, 0, 0),
+                                  mesh_cache.Get(vertices, kBoxIndices)));
+    models.back()->SetVerticesIntoGpu();
+  }
+  const GlCallCounters& counters = gl_hooks::GetCallCounters();
+  EXPECT_EQ(counters.num_buffers_created, 2);
+  EXPECT_EQ(counters.num_bytes_uploaded,
+            models[0]->mesh()->gpu_size_in_bytes());
+  EXPECT_EQ(mesh_cache.num_live_meshes(), 1);
+  models.clear();
+}
+
+// A thousand static props are drawn with a handful of draw calls.
+TEST_F(GlHooksWithoutDriverTest, BatchesManyStaticModelsIntoFewDrawCalls) {
+  constexpr int kGridSize = 10;
+  MeshCache mesh_cache;
+  const Eigen::MatrixXf vertices =
+      BoxVertices(Eigen::Vector3f::Constant(0.1f));
+  std::vector<std::unique_ptr<Model>> models;
+  for (int i = 0; i < kGridSize * kGridSize * kGridSize; ++i) {
+    const Eigen::Vector3f position(
+        0.5f * (i % kGridSize) - 2.25f,
+        0.5f * (i / kGridSize % kGridSize) - 2.25f,
+        -0.5f * (i / (kGridSize * kGridSize)) - 5.0f);
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(), position,
+                                  mesh_cache.Get(vertices, kBoxIndices)));
+  }
+  Camera camera;
+  camera.SetPerspective(ConvertDegreesToRadians(90.0f), 1.0f, 0.1f, 50.0f);
+  const ShaderProgram shader_program;
+  ThreadPool thread_pool(4);
+  {
+    // The models span 2x2x1 cells of the grid.
+    StaticBatcher static_batcher(10.0f, &thread_pool);
+    for (const std::unique_ptr<Model>& model : models) {
+      static_batcher.AddModel(model.get(), 0);
+    }
+    static_batcher.Update();
+    EXPECT_EQ(static_batcher.num_models(), 1000);
+    EXPECT_EQ(static_batcher.num_chunks(), 4);
+    EXPECT_EQ(static_batcher.stats().num_bytes_uploaded,
+              1000 * models[0]->mesh()->gpu_size_in_bytes());
+
+    gl_hooks::ResetCallCounters();
+    static_batcher.Draw(0, shader_program, camera);
+    const GlCallCounters& counters = gl_hooks::GetCallCounters();
+    EXPECT_LE(counters.num_draw_calls(), 5);
+    EXPECT_EQ(counters.num_draw_calls(), static_batcher.stats().num_draw_calls);
+    EXPECT_EQ(counters.num_bytes_uploaded, 0);
+
+    // Removing or adding a model only rebuilds its chunk.
+    static_batcher.ResetStats();
+    EXPECT_TRUE(static_batcher.RemoveModel(models[0].get()));
+    EXPECT_FALSE(static_batcher.RemoveModel(models[0].get()));
+    static_batcher.Update();
+    EXPECT_EQ(static_batcher.stats().num_rebuilt_chunks, 1);
+    static_batcher.AddModel(models[0].get(), 0);
+    static_batcher.Update();
+    EXPECT_EQ(static_batcher.stats().num_rebuilt_chunks, 2);
+    static_batcher.Update();
+    EXPECT_EQ(static_batcher.stats().num_rebuilt_chunks, 2);
+  }
+}
+
+TEST_F(GlHooksWithoutDriverTest, StreamsTheSmallModelsIntoOneDraw) {
+  constexpr int kNumModels = 100;
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  std::vector<std::unique_ptr<Model>> models;
+  std::vector<Model*> visible_models;
+  for (int i = 0; i < kNumModels; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f(0.0f, 0.1f * i, 0.0f),
+                                  Eigen::Vector3f(i, 0, 0), vertices,
+                                  kBoxIndices));
+    visible_models.push_back(models.back().get());
+  }
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  ThreadPool thread_pool(4);
+  {
+    // The boxes have 36 vertices in their triangle lists.
+    DynamicBatcher dynamic_batcher(36, 36 * kNumModels, &thread_pool);
+    std::string error_info_log;
+    ASSERT_TRUE(dynamic_batcher.Initialize(&error_info_log));
+    gl_hooks::ResetCallCounters();
+    dynamic_batcher.Draw(shader_program, identity, identity, visible_models);
+    const GlCallCounters& counters = gl_hooks::GetCallCounters();
+    EXPECT_EQ(counters.num_draw_calls(), 1);
+    EXPECT_EQ(counters.num_bytes_uploaded,
+              kNumModels * 36 * 3 * static_cast<int64_t>(sizeof(float)));
+    EXPECT_EQ(dynamic_batcher.stats().num_batched_models, kNumModels);
+    EXPECT_EQ(dynamic_batcher.stats().num_individual_draws, 0);
+  }
+  {
+    // The models beyond the capacity, or too large, are drawn one by one.
+    DynamicBatcher dynamic_batcher(36, 36 * 10, &thread_pool);
+    std::string error_info_log;
+    ASSERT_TRUE(dynamic_batcher.Initialize(&error_info_log));
+    gl_hooks::ResetCallCounters();
+    dynamic_batcher.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_draw_calls(),
+              1 + kNumModels - 10);
+    DynamicBatcher no_batcher(35, 36 * kNumModels, &thread_pool);
+    ASSERT_TRUE(no_batcher.Initialize(&error_info_log));
+    no_batcher.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(no_batcher.stats().num_batch_draws, 0);
+    EXPECT_EQ(no_batcher.stats().num_individual_draws, kNumModels);
+  }
+}
+
+// The depth pre-pass and the shading pass of a frame draw the same batch, and
+// the next frame streams it again.
+TEST_F(GlHooksWithoutDriverTest, DrawsOfAFrameShareTheDynamicBatch) {
+  constexpr int kNumModels = 10;
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  std::vector<std::unique_ptr<Model>> models;
+  std::vector<Model*> visible_models;
+  for (int i = 0; i < kNumModels; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f(i, 0, 0), vertices,
+                                  kBoxIndices));
+    visible_models.push_back(models.back().get());
+  }
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  const int64_t batch_bytes =
+      kNumModels * 36 * 3 * static_cast<int64_t>(sizeof(float));
+  ThreadPool thread_pool(4);
+  {
+    DynamicBatcher dynamic_batcher(36, 36 * kNumModels, &thread_pool);
+    std::string error_info_log;
+    ASSERT_TRUE(dynamic_batcher.Initialize(&error_info_log));
+    dynamic_batcher.BeginFrame();
+    gl_hooks::ResetCallCounters();
+    dynamic_batcher.Draw(shader_program, identity, identity, visible_models);
+    dynamic_batcher.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_draw_calls(), 2);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded, batch_bytes);
+    EXPECT_EQ(dynamic_batcher.stats().num_batched_models, 2 * kNumModels);
+    // The other models of the frame do not fit in the rest of its region.
+    const std::vector<Model*> first_model(1, visible_models[0]);
+    dynamic_batcher.Draw(shader_program, identity, identity, first_model);
+    EXPECT_EQ(dynamic_batcher.stats().num_individual_draws, 1);
+    dynamic_batcher.BeginFrame();
+    gl_hooks::ResetCallCounters();
+    dynamic_batcher.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded, batch_bytes);
+  }
+}
+
+TEST_F(GlHooksWithoutDriverTest, PullsTheVerticesOfDifferentMeshesInOneDraw) {
+  constexpr int kNumModels = 10;
+  // Indexed boxes of two sizes and an unindexed triangle.
+  Eigen::MatrixXf triangle(3, 3);
+  triangle << 0, 1, 0,
+              0, 0, 1,
+              0, 0, 0;
+  const std::vector<std::shared_ptr<Mesh>> meshes = {
+    std::make_shared<Mesh>(BoxVertices(Eigen::Vector3f::Ones()), kBoxIndices),
+    std::make_shared<Mesh>(BoxVertices(Eigen::Vector3f::Constant(2.0f)),
+                           kBoxIndices),
+    std::make_shared<Mesh>(triangle, std::vector<GLuint>())
+  };
+  std::vector<std::unique_ptr<Model>> models;
+  std::vector<Model*> visible_models;
+  for (int i = 0; i < kNumModels; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f(i, 0, 0), meshes[i % 3]));
+    visible_models.push_back(models.back().get());
+  }
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  const int64_t table_bytes = kNumModels * 5 * sizeof(GLint);
+  const int64_t matrix_bytes = 16 * sizeof(GLfloat);
+  {
+    TransformBuffer transform_buffer(1 << 16);
+    VertexPullingRenderer renderer(1 << 16, &transform_buffer);
+    std::string error_info_log;
+    ASSERT_TRUE(transform_buffer.Initialize(&error_info_log));
+    ASSERT_TRUE(renderer.Initialize(&error_info_log));
+    gl_hooks::ResetCallCounters();
+    renderer.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_draw_calls(), 1);
+    EXPECT_EQ(renderer.num_meshes(), 3);
+    EXPECT_EQ(renderer.stats().num_pulled_models, kNumModels);
+    EXPECT_EQ(renderer.stats().num_pulled_vertices, 7 * 36 + 3 * 3);
+    // The arenas are uploaded once, the draw table every frame, and the
+    // model matrices when the models move.
+    const int64_t arena_bytes = (2 * 8 + 3) * 3 * sizeof(GLfloat) +
+        2 * 36 * sizeof(GLuint);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded,
+              arena_bytes + table_bytes + kNumModels * matrix_bytes);
+    gl_hooks::ResetCallCounters();
+    renderer.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded, table_bytes);
+    models[3]->set_position(Eigen::Vector3f(0, 1, 0));
+    gl_hooks::ResetCallCounters();
+    renderer.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded,
+              table_bytes + matrix_bytes);
+  }
+  {
+    // The larger box does not fit in the arenas, so its models are skipped.
+    TransformBuffer transform_buffer(1 << 16);
+    VertexPullingRenderer renderer(36, &transform_buffer);
+    std::string error_info_log;
+    ASSERT_TRUE(transform_buffer.Initialize(&error_info_log));
+    ASSERT_TRUE(renderer.Initialize(&error_info_log));
+    renderer.Draw(shader_program, identity, identity, visible_models);
+    EXPECT_EQ(renderer.num_meshes(), 2);
+    EXPECT_EQ(renderer.stats().num_pulled_models, 7);
+    EXPECT_EQ(renderer.stats().num_skipped_models, 3);
+  }
+}
+
+// The records are not mistaken for the ones of new meshes, and the arenas do
+// not keep the geometry of the deleted meshes.
+TEST_F(GlHooksWithoutDriverTest, DropsTheGeometryOfDeletedMeshes) {
+  Eigen::MatrixXf triangle(3, 3);
+  triangle << 0, 1, 0,
+              0, 0, 1,
+              0, 0, 0;
+  std::shared_ptr<Mesh> box_mesh =
+      std::make_shared<Mesh>(BoxVertices(Eigen::Vector3f::Ones()),
+                             kBoxIndices);
+  std::unique_ptr<Model> box(new Model(Eigen::Vector3f::Zero(),
+                                       Eigen::Vector3f::Zero(), box_mesh));
+  Model triangle_model(Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones(),
+                       std::make_shared<Mesh>(triangle,
+                                              std::vector<GLuint>()));
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  TransformBuffer transform_buffer(1 << 16);
+  VertexPullingRenderer renderer(1 << 16, &transform_buffer);
+  std::string error_info_log;
+  ASSERT_TRUE(transform_buffer.Initialize(&error_info_log));
+  ASSERT_TRUE(renderer.Initialize(&error_info_log));
+  renderer.Draw(shader_program, identity, identity,
+                { box.get(), &triangle_model });
+  EXPECT_EQ(renderer.num_meshes(), 2);
+  EXPECT_EQ(renderer.vertex_arena_size(), (8 + 3) * 3);
+  EXPECT_EQ(renderer.index_arena_size(), 36);
+
+  // Deleting the box leaves most of the arenas unused, so they are
+  // compacted and uploaded again.
+  transform_buffer.Remove(box.get());
+  box.reset();
+  box_mesh.reset();
+  renderer.ResetStats();
+  renderer.Draw(shader_program, identity, identity, { &triangle_model });
+  EXPECT_EQ(renderer.num_meshes(), 1);
+  EXPECT_EQ(renderer.vertex_arena_size(), 3 * 3);
+  EXPECT_EQ(renderer.index_arena_size(), 0);
+  EXPECT_EQ(renderer.stats().num_pulled_vertices, 3);
+  // The compacted vertex arena, the empty index arena, and the draw table of
+  // one model (four record entries and a transform handle).
+  EXPECT_EQ(renderer.stats().num_bytes_uploaded,
+            3 * 3 * static_cast<int64_t>(sizeof(GLfloat)) +
+            5 * static_cast<int64_t>(sizeof(GLint)));
+}
+
+// A mesh that does not fit compacts the arenas in the middle of a frame, so
+// the meshes added before it move.
+TEST_F(GlHooksWithoutDriverTest, DrawsTheMovedMeshesAfterACompaction) {
+  Eigen::MatrixXf triangle(3, 3);
+  triangle << 0, 1, 0,
+              0, 0, 1,
+              0, 0, 0;
+  std::vector<std::shared_ptr<Mesh>> meshes = {
+    std::make_shared<Mesh>(triangle, std::vector<GLuint>()),
+    std::make_shared<Mesh>(BoxVertices(Eigen::Vector3f::Ones()), kBoxIndices),
+    std::make_shared<Mesh>(BoxVertices(Eigen::Vector3f::Constant(2.0f)),
+                           kBoxIndices),
+    std::make_shared<Mesh>(BoxVertices(Eigen::Vector3f::Constant(3.0f)),
+                           kBoxIndices)
+  };
+  std::vector<std::unique_ptr<Model>> models;
+  for (const std::shared_ptr<Mesh>& mesh : meshes) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f::Zero(), mesh));
+  }
+  const ShaderProgram shader_program;
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  TransformBuffer transform_buffer(1 << 16);
+  VertexPullingRenderer renderer(80, &transform_buffer);
+  std::string error_info_log;
+  ASSERT_TRUE(transform_buffer.Initialize(&error_info_log));
+  ASSERT_TRUE(renderer.Initialize(&error_info_log));
+  renderer.Draw(shader_program, identity, identity,
+                { models[0].get(), models[1].get(), models[2].get() });
+  EXPECT_EQ(renderer.vertex_arena_size(), (3 + 8 + 8) * 3);
+
+  // The first box leaves less than half of the arenas unused, so they are
+  // compacted only when the last box does not fit.
+  transform_buffer.Remove(models[1].get());
+  models[1].reset();
+  meshes[1].reset();
+  const std::vector<Model*> drawn_models =
+      { models[2].get(), models[3].get(), models[0].get() };
+  renderer.ResetStats();
+  renderer.Draw(shader_program, identity, identity, drawn_models);
+  EXPECT_EQ(renderer.num_meshes(), 3);
+  EXPECT_EQ(renderer.stats().num_skipped_models, 0);
+  EXPECT_EQ(renderer.vertex_arena_size(), (3 + 8 + 8) * 3);
+  EXPECT_EQ(renderer.index_arena_size(), 2 * 36);
+
+  // Every record of the draw table points at the geometry of its model.
+  const std::vector<GLint>& draw_records = renderer.draw_records();
+  ASSERT_EQ(draw_records.size(), 4 * drawn_models.size());
+  for (int i = 0; i < static_cast<int>(drawn_models.size()); ++i) {
+    const Mesh& mesh = *drawn_models[i]->mesh();
+    const int first_index = draw_records[4 * i + 1];
+    const int first_float = draw_records[4 * i + 2];
+    const int stride = draw_records[4 * i + 3];
+    for (int vertex = 0; vertex < mesh.num_vertices(); ++vertex) {
+      for (int axis = 0; axis < 3; ++axis) {
+        EXPECT_EQ(renderer.vertex_arena()[first_float + vertex * stride + axis],
+                  mesh.vertices()(axis, vertex));
+      }
+    }
+    if (mesh.num_indices() == 0) {
+      EXPECT_EQ(first_index, -1);
+      continue;
+    }
+    ASSERT_GE(first_index, 0);
+    for (int j = 0; j < mesh.num_indices(); ++j) {
+      EXPECT_EQ(renderer.index_arena()[first_index + j], mesh.indices()[j]);
+    }
+  }
+}
+
+TEST_F(GlHooksWithoutDriverTest, TransformBufferUploadsOnlyTheMovedModels) {
+  constexpr int kNumModels = 300;
+  const int64_t matrix_bytes = 16 * sizeof(GLfloat);
+  const Eigen::MatrixXf vertices = BoxVertices(Eigen::Vector3f::Ones());
+  std::vector<std::unique_ptr<Model>> models;
+  TransformBuffer transform_buffer(1 << 16);
+  std::string error_info_log;
+  ASSERT_TRUE(transform_buffer.Initialize(&error_info_log));
+  for (int i = 0; i < kNumModels; ++i) {
+    models.emplace_back(new Model(Eigen::Vector3f::Zero(),
+                                  Eigen::Vector3f(i, 0, 0), vertices,
+                                  kBoxIndices));
+    EXPECT_EQ(transform_buffer.Add(models.back().get()), i);
+  }
+  // The first update grows the buffer and uploads every matrix.
+  gl_hooks::ResetCallCounters();
+  transform_buffer.Update();
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded,
+            kNumModels * matrix_bytes);
+  EXPECT_EQ(transform_buffer.stats().num_changed_matrices, kNumModels);
+  // Nothing moved.
+  transform_buffer.ResetStats();
+  gl_hooks::ResetCallCounters();
+  transform_buffer.Update();
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded, 0);
+  // Two nearby models share a range; a distant one gets its own.
+  models[10]->set_position(Eigen::Vector3f::Ones());
+  models[12]->set_orientation(Eigen::Vector3f::Ones());
+  models[200]->set_position(Eigen::Vector3f::Ones());
+  gl_hooks::ResetCallCounters();
+  transform_buffer.Update();
+  EXPECT_EQ(transform_buffer.stats().num_changed_matrices, 3);
+  EXPECT_EQ(transform_buffer.stats().num_upload_ranges, 2);
+  EXPECT_EQ(gl_hooks::GetCallCounters().num_bytes_uploaded, 4 * matrix_bytes);
+  // A removed model gives its handle to the next one.
+  transform_buffer.Remove(models[5].get());
+  EXPECT_EQ(transform_buffer.handle(models[5].get()), -1);
+  EXPECT_EQ(transform_buffer.Add(models[5].get()), 5);
+}
+#endif  // WVU_ENABLE_GL_HOOKS
+
 }  // namespace wvu
@@ -0,0 +1,292 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "camera.h"
+
+#define _USE_MATH_DEFINES  // For using M_PI.
+#include <cmath>
+#include <limits>
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+#include "camera_utils.h"
+#include "transformations.h"
+
+namespace wvu {
+namespace {
+// Normalizes a plane so that its normal has unit length. A plane without
+// normal either accepts every point or none; keep it as a constant.
+Eigen::Vector4f NormalizePlane(const Eigen::Vector4f& plane) {
+  const float normal_norm = plane.head<3>().norm();
+  if (normal_norm < 1e-12f) {
+    return Eigen::Vector4f(0.0f, 0.0f, 0.0f, plane[3] >= 0.0f ? 1.0f : -1.0f);
+  }
+  return plane / normal_norm;
+}
+
+// Maps a point in normalized device coordinates to the world.
+Eigen::Vector3f UnprojectPoint(const Eigen::Matrix4f& inverse_view_projection,
+                               const Eigen::Vector3f& ndc) {
+  const Eigen::Vector4f point =
+      inverse_view_projection * Eigen::Vector4f(ndc.x(), ndc.y(), ndc.z(), 1);
+  return point.head<3>() / point[3];
+}
+
+}  // namespace
+
+Camera::Camera()
+    : orientation_(Eigen::Vector3f::Zero()),
+      position_(Eigen::Vector3f::Zero()),
+      version_(0),
+      view_dirty_(true),
+      projection_dirty_(true),
+      view_projection_dirty_(true) {
+  SetPerspective(0.25f * static_cast<float>(M_PI), 4.0f / 3.0f, 0.1f, 10.0f);
+}
+
+void Camera::SetPerspective(const float field_of_view,
+                            const float aspect_ratio,
+                            const float near,
+                            const float far) {
+  projection_type_ = ProjectionType::PERSPECTIVE;
+  field_of_view_ = field_of_view;
+  orthographic_height_ = 0.0f;
+  aspect_ratio_ = aspect_ratio;
+  near_ = near;
+  far_ = far;
+  projection_dirty_ = true;
+  ++version_;
+}
+
+void Camera::SetOrthographic(const float height,
+                             const float aspect_ratio,
+                             const float near,
+                             const float far) {
+  projection_type_ = ProjectionType::ORTHOGRAPHIC;
+  field_of_view_ = 0.0f;
+  orthographic_height_ = height;
+  aspect_ratio_ = aspect_ratio;
+  near_ = near;
+  far_ = far;
+  projection_dirty_ = true;
+  ++version_;
+}
+
+void Camera::SetReverseZInfinitePerspective(const float field_of_view,
+                                            const float aspect_ratio,
+                                            const float near) {
+  projection_type_ = ProjectionType::REVERSE_Z_INFINITE_PERSPECTIVE;
+  field_of_view_ = field_of_view;
+  orthographic_height_ = 0.0f;
+  aspect_ratio_ = aspect_ratio;
+  near_ = near;
+  far_ = std::numeric_limits<float>::infinity();
+  projection_dirty_ = true;
+  ++version_;
+}
+
+void Camera::set_aspect_ratio(const float aspect_ratio) {
+  aspect_ratio_ = aspect_ratio;
+  projection_dirty_ = true;
+  ++version_;
+}
+
+void Camera::set_orientation(const Eigen::Vector3f& orientation) {
+  orientation_ = orientation;
+  view_dirty_ = true;
+  ++version_;
+}
+
+void Camera::set_position(const Eigen::Vector3f& position) {
+  position_ = position;
+  view_dirty_ = true;
+  ++version_;
+}
+
+const Eigen::Matrix4f& Camera::view_matrix() const {
+  UpdateView();
+  return view_;
+}
+
+const Eigen::Matrix4f& Camera::inverse_view_matrix() const {
+  UpdateView();
+  return inverse_view_;
+}
+
+const Eigen::Matrix4f& Camera::projection_matrix() const {
+  UpdateProjection();
+  return projection_;
+}
+
+const Eigen::Matrix4f& Camera::inverse_projection_matrix() const {
+  UpdateProjection();
+  return inverse_projection_;
+}
+
+const Eigen::Matrix4f& Camera::view_projection_matrix() const {
+  UpdateViewProjection();
+  return view_projection_;
+}
+
+const Eigen::Matrix4f& Camera::inverse_view_projection_matrix() const {
+  UpdateViewProjection();
+  return inverse_view_projection_;
+}
+
+const Eigen::Matrix<float, 6, 4>& Camera::frustum_planes() const {
+  UpdateViewProjection();
+  return frustum_planes_;
+}
+
+bool Camera::IsBoxInFrustum(const Eigen::Matrix4f& model,
+                            const Eigen::Vector3f& box_min,
+                            const Eigen::Vector3f& box_max) const {
+  UpdateViewProjection();
+  // Bring the planes to the object frame instead of transforming the eight
+  // corners of the box to the world.
+  const Eigen::Matrix<float, 6, 4> object_planes = frustum_planes_ * model;
+  for (int i = 0; i < 6; ++i) {
+    // The corner of the box farthest along the plane normal.
+    const Eigen::Vector3f normal = object_planes.block<1, 3>(i, 0).transpose();
+    const Eigen::Vector3f corner(
+        (normal.x() >= 0.0f) ? box_max.x() : box_min.x(),
+        (normal.y() >= 0.0f) ? box_max.y() : box_min.y(),
+        (normal.z() >= 0.0f) ? box_max.z() : box_min.z());
+    if (normal.dot(corner) + object_planes(i, 3) < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Camera::ComputeRay(const Eigen::Vector2f& ndc,
+                        Eigen::Vector3f* origin,
+                        Eigen::Vector3f* direction) const {
+  UpdateViewProjection();
+  // The reverse-Z projection maps the near plane to 1 and infinity to 0.
+  const bool reverse_z =
+      projection_type_ == ProjectionType::REVERSE_Z_INFINITE_PERSPECTIVE;
+  const float near_depth = reverse_z ? 1.0f : -1.0f;
+  const float far_depth = reverse_z ? 0.5f : 1.0f;
+  *origin = UnprojectPoint(inverse_view_projection_,
+                           Eigen::Vector3f(ndc.x(), ndc.y(), near_depth));
+  const Eigen::Vector3f far_point = UnprojectPoint(
+      inverse_view_projection_, Eigen::Vector3f(ndc.x(), ndc.y(), far_depth));
+  *direction = (far_point - *origin).normalized();
+}
+
+float Camera::ComputeViewDepth(const Eigen::Vector3f& point) const {
+  UpdateView();
+  // The camera looks down -z.
+  return -(view_.block<1, 3>(2, 0).dot(point) + view_(2, 3));
+}
+
+void Camera::UpdateView() const {
+  if (!view_dirty_) {
+    return;
+  }
+  // The pose is the camera -> world transformation; the view matrix is its
+  // inverse, which for a rigid transformation only needs a transpose.
+  const float angle = orientation_.norm();
+  inverse_view_ = ComputeTranslationMatrix(position_);
+  if (angle >= 1e-8f) {
+    inverse_view_ =
+        inverse_view_ * ComputeRotationMatrix(orientation_ / angle, angle);
+  }
+  const Eigen::Matrix3f rotation_transpose =
+      inverse_view_.block<3, 3>(0, 0).transpose();
+  view_.setIdentity();
+  view_.block<3, 3>(0, 0) = rotation_transpose;
+  view_.block<3, 1>(0, 3) = -rotation_transpose * position_;
+  view_dirty_ = false;
+  view_projection_dirty_ = true;
+}
+
+void Camera::UpdateProjection() const {
+  if (!projection_dirty_) {
+    return;
+  }
+  switch (projection_type_) {
+    case ProjectionType::PERSPECTIVE:
+      projection_ = ComputePerspectiveProjectionMatrix(
+          field_of_view_, aspect_ratio_, near_, far_);
+      break;
+    case ProjectionType::ORTHOGRAPHIC: {
+      const float half_height = 0.5f * orthographic_height_;
+      const float half_width = aspect_ratio_ * half_height;
+      projection_ = ComputeOrthographicProjectionMatrix(
+          -half_width, half_width, -half_height, half_height, near_, far_);
+      break;
+    }
+    case ProjectionType::REVERSE_Z_INFINITE_PERSPECTIVE:
+      projection_ = ComputeReverseZInfinitePerspectiveProjectionMatrix(
+          field_of_view_, aspect_ratio_, near_);
+      break;
+  }
+  inverse_projection_ = projection_.inverse();
+  projection_dirty_ = false;
+  view_projection_dirty_ = true;
+}
+
+void Camera::UpdateViewProjection() const {
+  UpdateView();
+  UpdateProjection();
+  if (!view_projection_dirty_) {
+    return;
+  }
+  view_projection_ = projection_ * view_;
+  inverse_view_projection_ = inverse_view_ * inverse_projection_;
+  // Extract the planes from the rows of the view-projection matrix: a point
+  // is inside when its clip coordinates satisfy -w <= x, y <= w and the
+  // depth range of the projection.
+  const Eigen::Vector4f row_x = view_projection_.row(0).transpose();
+  const Eigen::Vector4f row_y = view_projection_.row(1).transpose();
+  const Eigen::Vector4f row_z = view_projection_.row(2).transpose();
+  const Eigen::Vector4f row_w = view_projection_.row(3).transpose();
+  frustum_planes_.row(0) = NormalizePlane(row_w + row_x).transpose();
+  frustum_planes_.row(1) = NormalizePlane(row_w - row_x).transpose();
+  frustum_planes_.row(2) = NormalizePlane(row_w + row_y).transpose();
+  frustum_planes_.row(3) = NormalizePlane(row_w - row_y).transpose();
+  if (projection_type_ == ProjectionType::REVERSE_Z_INFINITE_PERSPECTIVE) {
+    // The depth range is 0 <= z <= w with the near plane at z = w.
+    frustum_planes_.row(4) = NormalizePlane(row_w - row_z).transpose();
+    frustum_planes_.row(5) = NormalizePlane(row_z).transpose();
+  } else {
+    frustum_planes_.row(4) = NormalizePlane(row_w + row_z).transpose();
+    frustum_planes_.row(5) = NormalizePlane(row_w - row_z).transpose();
+  }
+  view_projection_dirty_ = false;
+}
+
+}  // namespace wvu
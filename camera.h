@@ -0,0 +1,227 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef CAMERA_H_
+#define CAMERA_H_
+
+#include <cstdint>
+#include <Eigen/Core>
+
+namespace wvu {
+// The projections supported by the camera.
+enum class ProjectionType {
+  // Perspective projection with near and far planes and [-1, 1] clip depth.
+  PERSPECTIVE,
+  // Orthographic projection with [-1, 1] clip depth.
+  ORTHOGRAPHIC,
+  // Perspective projection with an infinitely far plane and reverse-Z. See
+  // ComputeReverseZInfinitePerspectiveProjectionMatrix().
+  REVERSE_Z_INFINITE_PERSPECTIVE
+};
+
+// A camera holding the intrinsics (the projection) and the pose. The derived
+// matrices and frustum planes are computed lazily the first time they are
+// requested after a change, so culling, picking and level-of-detail code can
+// all query them every frame without recomputing them. The getters update
+// the cache, so a camera must not be shared across threads while it changes.
+//
+// Example:
+//
+// wvu::Camera camera;
+// camera.SetPerspective(ConvertDegreesToRadians(45.0f), 4.0f / 3.0f, 0.1f,
+//                       10.0f);
+// camera.set_position(Eigen::Vector3f(0.0f, 0.0f, 5.0f));
+// if (camera.IsBoxInFrustum(model->ComputeModelMatrix(),
+//                           model->bounding_box_min(),
+//                           model->bounding_box_max())) {
+//   model->Draw(shader_program, camera.projection_matrix(),
+//               camera.view_matrix());
+// }
+class Camera {
+ public:
+  // Constructor. Builds a camera at the origin looking down -z with a 45
+  // degrees perspective projection.
+  Camera();
+
+  // Sets a perspective projection.
+  // Params:
+  //   field_of_view  The vertical field of view angle in radians.
+  //   aspect_ratio  The width / height ratio of the window dimensions.
+  //   near  The near distance plane.
+  //   far  The far distance plane.
+  void SetPerspective(const float field_of_view,
+                      const float aspect_ratio,
+                      const float near,
+                      const float far);
+
+  // Sets an orthographic projection centered on the viewing direction.
+  // Params:
+  //   height  The height of the view volume in world units.
+  //   aspect_ratio  The width / height ratio of the window dimensions.
+  //   near  The near distance plane.
+  //   far  The far distance plane.
+  void SetOrthographic(const float height,
+                       const float aspect_ratio,
+                       const float near,
+                       const float far);
+
+  // Sets a reverse-Z perspective projection without far plane.
+  // Params:
+  //   field_of_view  The vertical field of view angle in radians.
+  //   aspect_ratio  The width / height ratio of the window dimensions.
+  //   near  The near distance plane.
+  void SetReverseZInfinitePerspective(const float field_of_view,
+                                      const float aspect_ratio,
+                                      const float near);
+
+  // Changes the aspect ratio and keeps the rest of the intrinsics, e.g., when
+  // the window is resized.
+  void set_aspect_ratio(const float aspect_ratio);
+
+  // Sets the orientation of the camera in the world using the Rodrigues
+  // vector: angle-axis vector where the angle is the norm of the vector.
+  void set_orientation(const Eigen::Vector3f& orientation);
+
+  // Sets the position of the camera in the world.
+  void set_position(const Eigen::Vector3f& position);
+
+  // Getters.
+  ProjectionType projection_type() const {
+    return projection_type_;
+  }
+  float field_of_view() const {
+    return field_of_view_;
+  }
+  float aspect_ratio() const {
+    return aspect_ratio_;
+  }
+  float near_plane() const {
+    return near_;
+  }
+  // Returns infinity for the reverse-Z projection.
+  float far_plane() const {
+    return far_;
+  }
+  const Eigen::Vector3f& orientation() const {
+    return orientation_;
+  }
+  const Eigen::Vector3f& position() const {
+    return position_;
+  }
+  // Returns a counter that changes every time the pose or the intrinsics
+  // change.
+  uint64_t version() const {
+    return version_;
+  }
+
+  // Returns the camera pose matrix (world -> camera transformation matrix).
+  const Eigen::Matrix4f& view_matrix() const;
+  // Returns the camera -> world transformation matrix.
+  const Eigen::Matrix4f& inverse_view_matrix() const;
+  // Returns the camera projection matrix.
+  const Eigen::Matrix4f& projection_matrix() const;
+  const Eigen::Matrix4f& inverse_projection_matrix() const;
+  // Returns projection * view.
+  const Eigen::Matrix4f& view_projection_matrix() const;
+  const Eigen::Matrix4f& inverse_view_projection_matrix() const;
+
+  // Returns the left, right, bottom, top, near and far planes of the view
+  // frustum in world coordinates, one per row. A plane (a, b, c, d) has a
+  // unit normal pointing inside the frustum, so a point p is inside when
+  // a * p.x + b * p.y + c * p.z + d >= 0 for every plane. The far plane of the
+  // reverse-Z projection is (0, 0, 0, 1), which accepts every point.
+  const Eigen::Matrix<float, 6, 4>& frustum_planes() const;
+
+  // Returns true if an axis-aligned box intersects the view frustum. The test
+  // is conservative: it may accept a few boxes near the frustum corners that
+  // are outside.
+  // Params:
+  //   model  The model matrix (object -> world transformation matrix).
+  //   box_min  The minimum corner of the box in the object frame.
+  //   box_max  The maximum corner of the box in the object frame.
+  bool IsBoxInFrustum(const Eigen::Matrix4f& model,
+                      const Eigen::Vector3f& box_min,
+                      const Eigen::Vector3f& box_max) const;
+
+  // Computes the world-space ray through a point of the image, e.g., for
+  // picking.
+  // Params:
+  //   ndc  The point in normalized device coordinates, in [-1, 1]^2.
+  //   origin  The point of the ray on the near plane.
+  //   direction  The unit direction of the ray.
+  void ComputeRay(const Eigen::Vector2f& ndc,
+                  Eigen::Vector3f* origin,
+                  Eigen::Vector3f* direction) const;
+
+  // Returns the distance along the viewing direction from the camera to a
+  // point in the world, e.g., to select a level of detail.
+  float ComputeViewDepth(const Eigen::Vector3f& point) const;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+ private:
+  // Recompute the cached matrices if the pose or the intrinsics changed.
+  void UpdateView() const;
+  void UpdateProjection() const;
+  void UpdateViewProjection() const;
+
+  // Intrinsics.
+  ProjectionType projection_type_;
+  float field_of_view_;
+  // Height of the orthographic view volume.
+  float orthographic_height_;
+  float aspect_ratio_;
+  float near_;
+  float far_;
+  // Pose.
+  Eigen::Vector3f orientation_;
+  Eigen::Vector3f position_;
+  uint64_t version_;
+
+  // Cache. Each flag is set when a matrix it depends on changes.
+  mutable bool view_dirty_;
+  mutable bool projection_dirty_;
+  mutable bool view_projection_dirty_;
+  mutable Eigen::Matrix4f view_;
+  mutable Eigen::Matrix4f inverse_view_;
+  mutable Eigen::Matrix4f projection_;
+  mutable Eigen::Matrix4f inverse_projection_;
+  mutable Eigen::Matrix4f view_projection_;
+  mutable Eigen::Matrix4f inverse_view_projection_;
+  mutable Eigen::Matrix<float, 6, 4> frustum_planes_;
+};
+
+}  // namespace wvu
+
+#endif  // CAMERA_H_
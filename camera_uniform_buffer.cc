@@ -0,0 +1,108 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "camera_uniform_buffer.h"
+
+#include <string>
+#include <Eigen/Core>
+
+#include "camera.h"
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// Size of a mat4 in the std140 layout.
+constexpr GLsizeiptr kMatrixBytes = 16 * sizeof(GLfloat);
+// The block holds the view and projection matrices.
+constexpr GLsizeiptr kBufferBytes = 2 * kMatrixBytes;
+
+}  // namespace
+
+constexpr GLuint CameraUniformBuffer::kBindingPoint;
+const char CameraUniformBuffer::kBlockName[] = "CameraBlock";
+
+CameraUniformBuffer::CameraUniformBuffer() : buffer_id_(0) {}
+
+CameraUniformBuffer::~CameraUniformBuffer() {
+  if (buffer_id_ != 0) {
+    GlResourceRegistry::Instance()->Unregister(GlObjectType::BUFFER,
+                                               buffer_id_);
+    glDeleteBuffers(1, &buffer_id_);
+  }
+}
+
+bool CameraUniformBuffer::Initialize(std::string* error_info_log) {
+  glGenBuffers(1, &buffer_id_);
+  if (buffer_id_ == 0) {
+    if (error_info_log) {
+      *error_info_log = "Could not create the camera uniform buffer.";
+    }
+    return false;
+  }
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  registry->Register(GlObjectType::BUFFER, buffer_id_, "camera_uniform_buffer",
+                     WVU_GL_CREATION_SITE);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+  glBufferData(GL_UNIFORM_BUFFER, kBufferBytes, nullptr, GL_STREAM_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, buffer_id_, kBufferBytes);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, kBindingPoint, buffer_id_);
+  return true;
+}
+
+bool CameraUniformBuffer::BindToProgram(
+    const ShaderProgram& shader_program) const {
+  const GLuint program_id = shader_program.shader_program_id();
+  const GLuint block_index = glGetUniformBlockIndex(program_id, kBlockName);
+  if (block_index == GL_INVALID_INDEX) return false;
+  glUniformBlockBinding(program_id, block_index, kBindingPoint);
+  return true;
+}
+
+void CameraUniformBuffer::Update(const Camera& camera) {
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+  // Orphan the previous contents so that the write does not wait for the
+  // draws of the previous frame that still read them.
+  glBufferData(GL_UNIFORM_BUFFER, kBufferBytes, nullptr, GL_STREAM_DRAW);
+  // Eigen stores matrices in column-major order, which is what std140 expects.
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, kMatrixBytes,
+                  camera.view_matrix().data());
+  glBufferSubData(GL_UNIFORM_BUFFER, kMatrixBytes, kMatrixBytes,
+                  camera.projection_matrix().data());
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+}  // namespace wvu
@@ -0,0 +1,95 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef CAMERA_UNIFORM_BUFFER_H_
+#define CAMERA_UNIFORM_BUFFER_H_
+
+#include <string>
+#include <GL/glew.h>
+
+#include "camera.h"
+#include "shader_program.h"
+
+namespace wvu {
+// A uniform buffer object holding the camera matrices for every shader that
+// declares the block below. Writing the camera once into the buffer, right
+// before the draws are submitted, late-latches the freshest camera into all
+// the draws of the frame instead of setting the uniforms of every program.
+//
+//   layout (std140) uniform CameraBlock {
+//     mat4 view;
+//     mat4 projection;
+//   };
+//
+// Example:
+//
+// wvu::CameraUniformBuffer camera_uniform_buffer;
+// std::string error_info_log;
+// if (!camera_uniform_buffer.Initialize(&error_info_log)) { ... }
+// camera_uniform_buffer.BindToProgram(shader_program);
+// while (...) {  // Rendering loop.
+//   ...  // Sample the input and update the camera.
+//   camera_uniform_buffer.Update(camera);
+//   ...  // Draw.
+// }
+class CameraUniformBuffer {
+ public:
+  // The uniform buffer binding point used by the block.
+  static constexpr GLuint kBindingPoint = 0;
+  // The name of the block in the shaders.
+  static const char kBlockName[];
+
+  CameraUniformBuffer();
+
+  // Destructor. Deletes the buffer.
+  ~CameraUniformBuffer();
+
+  // Creates the buffer and binds it to kBindingPoint. Requires a current
+  // OpenGL context. Returns true if successful.
+  bool Initialize(std::string* error_info_log);
+
+  // Connects the camera block of a shader program to the buffer. Returns false
+  // if the program does not declare the block.
+  bool BindToProgram(const ShaderProgram& shader_program) const;
+
+  // Writes the matrices of the camera into the buffer.
+  void Update(const Camera& camera);
+
+ private:
+  GLuint buffer_id_;
+};
+
+}  // namespace wvu
+
+#endif  // CAMERA_UNIFORM_BUFFER_H_
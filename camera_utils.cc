@@ -85,5 +85,41 @@ Eigen::Matrix4f ComputePerspectiveProjectionMatrix(const GLfloat field_of_view,
   return projection_matrix;
 }
 
+// Computes the orthographic camera projection matrix.
+Eigen::Matrix4f ComputeOrthographicProjectionMatrix(const GLfloat left,
+                                                    const GLfloat right,
+                                                    const GLfloat bottom,
+                                                    const GLfloat top,
+                                                    const GLfloat near,
+                                                    const GLfloat far) {
+  // Map the view volume to the [-1, 1] cube. The camera looks down -z.
+  const GLfloat width = right - left;
+  const GLfloat height = top - bottom;
+  const GLfloat planes_distance = far - near;
+  Eigen::Matrix4f projection_matrix;
+  projection_matrix << 2.0f / width, 0.0f, 0.0f, -(right + left) / width,
+      0.0f, 2.0f / height, 0.0f, -(top + bottom) / height,
+      0.0f, 0.0f, -2.0f / planes_distance, -(far + near) / planes_distance,
+      0.0f, 0.0f, 0.0f, 1.0f;
+  return projection_matrix;
+}
+
+// Computes a reverse-Z perspective projection matrix without far plane.
+Eigen::Matrix4f ComputeReverseZInfinitePerspectiveProjectionMatrix(
+    const GLfloat field_of_view,
+    const GLfloat aspect_ratio,
+    const GLfloat near) {
+  // The clip depth is the constant near, so the depth after the perspective
+  // division is near / distance: 1 at the near plane and 0 at infinity.
+  const GLfloat y_scale = ComputeCotangent(0.5f * field_of_view);
+  const GLfloat x_scale = y_scale / aspect_ratio;
+  Eigen::Matrix4f projection_matrix;
+  projection_matrix << x_scale, 0.0f, 0.0f, 0.0f,
+      0.0f, y_scale, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, near,
+      0.0f, 0.0f, -1.0f, 0.0f;
+  return projection_matrix;
+}
+
 }  // namespace wvu
 
@@ -49,6 +49,36 @@ Eigen::Matrix4f ComputePerspectiveProjectionMatrix(const GLfloat field_of_view,
                                                    const GLfloat aspect_ratio,
                                                    const GLfloat near,
                                                    const GLfloat far);
+
+// Computes the orthographic camera projection matrix. The view volume is the
+// box [left, right] x [bottom, top] x [-far, -near] in camera coordinates.
+// Params:
+//   left  The left plane of the view volume.
+//   right  The right plane of the view volume.
+//   bottom  The bottom plane of the view volume.
+//   top  The top plane of the view volume.
+//   near  The near distance plane.
+//   far  The far distance plane.
+Eigen::Matrix4f ComputeOrthographicProjectionMatrix(const GLfloat left,
+                                                    const GLfloat right,
+                                                    const GLfloat bottom,
+                                                    const GLfloat top,
+                                                    const GLfloat near,
+                                                    const GLfloat far);
+
+// Computes a perspective projection matrix with reverse-Z and an infinitely
+// far plane. The near plane maps to depth 1 and infinity to depth 0, which
+// spreads the floating-point depth precision evenly across the distance. The
+// matrix expects a [0, 1] clip depth range (glClipControl with
+// GL_ZERO_TO_ONE), a depth buffer cleared to 0 and the GL_GREATER depth test.
+// Params:
+//   field_of_view  The field of view angle in radians.
+//   aspect_ratio  The width / height ratio of the window dimensions.
+//   near  The near distance plane.
+Eigen::Matrix4f ComputeReverseZInfinitePerspectiveProjectionMatrix(
+    const GLfloat field_of_view,
+    const GLfloat aspect_ratio,
+    const GLfloat near);
 }  // namespace wvu
 
 #endif  // CAMERA_UTILS_H_
@@ -0,0 +1,169 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "damage_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+
+#include "math_kernels.h"
+#include "model.h"
+
+namespace wvu {
+
+ScreenRect ScreenRect::Union(const ScreenRect& other) const {
+  if (IsEmpty()) return other;
+  if (other.IsEmpty()) return *this;
+  ScreenRect rect;
+  rect.x_min = std::min(x_min, other.x_min);
+  rect.y_min = std::min(y_min, other.y_min);
+  rect.x_max = std::max(x_max, other.x_max);
+  rect.y_max = std::max(y_max, other.y_max);
+  return rect;
+}
+
+bool ScreenRect::Intersects(const ScreenRect& other) const {
+  return !IsEmpty() && !other.IsEmpty() &&
+      x_min < other.x_max && other.x_min < x_max &&
+      y_min < other.y_max && other.y_min < y_max;
+}
+
+DamageTracker::DamageTracker(const int width,
+                             const int height,
+                             const int margin_pixels)
+    : width_(width),
+      height_(height),
+      margin_pixels_(margin_pixels),
+      invalidated_(true),
+      camera_version_(0),
+      frame_(0) {}
+
+ScreenRect DamageTracker::FullScreenRect() const {
+  ScreenRect rect;
+  rect.x_max = width_;
+  rect.y_max = height_;
+  return rect;
+}
+
+ScreenRect DamageTracker::Update(const Eigen::Matrix4f& view_projection,
+                                 const uint64_t camera_version,
+                                 const std::vector<Model*>& models) {
+  ++frame_;
+  stats_ = DamageStats();
+  // A new camera moves every model on the screen.
+  const bool full_redraw = invalidated_ || camera_version != camera_version_;
+  invalidated_ = false;
+  camera_version_ = camera_version;
+  ScreenRect damage;
+  for (Model* model : models) {
+    ModelFootprint& footprint = footprints_[model];
+    const bool is_new = footprint.frame == 0;
+    footprint.frame = frame_;
+    if (!full_redraw && !is_new && footprint.version == model->version()) {
+      continue;
+    }
+    // The old rectangle has to be erased and the new one drawn.
+    ++stats_.num_changed_models;
+    const ScreenRect rect = ComputeScreenRect(view_projection, model);
+    damage = damage.Union(footprint.rect).Union(rect);
+    footprint.version = model->version();
+    footprint.rect = rect;
+  }
+  // The models that disappeared leave their old rectangle behind.
+  for (auto it = footprints_.begin(); it != footprints_.end();) {
+    if (it->second.frame != frame_) {
+      ++stats_.num_changed_models;
+      damage = damage.Union(it->second.rect);
+      it = footprints_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (full_redraw) {
+    damage = FullScreenRect();
+  }
+  stats_.damaged_fraction = static_cast<double>(damage.width()) *
+      damage.height() / (static_cast<double>(width_) * height_);
+  return damage;
+}
+
+bool DamageTracker::Overlaps(const Model* model,
+                             const ScreenRect& rect) const {
+  const auto it = footprints_.find(model);
+  if (it == footprints_.end()) return true;
+  return it->second.rect.Intersects(rect);
+}
+
+ScreenRect DamageTracker::ComputeScreenRect(
+    const Eigen::Matrix4f& view_projection, Model* model) const {
+  const Eigen::Matrix4f model_view_projection =
+      view_projection * model->ComputeModelMatrix();
+  const Eigen::Vector3f& box_min = model->bounding_box_min();
+  const Eigen::Vector3f& box_max = model->bounding_box_max();
+  Eigen::Vector2f ndc_min = Eigen::Vector2f::Constant(1.0f);
+  Eigen::Vector2f ndc_max = Eigen::Vector2f::Constant(-1.0f);
+  for (int corner = 0; corner < 8; ++corner) {
+    const Eigen::Vector3f point((corner & 1) ? box_max.x() : box_min.x(),
+                                (corner & 2) ? box_max.y() : box_min.y(),
+                                (corner & 4) ? box_max.z() : box_min.z());
+    const Eigen::Vector4f clip = model_view_projection.leftCols<3>() * point +
+        model_view_projection.col(3);
+    // A box crossing the camera plane can cover any part of the screen.
+    if (clip.w() < kMinClipW) {
+      return FullScreenRect();
+    }
+    const Eigen::Vector2f ndc = clip.head<2>() / clip.w();
+    ndc_min = ndc_min.cwiseMin(ndc);
+    ndc_max = ndc_max.cwiseMax(ndc);
+  }
+  // Clamp to the screen before converting to pixels to avoid overflows.
+  ndc_min = ndc_min.cwiseMax(Eigen::Vector2f::Constant(-1.0f));
+  ndc_max = ndc_max.cwiseMin(Eigen::Vector2f::Constant(1.0f));
+  ScreenRect rect;
+  rect.x_min = std::max(0, static_cast<int>(std::floor(
+      0.5f * (ndc_min.x() + 1.0f) * width_)) - margin_pixels_);
+  rect.y_min = std::max(0, static_cast<int>(std::floor(
+      0.5f * (ndc_min.y() + 1.0f) * height_)) - margin_pixels_);
+  rect.x_max = std::min(width_, static_cast<int>(std::ceil(
+      0.5f * (ndc_max.x() + 1.0f) * width_)) + margin_pixels_);
+  rect.y_max = std::min(height_, static_cast<int>(std::ceil(
+      0.5f * (ndc_max.y() + 1.0f) * height_)) + margin_pixels_);
+  return rect;
+}
+
+}  // namespace wvu
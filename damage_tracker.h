@@ -0,0 +1,161 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef DAMAGE_TRACKER_H_
+#define DAMAGE_TRACKER_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+
+#include "model.h"
+
+namespace wvu {
+// An axis-aligned rectangle of pixels [x_min, x_max) x [y_min, y_max), with
+// the origin at the lower left corner like glScissor().
+struct ScreenRect {
+  int x_min = 0;
+  int y_min = 0;
+  int x_max = 0;
+  int y_max = 0;
+
+  bool IsEmpty() const {
+    return x_min >= x_max || y_min >= y_max;
+  }
+  int width() const {
+    return IsEmpty() ? 0 : x_max - x_min;
+  }
+  int height() const {
+    return IsEmpty() ? 0 : y_max - y_min;
+  }
+  // Returns the smallest rectangle containing both rectangles.
+  ScreenRect Union(const ScreenRect& other) const;
+  // Returns true if the rectangles share at least one pixel.
+  bool Intersects(const ScreenRect& other) const;
+};
+
+// Statistics of the last frame.
+struct DamageStats {
+  // Number of models whose pose changed, appeared or disappeared.
+  int num_changed_models = 0;
+  // Fraction of the framebuffer in the damaged region.
+  double damaged_fraction = 0.0;
+};
+
+// Tracks the region of the framebuffer that has to be redrawn. Every frame,
+// the models whose version changed since the last frame damage the screen
+// rectangles of their old and new projected bounding boxes; the damaged
+// region is the union of those rectangles. Changing the camera damages the
+// whole framebuffer. The rest of the framebuffer can be kept from the last
+// frame, e.g., in a RenderTarget, so only the damaged region is cleared and
+// only the models overlapping it are drawn.
+//
+// Example:
+//
+// wvu::DamageTracker damage_tracker(640, 480, 2);
+// while (...) {  // Rendering loop.
+//   const wvu::ScreenRect damage = damage_tracker.Update(
+//       camera.view_projection_matrix(), camera.version(), models);
+//   if (!damage.IsEmpty()) {
+//     glScissor(damage.x_min, damage.y_min, damage.width(),
+//               damage.height());
+//     ...  // Clear, and draw the models for which
+//          // damage_tracker.Overlaps(model, damage).
+//   }
+// }
+class DamageTracker {
+ public:
+  // Constructor.
+  // Params:
+  //   width  The width of the framebuffer in pixels.
+  //   height  The height of the framebuffer in pixels.
+  //   margin_pixels  Pixels added around every projected bounding box to
+  //     cover wide lines and rasterization rounding.
+  DamageTracker(const int width, const int height, const int margin_pixels);
+
+  // Computes the damaged region of this frame and remembers the screen
+  // rectangles of the models for the next frame.
+  // Params:
+  //   view_projection  The camera projection * view matrix.
+  //   camera_version  The version of the camera; see Camera::version().
+  //   models  The models in the scene.
+  ScreenRect Update(const Eigen::Matrix4f& view_projection,
+                    const uint64_t camera_version,
+                    const std::vector<Model*>& models);
+
+  // Damages the whole framebuffer in the next frame, e.g., after resizing the
+  // window or losing the contents of the framebuffer.
+  void InvalidateAll() {
+    invalidated_ = true;
+  }
+
+  // Returns true if the screen rectangle of the model computed by the last
+  // Update() overlaps the rectangle. Unknown models always overlap.
+  bool Overlaps(const Model* model, const ScreenRect& rect) const;
+
+  // Returns the whole framebuffer.
+  ScreenRect FullScreenRect() const;
+
+  // Returns the statistics of the last frame.
+  const DamageStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  // The footprint of a model in the last frame.
+  struct ModelFootprint {
+    uint64_t version = 0;
+    ScreenRect rect;
+    // Frame in which the model was seen for the last time.
+    int64_t frame = 0;
+  };
+
+  // Computes the screen rectangle of the projected bounding box of a model.
+  ScreenRect ComputeScreenRect(const Eigen::Matrix4f& view_projection,
+                               Model* model) const;
+
+  const int width_;
+  const int height_;
+  const int margin_pixels_;
+  bool invalidated_;
+  uint64_t camera_version_;
+  int64_t frame_;
+  std::unordered_map<const Model*, ModelFootprint> footprints_;
+  DamageStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // DAMAGE_TRACKER_H_
@@ -32,8 +32,21 @@
 // Please contact the author of this library if you have any questions.
 // Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/StdVector>
 
 // The macro below tells the linker to use the GLEW library in a static way.
 // This is mainly for compatibility with Windows.
@@ -47,6 +60,7 @@
 // creating windows for OpenGL rendering.
 // See http://www.glfw.org/ for more information.
 #include <GLFW/glfw3.h>
+#include <gflags/gflags.h>
 
 // Shader program.
 #include "shader_program.h"
@@ -57,9 +71,252 @@
 // Transformation utils.
 #include "transformations.h"
 
+// Batched math kernels.
+#include "math_kernels.h"
+
 // Camera utils.
+#include "camera.h"
 #include "camera_utils.h"
 
+// Multi-view rendering.
+#include "multi_view_renderer.h"
+
+// Culling.
+#include "hardware_occlusion_culler.h"
+#include "model_bounds.h"
+#include "occlusion_culler.h"
+#include "thread_pool.h"
+
+// Wireframe rendering.
+#include "wireframe_renderer.h"
+
+// CPU rendering.
+#include "software_renderer.h"
+
+// Depth management and measurements.
+#include "gpu_query_ring.h"
+#include "render_order.h"
+
+// On-demand rendering.
+#include "redraw_scheduler.h"
+
+// Partial redraws.
+#include "damage_tracker.h"
+#include "render_target.h"
+
+// Shared meshes and GPU memory residency.
+#include "mesh.h"
+#include "mesh_pack.h"
+#include "residency_manager.h"
+
+// Batching.
+#include "dynamic_batcher.h"
+#include "static_batcher.h"
+
+// Programmable vertex pulling.
+#include "transform_buffer.h"
+#include "vertex_pulling_renderer.h"
+
+// Frame pacing and late-latching.
+#include "camera_uniform_buffer.h"
+#include "frame_pacer.h"
+
+// Input latency measurements.
+#include "input_latency_tracker.h"
+
+// Dynamic resolution.
+#include "dynamic_resolution.h"
+#include "upscaler.h"
+
+// Frame capture.
+#include "frame_capture.h"
+
+// OpenGL command capture.
+#include "gl_command_stream.h"
+#include "gl_hooks.h"
+
+// GPU memory accounting.
+#include "gl_resource_registry.h"
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define CS470_GFLAGS_NAMESPACE google
+#else
+#define CS470_GFLAGS_NAMESPACE gflags
+#endif
+
+DEFINE_string(occlusion_culling, "none",
+              "Occlusion culling method: none, software (a software "
+              "rasterized hierarchical depth buffer of the occluders), or "
+              "hardware (GPU occlusion queries with conditional rendering).");
+DEFINE_int32(occlusion_query_interval, 4,
+             "With hardware occlusion culling, visible models are re-queried "
+             "every this many frames.");
+DEFINE_int32(occlusion_buffer_width, 160,
+             "Width of the software occlusion depth buffer.");
+DEFINE_int32(occlusion_buffer_height, 120,
+             "Height of the software occlusion depth buffer.");
+DEFINE_bool(depth_pre_pass, false,
+            "Renders the depth of the visible models with a minimal shader "
+            "before shading them, so that every pixel is shaded once.");
+DEFINE_bool(front_to_back, true,
+            "Sorts the opaque models front to back before drawing them.");
+DEFINE_string(wireframe_mode, "polygon_mode",
+              "How the wireframes are rendered: polygon_mode "
+              "(glPolygonMode), barycentric (edge distance computed in the "
+              "fragment shader) or edge_lines (unique edges drawn as "
+              "GL_LINES). Hardware occlusion culling always uses "
+              "polygon_mode.");
+DEFINE_double(wireframe_line_width, 1.0,
+              "Width of the lines in pixels for the barycentric wireframes.");
+DEFINE_bool(hidden_line_removal, false,
+            "Hides the lines behind the triangles in the barycentric "
+            "wireframes.");
+DEFINE_string(projection, "perspective",
+              "Camera projection: perspective, orthographic, or reverse_z (a "
+              "perspective projection with an infinitely far plane; needs "
+              "ARB_clip_control).");
+DEFINE_int32(num_views, 1,
+             "Number of views rendered per frame in a split screen, at most "
+             "8. Two views form a stereo pair. The views are culled in a "
+             "single traversal of the models.");
+DEFINE_bool(multi_view_instancing, true,
+            "Draws every model once for all the views that see it with "
+            "instanced multi-viewport rendering (gl_ViewportIndex) when the "
+            "context supports it. Otherwise, draws the models once per "
+            "view.");
+DEFINE_bool(on_demand_rendering, false,
+            "Redraws only when the models, the camera or the window changed, "
+            "or while animating. Otherwise, sleeps until the next window "
+            "event instead of rendering the same frame again.");
+DEFINE_double(idle_wait_seconds, 0.5,
+              "Maximum time that the on-demand rendering sleeps waiting for "
+              "window events before checking the scene again.");
+DEFINE_bool(animate, false, "Spins the boxes behind the wall.");
+DEFINE_double(cpu_usage_interval_seconds, 5.0,
+              "Interval at which the CPU usage of the process is printed. "
+              "Zero disables it.");
+DEFINE_bool(damage_tracking, false,
+            "Renders into an offscreen framebuffer and redraws only the "
+            "screen rectangles covered by the models that changed since the "
+            "last frame, with scissored clears and draws. Every frame, the "
+            "framebuffer is copied to the window.");
+DEFINE_bool(frame_pacing, false,
+            "Predicts the render time from the recent frames and sleeps "
+            "until just before the next refresh, then samples the input. "
+            "Shortens the input-to-photon latency with vsync.");
+DEFINE_double(frame_pacing_margin_ms, 2.0,
+              "Safety margin added to the predicted render time.");
+DEFINE_bool(late_latching, false,
+            "Samples the input again after culling and writes the camera "
+            "into a uniform buffer right before the draws are submitted.");
+DEFINE_bool(adaptive_vsync, true,
+            "Uses adaptive vsync (swap interval -1), which tears instead of "
+            "waiting for the next refresh when a frame is late, if the "
+            "driver supports EXT_swap_control_tear.");
+DEFINE_string(latency_histogram_csv, "",
+              "Measures the latency from each input event to the display of "
+              "the frame that consumed it, and writes the histogram into this "
+              "CSV file at exit.");
+DEFINE_double(inject_input_hz, 0.0,
+              "Injects synthetic input events at this rate to measure the "
+              "input latency without a user. Zero disables it.");
+DEFINE_bool(dynamic_resolution, false,
+            "Renders into an offscreen framebuffer whose resolution scales "
+            "to keep the GPU time of the frames at --target_frame_ms, and "
+            "upscales it to the window.");
+DEFINE_double(target_frame_ms, 16.0,
+              "Target GPU time of a frame for the dynamic resolution.");
+DEFINE_double(min_resolution_scale, 0.5,
+              "Smallest scale of the dynamic resolution.");
+DEFINE_double(max_resolution_scale, 1.0,
+              "Largest scale of the dynamic resolution.");
+DEFINE_string(upscale_filter, "sharpen",
+              "Filter that upscales the dynamic resolution to the window: "
+              "bilinear or sharpen.");
+DEFINE_double(upscale_sharpness, 0.5,
+              "Strength of the sharpen upscale filter.");
+DEFINE_string(resolution_scale_log, "",
+              "Writes the resolution scale of every frame into this CSV "
+              "file.");
+DEFINE_string(capture_path, "",
+              "Records the frames: the Y4M file, or the prefix of the "
+              "numbered PPM or PNG files. Empty disables the capture.");
+DEFINE_string(capture_format, "png",
+              "File format of the captured frames: ppm, png or y4m.");
+DEFINE_int32(capture_start_frame, 0, "First frame to capture.");
+DEFINE_int32(capture_frames, 0,
+             "Number of frames to capture, e.g., one for a screenshot. Zero "
+             "captures until the window closes.");
+DEFINE_int32(capture_ring_size, 3,
+             "Number of pixel buffer objects that read the frames back "
+             "asynchronously.");
+DEFINE_int32(capture_fps, 60, "Frame rate stored in the Y4M files.");
+DEFINE_string(gl_capture_path, "",
+              "Records the OpenGL commands, with the contents of the buffers, "
+              "the textures and the shaders, into this file for gl_replay. "
+              "Needs the ENABLE_GL_HOOKS build option.");
+DEFINE_int32(gl_capture_frames, 60,
+             "Number of frames of the OpenGL command capture.");
+DEFINE_string(gpu_memory_log, "",
+              "Writes the GPU memory of the registered OpenGL objects after "
+              "every frame into this CSV file, to track its growth over "
+              "long runs.");
+DEFINE_int32(gpu_memory_budget_mb, 0,
+             "Keeps the GPU buffers of the models within this many MB: the "
+             "models are uploaded when they become visible and the least "
+             "recently visible ones are evicted. Zero uploads all the models "
+             "at the start.");
+DEFINE_bool(drop_cpu_geometry, false,
+            "Frees the CPU copy of the geometry of the models once uploaded. "
+            "With a GPU memory budget, the evicted models are read back from "
+            "the mesh pack.");
+DEFINE_bool(static_batching, false,
+            "Merges the static models into pre-transformed buffers, one per "
+            "cell of a grid, drawn with one call per cell. With --animate, "
+            "only the wall is static.");
+DEFINE_double(static_batch_chunk_size, 4.0,
+              "Edge of the cells of the grid that groups the static models, "
+              "in world units.");
+DEFINE_bool(dynamic_batching, false,
+            "Draws the small visible models of every frame with one call, "
+            "from a streaming vertex buffer written by the worker threads. "
+            "Turns itself off while a draw call costs less than batching a "
+            "model.");
+DEFINE_int32(dynamic_batch_max_vertices, 64,
+             "Models with more vertices in their triangle list are drawn "
+             "one by one.");
+DEFINE_int32(dynamic_batch_capacity, 1 << 16,
+             "Most vertices batched in a frame.");
+DEFINE_string(vertex_fetch, "classic",
+              "How the vertex shader gets the vertices of the visible models: "
+              "classic (vertex arrays, a draw call per model), pulling "
+              "(texelFetch() from texture buffers, one draw call for all the "
+              "models), or alternate (switches between both every stats "
+              "interval to compare them).");
+DEFINE_string(mesh_pack, "",
+              "Writes the geometry of the models into this file at the start, "
+              "and reads the evicted models back from it.");
+DEFINE_string(render_backend, "opengl",
+              "Render backend: opengl, or software (a tiled, multithreaded "
+              "CPU rasterizer whose frames are blitted to the window). To "
+              "compare against Mesa's llvmpipe, run the opengl backend with "
+              "LIBGL_ALWAYS_SOFTWARE=1.");
+DEFINE_int32(headless_frames, 0,
+             "With the software backend, renders this many frames without "
+             "creating a window, prints the timings and exits.");
+DEFINE_string(software_output_ppm, "",
+              "With the software backend, saves the last frame to this PPM "
+              "file.");
+DEFINE_int32(num_threads, 0,
+             "Number of threads for CPU work. Zero uses all the cores.");
+DEFINE_string(simd_level, "",
+              "Instruction set of the math kernels: scalar, sse4.2, avx2 or "
+              "avx512. Empty picks the best one that the CPU supports.");
+DEFINE_int32(stats_interval, 0,
+             "Prints the rendering statistics every this many frames. Zero "
+             "disables the statistics.");
+
 // Annonymous namespace for constants and helper functions.
 namespace {
 using wvu::Model;
@@ -89,6 +346,21 @@ const std::string vertex_shader_src =
     "gl_Position = projection * view * model * vec4(position, 1.0f);\n"
     "}\n";
 
+// Vertex shader that reads the camera matrices from a uniform buffer; see
+// CameraUniformBuffer. Used for late-latching.
+const std::string camera_block_vertex_shader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 position;\n"
+    "uniform mat4 model;\n"
+    "layout (std140) uniform CameraBlock {\n"
+    "  mat4 view;\n"
+    "  mat4 projection;\n"
+    "};\n"
+    "\n"
+    "void main() {\n"
+    "gl_Position = projection * view * model * vec4(position, 1.0f);\n"
+    "}\n";
+
 // Fragment shader follows standard 3.3.0. The goal of the fragment shader is to
 // calculate the color of the pixel corresponding to a vertex. This is why we
 // declare a variable named color of type vec4 (4D vector) as its output. This
@@ -100,6 +372,25 @@ const std::string fragment_shader_src =
     "color = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
     "}\n";
 
+// Fragment shader of the depth pre-pass. It uses the vertex shader above and
+// only writes depth, so it does not output any color.
+const std::string depth_fragment_shader_src =
+    "#version 330 core\n"
+    "void main() {\n"
+    "}\n";
+
+// Number of frames in flight of the GPU measurements.
+constexpr int kNumGpuQueriesInFlight = 4;
+
+// Input latency histogram: 1 ms bins up to 200 ms, and frames followed.
+constexpr double kInputLatencyBinSeconds = 1e-3;
+constexpr int kNumInputLatencyBins = 200;
+constexpr int kMaxInputLatencyFramesInFlight = 16;
+
+// All the models share a shader program, so the static batches are grouped
+// by space only.
+constexpr int kStaticBatchKey = 0;
+
 // Error callback function. This function follows the required signature of
 // GLFW. See http://www.glfw.org/docs/3.0/group__error.html for more
 // information.
@@ -107,6 +398,34 @@ static void ErrorCallback(int error, const char* description) {
   std::cerr << "ERROR: " << description << std::endl;
 }
 
+// The state reached by the window callbacks through the window user pointer.
+struct WindowState {
+  wvu::RedrawScheduler* redraw_scheduler = nullptr;
+  // Timestamps the input events when not null.
+  wvu::InputLatencyTracker* input_latency_tracker = nullptr;
+};
+
+// Marks the next frame of the window as dirty.
+static void InvalidateWindow(GLFWwindow* window) {
+  const WindowState* state =
+      static_cast<const WindowState*>(glfwGetWindowUserPointer(window));
+  if (state != nullptr && state->redraw_scheduler != nullptr) {
+    state->redraw_scheduler->Invalidate();
+  }
+}
+
+// Timestamps an input event as soon as GLFW delivers it, and marks the next
+// frame as dirty. glfwGetTime() reads the monotonic clock.
+static void RecordInputEvent(GLFWwindow* window,
+                             const wvu::InputEventType type) {
+  const WindowState* state =
+      static_cast<const WindowState*>(glfwGetWindowUserPointer(window));
+  if (state != nullptr && state->input_latency_tracker != nullptr) {
+    state->input_latency_tracker->RecordEvent(type, glfwGetTime());
+  }
+  InvalidateWindow(window);
+}
+
 // Key callback. This function follows the required signature of GLFW. See
 // http://www.glfw.org/docs/latest/input_guide.html fore more information.
 static void KeyCallback(GLFWwindow* window,
@@ -117,6 +436,42 @@ static void KeyCallback(GLFWwindow* window,
   if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
     glfwSetWindowShouldClose(window, GL_TRUE);
   }
+  RecordInputEvent(window, wvu::InputEventType::KEY);
+}
+
+// Mouse callbacks. They only feed the input latency measurements and the
+// redraws.
+static void MouseButtonCallback(GLFWwindow* window,
+                                int button,
+                                int action,
+                                int mods) {
+  RecordInputEvent(window, wvu::InputEventType::MOUSE_BUTTON);
+}
+
+static void CursorPosCallback(GLFWwindow* window, double x, double y) {
+  RecordInputEvent(window, wvu::InputEventType::CURSOR_MOTION);
+}
+
+static void ScrollCallback(GLFWwindow* window,
+                           double x_offset,
+                           double y_offset) {
+  RecordInputEvent(window, wvu::InputEventType::SCROLL);
+}
+
+// Window callbacks. The window contents may need to be redrawn after any of
+// these events.
+static void WindowRefreshCallback(GLFWwindow* window) {
+  InvalidateWindow(window);
+}
+
+static void FramebufferSizeCallback(GLFWwindow* window,
+                                    int width,
+                                    int height) {
+  InvalidateWindow(window);
+}
+
+static void WindowFocusCallback(GLFWwindow* window, int focused) {
+  InvalidateWindow(window);
 }
 
 // Configures glfw.
@@ -147,19 +502,35 @@ void ConfigureViewPort(GLFWwindow* window) {
   glViewport(0, 0, width, height);
 }
 
+// Configures the depth test. Fragments closer to the camera than the ones
+// already in the depth buffer pass the test. With reverse-Z, the closer
+// fragments have the larger depth and the clip depth range is [0, 1].
+void ConfigureDepthTest(const bool reverse_z) {
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(reverse_z ? GL_GREATER : GL_LESS);
+  glDepthMask(GL_TRUE);
+  if (reverse_z) {
+    glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+  }
+}
+
 // Clears the frame buffer.
-void ClearTheFrameBuffer() {
+void ClearTheFrameBuffer(const bool reverse_z) {
   // Sets the initial color of the framebuffer in the RGBA, R = Red, G = Green,
   // B = Blue, and A = alpha.
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  // Tells OpenGL to clear the Color buffer.
-  glClear(GL_COLOR_BUFFER_BIT);
+  // Sets the initial depth to the far plane.
+  glClearDepth(reverse_z ? 0.0 : 1.0);
+  // Tells OpenGL to clear the Color and Depth buffers.
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-bool CreateShaderProgram(wvu::ShaderProgram* shader_program) {
+bool CreateShaderProgram(const std::string& vertex_shader_source,
+                         const std::string& fragment_shader_source,
+                         wvu::ShaderProgram* shader_program) {
   if (shader_program == nullptr) return false;
-  shader_program->LoadVertexShaderFromString(vertex_shader_src);
-  shader_program->LoadFragmentShaderFromString(fragment_shader_src);
+  shader_program->LoadVertexShaderFromString(vertex_shader_source);
+  shader_program->LoadFragmentShaderFromString(fragment_shader_source);
   std::string error_info_log;
   if (!shader_program->Create(&error_info_log)) {
     std::cout << "ERROR: " << error_info_log << "\n";
@@ -171,41 +542,1074 @@ bool CreateShaderProgram(wvu::ShaderProgram* shader_program) {
   return true;
 }
 
+// Optional rendering subsystems. Null members are disabled.
+struct RenderingSubsystems {
+  // Computes the model matrices and world boxes of the models to draw in
+  // batches for the frustum and occlusion culling.
+  wvu::ModelBounds* model_bounds = nullptr;
+  // Culls the models hidden behind its occluders on the CPU.
+  wvu::OcclusionCuller* occlusion_culler = nullptr;
+  // Culls the occluded models on the GPU with occlusion queries.
+  wvu::HardwareOcclusionCuller* hardware_occlusion_culler = nullptr;
+  // Renders the depth of the models before shading them.
+  const wvu::ShaderProgram* depth_shader_program = nullptr;
+  // Sorts the models front to back.
+  bool sort_front_to_back = false;
+  // Draws the shader-based wireframes. Only used when wireframe_mode is not
+  // POLYGON_MODE.
+  wvu::WireframeRenderer* wireframe_renderer = nullptr;
+  wvu::WireframeMode wireframe_mode = wvu::WireframeMode::POLYGON_MODE;
+  // Measures the GPU time of the frame.
+  wvu::GpuQueryRing* gpu_timer = nullptr;
+  // Counts the fragments that pass the depth test in the shading pass.
+  wvu::GpuQueryRing* shaded_samples_counter = nullptr;
+  // Renders on the CPU instead of OpenGL when not null.
+  wvu::SoftwareRenderer* software_renderer = nullptr;
+  // Whether the camera uses a reverse-Z projection.
+  bool reverse_z = false;
+  // Renders several views per frame when not null.
+  wvu::MultiViewRenderer* multi_view_renderer = nullptr;
+  const std::vector<wvu::RenderView>* views = nullptr;
+  // Redraws only the damaged region of the render target when not null.
+  wvu::DamageTracker* damage_tracker = nullptr;
+  wvu::RenderTarget* render_target = nullptr;
+  // Late-latching: samples the input again and writes the camera into the
+  // uniform buffer right before the draws when not null.
+  wvu::CameraUniformBuffer* camera_uniform_buffer = nullptr;
+  std::function<void()> late_latch_input;
+  // Schedules the frames when not null.
+  wvu::FramePacer* frame_pacer = nullptr;
+  // Measures the input-to-display latency when not null.
+  wvu::InputLatencyTracker* input_latency_tracker = nullptr;
+  // Scales the render resolution when not null. The scaling happens around
+  // RenderScene().
+  const wvu::ResolutionScaleController* resolution_controller = nullptr;
+  // Uploads the visible models and evicts the others within a GPU memory
+  // budget when not null.
+  wvu::ModelResidencyManager* residency_manager = nullptr;
+  // Draws the static models, which are not in the models to draw, from
+  // merged buffers in every pass when not null.
+  wvu::StaticBatcher* static_batcher = nullptr;
+  // Draws the small models from a streaming buffer in DrawModels() when not
+  // null.
+  wvu::DynamicBatcher* dynamic_batcher = nullptr;
+  // Draws the models with one draw call that pulls their vertices in
+  // DrawModels() when not null and pull_vertices is true. The depth shader
+  // program is only set with a depth pre-pass.
+  wvu::VertexPullingRenderer* vertex_pulling_renderer = nullptr;
+  const wvu::ShaderProgram* vertex_pulling_shader_program = nullptr;
+  const wvu::ShaderProgram* vertex_pulling_depth_shader_program = nullptr;
+  bool pull_vertices = false;
+  // The model matrices of the vertex pulling when not null.
+  wvu::TransformBuffer* transform_buffer = nullptr;
+};
+
+// The latest GPU measurements.
+struct GpuMeasurements {
+  // GPU time of the frame.
+  double gpu_seconds = 0.0;
+  // Whether gpu_seconds was read in the last update.
+  bool has_new_gpu_seconds = false;
+  // Number of fragments shaded per pixel of the framebuffer.
+  double overdraw = 0.0;
+};
+
+// Reads the GPU measurements that became available.
+void UpdateGpuMeasurements(const RenderingSubsystems& subsystems,
+                           GpuMeasurements* measurements) {
+  GLuint64 result = 0;
+  measurements->has_new_gpu_seconds = subsystems.gpu_timer != nullptr &&
+      subsystems.gpu_timer->LatestResult(&result);
+  if (measurements->has_new_gpu_seconds) {
+    measurements->gpu_seconds = 1e-9 * result;
+  }
+  // The samples are tagged with the pixels of the viewport they were counted
+  // in, which is scaled with the dynamic resolution.
+  int64_t num_pixels = 0;
+  if (subsystems.shaded_samples_counter != nullptr &&
+      subsystems.shaded_samples_counter->LatestResult(&result, &num_pixels) &&
+      num_pixels > 0) {
+    measurements->overdraw = static_cast<double>(result) / num_pixels;
+  }
+}
+
+// Draws the models that passed the culling. Every pass of RenderScene() and
+// the hardware occlusion culler draw the models with this, so the vertex
+// pulling, the dynamic batching and the shader-based wireframes work with all
+// of them.
+// Params:
+//   shader_program  The shader program of the pass. It is in use, and is in
+//     use again on return.
+//   is_depth_pass  Whether the pass is the depth pre-pass.
+//   projection  The camera projection matrix.
+//   view  The camera pose matrix (world -> camera transformation matrix).
+//   models  The models to draw.
+//   subsystems  The rendering subsystems.
+void DrawModels(const wvu::ShaderProgram& shader_program,
+                const bool is_depth_pass,
+                const Eigen::Matrix4f& projection,
+                const Eigen::Matrix4f& view,
+                const std::vector<Model*>& models,
+                const RenderingSubsystems& subsystems) {
+  if (subsystems.vertex_pulling_renderer != nullptr &&
+      subsystems.pull_vertices) {
+    const wvu::ShaderProgram& vertex_pulling_shader_program = is_depth_pass ?
+        *subsystems.vertex_pulling_depth_shader_program :
+        *subsystems.vertex_pulling_shader_program;
+    vertex_pulling_shader_program.Use();
+    subsystems.vertex_pulling_renderer->Draw(vertex_pulling_shader_program,
+                                             projection, view, models);
+    shader_program.Use();
+  } else if (subsystems.dynamic_batcher != nullptr) {
+    subsystems.dynamic_batcher->Draw(shader_program, projection, view,
+                                     models);
+  } else if (subsystems.wireframe_renderer != nullptr && !is_depth_pass) {
+    for (Model* model : models) {
+      subsystems.wireframe_renderer->Draw(subsystems.wireframe_mode, model,
+                                          projection, view);
+    }
+    shader_program.Use();
+  } else {
+    for (Model* model : models) {
+      model->Draw(shader_program, projection, view);
+    }
+  }
+}
+
 // Renders the scene.
 void RenderScene(const wvu::ShaderProgram& shader_program,
-                 const Eigen::Matrix4f& projection,
-                 const Eigen::Matrix4f& view,
+                 const wvu::Camera& camera,
                  std::vector<Model*>* models_to_draw,
+                 const RenderingSubsystems& subsystems,
                  GLFWwindow* window) {
+  if (subsystems.gpu_timer != nullptr) {
+    subsystems.gpu_timer->Begin();
+  }
+  // The camera caches its matrices, so asking for them is cheap.
+  Eigen::Matrix4f projection = camera.projection_matrix();
+  Eigen::Matrix4f view = camera.view_matrix();
+  // With damage tracking, the render target keeps the last frame and only the
+  // damaged region is cleared and redrawn.
+  wvu::ScreenRect damage;
+  if (subsystems.damage_tracker != nullptr) {
+    damage = subsystems.damage_tracker->Update(
+        camera.view_projection_matrix(), camera.version(), *models_to_draw);
+    subsystems.render_target->Bind();
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(damage.x_min, damage.y_min, damage.width(), damage.height());
+  }
   // Clear the buffer.
-  ClearTheFrameBuffer();
+  ClearTheFrameBuffer(subsystems.reverse_z);
   // Let OpenGL know that we want to use our shader program.
   shader_program.Use();
-  // Render the models in a wireframe mode.
-  glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+  // Render the models in a wireframe mode. The shader-based wireframes are
+  // drawn from filled triangles or lines.
+  const bool use_polygon_mode =
+      subsystems.wireframe_mode == wvu::WireframeMode::POLYGON_MODE;
+  glPolygonMode(GL_FRONT_AND_BACK, use_polygon_mode ? GL_LINE : GL_FILL);
+  // The multi-view renderer culls against the frustums of all its views.
+  if (subsystems.multi_view_renderer != nullptr) {
+    subsystems.multi_view_renderer->Render(*subsystems.views,
+                                           *models_to_draw);
+    if (subsystems.gpu_timer != nullptr) {
+      subsystems.gpu_timer->End();
+    }
+    return;
+  }
+  // Discard the models outside of the view frustum. The occlusion culler
+  // reuses the model matrices of the batch.
+  wvu::ModelBounds* model_bounds = subsystems.model_bounds;
+  model_bounds->Update(*models_to_draw);
+  std::vector<uint8_t> in_frustum;
+  model_bounds->TestInFrustum(camera, &in_frustum);
+  std::vector<Model*> models_in_frustum;
+  std::vector<float> frustum_model_matrices;
+  models_in_frustum.reserve(models_to_draw->size());
+  for (int i = 0; i < model_bounds->size(); ++i) {
+    Model* model = model_bounds->model(i);
+    if (!in_frustum[i] || (subsystems.damage_tracker != nullptr &&
+                           !subsystems.damage_tracker->Overlaps(model,
+                                                                damage))) {
+      continue;
+    }
+    models_in_frustum.push_back(model);
+    const float* model_matrix = model_bounds->model_matrices() + 16 * i;
+    frustum_model_matrices.insert(frustum_model_matrices.end(), model_matrix,
+                                  model_matrix + 16);
+  }
+  if (subsystems.dynamic_batcher != nullptr) {
+    subsystems.dynamic_batcher->BeginFrame();
+  }
+  // The occlusion queries draw the visible models first, and both the
+  // visible and the hidden ones in the order they are given.
+  if (subsystems.hardware_occlusion_culler != nullptr) {
+    if (subsystems.sort_front_to_back) {
+      wvu::SortModelsFrontToBack(view, &models_in_frustum);
+    }
+    // The occluded models are drawn conditionally, so they need their
+    // buffers too.
+    if (subsystems.residency_manager != nullptr) {
+      subsystems.residency_manager->MakeResident(&models_in_frustum);
+    }
+    // The static models occlude the others in the queries.
+    if (subsystems.static_batcher != nullptr) {
+      subsystems.static_batcher->Draw(kStaticBatchKey, shader_program,
+                                      camera);
+    }
+    subsystems.hardware_occlusion_culler->RenderModels(
+        shader_program,
+        [&](const std::vector<Model*>& models) {
+          DrawModels(shader_program, false, projection, view, models,
+                     subsystems);
+        },
+        projection, view, models_in_frustum);
+    glBindVertexArray(0);
+    if (subsystems.gpu_timer != nullptr) {
+      subsystems.gpu_timer->End();
+    }
+    return;
+  }
+  // Select the models to draw.
+  std::vector<Model*> visible_models;
+  if (subsystems.occlusion_culler != nullptr) {
+    subsystems.occlusion_culler->RenderOccluders(projection, view);
+    subsystems.occlusion_culler->CullModels(models_in_frustum,
+                                            frustum_model_matrices.data(),
+                                            &visible_models);
+  } else {
+    visible_models.swap(models_in_frustum);
+  }
+  if (subsystems.sort_front_to_back) {
+    wvu::SortModelsFrontToBack(view, &visible_models);
+  }
+  // Upload the visible models that are not in the GPU.
+  if (subsystems.residency_manager != nullptr) {
+    subsystems.residency_manager->MakeResident(&visible_models);
+  }
+  // The software backend rasterizes on the CPU and copies the result into
+  // the window.
+  if (subsystems.software_renderer != nullptr) {
+    subsystems.software_renderer->BeginFrame();
+    for (Model* model : visible_models) {
+      subsystems.software_renderer->Draw(model, projection, view);
+    }
+    subsystems.software_renderer->EndFrame();
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    subsystems.software_renderer->BlitToFramebuffer(0, viewport[2],
+                                                    viewport[3]);
+    if (subsystems.gpu_timer != nullptr) {
+      subsystems.gpu_timer->End();
+    }
+    return;
+  }
+  // Late-latch the camera: the input that arrived while culling still makes it
+  // into this frame. The models were culled with the camera sampled before,
+  // which differs by a small motion at most.
+  if (subsystems.camera_uniform_buffer != nullptr) {
+    if (subsystems.late_latch_input) {
+      subsystems.late_latch_input();
+    }
+    subsystems.camera_uniform_buffer->Update(camera);
+    projection = camera.projection_matrix();
+    view = camera.view_matrix();
+  }
+  // Depth pre-pass: lay down the depth of the visible models without shading
+  // them. The shading pass then only accepts the fragments with equal depth
+  // and does not need to write depth again.
+  if (subsystems.depth_shader_program != nullptr) {
+    subsystems.depth_shader_program->Use();
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    DrawModels(*subsystems.depth_shader_program, true, projection, view,
+               visible_models, subsystems);
+    if (subsystems.static_batcher != nullptr) {
+      subsystems.static_batcher->Draw(kStaticBatchKey,
+                                      *subsystems.depth_shader_program,
+                                      camera);
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(subsystems.reverse_z ? GL_GEQUAL : GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    shader_program.Use();
+  }
   // Draw the models.
-  // TODO: For every model in models_to_draw, call its Draw() method, passing
-  // the view and projection matrices.
+  if (subsystems.shaded_samples_counter != nullptr) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    subsystems.shaded_samples_counter->Begin(
+        static_cast<int64_t>(viewport[2]) * viewport[3]);
+  }
+  DrawModels(shader_program, false, projection, view, visible_models,
+             subsystems);
+  if (subsystems.static_batcher != nullptr) {
+    subsystems.static_batcher->Draw(kStaticBatchKey, shader_program, camera);
+  }
+  if (subsystems.shaded_samples_counter != nullptr) {
+    subsystems.shaded_samples_counter->End();
+  }
+  // Restore the depth state.
+  if (subsystems.depth_shader_program != nullptr) {
+    glDepthFunc(subsystems.reverse_z ? GL_GREATER : GL_LESS);
+    glDepthMask(GL_TRUE);
+  }
   // Let OpenGL know that we are done with our vertex array object.
   glBindVertexArray(0);
+  // Present the whole render target; the back buffer of the window does not
+  // keep its contents across swaps.
+  if (subsystems.damage_tracker != nullptr) {
+    glDisable(GL_SCISSOR_TEST);
+    int width;
+    int height;
+    glfwGetFramebufferSize(window, &width, &height);
+    subsystems.render_target->BlitToFramebuffer(0, width, height);
+    glViewport(0, 0, width, height);
+  }
+  if (subsystems.gpu_timer != nullptr) {
+    subsystems.gpu_timer->End();
+  }
+}
+
+// Creates a box model centered at position with the given half extents. The
+// boxes of the same size share their mesh.
+Model* CreateBoxModel(const Eigen::Vector3f& half_extents,
+                      const Eigen::Vector3f& position,
+                      wvu::MeshCache* mesh_cache) {
+  Eigen::MatrixXf vertices(3, 8);
+  for (int corner = 0; corner < 8; ++corner) {
+    vertices.col(corner) <<
+        ((corner & 1) ? half_extents.x() : -half_extents.x()),
+        ((corner & 2) ? half_extents.y() : -half_extents.y()),
+        ((corner & 4) ? half_extents.z() : -half_extents.z());
+  }
+  const std::vector<GLuint> indices = {
+    0, 2, 3, 0, 3, 1,  // Back (-z).
+    4, 5, 7, 4, 7, 6,  // Front (+z).
+    0, 1, 5, 0, 5, 4,  // Bottom (-y).
+    2, 6, 7, 2, 7, 3,  // Top (+y).
+    0, 4, 6, 0, 6, 2,  // Left (-x).
+    1, 3, 7, 1, 7, 5   // Right (+x).
+  };
+  return new Model(Eigen::Vector3f::Zero(), position,
+                   mesh_cache->Get(vertices, indices));
+}
+
+// Builds a dense scene: a grid of small boxes, most of them behind a large
+// wall that acts as an occluder.
+void ConstructModels(std::vector<Model*>* models_to_draw,
+                     std::vector<Model*>* occluders) {
+  // The models keep their meshes alive.
+  wvu::MeshCache mesh_cache;
+  // The wall.
+  Model* wall = CreateBoxModel(Eigen::Vector3f(1.5f, 1.0f, 0.05f),
+                               Eigen::Vector3f(0.0f, 0.0f, -4.0f),
+                               &mesh_cache);
+  models_to_draw->push_back(wall);
+  occluders->push_back(wall);
+  // The grid of boxes behind the wall.
+  constexpr int kGridSize = 16;
+  const Eigen::Vector3f box_half_extents(0.1f, 0.1f, 0.1f);
+  for (int row = 0; row < kGridSize; ++row) {
+    for (int column = 0; column < kGridSize; ++column) {
+      const Eigen::Vector3f position(
+          -3.0f + 6.0f * column / (kGridSize - 1),
+          -2.0f + 4.0f * row / (kGridSize - 1),
+          -7.0f);
+      models_to_draw->push_back(
+          CreateBoxModel(box_half_extents, position, &mesh_cache));
+    }
+  }
+}
+
+// Spins the models that are not occluders about their vertical axis at 45
+// degrees per second.
+void AnimateModels(const double seconds,
+                   const std::vector<Model*>& occluders,
+                   std::vector<Model*>* models) {
+  const float angle = wvu::ConvertDegreesToRadians(
+      static_cast<float>(std::fmod(45.0 * seconds, 360.0)));
+  for (Model* model : *models) {
+    if (std::find(occluders.begin(), occluders.end(), model) ==
+        occluders.end()) {
+      model->set_orientation(Eigen::Vector3f(0.0f, angle, 0.0f));
+    }
+  }
+}
+
+// Moves the camera with the keyboard: W and S move forward and backward, A
+// and D move left and right, and the arrows move up and down, at a constant
+// speed.
+struct CameraController {
+  double last_update_seconds = -1.0;
+
+  void Update(GLFWwindow* window, wvu::Camera* camera) {
+    const double now = glfwGetTime();
+    const float elapsed_seconds = (last_update_seconds < 0.0) ?
+        0.0f : static_cast<float>(now - last_update_seconds);
+    last_update_seconds = now;
+    Eigen::Vector3f direction = Eigen::Vector3f::Zero();
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) direction.z() -= 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) direction.z() += 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) direction.x() -= 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) direction.x() += 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) direction.y() += 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) direction.y() -= 1.0f;
+    if (direction.isZero() || elapsed_seconds <= 0.0f) return;
+    // Units per second, in the camera frame.
+    constexpr float kSpeed = 2.0f;
+    const Eigen::Matrix3f camera_to_world =
+        camera->inverse_view_matrix().block<3, 3>(0, 0);
+    camera->set_position(camera->position() + kSpeed * elapsed_seconds *
+                         camera_to_world * direction.normalized());
+  }
+};
+
+// Measures the CPU usage of the process: the CPU time of all its threads over
+// the wall time.
+struct CpuUsageMeter {
+  std::clock_t cpu_start = std::clock();
+  std::chrono::steady_clock::time_point wall_start =
+      std::chrono::steady_clock::now();
+  int num_frames_rendered_start = 0;
+  int num_frames_skipped_start = 0;
+};
+
+// Prints the CPU usage since the last report every
+// FLAGS_cpu_usage_interval_seconds.
+void ReportCpuUsage(const wvu::RedrawScheduler& redraw_scheduler,
+                    CpuUsageMeter* meter) {
+  if (FLAGS_cpu_usage_interval_seconds <= 0.0) return;
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  const double wall_seconds =
+      std::chrono::duration<double>(now - meter->wall_start).count();
+  if (wall_seconds < FLAGS_cpu_usage_interval_seconds) return;
+  const std::clock_t cpu_now = std::clock();
+  const double cpu_seconds =
+      static_cast<double>(cpu_now - meter->cpu_start) / CLOCKS_PER_SEC;
+  std::cout << "CPU usage " << 100.0 * cpu_seconds / wall_seconds
+            << "% of a core ("
+            << (FLAGS_on_demand_rendering ? "on-demand" : "continuous")
+            << " rendering): "
+            << redraw_scheduler.num_frames_rendered() -
+               meter->num_frames_rendered_start
+            << " frames rendered, "
+            << redraw_scheduler.num_frames_skipped() -
+               meter->num_frames_skipped_start
+            << " idle wake-ups in " << wall_seconds << " s\n";
+  meter->cpu_start = cpu_now;
+  meter->wall_start = now;
+  meter->num_frames_rendered_start = redraw_scheduler.num_frames_rendered();
+  meter->num_frames_skipped_start = redraw_scheduler.num_frames_skipped();
+}
+
+// Sets the GPU buffers of the models. Returns false if a model has neither
+// GPU buffers nor CPU geometry to upload.
+bool SetModelsIntoGpu(const std::vector<Model*>& models) {
+  for (Model* model : models) {
+    if (!model->SetVerticesIntoGpu()) return false;
+  }
+  return true;
 }
 
-void ConstructModels(std::vector<Model*>* models_to_draw) {
-  // TODO: Prepare your models here.
-  // 1. Construct models by setting their vertices and poses.
-  // 2. Create your models in the heap and add the pointers to models_to_draw.
-  // 3. For every added model in models to draw, set the GPU buffers by
-  // calling the method model method SetVerticesIntoGPU().
+// Returns the meshes of the models, once each, in the order of their first
+// model.
+std::vector<wvu::Mesh*> CollectUniqueMeshes(const std::vector<Model*>& models) {
+  std::vector<wvu::Mesh*> meshes;
+  std::unordered_set<const wvu::Mesh*> seen_meshes;
+  for (const Model* model : models) {
+    if (seen_meshes.insert(model->mesh().get()).second) {
+      meshes.push_back(model->mesh().get());
+    }
+  }
+  return meshes;
 }
 
 void DeleteModels(std::vector<Model*>* models_to_draw) {
-  // TODO: Implement me!
-  // Call delete on each models to draw.
+  for (Model* model : *models_to_draw) {
+    delete model;
+  }
+  models_to_draw->clear();
+}
+
+// Prints the input-to-display latencies measured so far.
+void PrintInputLatencyStats(const wvu::InputLatencyStats& stats) {
+  std::cout << "  Input latency: " << stats.num_events << " events ("
+            << stats.num_dropped_events << " dropped), "
+            << 1e3 * stats.average_seconds << " ms average, p50 "
+            << 1e3 * stats.p50_seconds << " ms, p95 "
+            << 1e3 * stats.p95_seconds << " ms, p99 "
+            << 1e3 * stats.p99_seconds << " ms, max "
+            << 1e3 * stats.max_seconds << " ms\n";
+}
+
+// Writes the latency histogram into FLAGS_latency_histogram_csv if set.
+bool ExportInputLatencyHistogram(const wvu::InputLatencyTracker& tracker) {
+  if (FLAGS_latency_histogram_csv.empty()) return true;
+  if (!tracker.ExportHistogramCsv(FLAGS_latency_histogram_csv)) {
+    std::cerr << "ERROR: Could not write " << FLAGS_latency_histogram_csv
+              << "\n";
+    return false;
+  }
+  return true;
+}
+
+// Prints the GPU memory of the live OpenGL objects by owner.
+void PrintGpuMemoryUsage(const wvu::GlResourceRegistry& registry) {
+  constexpr double kBytesPerMegabyte = 1024.0 * 1024.0;
+  std::cout << "  GPU memory: " << registry.live_bytes() / kBytesPerMegabyte
+            << " MB in " << registry.num_live_objects() << " objects (peak "
+            << registry.peak_bytes() / kBytesPerMegabyte << " MB)";
+  for (const wvu::GlResourceUsage& usage : registry.UsageByOwner()) {
+    std::cout << ", " << usage.owner_tag << " "
+              << usage.num_bytes / kBytesPerMegabyte << " MB ("
+              << usage.num_objects << ")";
+  }
+  std::cout << "\n";
+}
+
+// Prints the uploads and evictions of the residency manager.
+void PrintResidencyStats(const wvu::ModelResidencyManager& residency_manager) {
+  constexpr double kBytesPerMegabyte = 1024.0 * 1024.0;
+  const wvu::ResidencyStats& stats = residency_manager.stats();
+  std::cout << "  Residency: "
+            << residency_manager.resident_bytes() / kBytesPerMegabyte
+            << " / " << residency_manager.budget_bytes() / kBytesPerMegabyte
+            << " MB in " << residency_manager.num_resident_meshes()
+            << " meshes, " << stats.num_hits << " hits, " << stats.num_misses
+            << " misses, " << stats.num_evictions << " evictions, "
+            << stats.num_pack_reads << " pack reads, "
+            << stats.num_bytes_uploaded / kBytesPerMegabyte << " MB uploaded";
+  if (stats.upload_seconds > 0.0) {
+    std::cout << " at " << stats.num_bytes_uploaded / kBytesPerMegabyte /
+        stats.upload_seconds << " MB/s";
+  }
+  std::cout << ", " << stats.num_frames_over_budget
+            << " frames over budget\n";
+}
+
+// Prints the draws of the static batches per frame and their rebuilds.
+void PrintStaticBatchStats(const wvu::StaticBatcher& static_batcher,
+                           const int num_frames) {
+  const wvu::StaticBatchStats& stats = static_batcher.stats();
+  std::cout << "  Static batching: " << static_batcher.num_models()
+            << " models in " << static_batcher.num_chunks() << " chunks, "
+            << static_cast<double>(stats.num_draw_calls) / num_frames
+            << " draw calls and "
+            << static_cast<double>(stats.num_culled_chunks) / num_frames
+            << " culled chunks per frame, " << stats.num_rebuilt_chunks
+            << " chunks rebuilt in " << 1e3 * stats.rebuild_seconds
+            << " ms\n";
+}
+
+// Prints the models of the dynamic batches per frame and the measured costs
+// that switch batching on and off.
+void PrintDynamicBatchStats(const wvu::DynamicBatcher& dynamic_batcher,
+                            const int num_frames) {
+  const wvu::DynamicBatchStats& stats = dynamic_batcher.stats();
+  std::cout << "  Dynamic batching ("
+            << (dynamic_batcher.is_batching() ? "on" : "off") << "): "
+            << static_cast<double>(stats.num_batched_models) / num_frames
+            << " batched models in "
+            << static_cast<double>(stats.num_batch_draws) / num_frames
+            << " draws and "
+            << static_cast<double>(stats.num_individual_draws) / num_frames
+            << " individual draws per frame, "
+            << 1e6 * dynamic_batcher.seconds_per_batched_model()
+            << " us per batched model vs "
+            << 1e6 * dynamic_batcher.seconds_per_draw()
+            << " us per draw, " << stats.num_fence_waits << " fence waits, "
+            << stats.num_switches << " switches\n";
+}
+
+// Prints the draw calls, models and vertices of the vertex pulling per frame.
+void PrintVertexPullingStats(const wvu::VertexPullingRenderer& renderer,
+                             const bool pull_vertices,
+                             const int num_frames) {
+  const wvu::VertexPullingStats& stats = renderer.stats();
+  std::cout << "  Vertex pulling (" << (pull_vertices ? "on" : "off")
+            << "): " << static_cast<double>(stats.num_draw_calls) / num_frames
+            << " draw calls for "
+            << static_cast<double>(stats.num_pulled_models) / num_frames
+            << " models and "
+            << static_cast<double>(stats.num_pulled_vertices) / num_frames
+            << " vertices per frame, " << stats.num_skipped_models
+            << " models skipped, " << renderer.num_meshes()
+            << " meshes in the arenas, "
+            << stats.num_bytes_uploaded / 1024.0 << " KiB uploaded\n";
+}
+
+// Prints the model matrices uploaded per frame by the transform buffer.
+void PrintTransformBufferStats(const wvu::TransformBuffer& transform_buffer,
+                               const int num_frames) {
+  const wvu::TransformBufferStats& stats = transform_buffer.stats();
+  std::cout << "  Transform buffer: " << transform_buffer.num_models()
+            << " models, "
+            << static_cast<double>(stats.num_changed_matrices) / num_frames
+            << " changed matrices in "
+            << static_cast<double>(stats.num_upload_ranges) / num_frames
+            << " ranges and "
+            << stats.num_bytes_uploaded / 1024.0 / num_frames
+            << " KiB uploaded per frame\n";
+}
+
+// Prints the OpenGL calls per frame counted by the hooks.
+void PrintGlCallCounters(const wvu::GlCallCounters& counters,
+                         const int num_frames) {
+  int64_t num_calls = 0;
+  for (int i = 0; i < wvu::kNumGlOpcodes; ++i) {
+    num_calls += counters.num_calls[i];
+  }
+  const double frames = std::max(num_frames, 1);
+  std::cout << "  OpenGL calls per frame: " << num_calls / frames << " ("
+            << counters.num_draw_calls() / frames << " draws, "
+            << counters.num_binds() / frames << " binds), "
+            << counters.num_bytes_uploaded / frames / 1024.0
+            << " KB uploaded, " << counters.num_buffers_created / frames
+            << " buffers and " << counters.num_textures_created / frames
+            << " textures created\n";
+}
+
+// Prints the throughput of the frame capture and its cost on the rendering
+// thread.
+void PrintFrameCaptureStats(const wvu::FrameCaptureStats& stats,
+                            const double wall_seconds) {
+  std::cout << "  Capture: " << stats.num_frames_written << " / "
+            << stats.num_frames_captured << " frames written ("
+            << stats.num_frames_written / wall_seconds << " fps), "
+            << stats.num_frames_dropped << " dropped, " << stats.num_stalls
+            << " stalls, " << stats.num_write_errors << " errors, "
+            << 1e3 * stats.render_thread_seconds /
+               std::max(stats.num_frames_captured, 1)
+            << " ms per frame on the rendering thread, writer busy "
+            << 100.0 * stats.writer_seconds / wall_seconds << "%\n";
+}
+
+// Starts the capture of the OpenGL commands into --gl_capture_path. Every
+// command from here on is recorded, so that the replay creates the same
+// objects.
+bool StartGlCommandCapture(GLFWwindow* window,
+                           wvu::GlCommandWriter* gl_command_writer) {
+  int width;
+  int height;
+  glfwGetFramebufferSize(window, &width, &height);
+  std::string error_info_log;
+  if (!gl_command_writer->Open(FLAGS_gl_capture_path, width, height,
+                               &error_info_log)) {
+    std::cerr << "ERROR: " << error_info_log << "\n";
+    return false;
+  }
+  wvu::gl_hooks::SetCommandWriter(gl_command_writer);
+  return true;
+}
+
+// Stops the capture of the OpenGL commands and prints its size.
+void FinishGlCommandCapture(wvu::GlCommandWriter* gl_command_writer) {
+  wvu::gl_hooks::SetCommandWriter(nullptr);
+  const uint64_t num_bytes = gl_command_writer->num_bytes();
+  gl_command_writer->Close();
+  std::cout << "OpenGL command capture into " << FLAGS_gl_capture_path
+            << ": " << gl_command_writer->num_frames() << " frames, "
+            << num_bytes / 1024.0 << " KB\n";
+}
+
+// Prints the timings of the software backend.
+void PrintSoftwareRendererStats(const wvu::SoftwareRendererStats& stats) {
+  std::cout << "  Software backend: " << stats.num_triangles
+            << " triangles, setup " << 1e3 * stats.setup_seconds
+            << " ms, rasterization " << 1e3 * stats.rasterization_seconds
+            << " ms, blit " << 1e3 * stats.blit_seconds << " ms\n";
+}
+
+// Prints the statistics of the subsystems that are enabled.
+// Params:
+//   frame_number  The number of frames rendered so far.
+//   average_frame_seconds  The average frame time since the last print.
+//   subsystems  The enabled rendering subsystems.
+//   gpu_measurements  The latest GPU measurements.
+void PrintStats(const int frame_number,
+                const double average_frame_seconds,
+                const RenderingSubsystems& subsystems,
+                const GpuMeasurements& gpu_measurements) {
+  std::cout << "Frame " << frame_number << ": "
+            << 1e3 * average_frame_seconds << " ms per frame ("
+            << FLAGS_wireframe_mode << " wireframes)\n";
+  if (subsystems.gpu_timer != nullptr) {
+    std::cout << "  GPU time " << 1e3 * gpu_measurements.gpu_seconds
+              << " ms (depth pre-pass "
+              << (subsystems.depth_shader_program != nullptr ? "on" : "off")
+              << ")\n";
+  }
+  if (subsystems.shaded_samples_counter != nullptr) {
+    std::cout << "  Overdraw " << gpu_measurements.overdraw
+              << " shaded fragments per pixel\n";
+  }
+  if (subsystems.occlusion_culler != nullptr) {
+    const wvu::OcclusionCullingStats& stats =
+        subsystems.occlusion_culler->stats();
+    std::cout << "  Software occlusion culling: "
+              << stats.CulledPercentage() << "% culled ("
+              << stats.num_models_culled << " / " << stats.num_models_tested
+              << "), " << stats.num_occluder_triangles
+              << " occluder triangles, rasterization "
+              << 1e3 * stats.rasterization_seconds << " ms, Hi-Z "
+              << 1e3 * stats.hierarchical_z_seconds << " ms, tests "
+              << 1e3 * stats.test_seconds << " ms\n";
+  }
+  if (subsystems.software_renderer != nullptr) {
+    PrintSoftwareRendererStats(subsystems.software_renderer->stats());
+  }
+  if (subsystems.frame_pacer != nullptr) {
+    const wvu::FramePacerStats& stats = subsystems.frame_pacer->stats();
+    std::cout << "  Frame pacing: input latency "
+              << 1e3 * stats.average_latency_seconds << " ms average, "
+              << 1e3 * stats.max_latency_seconds << " ms max, predicted "
+              << "render time " << 1e3 * stats.predicted_render_seconds
+              << " ms, " << stats.num_missed_deadlines << " / "
+              << stats.num_frames << " missed refreshes\n";
+    subsystems.frame_pacer->ResetStats();
+  }
+  if (subsystems.resolution_controller != nullptr) {
+    const wvu::ResolutionScaleController& controller =
+        *subsystems.resolution_controller;
+    std::cout << "  Dynamic resolution: scale " << controller.scale() << " ("
+              << FLAGS_upscale_filter << " upscaling), target "
+              << FLAGS_target_frame_ms << " ms";
+    // The smoothed time restarts after every change of scale.
+    if (controller.filtered_gpu_seconds() >= 0.0) {
+      std::cout << ", smoothed GPU time "
+                << 1e3 * controller.filtered_gpu_seconds() << " ms";
+    }
+    std::cout << "\n";
+  }
+  if (subsystems.input_latency_tracker != nullptr) {
+    PrintInputLatencyStats(
+        subsystems.input_latency_tracker->ComputeStats());
+  }
+  if (subsystems.damage_tracker != nullptr) {
+    const wvu::DamageStats& stats = subsystems.damage_tracker->stats();
+    std::cout << "  Damage tracking: " << 100.0 * stats.damaged_fraction
+              << "% of the framebuffer redrawn, " << stats.num_changed_models
+              << " changed models\n";
+  }
+  if (subsystems.multi_view_renderer != nullptr) {
+    const wvu::MultiViewStats& stats =
+        subsystems.multi_view_renderer->stats();
+    std::cout << "  Multi-view ("
+              << wvu::MultiViewTechniqueName(
+                     subsystems.multi_view_renderer->technique())
+              << "): " << stats.num_views << " views, "
+              << stats.num_models_tested << " models, "
+              << stats.num_visible_model_views << " visible model views, "
+              << stats.num_draw_calls << " draw calls\n";
+  }
+  if (subsystems.hardware_occlusion_culler != nullptr) {
+    const wvu::HardwareOcclusionStats& stats =
+        subsystems.hardware_occlusion_culler->stats();
+    std::cout << "  Hardware occlusion culling: " << stats.num_models
+              << " models, " << stats.num_visible_draws << " visible draws, "
+              << stats.num_conditional_draws << " conditional draws, "
+              << stats.num_box_queries << " box queries, "
+              << stats.num_geometry_queries << " geometry queries, "
+              << stats.num_pending_results << " results pending, "
+              << stats.num_depth_fill_models << " depth fills, CPU "
+              << 1e3 * stats.cpu_seconds << " ms\n";
+  }
+  if (subsystems.residency_manager != nullptr) {
+    PrintResidencyStats(*subsystems.residency_manager);
+    subsystems.residency_manager->ResetStats();
+  }
+  if (subsystems.dynamic_batcher != nullptr) {
+    PrintDynamicBatchStats(*subsystems.dynamic_batcher, FLAGS_stats_interval);
+    subsystems.dynamic_batcher->ResetStats();
+  }
+  if (subsystems.static_batcher != nullptr) {
+    PrintStaticBatchStats(*subsystems.static_batcher, FLAGS_stats_interval);
+    subsystems.static_batcher->ResetStats();
+  }
+  if (subsystems.vertex_pulling_renderer != nullptr) {
+    PrintVertexPullingStats(*subsystems.vertex_pulling_renderer,
+                            subsystems.pull_vertices, FLAGS_stats_interval);
+    subsystems.vertex_pulling_renderer->ResetStats();
+    PrintTransformBufferStats(*subsystems.transform_buffer,
+                              FLAGS_stats_interval);
+    subsystems.transform_buffer->ResetStats();
+  }
+  PrintGpuMemoryUsage(*wvu::GlResourceRegistry::Instance());
+  // The hooks counted the calls since the last statistics.
+  if (wvu::kGlHooksEnabled) {
+    PrintGlCallCounters(wvu::gl_hooks::GetCallCounters(),
+                        FLAGS_stats_interval);
+    wvu::gl_hooks::ResetCallCounters();
+  }
+}
+
+// Sets the intrinsics of the camera for the window.
+// Params:
+//   projection  The projection name: perspective, orthographic or reverse_z.
+//   camera  The camera to configure.
+bool ConfigureCamera(const std::string& projection, wvu::Camera* camera) {
+  const float field_of_view = wvu::ConvertDegreesToRadians(45.0f);
+  const float aspect_ratio =
+      static_cast<float>(kWindowWidth) / static_cast<float>(kWindowHeight);
+  const float near_plane = 0.1f;
+  const float far_plane = 10.0f;
+  if (projection == "perspective") {
+    camera->SetPerspective(field_of_view, aspect_ratio, near_plane, far_plane);
+  } else if (projection == "orthographic") {
+    // Frame the grid of boxes.
+    camera->SetOrthographic(5.0f, aspect_ratio, near_plane, far_plane);
+  } else if (projection == "reverse_z") {
+    camera->SetReverseZInfinitePerspective(field_of_view, aspect_ratio,
+                                           near_plane);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Splits the window into a grid of views. The cameras are placed side by side
+// along the x axis; two views form a stereo pair.
+// Params:
+//   projection  The projection name of the cameras.
+//   num_views  The number of views.
+//   cameras  The cameras of the views.
+//   views  The views, which point to the cameras.
+void BuildSplitScreenViews(
+    const std::string& projection,
+    const int num_views,
+    std::vector<wvu::Camera, Eigen::aligned_allocator<wvu::Camera> >* cameras,
+    std::vector<wvu::RenderView>* views) {
+  // Distance between the cameras of neighboring views.
+  const float camera_spacing = (num_views == 2) ? 0.064f : 0.5f;
+  const int num_columns =
+      static_cast<int>(std::ceil(std::sqrt(static_cast<float>(num_views))));
+  const int num_rows = (num_views + num_columns - 1) / num_columns;
+  const int view_width = kWindowWidth / num_columns;
+  const int view_height = kWindowHeight / num_rows;
+  cameras->resize(num_views);
+  views->resize(num_views);
+  for (int i = 0; i < num_views; ++i) {
+    wvu::Camera& camera = (*cameras)[i];
+    ConfigureCamera(projection, &camera);
+    camera.set_aspect_ratio(static_cast<float>(view_width) /
+                            static_cast<float>(view_height));
+    camera.set_position(Eigen::Vector3f(
+        camera_spacing * (i - 0.5f * (num_views - 1)), 0.0f, 0.0f));
+    wvu::RenderView& view = (*views)[i];
+    view.camera = &camera;
+    // The first view is at the top left corner.
+    view.x = (i % num_columns) * view_width;
+    view.y = (num_rows - 1 - i / num_columns) * view_height;
+    view.width = view_width;
+    view.height = view_height;
+  }
+}
+
+// Renders FLAGS_headless_frames frames with the software backend without
+// creating a window or an OpenGL context. Returns the exit code.
+int RunHeadlessSoftwareRenderer(const wvu::Camera& camera) {
+  const Eigen::Matrix4f& projection = camera.projection_matrix();
+  const Eigen::Matrix4f& view = camera.view_matrix();
+  std::vector<Model*> models_to_draw;
+  std::vector<Model*> occluders;
+  ConstructModels(&models_to_draw, &occluders);
+  wvu::ThreadPool thread_pool(FLAGS_num_threads);
+  wvu::SoftwareRenderer software_renderer(kWindowWidth, kWindowHeight,
+                                          &thread_pool);
+  // Without a display, a frame is shown when the CPU finishes it.
+  const bool measure_input_latency =
+      !FLAGS_latency_histogram_csv.empty() || FLAGS_inject_input_hz > 0.0;
+  wvu::InputLatencyTracker input_latency_tracker(
+      false, kMaxInputLatencyFramesInFlight, kInputLatencyBinSeconds,
+      kNumInputLatencyBins);
+  std::unique_ptr<wvu::SyntheticInputInjector> input_injector;
+  if (FLAGS_inject_input_hz > 0.0) {
+    input_injector.reset(
+        new wvu::SyntheticInputInjector(FLAGS_inject_input_hz));
+  }
+  wvu::ModelBounds model_bounds;
+  std::vector<uint8_t> in_frustum;
+  const std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+  double total_seconds = 0.0;
+  for (int frame = 0; frame < FLAGS_headless_frames; ++frame) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (input_injector != nullptr) {
+      input_injector->Poll(
+          std::chrono::duration<double>(start - epoch).count(),
+          &input_latency_tracker);
+    }
+    model_bounds.Update(models_to_draw);
+    model_bounds.TestInFrustum(camera, &in_frustum);
+    std::vector<Model*> visible_models;
+    for (int i = 0; i < model_bounds.size(); ++i) {
+      if (in_frustum[i]) {
+        visible_models.push_back(model_bounds.model(i));
+      }
+    }
+    if (FLAGS_front_to_back) {
+      wvu::SortModelsFrontToBack(view, &visible_models);
+    }
+    software_renderer.BeginFrame();
+    for (Model* model : visible_models) {
+      software_renderer.Draw(model, projection, view);
+    }
+    software_renderer.EndFrame();
+    const std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now();
+    input_latency_tracker.FrameSwapped(
+        input_latency_tracker.FrameSubmitted(),
+        std::chrono::duration<double>(end - epoch).count());
+    total_seconds += std::chrono::duration<double>(end - start).count();
+  }
+  std::cout << "Headless software backend: " << FLAGS_headless_frames
+            << " frames, " << 1e3 * total_seconds / FLAGS_headless_frames
+            << " ms per frame with " << thread_pool.num_threads()
+            << " threads\n";
+  PrintSoftwareRendererStats(software_renderer.stats());
+  if (measure_input_latency) {
+    PrintInputLatencyStats(input_latency_tracker.ComputeStats());
+  }
+  bool saved = ExportInputLatencyHistogram(input_latency_tracker);
+  if (!FLAGS_software_output_ppm.empty()) {
+    if (!software_renderer.SaveFrameAsPpm(FLAGS_software_output_ppm)) {
+      saved = false;
+      std::cerr << "ERROR: Could not write " << FLAGS_software_output_ppm
+                << "\n";
+    }
+  }
+  DeleteModels(&models_to_draw);
+  return saved ? 0 : -1;
 }
 
 }  // namespace
 
 int main(int argc, char** argv) {
+  CS470_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Construct the camera.
+  wvu::Camera camera;
+  if (!ConfigureCamera(FLAGS_projection, &camera)) {
+    std::cerr << "ERROR: Unknown projection: " << FLAGS_projection << "\n";
+    return -1;
+  }
+  const bool reverse_z = camera.projection_type() ==
+      wvu::ProjectionType::REVERSE_Z_INFINITE_PERSPECTIVE;
+  // The CPU rasterizers clip and test depth with the [-1, 1] convention.
+  if (reverse_z && (FLAGS_render_backend == "software" ||
+                    FLAGS_occlusion_culling == "software")) {
+    std::cerr << "ERROR: The reverse_z projection needs the opengl backend "
+              << "and no software occlusion culling.\n";
+    return -1;
+  }
+
+  if (!FLAGS_gl_capture_path.empty() && !wvu::kGlHooksEnabled) {
+    std::cerr << "ERROR: The OpenGL command capture needs the "
+              << "ENABLE_GL_HOOKS build option (cmake -DENABLE_GL_HOOKS=ON).\n";
+    return -1;
+  }
+
+  // Select the variant of the math kernels once, before any kernel runs.
+  if (FLAGS_simd_level.empty()) {
+    wvu::GetSimdLevel();
+  } else {
+    wvu::SimdLevel simd_level;
+    if (!wvu::ParseSimdLevel(FLAGS_simd_level, &simd_level)) {
+      std::cerr << "ERROR: Unknown simd_level: " << FLAGS_simd_level << "\n";
+      return -1;
+    }
+    if (!wvu::ForceSimdLevel(simd_level)) {
+      std::cerr << "ERROR: This build or CPU does not support simd_level "
+                << FLAGS_simd_level << ".\n";
+      return -1;
+    }
+  }
+  std::cout << "Math kernels: " << wvu::SimdLevelName(wvu::GetSimdLevel())
+            << "\n";
+
+  // The CPU rasterizers and the shader-based wireframes read the CPU copy of
+  // the geometry, the static batcher rebuilds a chunk from the CPU copy of
+  // all its models, the dynamic batcher transforms it every frame, and only
+  // the single-view OpenGL path uploads on demand.
+  if (FLAGS_drop_cpu_geometry &&
+      (FLAGS_render_backend == "software" ||
+       FLAGS_occlusion_culling == "software" ||
+       FLAGS_wireframe_mode != "polygon_mode" || FLAGS_static_batching ||
+       FLAGS_dynamic_batching)) {
+    std::cerr << "ERROR: drop_cpu_geometry needs the opengl backend, the "
+              << "polygon_mode wireframes, and no software occlusion "
+              << "culling, static batching or dynamic batching.\n";
+    return -1;
+  }
+  // Only the single-view OpenGL path without occlusion queries has a depth
+  // pre-pass, and the multi-view renderer draws the models in their order.
+  // Sorting is on by default, so only asking for it with multiple views is
+  // an error.
+  if (FLAGS_depth_pre_pass &&
+      (FLAGS_render_backend == "software" || FLAGS_num_views > 1 ||
+       FLAGS_occlusion_culling == "hardware")) {
+    std::cerr << "ERROR: The depth pre-pass needs the opengl backend, a "
+              << "single view and no hardware occlusion culling.\n";
+    return -1;
+  }
+  if (FLAGS_front_to_back && FLAGS_num_views > 1 &&
+      !CS470_GFLAGS_NAMESPACE::GetCommandLineFlagInfoOrDie("front_to_back")
+           .is_default) {
+    std::cerr << "ERROR: Sorting the models front to back needs a single "
+              << "view.\n";
+    return -1;
+  }
+  if (FLAGS_gpu_memory_budget_mb > 0 &&
+      (FLAGS_render_backend == "software" || FLAGS_num_views > 1)) {
+    std::cerr << "ERROR: The GPU memory budget needs the opengl backend and "
+              << "a single view.\n";
+    return -1;
+  }
+  if (FLAGS_vertex_fetch != "classic" && FLAGS_vertex_fetch != "pulling" &&
+      FLAGS_vertex_fetch != "alternate") {
+    std::cerr << "ERROR: Unknown vertex fetch: " << FLAGS_vertex_fetch
+              << "\n";
+    return -1;
+  }
+  // The batches and the pulled vertices replace the OpenGL draws of
+  // RenderScene(), which the software backend and the multi-view renderer do
+  // not make, and have none of the vertex attributes of the shader-based
+  // wireframes.
+  const bool pull_vertices = FLAGS_vertex_fetch != "classic";
+  if ((FLAGS_static_batching || FLAGS_dynamic_batching || pull_vertices) &&
+      (FLAGS_render_backend == "software" || FLAGS_num_views > 1 ||
+       FLAGS_wireframe_mode != "polygon_mode")) {
+    std::cerr << "ERROR: Batching and vertex pulling need the opengl "
+              << "backend, a single view and the polygon_mode wireframes.\n";
+    return -1;
+  }
+  // The merged buffers and the arenas keep the geometry of their models on
+  // the GPU for good, where the budget cannot evict it.
+  if ((FLAGS_static_batching || pull_vertices) &&
+      FLAGS_gpu_memory_budget_mb > 0) {
+    std::cerr << "ERROR: Static batching and vertex pulling need no GPU "
+              << "memory budget.\n";
+    return -1;
+  }
+  // Both draw the same models, so the batcher would never draw.
+  if (FLAGS_vertex_fetch == "pulling" && FLAGS_dynamic_batching) {
+    std::cerr << "ERROR: Dynamic batching needs the classic or the alternate "
+              << "vertex fetch.\n";
+    return -1;
+  }
+  if (FLAGS_gpu_memory_budget_mb > 0 && FLAGS_drop_cpu_geometry &&
+      FLAGS_mesh_pack.empty()) {
+    std::cerr << "ERROR: The GPU memory budget with drop_cpu_geometry needs a "
+              << "mesh_pack to read the evicted models back.\n";
+    return -1;
+  }
+
+  // The software backend does not need a window to render.
+  if (FLAGS_render_backend == "software" && FLAGS_headless_frames > 0) {
+    return RunHeadlessSoftwareRenderer(camera);
+  }
+
   // Initialize the GLFW library.
   if (!glfwInit()) {
     return -1;
@@ -231,8 +1635,18 @@ int main(int argc, char** argv) {
 
   // Make the window's context current.
   glfwMakeContextCurrent(window);
-  glfwSwapInterval(1);
+  // Adaptive vsync tears instead of waiting a whole refresh for a late frame.
+  const bool adaptive_vsync = FLAGS_adaptive_vsync &&
+      (glfwExtensionSupported("GLX_EXT_swap_control_tear") ||
+       glfwExtensionSupported("WGL_EXT_swap_control_tear"));
+  glfwSwapInterval(adaptive_vsync ? -1 : 1);
   glfwSetKeyCallback(window, KeyCallback);
+  glfwSetWindowRefreshCallback(window, WindowRefreshCallback);
+  glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+  glfwSetWindowFocusCallback(window, WindowFocusCallback);
+  glfwSetMouseButtonCallback(window, MouseButtonCallback);
+  glfwSetCursorPosCallback(window, CursorPosCallback);
+  glfwSetScrollCallback(window, ScrollCallback);
 
   // Initialize GLEW.
   glewExperimental = GL_TRUE;
@@ -242,43 +1656,710 @@ int main(int argc, char** argv) {
     return -1;
   }
 
+  // Record the OpenGL commands from the first one.
+  wvu::GlCommandWriter gl_command_writer;
+  if (!FLAGS_gl_capture_path.empty() &&
+      !StartGlCommandCapture(window, &gl_command_writer)) {
+    glfwTerminate();
+    return -1;
+  }
+
   // Configure View Port.
   ConfigureViewPort(window);
 
+  // Configure the depth buffer.
+  if (reverse_z && !GLEW_ARB_clip_control) {
+    std::cerr << "ERROR: The reverse_z projection needs ARB_clip_control.\n";
+    glfwTerminate();
+    return -1;
+  }
+  ConfigureDepthTest(reverse_z);
+
   // Compile shaders and create shader program.
+  // With late-latching, the camera comes from a uniform buffer.
+  const std::string& scene_vertex_shader_src = FLAGS_late_latching ?
+      camera_block_vertex_shader_src : vertex_shader_src;
   wvu::ShaderProgram shader_program;
-  if (!CreateShaderProgram(&shader_program)) {
+  if (!CreateShaderProgram(scene_vertex_shader_src, fragment_shader_src,
+                           &shader_program)) {
+    return -1;
+  }
+  wvu::ShaderProgram depth_shader_program;
+  if (FLAGS_depth_pre_pass &&
+      !CreateShaderProgram(scene_vertex_shader_src, depth_fragment_shader_src,
+                           &depth_shader_program)) {
     return -1;
   }
 
   // Construct the models to draw in the scene.
   std::vector<Model*> models_to_draw;
-  ConstructModels(&models_to_draw);
+  std::vector<Model*> occluders;
+  ConstructModels(&models_to_draw, &occluders);
+  // With static batching, the batcher draws the static models and only the
+  // others are drawn one by one.
+  std::vector<Model*> static_models;
+  std::vector<Model*> dynamic_models;
+  if (FLAGS_static_batching) {
+    for (Model* model : models_to_draw) {
+      const bool is_static = !FLAGS_animate ||
+          std::find(occluders.begin(), occluders.end(), model) !=
+              occluders.end();
+      (is_static ? static_models : dynamic_models).push_back(model);
+    }
+  }
+  std::vector<Model*>* models_to_render =
+      FLAGS_static_batching ? &dynamic_models : &models_to_draw;
+  // Write the geometry of the unique meshes into the mesh pack.
+  const std::vector<wvu::Mesh*> meshes = CollectUniqueMeshes(models_to_draw);
+  wvu::MeshPack mesh_pack;
+  if (!FLAGS_mesh_pack.empty()) {
+    std::string error_info_log;
+    if (!wvu::MeshPack::Write(FLAGS_mesh_pack,
+                              std::vector<const wvu::Mesh*>(meshes.begin(),
+                                                            meshes.end()),
+                              &error_info_log) ||
+        !mesh_pack.Open(FLAGS_mesh_pack, &error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+  }
+  // Upload the meshes as their models become visible within the budget, or
+  // all of them now.
+  std::unique_ptr<wvu::ModelResidencyManager> residency_manager;
+  if (FLAGS_gpu_memory_budget_mb > 0) {
+    residency_manager.reset(new wvu::ModelResidencyManager(
+        static_cast<int64_t>(FLAGS_gpu_memory_budget_mb) << 20,
+        FLAGS_drop_cpu_geometry,
+        FLAGS_mesh_pack.empty() ? nullptr : &mesh_pack));
+    for (size_t i = 0; i < meshes.size(); ++i) {
+      residency_manager->AddMesh(
+          meshes[i], FLAGS_mesh_pack.empty() ? -1 : static_cast<int>(i));
+    }
+  } else if (!SetModelsIntoGpu(*models_to_render)) {
+    std::cerr << "ERROR: A mesh has no geometry to upload to the GPU.\n";
+    return -1;
+  }
 
-  // Construct the camera projection matrix.
-  const float field_of_view = wvu::ConvertDegreesToRadians(45.0f);
-  const float aspect_ratio = static_cast<float>(kWindowWidth / kWindowHeight);
-  const float near_plane = 0.1f;
-  const float far_plane = 10.0f;
-  const Eigen::Matrix4f& projection =
-      wvu::ComputePerspectiveProjectionMatrix(field_of_view, aspect_ratio,
-                                              near_plane, far_plane);
-  const Eigen::Matrix4f view = Eigen::Matrix4f::Identity();
+  // Set up the culling.
+  wvu::ThreadPool thread_pool(FLAGS_num_threads);
+  wvu::ModelBounds model_bounds;
+  RenderingSubsystems subsystems;
+  subsystems.model_bounds = &model_bounds;
+  subsystems.reverse_z = reverse_z;
+  subsystems.sort_front_to_back = FLAGS_front_to_back;
+  subsystems.residency_manager = residency_manager.get();
+  std::unique_ptr<wvu::StaticBatcher> static_batcher;
+  if (FLAGS_static_batching) {
+    static_batcher.reset(new wvu::StaticBatcher(FLAGS_static_batch_chunk_size,
+                                                &thread_pool));
+    for (Model* model : static_models) {
+      static_batcher->AddModel(model, kStaticBatchKey);
+    }
+    static_batcher->Update();
+    subsystems.static_batcher = static_batcher.get();
+  }
+  std::unique_ptr<wvu::DynamicBatcher> dynamic_batcher;
+  if (FLAGS_dynamic_batching) {
+    dynamic_batcher.reset(
+        new wvu::DynamicBatcher(FLAGS_dynamic_batch_max_vertices,
+                                FLAGS_dynamic_batch_capacity, &thread_pool));
+    std::string error_info_log;
+    if (!dynamic_batcher->Initialize(&error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    subsystems.dynamic_batcher = dynamic_batcher.get();
+  }
+  std::unique_ptr<wvu::TransformBuffer> transform_buffer;
+  std::unique_ptr<wvu::VertexPullingRenderer> vertex_pulling_renderer;
+  wvu::ShaderProgram vertex_pulling_shader_program;
+  wvu::ShaderProgram vertex_pulling_depth_shader_program;
+  if (pull_vertices) {
+    if (!CreateShaderProgram(wvu::VertexPullingRenderer::kVertexShaderSource,
+                             fragment_shader_src,
+                             &vertex_pulling_shader_program)) {
+      return -1;
+    }
+    if (FLAGS_depth_pre_pass &&
+        !CreateShaderProgram(wvu::VertexPullingRenderer::kVertexShaderSource,
+                             depth_fragment_shader_src,
+                             &vertex_pulling_depth_shader_program)) {
+      return -1;
+    }
+    GLint max_texture_buffer_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texture_buffer_size);
+    transform_buffer.reset(new wvu::TransformBuffer(max_texture_buffer_size));
+    vertex_pulling_renderer.reset(new wvu::VertexPullingRenderer(
+        max_texture_buffer_size, transform_buffer.get()));
+    std::string error_info_log;
+    if (!transform_buffer->Initialize(&error_info_log) ||
+        !vertex_pulling_renderer->Initialize(&error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    // Fill the arenas and the transform buffer before the first frame.
+    for (Model* model : *models_to_render) {
+      vertex_pulling_renderer->AddMesh(model->mesh());
+      transform_buffer->Add(model);
+    }
+    subsystems.transform_buffer = transform_buffer.get();
+    subsystems.vertex_pulling_renderer = vertex_pulling_renderer.get();
+    subsystems.vertex_pulling_shader_program = &vertex_pulling_shader_program;
+    if (FLAGS_depth_pre_pass) {
+      subsystems.vertex_pulling_depth_shader_program =
+          &vertex_pulling_depth_shader_program;
+    }
+    subsystems.pull_vertices = true;
+  }
+  // The arenas have a copy of the geometry, so the CPU one is not needed
+  // anymore. With a budget, the residency manager drops it after uploading
+  // the meshes.
+  if (FLAGS_drop_cpu_geometry && residency_manager == nullptr) {
+    for (wvu::Mesh* mesh : meshes) {
+      mesh->ReleaseCpuGeometry();
+    }
+  }
+  if (FLAGS_depth_pre_pass) {
+    subsystems.depth_shader_program = &depth_shader_program;
+  }
+  std::unique_ptr<wvu::OcclusionCuller> occlusion_culler;
+  std::unique_ptr<wvu::HardwareOcclusionCuller> hardware_occlusion_culler;
+  if (FLAGS_occlusion_culling == "software") {
+    occlusion_culler.reset(
+        new wvu::OcclusionCuller(FLAGS_occlusion_buffer_width,
+                                 FLAGS_occlusion_buffer_height,
+                                 &thread_pool));
+    for (Model* occluder : occluders) {
+      occlusion_culler->AddOccluder(occluder);
+    }
+    subsystems.occlusion_culler = occlusion_culler.get();
+  } else if (FLAGS_occlusion_culling == "hardware") {
+    // The culler draws the models itself, with glPolygonMode lines for the
+    // wireframes.
+    if (FLAGS_wireframe_mode != "polygon_mode") {
+      std::cerr << "ERROR: Hardware occlusion culling needs the "
+                << "polygon_mode wireframes.\n";
+      return -1;
+    }
+    hardware_occlusion_culler.reset(
+        new wvu::HardwareOcclusionCuller(FLAGS_occlusion_query_interval));
+    std::string error_info_log;
+    if (!hardware_occlusion_culler->Initialize(&error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    subsystems.hardware_occlusion_culler = hardware_occlusion_culler.get();
+  } else if (FLAGS_occlusion_culling != "none") {
+    std::cerr << "ERROR: Unknown occlusion culling method: "
+              << FLAGS_occlusion_culling << "\n";
+    return -1;
+  }
+
+  // Set up the render backend.
+  std::unique_ptr<wvu::SoftwareRenderer> software_renderer;
+  if (FLAGS_render_backend == "software") {
+    if (subsystems.hardware_occlusion_culler != nullptr) {
+      std::cerr << "ERROR: Hardware occlusion culling needs the opengl "
+                << "backend.\n";
+      return -1;
+    }
+    software_renderer.reset(
+        new wvu::SoftwareRenderer(kWindowWidth, kWindowHeight, &thread_pool));
+    subsystems.software_renderer = software_renderer.get();
+  } else if (FLAGS_render_backend != "opengl") {
+    std::cerr << "ERROR: Unknown render backend: " << FLAGS_render_backend
+              << "\n";
+    return -1;
+  }
+
+  // Set up the views.
+  std::unique_ptr<wvu::MultiViewRenderer> multi_view_renderer;
+  std::vector<wvu::Camera, Eigen::aligned_allocator<wvu::Camera> >
+      view_cameras;
+  std::vector<wvu::RenderView> views;
+  if (FLAGS_num_views > 1) {
+    if (FLAGS_num_views > wvu::MultiViewRenderer::kMaxViews ||
+        FLAGS_render_backend != "opengl" ||
+        FLAGS_occlusion_culling != "none" ||
+        FLAGS_wireframe_mode != "polygon_mode") {
+      std::cerr << "ERROR: Multiple views support up to "
+                << wvu::MultiViewRenderer::kMaxViews << " views with the "
+                << "opengl backend, no occlusion culling and polygon_mode "
+                << "wireframes.\n";
+      return -1;
+    }
+    multi_view_renderer.reset(new wvu::MultiViewRenderer);
+    std::string error_info_log;
+    if (!multi_view_renderer->Initialize(FLAGS_multi_view_instancing,
+                                         &error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    BuildSplitScreenViews(FLAGS_projection, FLAGS_num_views, &view_cameras,
+                          &views);
+    subsystems.multi_view_renderer = multi_view_renderer.get();
+    subsystems.views = &views;
+  }
+
+  // Set up the partial redraws.
+  std::unique_ptr<wvu::RenderTarget> render_target;
+  std::unique_ptr<wvu::DamageTracker> damage_tracker;
+  if (FLAGS_damage_tracking) {
+    if (FLAGS_render_backend != "opengl" || FLAGS_num_views > 1 ||
+        FLAGS_occlusion_culling == "hardware") {
+      std::cerr << "ERROR: Damage tracking needs the opengl backend, a "
+                << "single view and no hardware occlusion culling.\n";
+      return -1;
+    }
+    int width;
+    int height;
+    glfwGetFramebufferSize(window, &width, &height);
+    render_target.reset(new wvu::RenderTarget);
+    std::string error_info_log;
+    if (!render_target->Create(width, height, &error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    // The margin covers the wide lines of the wireframes.
+    const int margin_pixels =
+        static_cast<int>(std::ceil(FLAGS_wireframe_line_width)) + 1;
+    damage_tracker.reset(new wvu::DamageTracker(width, height, margin_pixels));
+    subsystems.render_target = render_target.get();
+    subsystems.damage_tracker = damage_tracker.get();
+  }
+
+  // Set up the wireframes.
+  std::unique_ptr<wvu::WireframeRenderer> wireframe_renderer;
+  if (!wvu::ParseWireframeMode(FLAGS_wireframe_mode,
+                               &subsystems.wireframe_mode)) {
+    std::cerr << "ERROR: Unknown wireframe mode: " << FLAGS_wireframe_mode
+              << "\n";
+    return -1;
+  }
+  if (subsystems.wireframe_mode != wvu::WireframeMode::POLYGON_MODE) {
+    wireframe_renderer.reset(new wvu::WireframeRenderer);
+    std::string error_info_log;
+    if (!wireframe_renderer->Initialize(&error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    wireframe_renderer->set_line_width(FLAGS_wireframe_line_width);
+    wireframe_renderer->set_hidden_line_removal(FLAGS_hidden_line_removal);
+    for (Model* model : models_to_draw) {
+      wireframe_renderer->PrepareModel(model);
+    }
+    subsystems.wireframe_renderer = wireframe_renderer.get();
+  }
+
+  // Set up the GPU measurements. The occlusion queries already use the
+  // samples passed target, so the overdraw is not measured with them.
+  std::unique_ptr<wvu::GpuQueryRing> gpu_timer;
+  std::unique_ptr<wvu::GpuQueryRing> shaded_samples_counter;
+  GpuMeasurements gpu_measurements;
+  if (FLAGS_stats_interval > 0) {
+    gpu_timer.reset(
+        new wvu::GpuQueryRing(GL_TIME_ELAPSED, kNumGpuQueriesInFlight));
+    subsystems.gpu_timer = gpu_timer.get();
+    if (subsystems.hardware_occlusion_culler == nullptr) {
+      shaded_samples_counter.reset(
+          new wvu::GpuQueryRing(GL_SAMPLES_PASSED, kNumGpuQueriesInFlight));
+      subsystems.shaded_samples_counter = shaded_samples_counter.get();
+    }
+  }
+
+  // Set up the dynamic resolution. The render target has the size of the
+  // window, and the frames are rendered into its bottom-left region.
+  std::unique_ptr<wvu::RenderTarget> scaled_render_target;
+  std::unique_ptr<wvu::Upscaler> upscaler;
+  std::unique_ptr<wvu::ResolutionScaleController> resolution_controller;
+  wvu::UpscaleFilter upscale_filter = wvu::UpscaleFilter::SHARPEN;
+  std::ofstream resolution_scale_log;
+  if (FLAGS_dynamic_resolution) {
+    if (FLAGS_render_backend != "opengl" || FLAGS_num_views > 1 ||
+        FLAGS_damage_tracking) {
+      std::cerr << "ERROR: Dynamic resolution needs the opengl backend, a "
+                << "single view and no damage tracking.\n";
+      return -1;
+    }
+    if (FLAGS_min_resolution_scale <= 0.0 ||
+        FLAGS_min_resolution_scale > FLAGS_max_resolution_scale ||
+        FLAGS_max_resolution_scale > 1.0) {
+      std::cerr << "ERROR: The resolution scales must satisfy 0 < "
+                << "min_resolution_scale <= max_resolution_scale <= 1.\n";
+      return -1;
+    }
+    if (!wvu::ParseUpscaleFilter(FLAGS_upscale_filter, &upscale_filter)) {
+      std::cerr << "ERROR: Unknown upscale filter: " << FLAGS_upscale_filter
+                << "\n";
+      return -1;
+    }
+    int width;
+    int height;
+    glfwGetFramebufferSize(window, &width, &height);
+    scaled_render_target.reset(new wvu::RenderTarget);
+    upscaler.reset(new wvu::Upscaler);
+    std::string error_info_log;
+    if (!scaled_render_target->Create(width, height, &error_info_log) ||
+        !upscaler->Initialize(&error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    upscaler->set_sharpness(FLAGS_upscale_sharpness);
+    // A change of scale shows in the GPU timer after the queries in flight.
+    constexpr double kResolutionHeadroom = 0.15;
+    resolution_controller.reset(new wvu::ResolutionScaleController(
+        1e-3 * FLAGS_target_frame_ms, FLAGS_min_resolution_scale,
+        FLAGS_max_resolution_scale, kResolutionHeadroom,
+        kNumGpuQueriesInFlight));
+    subsystems.resolution_controller = resolution_controller.get();
+    if (gpu_timer == nullptr) {
+      gpu_timer.reset(
+          new wvu::GpuQueryRing(GL_TIME_ELAPSED, kNumGpuQueriesInFlight));
+      subsystems.gpu_timer = gpu_timer.get();
+    }
+    if (!FLAGS_resolution_scale_log.empty()) {
+      resolution_scale_log.open(FLAGS_resolution_scale_log);
+      if (!resolution_scale_log.is_open()) {
+        std::cerr << "ERROR: Could not write " << FLAGS_resolution_scale_log
+                  << "\n";
+        return -1;
+      }
+      resolution_scale_log << "frame,scale,width,height,gpu_ms\n";
+    }
+  }
+
+  std::ofstream gpu_memory_log;
+  if (!FLAGS_gpu_memory_log.empty()) {
+    gpu_memory_log.open(FLAGS_gpu_memory_log);
+    if (!gpu_memory_log.is_open()) {
+      std::cerr << "ERROR: Could not write " << FLAGS_gpu_memory_log << "\n";
+      return -1;
+    }
+    gpu_memory_log << "frame,live_bytes,num_objects\n";
+  }
+
+  // Set up the frame capture.
+  std::unique_ptr<wvu::FrameCapture> frame_capture;
+  if (!FLAGS_capture_path.empty()) {
+    wvu::CaptureFormat capture_format;
+    if (!wvu::ParseCaptureFormat(FLAGS_capture_format, &capture_format)) {
+      std::cerr << "ERROR: Unknown capture format: " << FLAGS_capture_format
+                << "\n";
+      return -1;
+    }
+    // Frames beyond two rings waiting for the writer are dropped rather than
+    // slowing down the rendering.
+    frame_capture.reset(new wvu::FrameCapture(
+        capture_format, FLAGS_capture_path, FLAGS_capture_ring_size,
+        2 * FLAGS_capture_ring_size, FLAGS_capture_fps));
+    int width;
+    int height;
+    glfwGetFramebufferSize(window, &width, &height);
+    std::string error_info_log;
+    if (!frame_capture->Initialize(width, height, &error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+  }
+  std::chrono::steady_clock::time_point capture_start;
+  int num_frames_captured = 0;
+
+  // Set up the frame pacing and the late-latching. The camera is moved with
+  // the keyboard.
+  CameraController camera_controller;
+  std::unique_ptr<wvu::FramePacer> frame_pacer;
+  if (FLAGS_frame_pacing) {
+    const GLFWvidmode* video_mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    const double refresh_rate =
+        (video_mode != nullptr && video_mode->refreshRate > 0) ?
+        video_mode->refreshRate : 60.0;
+    constexpr int kFramePacingHistorySize = 16;
+    frame_pacer.reset(new wvu::FramePacer(1.0 / refresh_rate,
+                                          1e-3 * FLAGS_frame_pacing_margin_ms,
+                                          kFramePacingHistorySize));
+    subsystems.frame_pacer = frame_pacer.get();
+    std::cout << "Frame pacing at " << refresh_rate << " Hz with "
+              << (adaptive_vsync ? "adaptive " : "") << "vsync\n";
+  }
+  std::unique_ptr<wvu::CameraUniformBuffer> camera_uniform_buffer;
+  if (FLAGS_late_latching) {
+    if (FLAGS_render_backend != "opengl" || FLAGS_num_views > 1 ||
+        FLAGS_occlusion_culling == "hardware" || FLAGS_damage_tracking) {
+      std::cerr << "ERROR: Late-latching needs the opengl backend, a single "
+                << "view, no hardware occlusion culling and no damage "
+                << "tracking.\n";
+      return -1;
+    }
+    camera_uniform_buffer.reset(new wvu::CameraUniformBuffer);
+    std::string error_info_log;
+    if (!camera_uniform_buffer->Initialize(&error_info_log)) {
+      std::cerr << "ERROR: " << error_info_log << "\n";
+      return -1;
+    }
+    camera_uniform_buffer->BindToProgram(shader_program);
+    if (FLAGS_depth_pre_pass) {
+      camera_uniform_buffer->BindToProgram(depth_shader_program);
+    }
+    subsystems.camera_uniform_buffer = camera_uniform_buffer.get();
+    wvu::FramePacer* pacer = frame_pacer.get();
+    subsystems.late_latch_input = [window, pacer, &camera_controller,
+                                   &camera]() {
+      glfwPollEvents();
+      camera_controller.Update(window, &camera);
+      if (pacer != nullptr) {
+        pacer->InputSampled();
+      }
+    };
+  }
+
+  // Set up the input latency measurements. A frame is displayed once its swap
+  // returned and the GPU finished it; the GPU timestamps are converted into
+  // the clock of glfwGetTime() with an offset measured once.
+  std::unique_ptr<wvu::InputLatencyTracker> input_latency_tracker;
+  std::unique_ptr<wvu::SyntheticInputInjector> input_injector;
+  std::unique_ptr<wvu::GpuTimestampQueue> gpu_timestamps;
+  double gpu_to_cpu_seconds = 0.0;
+  if (!FLAGS_latency_histogram_csv.empty() || FLAGS_inject_input_hz > 0.0) {
+    const bool has_timestamps = GLEW_ARB_timer_query;
+    if (has_timestamps) {
+      gpu_timestamps.reset(new wvu::GpuTimestampQueue(
+          kMaxInputLatencyFramesInFlight));
+      gpu_to_cpu_seconds = glfwGetTime() -
+          1e-9 * wvu::GpuTimestampQueue::CurrentGpuTime();
+    }
+    input_latency_tracker.reset(new wvu::InputLatencyTracker(
+        has_timestamps, kMaxInputLatencyFramesInFlight,
+        kInputLatencyBinSeconds, kNumInputLatencyBins));
+    subsystems.input_latency_tracker = input_latency_tracker.get();
+    if (FLAGS_inject_input_hz > 0.0) {
+      input_injector.reset(
+          new wvu::SyntheticInputInjector(FLAGS_inject_input_hz));
+    }
+  }
+
+  // Set up the on-demand rendering. The window callbacks reach the scheduler
+  // and the latency tracker through the window user pointer.
+  wvu::RedrawScheduler redraw_scheduler;
+  redraw_scheduler.set_animating(FLAGS_animate);
+  WindowState window_state;
+  window_state.redraw_scheduler = &redraw_scheduler;
+  window_state.input_latency_tracker = input_latency_tracker.get();
+  glfwSetWindowUserPointer(window, &window_state);
+  CpuUsageMeter cpu_usage_meter;
 
   // Loop until the user closes the window.
+  int frame_number = 0;
+  std::chrono::steady_clock::time_point stats_interval_start =
+      std::chrono::steady_clock::now();
   while (!glfwWindowShouldClose(window)) {
+    // With frame pacing, sleep first and then sample the input; otherwise the
+    // input was polled after the last swap.
+    if (frame_pacer != nullptr) {
+      frame_pacer->WaitForFrameStart();
+      glfwPollEvents();
+    }
+    if (input_injector != nullptr &&
+        input_injector->Poll(glfwGetTime(), input_latency_tracker.get()) > 0) {
+      redraw_scheduler.Invalidate();
+    }
+    camera_controller.Update(window, &camera);
+    if (frame_pacer != nullptr) {
+      frame_pacer->InputSampled();
+    }
+    if (FLAGS_animate) {
+      AnimateModels(glfwGetTime(), occluders, &models_to_draw);
+    }
+    // The visibility of the hardware occlusion culler settles over the next
+    // frames, so keep drawing until its results arrive.
+    if (subsystems.hardware_occlusion_culler != nullptr &&
+        subsystems.hardware_occlusion_culler->stats().num_pending_results >
+            0) {
+      redraw_scheduler.Invalidate();
+    }
+    const uint64_t scene_version = wvu::ComputeSceneVersion(models_to_draw);
+    uint64_t camera_version = camera.version();
+    for (const wvu::Camera& view_camera : view_cameras) {
+      camera_version += view_camera.version();
+    }
+    if (FLAGS_on_demand_rendering &&
+        !redraw_scheduler.NeedsRedraw(scene_version, camera_version)) {
+      // Nothing changed: sleep until an event arrives or the timeout.
+      redraw_scheduler.FrameSkipped();
+      ReportCpuUsage(redraw_scheduler, &cpu_usage_meter);
+      glfwWaitEventsTimeout(FLAGS_idle_wait_seconds);
+      continue;
+    }
+
     // Render the scene!
-    RenderScene(shader_program, projection, view, &models_to_draw, window);
+    if (gl_command_writer.is_open()) {
+      gl_command_writer.BeginFrame();
+    }
+    if (frame_pacer != nullptr) {
+      frame_pacer->BeginFrame();
+    }
+    int window_width = 0;
+    int window_height = 0;
+    int scaled_width = 0;
+    int scaled_height = 0;
+    if (resolution_controller != nullptr) {
+      glfwGetFramebufferSize(window, &window_width, &window_height);
+      wvu::ComputeScaledSize(window_width, window_height,
+                             resolution_controller->scale(), &scaled_width,
+                             &scaled_height);
+      scaled_render_target->Bind(scaled_width, scaled_height);
+    }
+    RenderScene(shader_program, camera, models_to_render, subsystems,
+                window);
+    if (resolution_controller != nullptr) {
+      upscaler->Upscale(upscale_filter, *scaled_render_target, scaled_width,
+                        scaled_height, 0, window_width, window_height);
+    }
+    if (frame_capture != nullptr && frame_number >= FLAGS_capture_start_frame &&
+        (FLAGS_capture_frames == 0 ||
+         num_frames_captured < FLAGS_capture_frames)) {
+      if (num_frames_captured == 0) {
+        capture_start = std::chrono::steady_clock::now();
+      }
+      frame_capture->Capture(0);
+      ++num_frames_captured;
+    }
+    if (frame_pacer != nullptr) {
+      frame_pacer->EndFrame();
+    }
+    // The frame consumed the events polled so far, late-latched ones included.
+    int64_t input_latency_frame = -1;
+    if (input_latency_tracker != nullptr) {
+      input_latency_frame = input_latency_tracker->FrameSubmitted();
+      if (gpu_timestamps != nullptr) {
+        gpu_timestamps->Issue(input_latency_frame);
+      }
+    }
+    UpdateGpuMeasurements(subsystems, &gpu_measurements);
+    if (resolution_controller != nullptr) {
+      if (gpu_measurements.has_new_gpu_seconds) {
+        resolution_controller->Update(gpu_measurements.gpu_seconds);
+      }
+      if (resolution_scale_log.is_open()) {
+        resolution_scale_log << frame_number << ","
+                             << resolution_controller->scale() << ","
+                             << scaled_width << "," << scaled_height << ","
+                             << 1e3 * gpu_measurements.gpu_seconds << "\n";
+      }
+    }
+    if (gpu_memory_log.is_open()) {
+      const wvu::GlResourceRegistry& registry =
+          *wvu::GlResourceRegistry::Instance();
+      gpu_memory_log << frame_number << "," << registry.live_bytes() << ","
+                     << registry.num_live_objects() << "\n";
+    }
+    ++frame_number;
+    if (FLAGS_stats_interval > 0 && frame_number % FLAGS_stats_interval == 0) {
+      const std::chrono::steady_clock::time_point now =
+          std::chrono::steady_clock::now();
+      const double average_frame_seconds =
+          std::chrono::duration<double>(now - stats_interval_start).count() /
+          FLAGS_stats_interval;
+      PrintStats(frame_number, average_frame_seconds, subsystems,
+                 gpu_measurements);
+      // Measure the other vertex fetch in the next interval.
+      if (FLAGS_vertex_fetch == "alternate") {
+        subsystems.pull_vertices = !subsystems.pull_vertices;
+      }
+      if (num_frames_captured > 0) {
+        PrintFrameCaptureStats(frame_capture->stats(),
+                               std::chrono::duration<double>(
+                                   now - capture_start).count());
+      }
+      stats_interval_start = now;
+    }
+
+    redraw_scheduler.FrameRendered(scene_version, camera_version);
+    ReportCpuUsage(redraw_scheduler, &cpu_usage_meter);
+
+    if (gl_command_writer.is_open()) {
+      gl_command_writer.EndFrame();
+      if (gl_command_writer.num_frames() >= FLAGS_gl_capture_frames) {
+        FinishGlCommandCapture(&gl_command_writer);
+      }
+    }
 
     // Swap front and back buffers.
     glfwSwapBuffers(window);
 
+    if (input_latency_tracker != nullptr) {
+      input_latency_tracker->FrameSwapped(input_latency_frame, glfwGetTime());
+      std::vector<std::pair<int64_t, GLuint64> > timestamps;
+      if (gpu_timestamps != nullptr) {
+        gpu_timestamps->Poll(&timestamps);
+      }
+      for (const std::pair<int64_t, GLuint64>& timestamp : timestamps) {
+        input_latency_tracker->FrameFinishedOnGpu(
+            timestamp.first, gpu_to_cpu_seconds + 1e-9 * timestamp.second);
+      }
+    }
+
     // Poll for and process events.
-    glfwPollEvents();
+    if (frame_pacer != nullptr) {
+      frame_pacer->FramePresented();
+    } else {
+      glfwPollEvents();
+    }
+  }
+
+  if (gl_command_writer.is_open()) {
+    FinishGlCommandCapture(&gl_command_writer);
+  }
+  if (frame_capture != nullptr) {
+    frame_capture->Finish();
+    if (num_frames_captured > 0) {
+      std::cout << "Frame capture into " << FLAGS_capture_path << ":\n";
+      PrintFrameCaptureStats(frame_capture->stats(),
+                             std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() -
+                                 capture_start).count());
+    }
+  }
+  if (input_latency_tracker != nullptr) {
+    std::cout << "Input-to-display latency:\n";
+    PrintInputLatencyStats(input_latency_tracker->ComputeStats());
+    ExportInputLatencyHistogram(*input_latency_tracker);
+  }
+
+  if (software_renderer != nullptr && !FLAGS_software_output_ppm.empty() &&
+      !software_renderer->SaveFrameAsPpm(FLAGS_software_output_ppm)) {
+    std::cerr << "ERROR: Could not write " << FLAGS_software_output_ppm
+              << "\n";
   }
 
-  // Cleaning up tasks.
+  // Cleaning up tasks. GPU resources are released while the context exists.
+  camera_uniform_buffer.reset();
+  frame_capture.reset();
+  gpu_timestamps.reset();
+  upscaler.reset();
+  scaled_render_target.reset();
+  render_target.reset();
+  glfwSetWindowUserPointer(window, nullptr);
+  multi_view_renderer.reset();
+  static_batcher.reset();
+  dynamic_batcher.reset();
+  vertex_pulling_renderer.reset();
+  transform_buffer.reset();
+  vertex_pulling_shader_program.Release();
+  vertex_pulling_depth_shader_program.Release();
+  software_renderer.reset();
+  hardware_occlusion_culler.reset();
+  wireframe_renderer.reset();
+  gpu_timer.reset();
+  shaded_samples_counter.reset();
   DeleteModels(&models_to_draw);
+  depth_shader_program.Release();
+  shader_program.Release();
+  // The objects still registered were not released by their owners.
+  const int num_leaks =
+      wvu::GlResourceRegistry::Instance()->ReportLeaks(&std::cerr);
+  if (num_leaks > 0) {
+    std::cerr << "WARNING: " << num_leaks << " OpenGL objects leaked.\n";
+  }
   // Destroy window.
   glfwDestroyWindow(window);
   // Tear down GLFW library.
@@ -0,0 +1,321 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "dynamic_batcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "math_kernels.h"
+#include "model.h"
+#include "shader_program.h"
+#include "thread_pool.h"
+
+namespace wvu {
+namespace {
+
+// Regions of the streaming buffer, i.e., frames the GPU may lag behind.
+constexpr int kNumRegions = 3;
+// The mode that is off is measured every this many frames.
+constexpr int kProbeInterval = 32;
+// Weight of a new measurement in the smoothed costs.
+constexpr double kSmoothing = 0.1;
+// The vertices of a batched model are transformed on the stack.
+constexpr int kMaxVerticesPerModel = 1024;
+
+double Smooth(const double average, const double measurement) {
+  return average < 0.0 ? measurement :
+      (1.0 - kSmoothing) * average + kSmoothing * measurement;
+}
+
+double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+DynamicBatcher::DynamicBatcher(const int max_vertices_per_model,
+                               const int capacity_in_vertices,
+                               ThreadPool* thread_pool) :
+    max_vertices_per_model_(std::min(max_vertices_per_model,
+                                     kMaxVerticesPerModel)),
+    capacity_in_vertices_(capacity_in_vertices),
+    thread_pool_(thread_pool),
+    vertex_array_object_id_(0),
+    vertex_buffer_object_id_(0),
+    region_fences_(kNumRegions, nullptr),
+    region_(0),
+    region_num_vertices_(0),
+    batch_num_models_(0),
+    batch_first_vertex_(0),
+    batch_num_vertices_(0),
+    is_batching_(true),
+    batch_this_frame_(true),
+    frame_(0),
+    seconds_per_batched_model_(-1.0),
+    seconds_per_draw_(-1.0) {}
+
+DynamicBatcher::~DynamicBatcher() {
+  for (GLsync fence : region_fences_) {
+    if (fence != nullptr) glDeleteSync(fence);
+  }
+  if (vertex_array_object_id_ == 0) return;
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  registry->Unregister(GlObjectType::BUFFER, vertex_buffer_object_id_);
+  registry->Unregister(GlObjectType::VERTEX_ARRAY, vertex_array_object_id_);
+  glDeleteBuffers(1, &vertex_buffer_object_id_);
+  glDeleteVertexArrays(1, &vertex_array_object_id_);
+}
+
+bool DynamicBatcher::Initialize(std::string* error_info_log) {
+  if (capacity_in_vertices_ <= 0) {
+    if (error_info_log) {
+      *error_info_log = "The streaming buffer needs a positive capacity.";
+    }
+    return false;
+  }
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  glGenVertexArrays(1, &vertex_array_object_id_);
+  glGenBuffers(1, &vertex_buffer_object_id_);
+  registry->Register(GlObjectType::VERTEX_ARRAY, vertex_array_object_id_,
+                     "dynamic_batcher", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER, vertex_buffer_object_id_,
+                     "dynamic_batcher", WVU_GL_CREATION_SITE);
+  glBindVertexArray(vertex_array_object_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_object_id_);
+  const GLsizeiptr buffer_size =
+      static_cast<GLsizeiptr>(kNumRegions) * capacity_in_vertices_ * 3 *
+      sizeof(GLfloat);
+  glBufferData(GL_ARRAY_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, vertex_buffer_object_id_,
+                    buffer_size);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                        static_cast<GLvoid*>(0));
+  glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
+  return true;
+}
+
+int DynamicBatcher::NumTriangleListVertices(const Model& model) {
+  return model.num_indices() == 0 ? model.num_vertices() : model.num_indices();
+}
+
+void DynamicBatcher::BeginFrame() {
+  // Fence the region of the last frame after all its draws.
+  if (region_num_vertices_ > 0) {
+    region_fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  region_ = (region_ + 1) % kNumRegions;
+  region_num_vertices_ = 0;
+  batch_models_.clear();
+  batch_num_vertices_ = 0;
+  // Wait until the GPU is done with the frame that used the region last.
+  GLsync& fence = region_fences_[region_];
+  if (fence != nullptr) {
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      constexpr GLuint64 kNoTimeout = 0xFFFFFFFFFFFFFFFFull;
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kNoTimeout);
+      ++stats_.num_fence_waits;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  // Every few frames, the small models take the other path to measure it.
+  ++frame_;
+  batch_this_frame_ = is_batching_ != (frame_ % kProbeInterval == 0);
+}
+
+void DynamicBatcher::Draw(const ShaderProgram& shader_program,
+                          const Eigen::Matrix4f& projection,
+                          const Eigen::Matrix4f& view,
+                          const std::vector<Model*>& models) {
+  std::vector<Model*> small_models;
+  std::vector<Model*> other_models;
+  small_models.reserve(models.size());
+  for (Model* model : models) {
+    const bool is_small =
+        NumTriangleListVertices(*model) <= max_vertices_per_model_ &&
+        model->num_vertices() <= max_vertices_per_model_ &&
+        model->mesh()->has_cpu_geometry();
+    (is_small ? small_models : other_models).push_back(model);
+  }
+
+  if (!small_models.empty() && batch_this_frame_) {
+    // The vertices are in the world frame already.
+    const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+    const GLuint program_id = shader_program.shader_program_id();
+    glUniformMatrix4fv(glGetUniformLocation(program_id, "model"), 1, GL_FALSE,
+                       identity.data());
+    glUniformMatrix4fv(glGetUniformLocation(program_id, "view"), 1, GL_FALSE,
+                       view.data());
+    glUniformMatrix4fv(glGetUniformLocation(program_id, "projection"), 1,
+                       GL_FALSE, projection.data());
+    const auto start = std::chrono::steady_clock::now();
+    const int num_streamed_vertices = region_num_vertices_;
+    const int num_batched_models = DrawBatch(small_models);
+    // A batch drawn again costs nothing to measure.
+    if (num_batched_models > 0 &&
+        region_num_vertices_ > num_streamed_vertices) {
+      seconds_per_batched_model_ = Smooth(
+          seconds_per_batched_model_, SecondsSince(start) / num_batched_models);
+    }
+    // The models beyond the capacity are drawn one by one.
+    other_models.insert(other_models.end(),
+                        small_models.begin() + num_batched_models,
+                        small_models.end());
+  } else if (!small_models.empty()) {
+    const auto start = std::chrono::steady_clock::now();
+    for (Model* model : small_models) {
+      model->Draw(shader_program, projection, view);
+    }
+    seconds_per_draw_ = Smooth(seconds_per_draw_,
+                               SecondsSince(start) / small_models.size());
+    stats_.num_individual_draws += small_models.size();
+  }
+  for (Model* model : other_models) {
+    model->Draw(shader_program, projection, view);
+  }
+  stats_.num_individual_draws += other_models.size();
+
+  // Batch while a batched model costs less than its draw call.
+  if (seconds_per_batched_model_ >= 0.0 && seconds_per_draw_ >= 0.0) {
+    const bool batching_pays_off =
+        seconds_per_batched_model_ <= seconds_per_draw_;
+    if (batching_pays_off != is_batching_) {
+      is_batching_ = batching_pays_off;
+      ++stats_.num_switches;
+    }
+  }
+}
+
+int DynamicBatcher::DrawBatch(const std::vector<Model*>& models) {
+  // The same models as the last batch of the frame, e.g., of the depth
+  // pre-pass, have the same vertices already.
+  if (batch_num_vertices_ > 0 && models == batch_models_) {
+    glBindVertexArray(vertex_array_object_id_);
+    glDrawArrays(GL_TRIANGLES, batch_first_vertex_, batch_num_vertices_);
+    glBindVertexArray(0);
+    stats_.num_batched_models += batch_num_models_;
+    ++stats_.num_batch_draws;
+    return batch_num_models_;
+  }
+
+  // Lay out the triangle lists of the models until the region is full.
+  std::vector<int> first_vertices;
+  first_vertices.reserve(models.size());
+  const int capacity_in_vertices =
+      capacity_in_vertices_ - region_num_vertices_;
+  int num_vertices = 0;
+  int num_models = 0;
+  for (; num_models < static_cast<int>(models.size()); ++num_models) {
+    const int model_vertices = NumTriangleListVertices(*models[num_models]);
+    if (num_vertices + model_vertices > capacity_in_vertices) break;
+    first_vertices.push_back(num_vertices);
+    num_vertices += model_vertices;
+  }
+  if (num_vertices == 0) return num_models;
+
+  // The fence of BeginFrame() already synchronizes the region, so the driver
+  // does not need to.
+  const GLint first_vertex =
+      region_ * capacity_in_vertices_ + region_num_vertices_;
+  const GLintptr offset =
+      static_cast<GLintptr>(first_vertex) * 3 * sizeof(GLfloat);
+  const GLsizeiptr size =
+      static_cast<GLsizeiptr>(num_vertices) * 3 * sizeof(GLfloat);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_object_id_);
+  float* destination = static_cast<float*>(glMapBufferRange(
+      GL_ARRAY_BUFFER, offset, size,
+      GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+      GL_MAP_INVALIDATE_RANGE_BIT));
+  const bool is_mapped = destination != nullptr;
+  if (!is_mapped) {
+    staging_vertices_.resize(3 * num_vertices);
+    destination = staging_vertices_.data();
+  }
+
+  // Transform the vertices of every model on the stack with the vertex
+  // kernel, then expand its triangle list into the buffer. The mapping is
+  // only written, since reading it back is slow. The kernel runs on the
+  // calling thread, since ParallelFor() is not reentrant.
+  thread_pool_->ParallelFor(0, num_models, [&](const int i) {
+    Model* model = models[i];
+    const Eigen::Matrix4f model_matrix = model->ComputeModelMatrix();
+    const Eigen::MatrixXf& vertices = model->vertices();
+    const int num_model_vertices = static_cast<int>(vertices.cols());
+    const std::vector<GLuint>& indices = model->indices();
+    float* output = destination + 3 * first_vertices[i];
+    if (indices.empty()) {
+      TransformVertices(model_matrix, vertices.data(), num_model_vertices,
+                        output, nullptr);
+      return;
+    }
+    float transformed_data[3 * kMaxVerticesPerModel];
+    TransformVertices(model_matrix, vertices.data(), num_model_vertices,
+                      transformed_data, nullptr);
+    for (size_t j = 0; j < indices.size(); ++j) {
+      const float* vertex = transformed_data + 3 * indices[j];
+      output[3 * j] = vertex[0];
+      output[3 * j + 1] = vertex[1];
+      output[3 * j + 2] = vertex[2];
+    }
+  });
+  if (is_mapped) {
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  } else {
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, destination);
+  }
+
+  glBindVertexArray(vertex_array_object_id_);
+  glDrawArrays(GL_TRIANGLES, first_vertex, num_vertices);
+  glBindVertexArray(0);
+  region_num_vertices_ += num_vertices;
+  batch_models_ = models;
+  batch_num_models_ = num_models;
+  batch_first_vertex_ = first_vertex;
+  batch_num_vertices_ = num_vertices;
+  stats_.num_batched_models += num_models;
+  ++stats_.num_batch_draws;
+  stats_.num_streamed_vertices += num_vertices;
+  return num_models;
+}
+
+}  // namespace wvu
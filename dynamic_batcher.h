@@ -0,0 +1,185 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef DYNAMIC_BATCHER_H_
+#define DYNAMIC_BATCHER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+namespace wvu {
+class Model;
+class ShaderProgram;
+class ThreadPool;
+
+// Statistics of the dynamic batcher.
+struct DynamicBatchStats {
+  // Models drawn from the streaming buffer, and the draw calls of the
+  // batches.
+  int num_batched_models = 0;
+  int num_batch_draws = 0;
+  // Models drawn one by one: too large, without their CPU geometry, beyond
+  // the capacity of the buffer or while batching is off.
+  int num_individual_draws = 0;
+  // Vertices written into the streaming buffer.
+  int64_t num_streamed_vertices = 0;
+  // Times the CPU waited for the GPU to release a region of the buffer.
+  int num_fence_waits = 0;
+  // Times batching was switched on or off.
+  int num_switches = 0;
+};
+
+// Draws the small models of a frame with a single draw call. Every frame,
+// the thread pool transforms the vertices of the small models into the world
+// frame and writes them, as a triangle list, straight into a streaming vertex
+// buffer. The buffer is a ring of regions, one per frame in flight; a region
+// is mapped without synchronization and a fence keeps the CPU from
+// overwriting it while the GPU still reads it. The draws of a frame, e.g., a
+// depth pre-pass and the shading pass, share its region and take the same
+// path, and drawing the same models again reuses their batch.
+//
+// Batching pays off while transforming a model costs less than a draw call.
+// The batcher measures both on the CPU, the latter by drawing the small
+// models one by one every few frames, and turns batching off while the
+// batched models cost more per model than their draw calls.
+//
+// Example:
+//
+// wvu::DynamicBatcher dynamic_batcher(64, 1 << 18, &thread_pool);
+// if (!dynamic_batcher.Initialize(&error_info_log)) { ... }
+// while (...) {  // Rendering loop.
+//   dynamic_batcher.BeginFrame();
+//   shader_program.Use();
+//   dynamic_batcher.Draw(shader_program, projection, view, visible_models);
+// }
+class DynamicBatcher {
+ public:
+  // Params:
+  //   max_vertices_per_model  The models with more vertices in their
+  //     triangle list are drawn one by one.
+  //   capacity_in_vertices  The vertices of a region of the buffer, i.e.,
+  //     the most vertices batched in a frame.
+  //   thread_pool  The threads that transform the vertices.
+  DynamicBatcher(const int max_vertices_per_model,
+                 const int capacity_in_vertices,
+                 ThreadPool* thread_pool);
+
+  // Destructor. Deletes the buffer, so the OpenGL context must be current if
+  // Initialize() was called.
+  ~DynamicBatcher();
+
+  // Creates the streaming buffer. Returns true if successful.
+  bool Initialize(std::string* error_info_log);
+
+  // Starts a frame: moves to the next region of the buffer, waiting for the
+  // GPU to release it if needed, and decides whether the draws of the frame
+  // batch the small models. Call it before the draws of every frame.
+  void BeginFrame();
+
+  // Draws the models, the small ones in a batch if the frame batches them.
+  // The shader program must be in use.
+  // Params:
+  //   shader_program  The shader program that is currently in use.
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  //   models  The models to draw.
+  void Draw(const ShaderProgram& shader_program,
+            const Eigen::Matrix4f& projection,
+            const Eigen::Matrix4f& view,
+            const std::vector<Model*>& models);
+
+  // Returns true if the small models are batched.
+  bool is_batching() const {
+    return is_batching_;
+  }
+
+  // Returns the measured CPU time of a batched model and of a draw call of a
+  // small model; negative before the first measurement.
+  double seconds_per_batched_model() const {
+    return seconds_per_batched_model_;
+  }
+
+  double seconds_per_draw() const {
+    return seconds_per_draw_;
+  }
+
+  const DynamicBatchStats& stats() const {
+    return stats_;
+  }
+
+  void ResetStats() {
+    stats_ = DynamicBatchStats();
+  }
+
+ private:
+  // Returns the vertices of the triangle list of a model.
+  static int NumTriangleListVertices(const Model& model);
+
+  // Streams the models into the region of the frame and draws them, or draws
+  // the last batch again if it has the same models. Returns the number of
+  // models drawn; the remaining ones did not fit.
+  int DrawBatch(const std::vector<Model*>& models);
+
+  const int max_vertices_per_model_;
+  const int capacity_in_vertices_;
+  ThreadPool* thread_pool_;
+  GLuint vertex_array_object_id_;
+  GLuint vertex_buffer_object_id_;
+  // The fence of the last frame that used each region.
+  std::vector<GLsync> region_fences_;
+  // The region of the frame and the vertices written into it.
+  int region_;
+  int region_num_vertices_;
+  // The last batch of the frame: its models and its vertices in the buffer.
+  std::vector<Model*> batch_models_;
+  int batch_num_models_;
+  GLint batch_first_vertex_;
+  int batch_num_vertices_;
+  // Staging memory when the buffer cannot be mapped.
+  std::vector<float> staging_vertices_;
+  bool is_batching_;
+  // Whether the draws of this frame batch the small models.
+  bool batch_this_frame_;
+  int frame_;
+  double seconds_per_batched_model_;
+  double seconds_per_draw_;
+  DynamicBatchStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // DYNAMIC_BATCHER_H_
@@ -0,0 +1,100 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wvu {
+namespace {
+
+// Weight of the newest measurement in the moving average.
+constexpr double kSmoothingFactor = 0.3;
+// Largest relative growth of the scale per change. Growing slowly avoids
+// overshooting the target, while shrinking is immediate to recover from
+// missed frames.
+constexpr double kMaxScaleGrowth = 1.1;
+
+}  // namespace
+
+ResolutionScaleController::ResolutionScaleController(
+    const double target_seconds,
+    const double min_scale,
+    const double max_scale,
+    const double headroom,
+    const int settle_frames) :
+    target_seconds_(target_seconds), min_scale_(min_scale),
+    max_scale_(max_scale), headroom_(headroom),
+    settle_frames_(settle_frames), scale_(max_scale),
+    filtered_gpu_seconds_(-1.0), frames_to_settle_(0) {}
+
+bool ResolutionScaleController::Update(const double gpu_seconds) {
+  // The measurement belongs to a frame rendered before the last change.
+  if (frames_to_settle_ > 0) {
+    --frames_to_settle_;
+    return false;
+  }
+  filtered_gpu_seconds_ = (filtered_gpu_seconds_ < 0.0) ? gpu_seconds :
+      kSmoothingFactor * gpu_seconds +
+      (1.0 - kSmoothingFactor) * filtered_gpu_seconds_;
+  if (filtered_gpu_seconds_ <= 0.0) return false;
+  const bool too_slow = filtered_gpu_seconds_ > target_seconds_;
+  const bool too_fast =
+      filtered_gpu_seconds_ < (1.0 - headroom_) * target_seconds_;
+  if (!too_slow && !too_fast) return false;
+  // Aim for the middle of the band.
+  const double goal_seconds = (1.0 - 0.5 * headroom_) * target_seconds_;
+  double new_scale =
+      scale_ * std::sqrt(goal_seconds / filtered_gpu_seconds_);
+  new_scale = std::min(new_scale, kMaxScaleGrowth * scale_);
+  new_scale = std::max(min_scale_, std::min(max_scale_, new_scale));
+  if (new_scale == scale_) return false;
+  scale_ = new_scale;
+  // The next measurements come from frames at the old scale.
+  filtered_gpu_seconds_ = -1.0;
+  frames_to_settle_ = settle_frames_;
+  return true;
+}
+
+void ComputeScaledSize(const int width,
+                       const int height,
+                       const double scale,
+                       int* scaled_width,
+                       int* scaled_height) {
+  *scaled_width = std::max(1, static_cast<int>(std::lround(width * scale)));
+  *scaled_height = std::max(1, static_cast<int>(std::lround(height * scale)));
+}
+
+}  // namespace wvu
@@ -0,0 +1,112 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+namespace wvu {
+// Chooses the scale of the render resolution from the measured GPU time of the
+// frames so that they take the target time. The GPU time of a frame is
+// roughly proportional to its number of pixels, i.e., to the square of the
+// scale, so the scale is corrected by the square root of the ratio between
+// the target and the measured times.
+//
+// The measurements are smoothed, and the scale only changes when the time
+// leaves a band below the target, which avoids oscillating between two
+// scales. The GPU timer results arrive a few frames late, so the measurements
+// of the frames rendered before a change are ignored.
+//
+// Example:
+//
+// wvu::ResolutionScaleController controller(1.0 / 60.0, 0.5, 1.0, 0.1, 4);
+// while (...) {  // Rendering loop.
+//   int width, height;
+//   wvu::ComputeScaledSize(window_width, window_height, controller.scale(),
+//                          &width, &height);
+//   ...  // Render at width x height and upscale to the window.
+//   if (gpu_timer.LatestResult(&nanoseconds)) {
+//     controller.Update(1e-9 * nanoseconds);
+//   }
+// }
+class ResolutionScaleController {
+ public:
+  // Constructor. The scale starts at max_scale.
+  // Params:
+  //   target_seconds  The target GPU time of a frame.
+  //   min_scale  The smallest scale of the resolution, in (0, 1].
+  //   max_scale  The largest scale of the resolution, in [min_scale, 1].
+  //   headroom  The fraction of the target below which the scale grows.
+  //   settle_frames  The number of measurements ignored after a change.
+  ResolutionScaleController(const double target_seconds,
+                            const double min_scale,
+                            const double max_scale,
+                            const double headroom,
+                            const int settle_frames);
+
+  // Feeds the GPU time of a frame. Returns true if the scale changed.
+  bool Update(const double gpu_seconds);
+
+  // Returns the current scale of the resolution.
+  double scale() const {
+    return scale_;
+  }
+
+  // Returns the smoothed GPU time.
+  double filtered_gpu_seconds() const {
+    return filtered_gpu_seconds_;
+  }
+
+ private:
+  const double target_seconds_;
+  const double min_scale_;
+  const double max_scale_;
+  const double headroom_;
+  const int settle_frames_;
+  double scale_;
+  // Exponential moving average of the GPU time; negative when empty.
+  double filtered_gpu_seconds_;
+  int frames_to_settle_;
+};
+
+// Computes the size of the framebuffer region rendered at the given scale.
+// Both dimensions are at least one pixel.
+void ComputeScaledSize(const int width,
+                       const int height,
+                       const double scale,
+                       int* scaled_width,
+                       int* scaled_height);
+
+}  // namespace wvu
+
+#endif  // DYNAMIC_RESOLUTION_H_
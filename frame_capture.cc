@@ -0,0 +1,285 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "frame_capture.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "image_writer.h"
+
+namespace wvu {
+namespace {
+
+// Returns the seconds elapsed since start.
+double SecondsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+bool ParseCaptureFormat(const std::string& name, CaptureFormat* format) {
+  if (name == "ppm") {
+    *format = CaptureFormat::PPM;
+  } else if (name == "png") {
+    *format = CaptureFormat::PNG;
+  } else if (name == "y4m") {
+    *format = CaptureFormat::Y4M;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FrameCapture::FrameCapture(const CaptureFormat format,
+                           const std::string& output_path,
+                           const int ring_size,
+                           const int max_queued_frames,
+                           const int frames_per_second) :
+    format_(format), output_path_(output_path),
+    max_queued_frames_(max_queued_frames),
+    frames_per_second_(frames_per_second), width_(0), height_(0),
+    slots_(ring_size), next_slot_(0), next_frame_index_(0),
+    initialized_(false), stop_(false) {}
+
+FrameCapture::~FrameCapture() {
+  Finish();
+}
+
+bool FrameCapture::Initialize(const int width,
+                              const int height,
+                              std::string* error_info_log) {
+  width_ = width;
+  height_ = height;
+  if (format_ == CaptureFormat::Y4M &&
+      !y4m_writer_.Open(output_path_, width, height, frames_per_second_)) {
+    if (error_info_log) {
+      *error_info_log = "Could not open " + output_path_ + " for writing.";
+    }
+    return false;
+  }
+  const GLsizeiptr buffer_size =
+      static_cast<GLsizeiptr>(width) * height * sizeof(uint32_t);
+  for (Slot& slot : slots_) {
+    glGenBuffers(1, &slot.pixel_buffer_id);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixel_buffer_id);
+    // Written by the GPU and read once by the CPU.
+    glBufferData(GL_PIXEL_PACK_BUFFER, buffer_size, nullptr, GL_STREAM_READ);
+    GlResourceRegistry::Instance()->Register(
+        GlObjectType::BUFFER, slot.pixel_buffer_id, "frame_capture",
+        WVU_GL_CREATION_SITE);
+    GlResourceRegistry::Instance()->SetSize(
+        GlObjectType::BUFFER, slot.pixel_buffer_id, buffer_size);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  stop_ = false;
+  writer_thread_ = std::thread(&FrameCapture::WriterLoop, this);
+  initialized_ = true;
+  return true;
+}
+
+void FrameCapture::Capture(const GLuint framebuffer_id) {
+  if (!initialized_) return;
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  ReadCompletedSlots(false);
+  Slot& slot = slots_[next_slot_];
+  bool stalled = false;
+  if (slot.fence != nullptr) {
+    // The ring is full: wait for the oldest copy.
+    stalled = true;
+    ReadSlot(&slot);
+  }
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_id);
+  glReadBuffer(framebuffer_id == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixel_buffer_id);
+  // With a pixel pack buffer bound, the pointer is an offset into it and the
+  // call returns without waiting for the copy.
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frame_index = next_frame_index_++;
+  next_slot_ = (next_slot_ + 1) % static_cast<int>(slots_.size());
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.num_frames_captured;
+  if (stalled) ++stats_.num_stalls;
+  stats_.render_thread_seconds += SecondsSince(start);
+}
+
+void FrameCapture::Finish() {
+  if (!initialized_) return;
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  ReadCompletedSlots(true);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    stats_.render_thread_seconds += SecondsSince(start);
+  }
+  frame_queued_.notify_one();
+  writer_thread_.join();
+  y4m_writer_.Close();
+  for (Slot& slot : slots_) {
+    GlResourceRegistry::Instance()->Unregister(GlObjectType::BUFFER,
+                                               slot.pixel_buffer_id);
+    glDeleteBuffers(1, &slot.pixel_buffer_id);
+    slot.pixel_buffer_id = 0;
+  }
+  initialized_ = false;
+}
+
+FrameCaptureStats FrameCapture::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void FrameCapture::ReadCompletedSlots(const bool wait) {
+  const int ring_size = static_cast<int>(slots_.size());
+  for (int i = 0; i < ring_size; ++i) {
+    Slot& slot = slots_[(next_slot_ + i) % ring_size];
+    if (slot.fence == nullptr) continue;
+    if (!wait) {
+      const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED &&
+          status != GL_CONDITION_SATISFIED) {
+        // The later copies are not done either.
+        break;
+      }
+    }
+    ReadSlot(&slot);
+  }
+}
+
+void FrameCapture::ReadSlot(Slot* slot) {
+  // Flushing makes sure that the fence reaches the GPU before waiting on it.
+  constexpr GLuint64 kNoTimeout = 0xFFFFFFFFFFFFFFFFull;
+  glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, kNoTimeout);
+  glDeleteSync(slot->fence);
+  slot->fence = nullptr;
+  QueuedFrame frame;
+  frame.frame_index = slot->frame_index;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (static_cast<int>(queued_frames_.size()) >= max_queued_frames_) {
+      ++stats_.num_frames_dropped;
+      return;
+    }
+    if (!free_pixel_buffers_.empty()) {
+      frame.pixels.swap(free_pixel_buffers_.back());
+      free_pixel_buffers_.pop_back();
+    }
+  }
+  const size_t num_pixels = static_cast<size_t>(width_) * height_;
+  frame.pixels.resize(num_pixels);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pixel_buffer_id);
+  const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                      num_pixels * sizeof(uint32_t),
+                                      GL_MAP_READ_BIT);
+  if (data != nullptr) {
+    std::memcpy(frame.pixels.data(), data, num_pixels * sizeof(uint32_t));
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (data == nullptr) {
+      ++stats_.num_write_errors;
+      return;
+    }
+    queued_frames_.push_back(QueuedFrame());
+    queued_frames_.back().frame_index = frame.frame_index;
+    queued_frames_.back().pixels.swap(frame.pixels);
+  }
+  frame_queued_.notify_one();
+}
+
+void FrameCapture::WriterLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    frame_queued_.wait(lock, [this]() {
+      return stop_ || !queued_frames_.empty();
+    });
+    // Drain the queue before stopping.
+    if (queued_frames_.empty()) return;
+    QueuedFrame frame;
+    frame.frame_index = queued_frames_.front().frame_index;
+    frame.pixels.swap(queued_frames_.front().pixels);
+    queued_frames_.pop_front();
+    lock.unlock();
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    const bool written = WriteFrame(frame);
+    const double seconds = SecondsSince(start);
+    lock.lock();
+    stats_.writer_seconds += seconds;
+    if (written) {
+      ++stats_.num_frames_written;
+    } else {
+      ++stats_.num_write_errors;
+    }
+    free_pixel_buffers_.push_back(std::vector<uint32_t>());
+    free_pixel_buffers_.back().swap(frame.pixels);
+  }
+}
+
+bool FrameCapture::WriteFrame(const QueuedFrame& frame) {
+  // The rows of glReadPixels() start at the bottom.
+  if (format_ == CaptureFormat::Y4M) {
+    return y4m_writer_.WriteFrame(width_, frame.pixels.data(), true);
+  }
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "_%06d.%s", frame.frame_index,
+                format_ == CaptureFormat::PNG ? "png" : "ppm");
+  const std::string filepath = output_path_ + suffix;
+  if (format_ == CaptureFormat::PNG) {
+    return WritePng(filepath, width_, height_, width_, frame.pixels.data(),
+                    true);
+  }
+  return WritePpm(filepath, width_, height_, width_, frame.pixels.data(),
+                  true);
+}
+
+}  // namespace wvu
@@ -0,0 +1,201 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+#include "image_writer.h"
+
+namespace wvu {
+// File formats of the captured frames.
+enum class CaptureFormat {
+  // One PPM file per frame.
+  PPM = 0,
+  // One PNG file per frame.
+  PNG = 1,
+  // A single YUV4MPEG2 video file.
+  Y4M = 2
+};
+
+// Parses a capture format name: ppm, png or y4m. Returns false if the name is
+// unknown.
+bool ParseCaptureFormat(const std::string& name, CaptureFormat* format);
+
+// Statistics of a capture.
+struct FrameCaptureStats {
+  // Frames read back into the pixel buffer ring.
+  int num_frames_captured = 0;
+  // Frames written to disk.
+  int num_frames_written = 0;
+  // Frames dropped because the writer thread fell behind.
+  int num_frames_dropped = 0;
+  // Captures that waited for the GPU because the ring was full.
+  int num_stalls = 0;
+  // Frames that could not be written, e.g., because of a full disk.
+  int num_write_errors = 0;
+  // Time spent by the rendering thread issuing the reads and copying the
+  // mapped buffers, i.e., the cost of recording on the frame time.
+  double render_thread_seconds = 0.0;
+  // Time spent by the writer thread encoding and writing the frames.
+  double writer_seconds = 0.0;
+};
+
+// Captures frames from a framebuffer without stalling the rendering. Each
+// capture issues glReadPixels() into the next pixel buffer object of a ring,
+// which copies the frame asynchronously on the GPU. A fence marks the copy,
+// and the buffer is mapped once the fence signals, usually a frame or two
+// later, so the CPU never waits for the GPU unless the ring is full. A writer
+// thread encodes the mapped frames and writes them to disk.
+//
+// Only the rendering thread, which owns the OpenGL context, calls the member
+// functions.
+//
+// Example:
+//
+// wvu::FrameCapture frame_capture(wvu::CaptureFormat::PNG, "session", 3, 8,
+//                                 60);
+// std::string error_info_log;
+// if (!frame_capture.Initialize(640, 480, &error_info_log)) { ... }
+// while (...) {  // Rendering loop.
+//   ...  // Draw.
+//   frame_capture.Capture(0);
+//   glfwSwapBuffers(window);
+// }
+// frame_capture.Finish();
+class FrameCapture {
+ public:
+  // Constructor.
+  // Params:
+  //   format  The file format.
+  //   output_path  The Y4M file, or the prefix of the numbered PPM or PNG
+  //     files, e.g., "session" writes session_000000.png and so on.
+  //   ring_size  The number of pixel buffer objects in flight.
+  //   max_queued_frames  The number of frames waiting for the writer thread
+  //     beyond which new frames are dropped.
+  //   frames_per_second  The frame rate stored in Y4M files.
+  FrameCapture(const CaptureFormat format,
+               const std::string& output_path,
+               const int ring_size,
+               const int max_queued_frames,
+               const int frames_per_second);
+
+  // Destructor. Finishes the capture.
+  ~FrameCapture();
+
+  // Creates the pixel buffer objects and starts the writer thread. Requires a
+  // current OpenGL context. Returns false and fills error_info_log on failure.
+  // Params:
+  //   width  The width of the captured region in pixels.
+  //   height  The height of the captured region in pixels.
+  //   error_info_log  The reason of the failure.
+  bool Initialize(const int width,
+                  const int height,
+                  std::string* error_info_log);
+
+  // Reads the bottom-left region of a framebuffer: the back buffer of the
+  // window if framebuffer_id is zero, or the first color attachment
+  // otherwise.
+  void Capture(const GLuint framebuffer_id);
+
+  // Reads back the frames in flight, writes every queued frame and stops the
+  // writer thread. Requires the OpenGL context.
+  void Finish();
+
+  // Returns a snapshot of the statistics.
+  FrameCaptureStats stats() const;
+
+ private:
+  // A pixel buffer object of the ring.
+  struct Slot {
+    GLuint pixel_buffer_id = 0;
+    // Signals when the copy into the buffer is done; null when idle.
+    GLsync fence = nullptr;
+    int frame_index = 0;
+  };
+
+  // A frame waiting for the writer thread.
+  struct QueuedFrame {
+    int frame_index = 0;
+    std::vector<uint32_t> pixels;
+  };
+
+  // Maps the buffers whose copy finished, oldest first. If wait is true,
+  // waits for all of them.
+  void ReadCompletedSlots(const bool wait);
+
+  // Copies the buffer of a slot into the writer queue and frees the slot.
+  void ReadSlot(Slot* slot);
+
+  // Main loop of the writer thread.
+  void WriterLoop();
+
+  // Encodes and writes a frame. Returns true if successful.
+  bool WriteFrame(const QueuedFrame& frame);
+
+  const CaptureFormat format_;
+  const std::string output_path_;
+  const int max_queued_frames_;
+  const int frames_per_second_;
+  int width_;
+  int height_;
+  std::vector<Slot> slots_;
+  // Index of the oldest slot, which is also the next one to use.
+  int next_slot_;
+  int next_frame_index_;
+  bool initialized_;
+  Y4mWriter y4m_writer_;
+  std::thread writer_thread_;
+  // Protects the members below.
+  mutable std::mutex mutex_;
+  // Signals the writer thread that a frame is queued or that it must stop.
+  std::condition_variable frame_queued_;
+  std::deque<QueuedFrame> queued_frames_;
+  // Pixel vectors of written frames, reused to avoid allocations.
+  std::vector<std::vector<uint32_t> > free_pixel_buffers_;
+  bool stop_;
+  FrameCaptureStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // FRAME_CAPTURE_H_
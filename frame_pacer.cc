@@ -0,0 +1,158 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace wvu {
+namespace {
+typedef FramePacer::Clock Clock;
+
+double SecondsBetween(const Clock::time_point start,
+                      const Clock::time_point end) {
+  return std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+FramePacer::FramePacer(const double refresh_period_seconds,
+                       const double safety_margin_seconds,
+                       const int history_size)
+    : refresh_period_seconds_(refresh_period_seconds),
+      safety_margin_seconds_(safety_margin_seconds),
+      render_seconds_history_(std::max(history_size, 1), 0.0),
+      next_history_index_(0),
+      history_count_(0),
+      has_input_sample_(false),
+      has_presented_(false),
+      total_latency_seconds_(0.0),
+      num_latency_samples_(0) {}
+
+void FramePacer::WaitForFrameStart() {
+  const double wait_seconds = ComputeWaitSeconds(Clock::now());
+  if (wait_seconds > 0.0) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(wait_seconds));
+  }
+}
+
+double FramePacer::ComputeWaitSeconds(const Clock::time_point now) const {
+  if (!has_presented_ || refresh_period_seconds_ <= 0.0) return 0.0;
+  // The first refresh after now that leaves enough time to render the frame.
+  const double predicted_render_seconds = PredictRenderSeconds();
+  const double since_present = SecondsBetween(last_present_, now);
+  const double num_periods = std::max(1.0, std::ceil(
+      (since_present + predicted_render_seconds) / refresh_period_seconds_));
+  const double deadline = num_periods * refresh_period_seconds_;
+  return std::max(0.0, deadline - predicted_render_seconds - since_present);
+}
+
+void FramePacer::InputSampled() {
+  InputSampled(Clock::now());
+}
+
+void FramePacer::InputSampled(const Clock::time_point time) {
+  input_sampled_ = time;
+  has_input_sample_ = true;
+}
+
+void FramePacer::BeginFrame() {
+  BeginFrame(Clock::now());
+}
+
+void FramePacer::BeginFrame(const Clock::time_point time) {
+  frame_begin_ = time;
+}
+
+void FramePacer::EndFrame() {
+  EndFrame(Clock::now());
+}
+
+void FramePacer::EndFrame(const Clock::time_point time) {
+  render_seconds_history_[next_history_index_] =
+      SecondsBetween(frame_begin_, time);
+  next_history_index_ =
+      (next_history_index_ + 1) % render_seconds_history_.size();
+  history_count_ = std::min(history_count_ + 1,
+                            static_cast<int>(render_seconds_history_.size()));
+  stats_.predicted_render_seconds = PredictRenderSeconds();
+}
+
+void FramePacer::FramePresented() {
+  FramePresented(Clock::now());
+}
+
+void FramePacer::FramePresented(const Clock::time_point time) {
+  // A frame presented more than one and a half periods after the previous
+  // one skipped at least one refresh.
+  if (has_presented_ && refresh_period_seconds_ > 0.0 &&
+      SecondsBetween(last_present_, time) > 1.5 * refresh_period_seconds_) {
+    ++stats_.num_missed_deadlines;
+  }
+  last_present_ = time;
+  has_presented_ = true;
+  ++stats_.num_frames;
+  if (!has_input_sample_) return;
+  has_input_sample_ = false;
+  const double latency_seconds = SecondsBetween(input_sampled_, time);
+  total_latency_seconds_ += latency_seconds;
+  ++num_latency_samples_;
+  stats_.average_latency_seconds =
+      total_latency_seconds_ / num_latency_samples_;
+  stats_.max_latency_seconds =
+      std::max(stats_.max_latency_seconds, latency_seconds);
+}
+
+double FramePacer::PredictRenderSeconds() const {
+  // The slowest recent frame: missing a refresh costs a whole period, so the
+  // prediction leans towards the worst case.
+  double render_seconds = 0.0;
+  for (int i = 0; i < history_count_; ++i) {
+    render_seconds = std::max(render_seconds, render_seconds_history_[i]);
+  }
+  return render_seconds + safety_margin_seconds_;
+}
+
+void FramePacer::ResetStats() {
+  stats_ = FramePacerStats();
+  stats_.predicted_render_seconds = PredictRenderSeconds();
+  total_latency_seconds_ = 0.0;
+  num_latency_samples_ = 0;
+}
+
+}  // namespace wvu
@@ -0,0 +1,146 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include <chrono>
+#include <vector>
+
+namespace wvu {
+// Statistics of the frame pacing.
+struct FramePacerStats {
+  // Number of frames presented.
+  int num_frames = 0;
+  // Number of frames presented one or more refresh periods late.
+  int num_missed_deadlines = 0;
+  // Render time predicted for the next frame, margin included.
+  double predicted_render_seconds = 0.0;
+  // Average and maximum time from sampling the input to the return of the
+  // buffer swap, i.e., the latency up to the refresh that shows the frame.
+  // Only the frames that sampled the input count.
+  double average_latency_seconds = 0.0;
+  double max_latency_seconds = 0.0;
+};
+
+// Schedules the frames so that they start as late as possible before the
+// next vertical refresh. The render time of the next frame is predicted from
+// the recent frames, and the pacer sleeps until the refresh deadline minus
+// that prediction and a safety margin. Sampling the input after waking up,
+// instead of right after the previous swap, shortens the input-to-photon
+// latency by up to one refresh period.
+//
+// The refreshes are estimated from the times at which the buffer swaps return,
+// which block until the refresh with vertical synchronization.
+//
+// Example:
+//
+// wvu::FramePacer frame_pacer(1.0 / 60.0, 0.001, 16);
+// while (...) {  // Rendering loop.
+//   frame_pacer.WaitForFrameStart();
+//   glfwPollEvents();
+//   ...  // Update the camera from the input.
+//   frame_pacer.InputSampled();
+//   frame_pacer.BeginFrame();
+//   ...  // Render.
+//   frame_pacer.EndFrame();
+//   glfwSwapBuffers(window);
+//   frame_pacer.FramePresented();
+// }
+class FramePacer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Constructor.
+  // Params:
+  //   refresh_period_seconds  The refresh period of the display. Zero
+  //     disables the waiting.
+  //   safety_margin_seconds  Time added to the predicted render time.
+  //   history_size  The number of recent frames used for the prediction.
+  FramePacer(const double refresh_period_seconds,
+             const double safety_margin_seconds,
+             const int history_size);
+
+  // Sleeps until the predicted start of the next frame.
+  void WaitForFrameStart();
+
+  // Returns how long to wait at time now before starting the next frame.
+  double ComputeWaitSeconds(const Clock::time_point now) const;
+
+  // Records the time at which the input used by the frame was sampled. The
+  // latest call of the frame counts, so late-latching calls it again.
+  void InputSampled();
+  void InputSampled(const Clock::time_point time);
+
+  // Mark the CPU work of the frame: from the start of the frame to the
+  // submission of the last command before the swap.
+  void BeginFrame();
+  void BeginFrame(const Clock::time_point time);
+  void EndFrame();
+  void EndFrame(const Clock::time_point time);
+
+  // Records the return of the buffer swap, which estimates the refresh.
+  void FramePresented();
+  void FramePresented(const Clock::time_point time);
+
+  // Returns the render time predicted for the next frame, margin included.
+  double PredictRenderSeconds() const;
+
+  // Returns the statistics since the last call to ResetStats().
+  const FramePacerStats& stats() const {
+    return stats_;
+  }
+  void ResetStats();
+
+ private:
+  const double refresh_period_seconds_;
+  const double safety_margin_seconds_;
+  // Render times of the recent frames in a ring.
+  std::vector<double> render_seconds_history_;
+  int next_history_index_;
+  int history_count_;
+  Clock::time_point frame_begin_;
+  Clock::time_point input_sampled_;
+  // Whether the input was sampled since the last present.
+  bool has_input_sample_;
+  Clock::time_point last_present_;
+  bool has_presented_;
+  double total_latency_seconds_;
+  int num_latency_samples_;
+  FramePacerStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // FRAME_PACER_H_
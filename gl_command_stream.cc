@@ -0,0 +1,293 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "gl_command_stream.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wvu {
+namespace {
+
+constexpr char kMagic[8] = {'W', 'V', 'U', 'G', 'L', 'C', 'A', 'P'};
+constexpr uint32_t kVersion = 2;
+// Magic, version, width and height.
+constexpr size_t kHeaderSize = sizeof(kMagic) + 3 * sizeof(uint32_t);
+// Opcode and size of the arguments.
+constexpr size_t kCommandHeaderSize = sizeof(uint16_t) + sizeof(uint32_t);
+// The buffer is written to disk beyond this size even within a frame.
+constexpr size_t kMaxBufferSize = 4 << 20;
+
+#define WVU_GL_OPCODE_NAME(opcode, name) name,
+const char* const kOpcodeNames[] = {
+  WVU_GL_OPCODES(WVU_GL_OPCODE_NAME)
+};
+#undef WVU_GL_OPCODE_NAME
+
+}  // namespace
+
+const char* GlOpcodeName(const GlOpcode opcode) {
+  const int index = static_cast<int>(opcode);
+  return (index >= 0 && index < kNumGlOpcodes) ? kOpcodeNames[index] :
+      "unknown";
+}
+
+GlCommandWriter::GlCommandWriter() :
+    command_size_offset_(0), num_bytes_flushed_(0), num_frames_(0) {}
+
+GlCommandWriter::~GlCommandWriter() {
+  Close();
+}
+
+bool GlCommandWriter::Open(const std::string& filepath,
+                           const int width,
+                           const int height,
+                           std::string* error_info_log) {
+  out_.open(filepath, std::ios::binary);
+  if (!out_.is_open()) {
+    if (error_info_log) {
+      *error_info_log = "Could not open " + filepath + " for writing.";
+    }
+    return false;
+  }
+  buffer_.clear();
+  num_bytes_flushed_ = 0;
+  num_frames_ = 0;
+  Append(kMagic, sizeof(kMagic));
+  Append(&kVersion, sizeof(kVersion));
+  const int32_t size[2] = {width, height};
+  Append(size, sizeof(size));
+  return true;
+}
+
+void GlCommandWriter::Close() {
+  if (!out_.is_open()) return;
+  Flush();
+  out_.close();
+}
+
+void GlCommandWriter::BeginFrame() {
+  BeginCommand(GlOpcode::BEGIN_FRAME);
+  EndCommand();
+}
+
+void GlCommandWriter::EndFrame() {
+  BeginCommand(GlOpcode::END_FRAME);
+  EndCommand();
+  ++num_frames_;
+  Flush();
+}
+
+void GlCommandWriter::BeginCommand(const GlOpcode opcode) {
+  const uint16_t value = static_cast<uint16_t>(opcode);
+  Append(&value, sizeof(value));
+  command_size_offset_ = buffer_.size();
+  const uint32_t size = 0;
+  Append(&size, sizeof(size));
+}
+
+void GlCommandWriter::WriteUint32(const uint32_t value) {
+  Append(&value, sizeof(value));
+}
+
+void GlCommandWriter::WriteInt32(const int32_t value) {
+  Append(&value, sizeof(value));
+}
+
+void GlCommandWriter::WriteInt64(const int64_t value) {
+  Append(&value, sizeof(value));
+}
+
+void GlCommandWriter::WriteFloat(const float value) {
+  Append(&value, sizeof(value));
+}
+
+void GlCommandWriter::WriteDouble(const double value) {
+  Append(&value, sizeof(value));
+}
+
+void GlCommandWriter::WriteBytes(const void* data, const size_t size) {
+  WriteUint32(static_cast<uint32_t>(size));
+  Append(data, size);
+}
+
+void GlCommandWriter::EndCommand() {
+  const uint32_t size = static_cast<uint32_t>(
+      buffer_.size() - command_size_offset_ - sizeof(uint32_t));
+  std::memcpy(buffer_.data() + command_size_offset_, &size, sizeof(size));
+  if (buffer_.size() > kMaxBufferSize) {
+    Flush();
+  }
+}
+
+void GlCommandWriter::Append(const void* data, const size_t size) {
+  if (size == 0) return;
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+void GlCommandWriter::Flush() {
+  if (buffer_.empty() || !out_.is_open()) return;
+  out_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+  num_bytes_flushed_ += buffer_.size();
+  buffer_.clear();
+}
+
+GlArgumentReader::GlArgumentReader(const GlCommand& command) :
+    data_(command.arguments), size_(command.size), offset_(0), ok_(true) {}
+
+uint32_t GlArgumentReader::ReadUint32() {
+  uint32_t value = 0;
+  Read(&value, sizeof(value));
+  return value;
+}
+
+int32_t GlArgumentReader::ReadInt32() {
+  int32_t value = 0;
+  Read(&value, sizeof(value));
+  return value;
+}
+
+int64_t GlArgumentReader::ReadInt64() {
+  int64_t value = 0;
+  Read(&value, sizeof(value));
+  return value;
+}
+
+float GlArgumentReader::ReadFloat() {
+  float value = 0.0f;
+  Read(&value, sizeof(value));
+  return value;
+}
+
+double GlArgumentReader::ReadDouble() {
+  double value = 0.0;
+  Read(&value, sizeof(value));
+  return value;
+}
+
+const uint8_t* GlArgumentReader::ReadBytes(uint32_t* size) {
+  *size = ReadUint32();
+  if (!ok_ || *size > size_ - offset_) {
+    ok_ = false;
+    *size = 0;
+    return nullptr;
+  }
+  const uint8_t* bytes = data_ + offset_;
+  offset_ += *size;
+  return bytes;
+}
+
+void GlArgumentReader::Read(void* value, const size_t size) {
+  if (!ok_ || size > size_ - offset_) {
+    ok_ = false;
+    return;
+  }
+  std::memcpy(value, data_ + offset_, size);
+  offset_ += size;
+}
+
+GlCommandReader::GlCommandReader() : width_(0), height_(0) {}
+
+bool GlCommandReader::Load(const std::string& filepath,
+                           std::string* error_info_log) {
+  std::ifstream in(filepath, std::ios::binary);
+  if (!in.is_open()) {
+    if (error_info_log) *error_info_log = "Could not open " + filepath + ".";
+    return false;
+  }
+  data_.assign(std::istreambuf_iterator<char>(in),
+               std::istreambuf_iterator<char>());
+  commands_.clear();
+  frames_.clear();
+  uint32_t version = 0;
+  if (data_.size() >= kHeaderSize) {
+    std::memcpy(&version, data_.data() + sizeof(kMagic), sizeof(version));
+  }
+  if (data_.size() < kHeaderSize ||
+      std::memcmp(data_.data(), kMagic, sizeof(kMagic)) != 0 ||
+      version != kVersion) {
+    if (error_info_log) {
+      *error_info_log = filepath + " is not a capture of this version.";
+    }
+    return false;
+  }
+  int32_t size[2];
+  std::memcpy(size, data_.data() + sizeof(kMagic) + sizeof(version),
+              sizeof(size));
+  width_ = size[0];
+  height_ = size[1];
+  size_t offset = kHeaderSize;
+  int frame_begin = -1;
+  while (offset + kCommandHeaderSize <= data_.size()) {
+    uint16_t opcode;
+    uint32_t arguments_size;
+    std::memcpy(&opcode, data_.data() + offset, sizeof(opcode));
+    std::memcpy(&arguments_size, data_.data() + offset + sizeof(opcode),
+                sizeof(arguments_size));
+    offset += kCommandHeaderSize;
+    if (opcode >= kNumGlOpcodes || arguments_size > data_.size() - offset) {
+      if (error_info_log) {
+        *error_info_log = filepath + " is corrupted.";
+      }
+      return false;
+    }
+    GlCommand command;
+    command.opcode = static_cast<GlOpcode>(opcode);
+    command.arguments = data_.data() + offset;
+    command.size = arguments_size;
+    offset += arguments_size;
+    // The frame markers only delimit the frames.
+    if (command.opcode == GlOpcode::BEGIN_FRAME) {
+      frame_begin = static_cast<int>(commands_.size());
+    } else if (command.opcode == GlOpcode::END_FRAME) {
+      if (frame_begin >= 0) {
+        frames_.push_back(std::make_pair(frame_begin,
+                                         static_cast<int>(commands_.size())));
+      }
+      frame_begin = -1;
+    } else {
+      commands_.push_back(command);
+    }
+  }
+  return true;
+}
+
+}  // namespace wvu
@@ -0,0 +1,306 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GL_COMMAND_STREAM_H_
+#define GL_COMMAND_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wvu {
+// The OpenGL commands that the capture records, in the format of
+// X(OPCODE, glFunctionName). The list generates the GlOpcode enum and the
+// names, so a new command only needs one line here.
+#define WVU_GL_OPCODES(X)                                       \
+  X(BEGIN_FRAME, "BeginFrame")                                  \
+  X(END_FRAME, "EndFrame")                                      \
+  X(GEN_BUFFERS, "glGenBuffers")                                \
+  X(DELETE_BUFFERS, "glDeleteBuffers")                          \
+  X(BIND_BUFFER, "glBindBuffer")                                \
+  X(BIND_BUFFER_BASE, "glBindBufferBase")                       \
+  X(BUFFER_DATA, "glBufferData")                                \
+  X(BUFFER_SUB_DATA, "glBufferSubData")                         \
+  X(GEN_VERTEX_ARRAYS, "glGenVertexArrays")                     \
+  X(DELETE_VERTEX_ARRAYS, "glDeleteVertexArrays")               \
+  X(BIND_VERTEX_ARRAY, "glBindVertexArray")                     \
+  X(VERTEX_ATTRIB_POINTER, "glVertexAttribPointer")             \
+  X(ENABLE_VERTEX_ATTRIB_ARRAY, "glEnableVertexAttribArray")    \
+  X(GEN_TEXTURES, "glGenTextures")                              \
+  X(DELETE_TEXTURES, "glDeleteTextures")                        \
+  X(BIND_TEXTURE, "glBindTexture")                              \
+  X(ACTIVE_TEXTURE, "glActiveTexture")                          \
+  X(TEX_PARAMETER_I, "glTexParameteri")                         \
+  X(TEX_IMAGE_2D, "glTexImage2D")                               \
+  X(TEX_SUB_IMAGE_2D, "glTexSubImage2D")                        \
+  X(TEX_BUFFER, "glTexBuffer")                                  \
+  X(PIXEL_STORE_I, "glPixelStorei")                             \
+  X(GEN_FRAMEBUFFERS, "glGenFramebuffers")                      \
+  X(DELETE_FRAMEBUFFERS, "glDeleteFramebuffers")                \
+  X(BIND_FRAMEBUFFER, "glBindFramebuffer")                      \
+  X(FRAMEBUFFER_TEXTURE_2D, "glFramebufferTexture2D")           \
+  X(FRAMEBUFFER_RENDERBUFFER, "glFramebufferRenderbuffer")      \
+  X(BLIT_FRAMEBUFFER, "glBlitFramebuffer")                      \
+  X(READ_BUFFER, "glReadBuffer")                                \
+  X(READ_PIXELS, "glReadPixels")                                \
+  X(GEN_RENDERBUFFERS, "glGenRenderbuffers")                    \
+  X(DELETE_RENDERBUFFERS, "glDeleteRenderbuffers")              \
+  X(BIND_RENDERBUFFER, "glBindRenderbuffer")                    \
+  X(RENDERBUFFER_STORAGE, "glRenderbufferStorage")              \
+  X(CREATE_SHADER, "glCreateShader")                            \
+  X(SHADER_SOURCE, "glShaderSource")                            \
+  X(COMPILE_SHADER, "glCompileShader")                          \
+  X(DELETE_SHADER, "glDeleteShader")                            \
+  X(CREATE_PROGRAM, "glCreateProgram")                          \
+  X(ATTACH_SHADER, "glAttachShader")                            \
+  X(LINK_PROGRAM, "glLinkProgram")                              \
+  X(DELETE_PROGRAM, "glDeleteProgram")                          \
+  X(USE_PROGRAM, "glUseProgram")                                \
+  X(GET_UNIFORM_LOCATION, "glGetUniformLocation")               \
+  X(GET_UNIFORM_BLOCK_INDEX, "glGetUniformBlockIndex")          \
+  X(UNIFORM_BLOCK_BINDING, "glUniformBlockBinding")             \
+  X(UNIFORM_1I, "glUniform1i")                                  \
+  X(UNIFORM_1IV, "glUniform1iv")                                \
+  X(UNIFORM_1F, "glUniform1f")                                  \
+  X(UNIFORM_2F, "glUniform2f")                                  \
+  X(UNIFORM_MATRIX_4FV, "glUniformMatrix4fv")                   \
+  X(VIEWPORT, "glViewport")                                     \
+  X(VIEWPORT_INDEXED_F, "glViewportIndexedf")                   \
+  X(SCISSOR, "glScissor")                                       \
+  X(SCISSOR_INDEXED, "glScissorIndexed")                        \
+  X(ENABLE, "glEnable")                                         \
+  X(DISABLE, "glDisable")                                       \
+  X(POLYGON_MODE, "glPolygonMode")                              \
+  X(DEPTH_MASK, "glDepthMask")                                  \
+  X(DEPTH_FUNC, "glDepthFunc")                                  \
+  X(COLOR_MASK, "glColorMask")                                  \
+  X(CLEAR_COLOR, "glClearColor")                                \
+  X(CLEAR_DEPTH, "glClearDepth")                                \
+  X(CLEAR, "glClear")                                           \
+  X(CLIP_CONTROL, "glClipControl")                              \
+  X(DRAW_ARRAYS, "glDrawArrays")                                \
+  X(DRAW_ELEMENTS, "glDrawElements")                            \
+  X(DRAW_ARRAYS_INSTANCED, "glDrawArraysInstanced")             \
+  X(DRAW_ELEMENTS_INSTANCED, "glDrawElementsInstanced")         \
+  X(GEN_QUERIES, "glGenQueries")                                \
+  X(DELETE_QUERIES, "glDeleteQueries")                          \
+  X(BEGIN_QUERY, "glBeginQuery")                                \
+  X(END_QUERY, "glEndQuery")                                    \
+  X(QUERY_COUNTER, "glQueryCounter")                            \
+  X(BEGIN_CONDITIONAL_RENDER, "glBeginConditionalRender")       \
+  X(END_CONDITIONAL_RENDER, "glEndConditionalRender")
+
+#define WVU_GL_OPCODE_ENUMERATOR(opcode, name) opcode,
+enum class GlOpcode : uint16_t {
+  WVU_GL_OPCODES(WVU_GL_OPCODE_ENUMERATOR)
+  NUM_OPCODES
+};
+#undef WVU_GL_OPCODE_ENUMERATOR
+
+constexpr int kNumGlOpcodes = static_cast<int>(GlOpcode::NUM_OPCODES);
+
+// Returns the name of the OpenGL function of the opcode, e.g., "glClear".
+const char* GlOpcodeName(const GlOpcode opcode);
+
+// Writes OpenGL commands into a capture file. A capture starts with a header
+// (magic, version and the size of the window) followed by the commands. Every
+// command is its opcode, the size of its arguments and the arguments in the
+// order of the OpenGL function. Pointers to client memory are written as
+// byte arrays prefixed by their size; offsets into buffer objects are written
+// as 64-bit integers. The values are stored in the byte order of the host,
+// i.e., the captures are meant for little-endian machines.
+//
+// The frames are delimited by BeginFrame() and EndFrame(). The commands
+// outside of the frames, e.g., the creation of the buffers and the shaders,
+// form the setup of the capture.
+//
+// Example:
+//
+// wvu::GlCommandWriter writer;
+// std::string error_info_log;
+// if (!writer.Open("scene.glcap", 640, 480, &error_info_log)) { ... }
+// writer.BeginCommand(wvu::GlOpcode::CLEAR);
+// writer.WriteUint32(GL_COLOR_BUFFER_BIT);
+// writer.EndCommand();
+// writer.Close();
+class GlCommandWriter {
+ public:
+  GlCommandWriter();
+
+  // Destructor. Closes the file.
+  ~GlCommandWriter();
+
+  // Creates the capture file and writes the header. Returns true if
+  // successful.
+  // Params:
+  //   filepath  The path of the capture file.
+  //   width  The width of the window framebuffer in pixels.
+  //   height  The height of the window framebuffer in pixels.
+  //   error_info_log  The reason of the failure.
+  bool Open(const std::string& filepath,
+            const int width,
+            const int height,
+            std::string* error_info_log);
+
+  // Writes the pending commands and closes the file.
+  void Close();
+
+  bool is_open() const {
+    return out_.is_open();
+  }
+
+  // Delimit the commands of a frame. EndFrame() also writes the pending
+  // commands to disk.
+  void BeginFrame();
+  void EndFrame();
+
+  // Write a command: its opcode, then its arguments.
+  void BeginCommand(const GlOpcode opcode);
+  void WriteUint32(const uint32_t value);
+  void WriteInt32(const int32_t value);
+  void WriteInt64(const int64_t value);
+  void WriteFloat(const float value);
+  void WriteDouble(const double value);
+  // Writes the size of the data, then the data.
+  void WriteBytes(const void* data, const size_t size);
+  void EndCommand();
+
+  // Returns the number of frames ended so far.
+  int num_frames() const {
+    return num_frames_;
+  }
+
+  // Returns the number of bytes of the capture so far.
+  uint64_t num_bytes() const {
+    return num_bytes_flushed_ + buffer_.size();
+  }
+
+ private:
+  // Appends raw bytes to the buffer.
+  void Append(const void* data, const size_t size);
+
+  // Writes the buffer to disk.
+  void Flush();
+
+  std::ofstream out_;
+  std::vector<uint8_t> buffer_;
+  // Offset in the buffer of the size field of the command being written.
+  size_t command_size_offset_;
+  uint64_t num_bytes_flushed_;
+  int num_frames_;
+};
+
+// A command of a capture, pointing into the loaded file.
+struct GlCommand {
+  GlOpcode opcode;
+  const uint8_t* arguments;
+  uint32_t size;
+};
+
+// Reads the arguments of a command in order. Reading past the end returns
+// zeros and clears ok().
+class GlArgumentReader {
+ public:
+  explicit GlArgumentReader(const GlCommand& command);
+
+  uint32_t ReadUint32();
+  int32_t ReadInt32();
+  int64_t ReadInt64();
+  float ReadFloat();
+  double ReadDouble();
+  // Returns a pointer to the data and sets its size.
+  const uint8_t* ReadBytes(uint32_t* size);
+
+  bool ok() const {
+    return ok_;
+  }
+
+ private:
+  // Copies the next size bytes into value.
+  void Read(void* value, const size_t size);
+
+  const uint8_t* data_;
+  uint32_t size_;
+  uint32_t offset_;
+  bool ok_;
+};
+
+// Loads a capture file and indexes its commands and frames.
+//
+// Example:
+//
+// wvu::GlCommandReader reader;
+// std::string error_info_log;
+// if (!reader.Load("scene.glcap", &error_info_log)) { ... }
+// for (const wvu::GlCommand& command : reader.commands()) { ... }
+class GlCommandReader {
+ public:
+  GlCommandReader();
+
+  // Reads the whole file. Returns false and fills error_info_log if the file
+  // cannot be read or is not a valid capture.
+  bool Load(const std::string& filepath, std::string* error_info_log);
+
+  const std::vector<GlCommand>& commands() const {
+    return commands_;
+  }
+
+  // Returns the [begin, end) ranges of command indices of the frames,
+  // excluding the frame markers.
+  const std::vector<std::pair<int, int> >& frames() const {
+    return frames_;
+  }
+
+  int width() const {
+    return width_;
+  }
+
+  int height() const {
+    return height_;
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+  std::vector<GlCommand> commands_;
+  std::vector<std::pair<int, int> > frames_;
+  int width_;
+  int height_;
+};
+
+}  // namespace wvu
+
+#endif  // GL_COMMAND_STREAM_H_
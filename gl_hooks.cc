@@ -0,0 +1,999 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// The hooks call the driver, so the redirecting macros are not wanted here.
+#define WVU_GL_HOOKS_IMPLEMENTATION
+#include "gl_hooks.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace wvu {
+
+GlCallCounters::GlCallCounters() {
+  Reset();
+}
+
+void GlCallCounters::Reset() {
+  for (int i = 0; i < kNumGlOpcodes; ++i) {
+    num_calls[i] = 0;
+  }
+  num_bytes_uploaded = 0;
+  num_buffers_created = 0;
+  num_textures_created = 0;
+}
+
+void GlCallCounters::Add(const GlCallCounters& other) {
+  for (int i = 0; i < kNumGlOpcodes; ++i) {
+    num_calls[i] += other.num_calls[i];
+  }
+  num_bytes_uploaded += other.num_bytes_uploaded;
+  num_buffers_created += other.num_buffers_created;
+  num_textures_created += other.num_textures_created;
+}
+
+int64_t GlCallCounters::num_draw_calls() const {
+  return num_calls_of(GlOpcode::DRAW_ARRAYS) +
+      num_calls_of(GlOpcode::DRAW_ELEMENTS) +
+      num_calls_of(GlOpcode::DRAW_ARRAYS_INSTANCED) +
+      num_calls_of(GlOpcode::DRAW_ELEMENTS_INSTANCED);
+}
+
+int64_t GlCallCounters::num_binds() const {
+  return num_calls_of(GlOpcode::BIND_BUFFER) +
+      num_calls_of(GlOpcode::BIND_BUFFER_BASE) +
+      num_calls_of(GlOpcode::BIND_VERTEX_ARRAY) +
+      num_calls_of(GlOpcode::BIND_TEXTURE) +
+      num_calls_of(GlOpcode::BIND_FRAMEBUFFER) +
+      num_calls_of(GlOpcode::BIND_RENDERBUFFER) +
+      num_calls_of(GlOpcode::USE_PROGRAM);
+}
+
+}  // namespace wvu
+
+#ifdef WVU_ENABLE_GL_HOOKS
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "gl_command_stream.h"
+
+namespace wvu {
+namespace gl_hooks {
+namespace {
+
+// Client memory written as a size-prefixed byte array.
+struct Bytes {
+  const void* data;
+  size_t size;
+};
+
+// An offset into a buffer object passed as a pointer.
+struct Offset {
+  const void* pointer;
+};
+
+// State of glPixelStorei() that sizes the images in client memory.
+struct PixelStoreState {
+  GLint row_length = 0;
+  GLint alignment = 4;
+};
+
+// A range mapped for writing, counted as an upload and recorded as a buffer
+// update when unmapped.
+struct MappedRange {
+  GLenum target;
+  GLintptr offset;
+  GLsizeiptr length;
+  const void* pointer;
+};
+
+GlCommandWriter* command_writer = nullptr;
+PixelStoreState pack_state;
+PixelStoreState unpack_state;
+GLuint pixel_pack_buffer = 0;
+GLuint pixel_unpack_buffer = 0;
+std::vector<MappedRange> mapped_ranges;
+GlCallCounters call_counters;
+bool forward_to_driver = true;
+// The state read back without the driver.
+GLuint fake_query_result_available = GL_TRUE;
+GLuint fake_query_samples_passed = 1;
+GLint polygon_mode = GL_FILL;
+// The names generated without the driver.
+GLuint next_fake_name = 1;
+
+// Write an argument with the writer method of its type. GLenum, GLuint and
+// GLbitfield are unsigned ints; GLint and GLsizei are ints.
+void WriteArgument(const unsigned int value) {
+  command_writer->WriteUint32(value);
+}
+
+void WriteArgument(const int value) {
+  command_writer->WriteInt32(value);
+}
+
+void WriteArgument(const unsigned char value) {
+  command_writer->WriteUint32(value);
+}
+
+void WriteArgument(const int64_t value) {
+  command_writer->WriteInt64(value);
+}
+
+void WriteArgument(const float value) {
+  command_writer->WriteFloat(value);
+}
+
+void WriteArgument(const double value) {
+  command_writer->WriteDouble(value);
+}
+
+void WriteArgument(const Bytes& bytes) {
+  command_writer->WriteBytes(bytes.data, bytes.size);
+}
+
+void WriteArgument(const Offset& offset) {
+  command_writer->WriteInt64(reinterpret_cast<intptr_t>(offset.pointer));
+}
+
+// Records a command if a writer is set.
+template <typename... Arguments>
+void WriteCommand(const GlOpcode opcode, const Arguments&... arguments) {
+  if (command_writer == nullptr) return;
+  command_writer->BeginCommand(opcode);
+  // Writes the arguments in order.
+  const int expand[] = {0, (WriteArgument(arguments), 0)...};
+  static_cast<void>(expand);
+  command_writer->EndCommand();
+}
+
+// Counts a command and records it.
+template <typename... Arguments>
+void Record(const GlOpcode opcode, const Arguments&... arguments) {
+  ++call_counters.num_calls[static_cast<int>(opcode)];
+  WriteCommand(opcode, arguments...);
+}
+
+// Records the ids of created or deleted objects.
+void RecordObjects(const GlOpcode opcode,
+                   const GLsizei n,
+                   const GLuint* ids) {
+  Record(opcode, Bytes{ids, n * sizeof(GLuint)});
+}
+
+void GenerateFakeNames(const GLsizei n, GLuint* names) {
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = next_fake_name++;
+  }
+}
+
+// Returns the number of bytes of an image in client memory.
+size_t ComputeImageSize(const GLsizei width,
+                        const GLsizei height,
+                        const GLenum format,
+                        const GLenum type,
+                        const PixelStoreState& state) {
+  int num_components = 4;
+  switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+      num_components = 1;
+      break;
+    case GL_RG:
+      num_components = 2;
+      break;
+    case GL_RGB:
+    case GL_BGR:
+      num_components = 3;
+      break;
+  }
+  int component_size = 1;
+  switch (type) {
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+      component_size = 2;
+      break;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+      component_size = 4;
+      break;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+      // Packed: one value per pixel.
+      num_components = 1;
+      component_size = 4;
+      break;
+  }
+  if (width <= 0 || height <= 0) return 0;
+  const size_t pixel_size = num_components * component_size;
+  const size_t row_pixels = state.row_length > 0 ? state.row_length : width;
+  const size_t alignment = state.alignment;
+  const size_t row_size =
+      (row_pixels * pixel_size + alignment - 1) / alignment * alignment;
+  return row_size * (height - 1) + width * pixel_size;
+}
+
+// Records the pixels of a texture image: from the unpack buffer, from client
+// memory, or none.
+void RecordTextureImage(const GlOpcode opcode,
+                        const GLenum target,
+                        const GLint level,
+                        const GLint internal_format_or_x_offset,
+                        const GLint border_or_y_offset,
+                        const GLsizei width,
+                        const GLsizei height,
+                        const GLenum format,
+                        const GLenum type,
+                        const void* pixels) {
+  if (pixel_unpack_buffer != 0) {
+    Record(opcode, target, level, internal_format_or_x_offset,
+           border_or_y_offset, width, height, format, type, 1u,
+           Offset{pixels});
+  } else if (pixels != nullptr) {
+    const size_t size =
+        ComputeImageSize(width, height, format, type, unpack_state);
+    call_counters.num_bytes_uploaded += size;
+    Record(opcode, target, level, internal_format_or_x_offset,
+           border_or_y_offset, width, height, format, type, 2u,
+           Bytes{pixels, size});
+  } else {
+    Record(opcode, target, level, internal_format_or_x_offset,
+           border_or_y_offset, width, height, format, type, 0u);
+  }
+}
+
+}  // namespace
+
+void SetCommandWriter(GlCommandWriter* writer) {
+  command_writer = writer;
+}
+
+const GlCallCounters& GetCallCounters() {
+  return call_counters;
+}
+
+void ResetCallCounters() {
+  call_counters.Reset();
+}
+
+void SetForwardToDriver(const bool forward) {
+  forward_to_driver = forward;
+}
+
+void SetFakeQueryResult(const bool available, const GLuint samples_passed) {
+  fake_query_result_available = available ? GL_TRUE : GL_FALSE;
+  fake_query_samples_passed = samples_passed;
+}
+
+void BindVertexArray(GLuint array) {
+  Record(GlOpcode::BIND_VERTEX_ARRAY, array);
+  if (!forward_to_driver) return;
+  glBindVertexArray(array);
+}
+
+void GenVertexArrays(GLsizei n, GLuint* arrays) {
+  if (forward_to_driver) {
+    glGenVertexArrays(n, arrays);
+  } else {
+    GenerateFakeNames(n, arrays);
+  }
+  RecordObjects(GlOpcode::GEN_VERTEX_ARRAYS, n, arrays);
+}
+
+void DeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+  RecordObjects(GlOpcode::DELETE_VERTEX_ARRAYS, n, arrays);
+  if (!forward_to_driver) return;
+  glDeleteVertexArrays(n, arrays);
+}
+
+void GenBuffers(GLsizei n, GLuint* buffers) {
+  if (forward_to_driver) {
+    glGenBuffers(n, buffers);
+  } else {
+    GenerateFakeNames(n, buffers);
+  }
+  call_counters.num_buffers_created += n;
+  RecordObjects(GlOpcode::GEN_BUFFERS, n, buffers);
+}
+
+void DeleteBuffers(GLsizei n, const GLuint* buffers) {
+  RecordObjects(GlOpcode::DELETE_BUFFERS, n, buffers);
+  if (!forward_to_driver) return;
+  glDeleteBuffers(n, buffers);
+}
+
+void BindBuffer(GLenum target, GLuint buffer) {
+  if (target == GL_PIXEL_PACK_BUFFER) {
+    pixel_pack_buffer = buffer;
+  } else if (target == GL_PIXEL_UNPACK_BUFFER) {
+    pixel_unpack_buffer = buffer;
+  }
+  Record(GlOpcode::BIND_BUFFER, target, buffer);
+  if (!forward_to_driver) return;
+  glBindBuffer(target, buffer);
+}
+
+void BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  Record(GlOpcode::BIND_BUFFER_BASE, target, index, buffer);
+  if (!forward_to_driver) return;
+  glBindBufferBase(target, index, buffer);
+}
+
+void BufferData(GLenum target,
+                GLsizeiptr size,
+                const void* data,
+                GLenum usage) {
+  // The data is optional: a null pointer only allocates.
+  if (data != nullptr) {
+    call_counters.num_bytes_uploaded += size;
+  }
+  Record(GlOpcode::BUFFER_DATA, target, static_cast<int64_t>(size), usage,
+         Bytes{data, data != nullptr ? static_cast<size_t>(size) : 0});
+  if (!forward_to_driver) return;
+  glBufferData(target, size, data, usage);
+}
+
+void BufferSubData(GLenum target,
+                   GLintptr offset,
+                   GLsizeiptr size,
+                   const void* data) {
+  call_counters.num_bytes_uploaded += size;
+  Record(GlOpcode::BUFFER_SUB_DATA, target, static_cast<int64_t>(offset),
+         Bytes{data, static_cast<size_t>(size)});
+  if (!forward_to_driver) return;
+  glBufferSubData(target, offset, size, data);
+}
+
+void* MapBufferRange(GLenum target,
+                     GLintptr offset,
+                     GLsizeiptr length,
+                     GLbitfield access) {
+  if (!forward_to_driver) return nullptr;
+  void* pointer = glMapBufferRange(target, offset, length, access);
+  // The writes into the mapping are counted and recorded at unmap time as an
+  // update of the range. Read-only mappings only read results back.
+  if (pointer != nullptr && (access & GL_MAP_WRITE_BIT) != 0) {
+    MappedRange range;
+    range.target = target;
+    range.offset = offset;
+    range.length = length;
+    range.pointer = pointer;
+    mapped_ranges.push_back(range);
+  }
+  return pointer;
+}
+
+GLboolean UnmapBuffer(GLenum target) {
+  for (size_t i = 0; i < mapped_ranges.size(); ++i) {
+    const MappedRange& range = mapped_ranges[i];
+    if (range.target != target) continue;
+    call_counters.num_bytes_uploaded += range.length;
+    WriteCommand(GlOpcode::BUFFER_SUB_DATA, target,
+                 static_cast<int64_t>(range.offset),
+                 Bytes{range.pointer, static_cast<size_t>(range.length)});
+    mapped_ranges.erase(mapped_ranges.begin() + i);
+    break;
+  }
+  return forward_to_driver ? glUnmapBuffer(target) : GL_TRUE;
+}
+
+void VertexAttribPointer(GLuint index,
+                         GLint size,
+                         GLenum type,
+                         GLboolean normalized,
+                         GLsizei stride,
+                         const void* pointer) {
+  // The core profile sources the attributes from buffer objects only.
+  Record(GlOpcode::VERTEX_ATTRIB_POINTER, index, size, type, normalized,
+         stride, Offset{pointer});
+  if (!forward_to_driver) return;
+  glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void EnableVertexAttribArray(GLuint index) {
+  Record(GlOpcode::ENABLE_VERTEX_ATTRIB_ARRAY, index);
+  if (!forward_to_driver) return;
+  glEnableVertexAttribArray(index);
+}
+
+void GenTextures(GLsizei n, GLuint* textures) {
+  if (forward_to_driver) {
+    glGenTextures(n, textures);
+  } else {
+    GenerateFakeNames(n, textures);
+  }
+  call_counters.num_textures_created += n;
+  RecordObjects(GlOpcode::GEN_TEXTURES, n, textures);
+}
+
+void DeleteTextures(GLsizei n, const GLuint* textures) {
+  RecordObjects(GlOpcode::DELETE_TEXTURES, n, textures);
+  if (!forward_to_driver) return;
+  glDeleteTextures(n, textures);
+}
+
+void BindTexture(GLenum target, GLuint texture) {
+  Record(GlOpcode::BIND_TEXTURE, target, texture);
+  if (!forward_to_driver) return;
+  glBindTexture(target, texture);
+}
+
+void ActiveTexture(GLenum texture) {
+  Record(GlOpcode::ACTIVE_TEXTURE, texture);
+  if (!forward_to_driver) return;
+  glActiveTexture(texture);
+}
+
+void TexParameteri(GLenum target, GLenum pname, GLint param) {
+  Record(GlOpcode::TEX_PARAMETER_I, target, pname, param);
+  if (!forward_to_driver) return;
+  glTexParameteri(target, pname, param);
+}
+
+void TexImage2D(GLenum target,
+                GLint level,
+                GLint internal_format,
+                GLsizei width,
+                GLsizei height,
+                GLint border,
+                GLenum format,
+                GLenum type,
+                const void* pixels) {
+  RecordTextureImage(GlOpcode::TEX_IMAGE_2D, target, level, internal_format,
+                     border, width, height, format, type, pixels);
+  if (!forward_to_driver) return;
+  glTexImage2D(target, level, internal_format, width, height, border, format,
+               type, pixels);
+}
+
+void TexSubImage2D(GLenum target,
+                   GLint level,
+                   GLint x_offset,
+                   GLint y_offset,
+                   GLsizei width,
+                   GLsizei height,
+                   GLenum format,
+                   GLenum type,
+                   const void* pixels) {
+  RecordTextureImage(GlOpcode::TEX_SUB_IMAGE_2D, target, level, x_offset,
+                     y_offset, width, height, format, type, pixels);
+  if (!forward_to_driver) return;
+  glTexSubImage2D(target, level, x_offset, y_offset, width, height, format,
+                  type, pixels);
+}
+
+void TexBuffer(GLenum target, GLenum internal_format, GLuint buffer) {
+  Record(GlOpcode::TEX_BUFFER, target, internal_format, buffer);
+  if (!forward_to_driver) return;
+  glTexBuffer(target, internal_format, buffer);
+}
+
+void PixelStorei(GLenum pname, GLint param) {
+  switch (pname) {
+    case GL_PACK_ROW_LENGTH:
+      pack_state.row_length = param;
+      break;
+    case GL_PACK_ALIGNMENT:
+      pack_state.alignment = param;
+      break;
+    case GL_UNPACK_ROW_LENGTH:
+      unpack_state.row_length = param;
+      break;
+    case GL_UNPACK_ALIGNMENT:
+      unpack_state.alignment = param;
+      break;
+  }
+  Record(GlOpcode::PIXEL_STORE_I, pname, param);
+  if (!forward_to_driver) return;
+  glPixelStorei(pname, param);
+}
+
+void GenFramebuffers(GLsizei n, GLuint* framebuffers) {
+  if (forward_to_driver) {
+    glGenFramebuffers(n, framebuffers);
+  } else {
+    GenerateFakeNames(n, framebuffers);
+  }
+  RecordObjects(GlOpcode::GEN_FRAMEBUFFERS, n, framebuffers);
+}
+
+void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+  RecordObjects(GlOpcode::DELETE_FRAMEBUFFERS, n, framebuffers);
+  if (!forward_to_driver) return;
+  glDeleteFramebuffers(n, framebuffers);
+}
+
+void BindFramebuffer(GLenum target, GLuint framebuffer) {
+  Record(GlOpcode::BIND_FRAMEBUFFER, target, framebuffer);
+  if (!forward_to_driver) return;
+  glBindFramebuffer(target, framebuffer);
+}
+
+void FramebufferTexture2D(GLenum target,
+                          GLenum attachment,
+                          GLenum texture_target,
+                          GLuint texture,
+                          GLint level) {
+  Record(GlOpcode::FRAMEBUFFER_TEXTURE_2D, target, attachment, texture_target,
+         texture, level);
+  if (!forward_to_driver) return;
+  glFramebufferTexture2D(target, attachment, texture_target, texture, level);
+}
+
+void FramebufferRenderbuffer(GLenum target,
+                             GLenum attachment,
+                             GLenum renderbuffer_target,
+                             GLuint renderbuffer) {
+  Record(GlOpcode::FRAMEBUFFER_RENDERBUFFER, target, attachment,
+         renderbuffer_target, renderbuffer);
+  if (!forward_to_driver) return;
+  glFramebufferRenderbuffer(target, attachment, renderbuffer_target,
+                            renderbuffer);
+}
+
+void BlitFramebuffer(GLint src_x0,
+                     GLint src_y0,
+                     GLint src_x1,
+                     GLint src_y1,
+                     GLint dst_x0,
+                     GLint dst_y0,
+                     GLint dst_x1,
+                     GLint dst_y1,
+                     GLbitfield mask,
+                     GLenum filter) {
+  Record(GlOpcode::BLIT_FRAMEBUFFER, src_x0, src_y0, src_x1, src_y1, dst_x0,
+         dst_y0, dst_x1, dst_y1, mask, filter);
+  if (!forward_to_driver) return;
+  glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1,
+                    dst_y1, mask, filter);
+}
+
+void ReadBuffer(GLenum source) {
+  Record(GlOpcode::READ_BUFFER, source);
+  if (!forward_to_driver) return;
+  glReadBuffer(source);
+}
+
+void ReadPixels(GLint x,
+                GLint y,
+                GLsizei width,
+                GLsizei height,
+                GLenum format,
+                GLenum type,
+                void* pixels) {
+  // Into the pack buffer at an offset, or into client memory of the recorded
+  // size, which the replay allocates.
+  if (pixel_pack_buffer != 0) {
+    Record(GlOpcode::READ_PIXELS, x, y, width, height, format, type, 1u,
+           Offset{pixels});
+  } else {
+    Record(GlOpcode::READ_PIXELS, x, y, width, height, format, type, 2u,
+           static_cast<int64_t>(
+               ComputeImageSize(width, height, format, type, pack_state)));
+  }
+  if (!forward_to_driver) return;
+  glReadPixels(x, y, width, height, format, type, pixels);
+}
+
+void GenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+  if (forward_to_driver) {
+    glGenRenderbuffers(n, renderbuffers);
+  } else {
+    GenerateFakeNames(n, renderbuffers);
+  }
+  RecordObjects(GlOpcode::GEN_RENDERBUFFERS, n, renderbuffers);
+}
+
+void DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+  RecordObjects(GlOpcode::DELETE_RENDERBUFFERS, n, renderbuffers);
+  if (!forward_to_driver) return;
+  glDeleteRenderbuffers(n, renderbuffers);
+}
+
+void BindRenderbuffer(GLenum target, GLuint renderbuffer) {
+  Record(GlOpcode::BIND_RENDERBUFFER, target, renderbuffer);
+  if (!forward_to_driver) return;
+  glBindRenderbuffer(target, renderbuffer);
+}
+
+void RenderbufferStorage(GLenum target,
+                         GLenum internal_format,
+                         GLsizei width,
+                         GLsizei height) {
+  Record(GlOpcode::RENDERBUFFER_STORAGE, target, internal_format, width,
+         height);
+  if (!forward_to_driver) return;
+  glRenderbufferStorage(target, internal_format, width, height);
+}
+
+GLuint CreateShader(GLenum type) {
+  const GLuint shader =
+      forward_to_driver ? glCreateShader(type) : next_fake_name++;
+  Record(GlOpcode::CREATE_SHADER, type, shader);
+  return shader;
+}
+
+void ShaderSource(GLuint shader,
+                  GLsizei count,
+                  const GLchar* const* strings,
+                  const GLint* lengths) {
+  // The strings are recorded as a single one, joined only for a writer.
+  std::string source;
+  if (command_writer != nullptr) {
+    for (GLsizei i = 0; i < count; ++i) {
+      if (lengths != nullptr && lengths[i] >= 0) {
+        source.append(strings[i], lengths[i]);
+      } else {
+        source.append(strings[i]);
+      }
+    }
+  }
+  Record(GlOpcode::SHADER_SOURCE, shader, Bytes{source.data(), source.size()});
+  // Older GLEW headers declare the strings without the inner const.
+  if (!forward_to_driver) return;
+  glShaderSource(shader, count, const_cast<const GLchar**>(strings),
+                 lengths);
+}
+
+void CompileShader(GLuint shader) {
+  Record(GlOpcode::COMPILE_SHADER, shader);
+  if (!forward_to_driver) return;
+  glCompileShader(shader);
+}
+
+void DeleteShader(GLuint shader) {
+  Record(GlOpcode::DELETE_SHADER, shader);
+  if (!forward_to_driver) return;
+  glDeleteShader(shader);
+}
+
+GLuint CreateProgram() {
+  const GLuint program =
+      forward_to_driver ? glCreateProgram() : next_fake_name++;
+  Record(GlOpcode::CREATE_PROGRAM, program);
+  return program;
+}
+
+void AttachShader(GLuint program, GLuint shader) {
+  Record(GlOpcode::ATTACH_SHADER, program, shader);
+  if (!forward_to_driver) return;
+  glAttachShader(program, shader);
+}
+
+void LinkProgram(GLuint program) {
+  Record(GlOpcode::LINK_PROGRAM, program);
+  if (!forward_to_driver) return;
+  glLinkProgram(program);
+}
+
+void DeleteProgram(GLuint program) {
+  Record(GlOpcode::DELETE_PROGRAM, program);
+  if (!forward_to_driver) return;
+  glDeleteProgram(program);
+}
+
+void UseProgram(GLuint program) {
+  Record(GlOpcode::USE_PROGRAM, program);
+  if (!forward_to_driver) return;
+  glUseProgram(program);
+}
+
+GLint GetUniformLocation(GLuint program, const GLchar* name) {
+  // The replay maps the recorded locations to its own.
+  const GLint location =
+      forward_to_driver ? glGetUniformLocation(program, name) : -1;
+  Record(GlOpcode::GET_UNIFORM_LOCATION, program,
+         Bytes{name, std::strlen(name)}, location);
+  return location;
+}
+
+GLuint GetUniformBlockIndex(GLuint program, const GLchar* name) {
+  const GLuint index = forward_to_driver ?
+      glGetUniformBlockIndex(program, name) : GL_INVALID_INDEX;
+  Record(GlOpcode::GET_UNIFORM_BLOCK_INDEX, program,
+         Bytes{name, std::strlen(name)}, index);
+  return index;
+}
+
+void UniformBlockBinding(GLuint program, GLuint index, GLuint binding) {
+  Record(GlOpcode::UNIFORM_BLOCK_BINDING, program, index, binding);
+  if (!forward_to_driver) return;
+  glUniformBlockBinding(program, index, binding);
+}
+
+void Uniform1i(GLint location, GLint v0) {
+  Record(GlOpcode::UNIFORM_1I, location, v0);
+  if (!forward_to_driver) return;
+  glUniform1i(location, v0);
+}
+
+void Uniform1iv(GLint location, GLsizei count, const GLint* values) {
+  Record(GlOpcode::UNIFORM_1IV, location, count,
+         Bytes{values, count * sizeof(GLint)});
+  if (!forward_to_driver) return;
+  glUniform1iv(location, count, values);
+}
+
+void Uniform1f(GLint location, GLfloat v0) {
+  Record(GlOpcode::UNIFORM_1F, location, v0);
+  if (!forward_to_driver) return;
+  glUniform1f(location, v0);
+}
+
+void Uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+  Record(GlOpcode::UNIFORM_2F, location, v0, v1);
+  if (!forward_to_driver) return;
+  glUniform2f(location, v0, v1);
+}
+
+void UniformMatrix4fv(GLint location,
+                      GLsizei count,
+                      GLboolean transpose,
+                      const GLfloat* values) {
+  Record(GlOpcode::UNIFORM_MATRIX_4FV, location, count, transpose,
+         Bytes{values, 16 * count * sizeof(GLfloat)});
+  if (!forward_to_driver) return;
+  glUniformMatrix4fv(location, count, transpose, values);
+}
+
+void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  Record(GlOpcode::VIEWPORT, x, y, width, height);
+  if (!forward_to_driver) return;
+  glViewport(x, y, width, height);
+}
+
+void ViewportIndexedf(GLuint index,
+                      GLfloat x,
+                      GLfloat y,
+                      GLfloat width,
+                      GLfloat height) {
+  Record(GlOpcode::VIEWPORT_INDEXED_F, index, x, y, width, height);
+  if (!forward_to_driver) return;
+  glViewportIndexedf(index, x, y, width, height);
+}
+
+void Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  Record(GlOpcode::SCISSOR, x, y, width, height);
+  if (!forward_to_driver) return;
+  glScissor(x, y, width, height);
+}
+
+void ScissorIndexed(GLuint index,
+                    GLint left,
+                    GLint bottom,
+                    GLsizei width,
+                    GLsizei height) {
+  Record(GlOpcode::SCISSOR_INDEXED, index, left, bottom, width, height);
+  if (!forward_to_driver) return;
+  glScissorIndexed(index, left, bottom, width, height);
+}
+
+void Enable(GLenum capability) {
+  Record(GlOpcode::ENABLE, capability);
+  if (!forward_to_driver) return;
+  glEnable(capability);
+}
+
+void Disable(GLenum capability) {
+  Record(GlOpcode::DISABLE, capability);
+  if (!forward_to_driver) return;
+  glDisable(capability);
+}
+
+void PolygonMode(GLenum face, GLenum mode) {
+  Record(GlOpcode::POLYGON_MODE, face, mode);
+  polygon_mode = mode;
+  if (!forward_to_driver) return;
+  glPolygonMode(face, mode);
+}
+
+void DepthMask(GLboolean flag) {
+  Record(GlOpcode::DEPTH_MASK, flag);
+  if (!forward_to_driver) return;
+  glDepthMask(flag);
+}
+
+void DepthFunc(GLenum function) {
+  Record(GlOpcode::DEPTH_FUNC, function);
+  if (!forward_to_driver) return;
+  glDepthFunc(function);
+}
+
+void ColorMask(GLboolean red,
+               GLboolean green,
+               GLboolean blue,
+               GLboolean alpha) {
+  Record(GlOpcode::COLOR_MASK, red, green, blue, alpha);
+  if (!forward_to_driver) return;
+  glColorMask(red, green, blue, alpha);
+}
+
+void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  Record(GlOpcode::CLEAR_COLOR, red, green, blue, alpha);
+  if (!forward_to_driver) return;
+  glClearColor(red, green, blue, alpha);
+}
+
+void ClearDepth(GLdouble depth) {
+  Record(GlOpcode::CLEAR_DEPTH, depth);
+  if (!forward_to_driver) return;
+  glClearDepth(depth);
+}
+
+void Clear(GLbitfield mask) {
+  Record(GlOpcode::CLEAR, mask);
+  if (!forward_to_driver) return;
+  glClear(mask);
+}
+
+void ClipControl(GLenum origin, GLenum depth) {
+  Record(GlOpcode::CLIP_CONTROL, origin, depth);
+  if (!forward_to_driver) return;
+  glClipControl(origin, depth);
+}
+
+void DrawArrays(GLenum mode, GLint first, GLsizei count) {
+  Record(GlOpcode::DRAW_ARRAYS, mode, first, count);
+  if (!forward_to_driver) return;
+  glDrawArrays(mode, first, count);
+}
+
+void DrawElements(GLenum mode,
+                  GLsizei count,
+                  GLenum type,
+                  const void* indices) {
+  // The indices come from the element buffer of the vertex array object.
+  Record(GlOpcode::DRAW_ELEMENTS, mode, count, type, Offset{indices});
+  if (!forward_to_driver) return;
+  glDrawElements(mode, count, type, indices);
+}
+
+void DrawArraysInstanced(GLenum mode,
+                         GLint first,
+                         GLsizei count,
+                         GLsizei instance_count) {
+  Record(GlOpcode::DRAW_ARRAYS_INSTANCED, mode, first, count, instance_count);
+  if (!forward_to_driver) return;
+  glDrawArraysInstanced(mode, first, count, instance_count);
+}
+
+void DrawElementsInstanced(GLenum mode,
+                           GLsizei count,
+                           GLenum type,
+                           const void* indices,
+                           GLsizei instance_count) {
+  Record(GlOpcode::DRAW_ELEMENTS_INSTANCED, mode, count, type,
+         Offset{indices}, instance_count);
+  if (!forward_to_driver) return;
+  glDrawElementsInstanced(mode, count, type, indices, instance_count);
+}
+
+void GenQueries(GLsizei n, GLuint* ids) {
+  if (forward_to_driver) {
+    glGenQueries(n, ids);
+  } else {
+    GenerateFakeNames(n, ids);
+  }
+  RecordObjects(GlOpcode::GEN_QUERIES, n, ids);
+}
+
+void DeleteQueries(GLsizei n, const GLuint* ids) {
+  RecordObjects(GlOpcode::DELETE_QUERIES, n, ids);
+  if (!forward_to_driver) return;
+  glDeleteQueries(n, ids);
+}
+
+void BeginQuery(GLenum target, GLuint id) {
+  Record(GlOpcode::BEGIN_QUERY, target, id);
+  if (!forward_to_driver) return;
+  glBeginQuery(target, id);
+}
+
+void EndQuery(GLenum target) {
+  Record(GlOpcode::END_QUERY, target);
+  if (!forward_to_driver) return;
+  glEndQuery(target);
+}
+
+void QueryCounter(GLuint id, GLenum target) {
+  Record(GlOpcode::QUERY_COUNTER, id, target);
+  if (!forward_to_driver) return;
+  glQueryCounter(id, target);
+}
+
+void BeginConditionalRender(GLuint id, GLenum mode) {
+  Record(GlOpcode::BEGIN_CONDITIONAL_RENDER, id, mode);
+  if (!forward_to_driver) return;
+  glBeginConditionalRender(id, mode);
+}
+
+void EndConditionalRender() {
+  Record(GlOpcode::END_CONDITIONAL_RENDER);
+  if (!forward_to_driver) return;
+  glEndConditionalRender();
+}
+
+void GetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params) {
+  if (forward_to_driver) {
+    glGetQueryObjectuiv(id, pname, params);
+  } else if (pname == GL_QUERY_RESULT_AVAILABLE) {
+    *params = fake_query_result_available;
+  } else {
+    *params = fake_query_samples_passed;
+  }
+}
+
+void GetIntegerv(GLenum pname, GLint* data) {
+  if (forward_to_driver) {
+    glGetIntegerv(pname, data);
+  } else if (pname == GL_POLYGON_MODE) {
+    data[0] = polygon_mode;
+    data[1] = polygon_mode;
+  } else if (pname == GL_VIEWPORT || pname == GL_SCISSOR_BOX) {
+    std::fill(data, data + 4, 0);
+  } else {
+    *data = 0;
+  }
+}
+
+GLsync FenceSync(GLenum condition, GLbitfield flags) {
+  if (!forward_to_driver) {
+    // Any non-null handle; it is never passed to the driver.
+    static int fake_sync;
+    return reinterpret_cast<GLsync>(&fake_sync);
+  }
+  return glFenceSync(condition, flags);
+}
+
+GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+  if (!forward_to_driver) return GL_ALREADY_SIGNALED;
+  return glClientWaitSync(sync, flags, timeout);
+}
+
+void DeleteSync(GLsync sync) {
+  if (!forward_to_driver) return;
+  glDeleteSync(sync);
+}
+
+}  // namespace gl_hooks
+}  // namespace wvu
+
+#endif  // WVU_ENABLE_GL_HOOKS
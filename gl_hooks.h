@@ -0,0 +1,430 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GL_HOOKS_H_
+#define GL_HOOKS_H_
+
+#include <cstdint>
+#include <GL/glew.h>
+
+#include "gl_command_stream.h"
+
+// Interposition layer of the OpenGL entry points used by the renderer. When
+// WVU_ENABLE_GL_HOOKS is defined (the ENABLE_GL_HOOKS CMake option), the
+// files that include this header after glew.h call the functions of
+// wvu::gl_hooks instead, which observe the call and forward it to the driver.
+// Otherwise the header only includes glew.h and the calls go straight to the
+// driver.
+//
+// The hooks count the calls by type, the bytes uploaded and the objects
+// created; see GlCallCounters. They also record the calls into a
+// GlCommandWriter while one is set, which captures the command stream for
+// gl_replay. The hooks can stop forwarding the calls to the driver, so that
+// tests count the calls of the renderer without an OpenGL context.
+//
+// Example:
+//
+// wvu::GlCommandWriter writer;
+// writer.Open("scene.glcap", width, height, &error_info_log);
+// wvu::gl_hooks::SetCommandWriter(&writer);
+// ...  // Render.
+// wvu::gl_hooks::SetCommandWriter(nullptr);
+// writer.Close();
+//
+// wvu::gl_hooks::ResetCallCounters();
+// ...  // Render a frame.
+// const int64_t num_draw_calls =
+//     wvu::gl_hooks::GetCallCounters().num_draw_calls();
+
+namespace wvu {
+// The hooked calls since the last reset.
+struct GlCallCounters {
+  GlCallCounters();
+
+  void Reset();
+
+  // Adds the calls of other, e.g., to sum the counters of several frames.
+  void Add(const GlCallCounters& other);
+
+  int64_t num_calls_of(const GlOpcode opcode) const {
+    return num_calls[static_cast<int>(opcode)];
+  }
+
+  // The glDraw* calls.
+  int64_t num_draw_calls() const;
+
+  // The calls that bind buffers, vertex arrays, textures, framebuffers,
+  // renderbuffers and programs.
+  int64_t num_binds() const;
+
+  // Number of calls per opcode. The frame markers are not calls.
+  int64_t num_calls[kNumGlOpcodes];
+  // Bytes copied from client memory into buffers and textures, including
+  // the writes into mapped buffers.
+  int64_t num_bytes_uploaded;
+  // Names generated by glGenBuffers() and glGenTextures().
+  int64_t num_buffers_created;
+  int64_t num_textures_created;
+};
+}  // namespace wvu
+
+#ifdef WVU_ENABLE_GL_HOOKS
+
+namespace wvu {
+constexpr bool kGlHooksEnabled = true;
+
+namespace gl_hooks {
+// Sets the writer that records the hooked calls; null stops the recording.
+// The hooks do not own the writer.
+void SetCommandWriter(GlCommandWriter* writer);
+
+// Returns the counters of the hooked calls since the last reset.
+const GlCallCounters& GetCallCounters();
+void ResetCallCounters();
+
+// Whether the hooks call the driver, true by default. Without the driver,
+// the hooks generate fake object names, return -1 uniform locations and
+// null mappings, so they only count and record the calls.
+void SetForwardToDriver(const bool forward_to_driver);
+
+// Sets the result of every query read while the hooks do not call the
+// driver: whether it is available, and the samples passed. By default, the
+// results are available and one sample passed.
+void SetFakeQueryResult(const bool available, const GLuint samples_passed);
+
+// The hooked entry points. They have the signatures of the OpenGL functions
+// without the gl prefix.
+void BindVertexArray(GLuint array);
+void GenVertexArrays(GLsizei n, GLuint* arrays);
+void DeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void GenBuffers(GLsizei n, GLuint* buffers);
+void DeleteBuffers(GLsizei n, const GLuint* buffers);
+void BindBuffer(GLenum target, GLuint buffer);
+void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                   const void* data);
+void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
+                     GLbitfield access);
+GLboolean UnmapBuffer(GLenum target);
+void VertexAttribPointer(GLuint index, GLint size, GLenum type,
+                         GLboolean normalized, GLsizei stride,
+                         const void* pointer);
+void EnableVertexAttribArray(GLuint index);
+void GenTextures(GLsizei n, GLuint* textures);
+void DeleteTextures(GLsizei n, const GLuint* textures);
+void BindTexture(GLenum target, GLuint texture);
+void ActiveTexture(GLenum texture);
+void TexParameteri(GLenum target, GLenum pname, GLint param);
+void TexImage2D(GLenum target, GLint level, GLint internal_format,
+                GLsizei width, GLsizei height, GLint border, GLenum format,
+                GLenum type, const void* pixels);
+void TexSubImage2D(GLenum target, GLint level, GLint x_offset, GLint y_offset,
+                   GLsizei width, GLsizei height, GLenum format, GLenum type,
+                   const void* pixels);
+void TexBuffer(GLenum target, GLenum internal_format, GLuint buffer);
+void PixelStorei(GLenum pname, GLint param);
+void GenFramebuffers(GLsizei n, GLuint* framebuffers);
+void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+void BindFramebuffer(GLenum target, GLuint framebuffer);
+void FramebufferTexture2D(GLenum target, GLenum attachment,
+                          GLenum texture_target, GLuint texture, GLint level);
+void FramebufferRenderbuffer(GLenum target, GLenum attachment,
+                             GLenum renderbuffer_target, GLuint renderbuffer);
+void BlitFramebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1,
+                     GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1,
+                     GLbitfield mask, GLenum filter);
+void ReadBuffer(GLenum source);
+void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                GLenum type, void* pixels);
+void GenRenderbuffers(GLsizei n, GLuint* renderbuffers);
+void DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers);
+void BindRenderbuffer(GLenum target, GLuint renderbuffer);
+void RenderbufferStorage(GLenum target, GLenum internal_format, GLsizei width,
+                         GLsizei height);
+GLuint CreateShader(GLenum type);
+void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings,
+                  const GLint* lengths);
+void CompileShader(GLuint shader);
+void DeleteShader(GLuint shader);
+GLuint CreateProgram();
+void AttachShader(GLuint program, GLuint shader);
+void LinkProgram(GLuint program);
+void DeleteProgram(GLuint program);
+void UseProgram(GLuint program);
+GLint GetUniformLocation(GLuint program, const GLchar* name);
+GLuint GetUniformBlockIndex(GLuint program, const GLchar* name);
+void UniformBlockBinding(GLuint program, GLuint index, GLuint binding);
+void Uniform1i(GLint location, GLint v0);
+void Uniform1iv(GLint location, GLsizei count, const GLint* values);
+void Uniform1f(GLint location, GLfloat v0);
+void Uniform2f(GLint location, GLfloat v0, GLfloat v1);
+void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+                      const GLfloat* values);
+void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void ViewportIndexedf(GLuint index, GLfloat x, GLfloat y, GLfloat width,
+                      GLfloat height);
+void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+void ScissorIndexed(GLuint index, GLint left, GLint bottom, GLsizei width,
+                    GLsizei height);
+void Enable(GLenum capability);
+void Disable(GLenum capability);
+void PolygonMode(GLenum face, GLenum mode);
+void DepthMask(GLboolean flag);
+void DepthFunc(GLenum function);
+void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void ClearDepth(GLdouble depth);
+void Clear(GLbitfield mask);
+void ClipControl(GLenum origin, GLenum depth);
+void DrawArrays(GLenum mode, GLint first, GLsizei count);
+void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                         GLsizei instance_count);
+void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                           const void* indices, GLsizei instance_count);
+void GenQueries(GLsizei n, GLuint* ids);
+void DeleteQueries(GLsizei n, const GLuint* ids);
+void BeginQuery(GLenum target, GLuint id);
+void EndQuery(GLenum target);
+void QueryCounter(GLuint id, GLenum target);
+void BeginConditionalRender(GLuint id, GLenum mode);
+void EndConditionalRender();
+// The query results and the state are read back, so they are neither
+// recorded nor counted. Without the driver, the query results are the fake
+// ones, GL_POLYGON_MODE is the mode last set through the hooks, and the other
+// state is zero.
+void GetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params);
+void GetIntegerv(GLenum pname, GLint* data);
+// The fences only synchronize the CPU with the GPU, so they are neither
+// recorded nor counted. Without the driver, they are signaled at once.
+GLsync FenceSync(GLenum condition, GLbitfield flags);
+GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void DeleteSync(GLsync sync);
+
+}  // namespace gl_hooks
+}  // namespace wvu
+
+// gl_hooks.cc calls the driver, so it does not redirect the calls.
+#ifndef WVU_GL_HOOKS_IMPLEMENTATION
+#undef glBindVertexArray
+#define glBindVertexArray ::wvu::gl_hooks::BindVertexArray
+#undef glGenVertexArrays
+#define glGenVertexArrays ::wvu::gl_hooks::GenVertexArrays
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays ::wvu::gl_hooks::DeleteVertexArrays
+#undef glGenBuffers
+#define glGenBuffers ::wvu::gl_hooks::GenBuffers
+#undef glDeleteBuffers
+#define glDeleteBuffers ::wvu::gl_hooks::DeleteBuffers
+#undef glBindBuffer
+#define glBindBuffer ::wvu::gl_hooks::BindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase ::wvu::gl_hooks::BindBufferBase
+#undef glBufferData
+#define glBufferData ::wvu::gl_hooks::BufferData
+#undef glBufferSubData
+#define glBufferSubData ::wvu::gl_hooks::BufferSubData
+#undef glMapBufferRange
+#define glMapBufferRange ::wvu::gl_hooks::MapBufferRange
+#undef glUnmapBuffer
+#define glUnmapBuffer ::wvu::gl_hooks::UnmapBuffer
+#undef glVertexAttribPointer
+#define glVertexAttribPointer ::wvu::gl_hooks::VertexAttribPointer
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray ::wvu::gl_hooks::EnableVertexAttribArray
+#undef glGenTextures
+#define glGenTextures ::wvu::gl_hooks::GenTextures
+#undef glDeleteTextures
+#define glDeleteTextures ::wvu::gl_hooks::DeleteTextures
+#undef glBindTexture
+#define glBindTexture ::wvu::gl_hooks::BindTexture
+#undef glActiveTexture
+#define glActiveTexture ::wvu::gl_hooks::ActiveTexture
+#undef glTexParameteri
+#define glTexParameteri ::wvu::gl_hooks::TexParameteri
+#undef glTexImage2D
+#define glTexImage2D ::wvu::gl_hooks::TexImage2D
+#undef glTexSubImage2D
+#define glTexSubImage2D ::wvu::gl_hooks::TexSubImage2D
+#undef glTexBuffer
+#define glTexBuffer ::wvu::gl_hooks::TexBuffer
+#undef glPixelStorei
+#define glPixelStorei ::wvu::gl_hooks::PixelStorei
+#undef glGenFramebuffers
+#define glGenFramebuffers ::wvu::gl_hooks::GenFramebuffers
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers ::wvu::gl_hooks::DeleteFramebuffers
+#undef glBindFramebuffer
+#define glBindFramebuffer ::wvu::gl_hooks::BindFramebuffer
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D ::wvu::gl_hooks::FramebufferTexture2D
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer ::wvu::gl_hooks::FramebufferRenderbuffer
+#undef glBlitFramebuffer
+#define glBlitFramebuffer ::wvu::gl_hooks::BlitFramebuffer
+#undef glReadBuffer
+#define glReadBuffer ::wvu::gl_hooks::ReadBuffer
+#undef glReadPixels
+#define glReadPixels ::wvu::gl_hooks::ReadPixels
+#undef glGenRenderbuffers
+#define glGenRenderbuffers ::wvu::gl_hooks::GenRenderbuffers
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers ::wvu::gl_hooks::DeleteRenderbuffers
+#undef glBindRenderbuffer
+#define glBindRenderbuffer ::wvu::gl_hooks::BindRenderbuffer
+#undef glRenderbufferStorage
+#define glRenderbufferStorage ::wvu::gl_hooks::RenderbufferStorage
+#undef glCreateShader
+#define glCreateShader ::wvu::gl_hooks::CreateShader
+#undef glShaderSource
+#define glShaderSource ::wvu::gl_hooks::ShaderSource
+#undef glCompileShader
+#define glCompileShader ::wvu::gl_hooks::CompileShader
+#undef glDeleteShader
+#define glDeleteShader ::wvu::gl_hooks::DeleteShader
+#undef glCreateProgram
+#define glCreateProgram ::wvu::gl_hooks::CreateProgram
+#undef glAttachShader
+#define glAttachShader ::wvu::gl_hooks::AttachShader
+#undef glLinkProgram
+#define glLinkProgram ::wvu::gl_hooks::LinkProgram
+#undef glDeleteProgram
+#define glDeleteProgram ::wvu::gl_hooks::DeleteProgram
+#undef glUseProgram
+#define glUseProgram ::wvu::gl_hooks::UseProgram
+#undef glGetUniformLocation
+#define glGetUniformLocation ::wvu::gl_hooks::GetUniformLocation
+#undef glGetUniformBlockIndex
+#define glGetUniformBlockIndex ::wvu::gl_hooks::GetUniformBlockIndex
+#undef glUniformBlockBinding
+#define glUniformBlockBinding ::wvu::gl_hooks::UniformBlockBinding
+#undef glUniform1i
+#define glUniform1i ::wvu::gl_hooks::Uniform1i
+#undef glUniform1iv
+#define glUniform1iv ::wvu::gl_hooks::Uniform1iv
+#undef glUniform1f
+#define glUniform1f ::wvu::gl_hooks::Uniform1f
+#undef glUniform2f
+#define glUniform2f ::wvu::gl_hooks::Uniform2f
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv ::wvu::gl_hooks::UniformMatrix4fv
+#undef glViewport
+#define glViewport ::wvu::gl_hooks::Viewport
+#undef glViewportIndexedf
+#define glViewportIndexedf ::wvu::gl_hooks::ViewportIndexedf
+#undef glScissor
+#define glScissor ::wvu::gl_hooks::Scissor
+#undef glScissorIndexed
+#define glScissorIndexed ::wvu::gl_hooks::ScissorIndexed
+#undef glEnable
+#define glEnable ::wvu::gl_hooks::Enable
+#undef glDisable
+#define glDisable ::wvu::gl_hooks::Disable
+#undef glPolygonMode
+#define glPolygonMode ::wvu::gl_hooks::PolygonMode
+#undef glDepthMask
+#define glDepthMask ::wvu::gl_hooks::DepthMask
+#undef glDepthFunc
+#define glDepthFunc ::wvu::gl_hooks::DepthFunc
+#undef glColorMask
+#define glColorMask ::wvu::gl_hooks::ColorMask
+#undef glClearColor
+#define glClearColor ::wvu::gl_hooks::ClearColor
+#undef glClearDepth
+#define glClearDepth ::wvu::gl_hooks::ClearDepth
+#undef glClear
+#define glClear ::wvu::gl_hooks::Clear
+#undef glClipControl
+#define glClipControl ::wvu::gl_hooks::ClipControl
+#undef glDrawArrays
+#define glDrawArrays ::wvu::gl_hooks::DrawArrays
+#undef glDrawElements
+#define glDrawElements ::wvu::gl_hooks::DrawElements
+#undef glDrawArraysInstanced
+#define glDrawArraysInstanced ::wvu::gl_hooks::DrawArraysInstanced
+#undef glDrawElementsInstanced
+#define glDrawElementsInstanced ::wvu::gl_hooks::DrawElementsInstanced
+#undef glGenQueries
+#define glGenQueries ::wvu::gl_hooks::GenQueries
+#undef glDeleteQueries
+#define glDeleteQueries ::wvu::gl_hooks::DeleteQueries
+#undef glBeginQuery
+#define glBeginQuery ::wvu::gl_hooks::BeginQuery
+#undef glEndQuery
+#define glEndQuery ::wvu::gl_hooks::EndQuery
+#undef glQueryCounter
+#define glQueryCounter ::wvu::gl_hooks::QueryCounter
+#undef glBeginConditionalRender
+#define glBeginConditionalRender ::wvu::gl_hooks::BeginConditionalRender
+#undef glEndConditionalRender
+#define glEndConditionalRender ::wvu::gl_hooks::EndConditionalRender
+#undef glGetQueryObjectuiv
+#define glGetQueryObjectuiv ::wvu::gl_hooks::GetQueryObjectuiv
+#undef glGetIntegerv
+#define glGetIntegerv ::wvu::gl_hooks::GetIntegerv
+#undef glFenceSync
+#define glFenceSync ::wvu::gl_hooks::FenceSync
+#undef glClientWaitSync
+#define glClientWaitSync ::wvu::gl_hooks::ClientWaitSync
+#undef glDeleteSync
+#define glDeleteSync ::wvu::gl_hooks::DeleteSync
+#endif  // WVU_GL_HOOKS_IMPLEMENTATION
+
+#else  // WVU_ENABLE_GL_HOOKS
+
+namespace wvu {
+constexpr bool kGlHooksEnabled = false;
+
+namespace gl_hooks {
+// Without the hooks, the calls are neither recorded nor counted.
+inline void SetCommandWriter(GlCommandWriter* writer) {}
+
+inline const GlCallCounters& GetCallCounters() {
+  static const GlCallCounters call_counters;
+  return call_counters;
+}
+
+inline void ResetCallCounters() {}
+
+inline void SetForwardToDriver(const bool forward_to_driver) {}
+
+inline void SetFakeQueryResult(const bool available,
+                               const GLuint samples_passed) {}
+}  // namespace gl_hooks
+}  // namespace wvu
+
+#endif  // WVU_ENABLE_GL_HOOKS
+
+#endif  // GL_HOOKS_H_
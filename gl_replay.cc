@@ -0,0 +1,782 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Replays a capture of the OpenGL commands of draw_scene (see
+// --gl_capture_path) in a hidden window as fast as possible, and reports the
+// time per frame. The replay does not run the application code, i.e., the
+// culling, the animation or the input, so it measures the driver and the GPU
+// alone and with the same commands every run.
+//
+// Usage: gl_replay --capture=scene.glcap --loops=10
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <gflags/gflags.h>
+
+#include "gl_command_stream.h"
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define CS470_GFLAGS_NAMESPACE google
+#else
+#define CS470_GFLAGS_NAMESPACE gflags
+#endif
+
+DEFINE_string(capture, "", "The capture file to replay.");
+DEFINE_int32(loops, 10,
+             "Number of times the frames are replayed after the first pass, "
+             "which also runs the setup of the capture.");
+DEFINE_bool(finish_every_frame, false,
+            "Waits for the GPU at the end of every frame, so that the frames "
+            "do not overlap.");
+
+namespace {
+using wvu::GlArgumentReader;
+using wvu::GlCommand;
+using wvu::GlCommandReader;
+using wvu::GlOpcode;
+
+// Maps the object names of the capture to the names created by the replay.
+class ObjectMap {
+ public:
+  // Returns the replay name of a recorded name. Zero maps to zero.
+  GLuint Find(const GLuint recorded) const {
+    const auto it = names_.find(recorded);
+    return it != names_.end() ? it->second : 0;
+  }
+
+  bool Contains(const GLuint recorded) const {
+    return names_.count(recorded) > 0;
+  }
+
+  void Insert(const GLuint recorded, const GLuint replayed) {
+    names_[recorded] = replayed;
+  }
+
+  void Erase(const GLuint recorded) {
+    names_.erase(recorded);
+  }
+
+ private:
+  std::unordered_map<GLuint, GLuint> names_;
+};
+
+// Key of the per-program maps: the recorded program and a recorded location
+// or block index.
+inline uint64_t ProgramKey(const GLuint program, const uint32_t value) {
+  return (static_cast<uint64_t>(program) << 32) | value;
+}
+
+struct ReplayState {
+  ObjectMap buffers;
+  ObjectMap vertex_arrays;
+  ObjectMap textures;
+  ObjectMap framebuffers;
+  ObjectMap renderbuffers;
+  ObjectMap shaders;
+  ObjectMap programs;
+  ObjectMap queries;
+  std::unordered_map<uint64_t, GLint> uniform_locations;
+  std::unordered_map<uint64_t, GLuint> uniform_block_indices;
+  // The recorded program in use, which the uniform locations belong to.
+  GLuint current_program = 0;
+  // Destination of the pixels read into client memory.
+  std::vector<uint8_t> read_pixels;
+  // Commands that the context does not support.
+  int num_skipped_commands = 0;
+};
+
+// Creates the replay objects of the recorded names that are not mapped yet.
+// The frames may be replayed many times, so a name is only created once.
+void GenObjects(GlArgumentReader* reader,
+                void (*gen)(GLsizei, GLuint*),
+                ObjectMap* objects) {
+  uint32_t size;
+  const uint8_t* data = reader->ReadBytes(&size);
+  for (uint32_t i = 0; i + sizeof(GLuint) <= size; i += sizeof(GLuint)) {
+    GLuint recorded;
+    std::memcpy(&recorded, data + i, sizeof(recorded));
+    if (objects->Contains(recorded)) continue;
+    GLuint replayed = 0;
+    gen(1, &replayed);
+    objects->Insert(recorded, replayed);
+  }
+}
+
+void DeleteObjects(GlArgumentReader* reader,
+                   void (*destroy)(GLsizei, const GLuint*),
+                   ObjectMap* objects) {
+  uint32_t size;
+  const uint8_t* data = reader->ReadBytes(&size);
+  std::vector<GLuint> names;
+  for (uint32_t i = 0; i + sizeof(GLuint) <= size; i += sizeof(GLuint)) {
+    GLuint recorded;
+    std::memcpy(&recorded, data + i, sizeof(recorded));
+    if (!objects->Contains(recorded)) continue;
+    names.push_back(objects->Find(recorded));
+    objects->Erase(recorded);
+  }
+  if (!names.empty()) destroy(names.size(), names.data());
+}
+
+// Returns the pixels of a recorded texture image: an offset into the unpack
+// buffer, the recorded bytes, or null.
+const void* ReadTexturePixels(GlArgumentReader* reader) {
+  const uint32_t kind = reader->ReadUint32();
+  if (kind == 1) {
+    return reinterpret_cast<const void*>(
+        static_cast<intptr_t>(reader->ReadInt64()));
+  }
+  if (kind == 2) {
+    uint32_t size;
+    return reader->ReadBytes(&size);
+  }
+  return nullptr;
+}
+
+// Issues the OpenGL call of a command. The GLEW function pointers are plain
+// functions, so the generation and deletion functions are wrapped in lambdas.
+void ReplayCommand(const GlCommand& command, ReplayState* state) {
+  GlArgumentReader reader(command);
+  switch (command.opcode) {
+    case GlOpcode::BEGIN_FRAME:
+    case GlOpcode::END_FRAME:
+    case GlOpcode::NUM_OPCODES:
+      break;
+    case GlOpcode::GEN_BUFFERS:
+      GenObjects(&reader, [](GLsizei n, GLuint* names) {
+        glGenBuffers(n, names);
+      }, &state->buffers);
+      break;
+    case GlOpcode::DELETE_BUFFERS:
+      DeleteObjects(&reader, [](GLsizei n, const GLuint* names) {
+        glDeleteBuffers(n, names);
+      }, &state->buffers);
+      break;
+    case GlOpcode::BIND_BUFFER: {
+      const GLenum target = reader.ReadUint32();
+      glBindBuffer(target, state->buffers.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::BIND_BUFFER_BASE: {
+      const GLenum target = reader.ReadUint32();
+      const GLuint index = reader.ReadUint32();
+      glBindBufferBase(target, index,
+                       state->buffers.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::BUFFER_DATA: {
+      const GLenum target = reader.ReadUint32();
+      const GLsizeiptr size = reader.ReadInt64();
+      const GLenum usage = reader.ReadUint32();
+      uint32_t data_size;
+      const uint8_t* data = reader.ReadBytes(&data_size);
+      glBufferData(target, size, data_size > 0 ? data : nullptr, usage);
+      break;
+    }
+    case GlOpcode::BUFFER_SUB_DATA: {
+      const GLenum target = reader.ReadUint32();
+      const GLintptr offset = reader.ReadInt64();
+      uint32_t size;
+      const uint8_t* data = reader.ReadBytes(&size);
+      glBufferSubData(target, offset, size, data);
+      break;
+    }
+    case GlOpcode::GEN_VERTEX_ARRAYS:
+      GenObjects(&reader, [](GLsizei n, GLuint* names) {
+        glGenVertexArrays(n, names);
+      }, &state->vertex_arrays);
+      break;
+    case GlOpcode::DELETE_VERTEX_ARRAYS:
+      DeleteObjects(&reader, [](GLsizei n, const GLuint* names) {
+        glDeleteVertexArrays(n, names);
+      }, &state->vertex_arrays);
+      break;
+    case GlOpcode::BIND_VERTEX_ARRAY:
+      glBindVertexArray(state->vertex_arrays.Find(reader.ReadUint32()));
+      break;
+    case GlOpcode::VERTEX_ATTRIB_POINTER: {
+      const GLuint index = reader.ReadUint32();
+      const GLint size = reader.ReadInt32();
+      const GLenum type = reader.ReadUint32();
+      const GLboolean normalized = reader.ReadUint32();
+      const GLsizei stride = reader.ReadInt32();
+      const intptr_t offset = reader.ReadInt64();
+      glVertexAttribPointer(index, size, type, normalized, stride,
+                            reinterpret_cast<const void*>(offset));
+      break;
+    }
+    case GlOpcode::ENABLE_VERTEX_ATTRIB_ARRAY:
+      glEnableVertexAttribArray(reader.ReadUint32());
+      break;
+    case GlOpcode::GEN_TEXTURES:
+      GenObjects(&reader, [](GLsizei n, GLuint* names) {
+        glGenTextures(n, names);
+      }, &state->textures);
+      break;
+    case GlOpcode::DELETE_TEXTURES:
+      DeleteObjects(&reader, [](GLsizei n, const GLuint* names) {
+        glDeleteTextures(n, names);
+      }, &state->textures);
+      break;
+    case GlOpcode::BIND_TEXTURE: {
+      const GLenum target = reader.ReadUint32();
+      glBindTexture(target, state->textures.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::ACTIVE_TEXTURE:
+      glActiveTexture(reader.ReadUint32());
+      break;
+    case GlOpcode::TEX_PARAMETER_I: {
+      const GLenum target = reader.ReadUint32();
+      const GLenum pname = reader.ReadUint32();
+      glTexParameteri(target, pname, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::TEX_IMAGE_2D: {
+      const GLenum target = reader.ReadUint32();
+      const GLint level = reader.ReadInt32();
+      const GLint internal_format = reader.ReadInt32();
+      const GLint border = reader.ReadInt32();
+      const GLsizei width = reader.ReadInt32();
+      const GLsizei height = reader.ReadInt32();
+      const GLenum format = reader.ReadUint32();
+      const GLenum type = reader.ReadUint32();
+      glTexImage2D(target, level, internal_format, width, height, border,
+                   format, type, ReadTexturePixels(&reader));
+      break;
+    }
+    case GlOpcode::TEX_SUB_IMAGE_2D: {
+      const GLenum target = reader.ReadUint32();
+      const GLint level = reader.ReadInt32();
+      const GLint x_offset = reader.ReadInt32();
+      const GLint y_offset = reader.ReadInt32();
+      const GLsizei width = reader.ReadInt32();
+      const GLsizei height = reader.ReadInt32();
+      const GLenum format = reader.ReadUint32();
+      const GLenum type = reader.ReadUint32();
+      glTexSubImage2D(target, level, x_offset, y_offset, width, height,
+                      format, type, ReadTexturePixels(&reader));
+      break;
+    }
+    case GlOpcode::TEX_BUFFER: {
+      const GLenum target = reader.ReadUint32();
+      const GLenum internal_format = reader.ReadUint32();
+      glTexBuffer(target, internal_format,
+                  state->buffers.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::PIXEL_STORE_I: {
+      const GLenum pname = reader.ReadUint32();
+      glPixelStorei(pname, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::GEN_FRAMEBUFFERS:
+      GenObjects(&reader, [](GLsizei n, GLuint* names) {
+        glGenFramebuffers(n, names);
+      }, &state->framebuffers);
+      break;
+    case GlOpcode::DELETE_FRAMEBUFFERS:
+      DeleteObjects(&reader, [](GLsizei n, const GLuint* names) {
+        glDeleteFramebuffers(n, names);
+      }, &state->framebuffers);
+      break;
+    case GlOpcode::BIND_FRAMEBUFFER: {
+      const GLenum target = reader.ReadUint32();
+      glBindFramebuffer(target,
+                        state->framebuffers.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::FRAMEBUFFER_TEXTURE_2D: {
+      const GLenum target = reader.ReadUint32();
+      const GLenum attachment = reader.ReadUint32();
+      const GLenum texture_target = reader.ReadUint32();
+      const GLuint texture = state->textures.Find(reader.ReadUint32());
+      glFramebufferTexture2D(target, attachment, texture_target, texture,
+                             reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::FRAMEBUFFER_RENDERBUFFER: {
+      const GLenum target = reader.ReadUint32();
+      const GLenum attachment = reader.ReadUint32();
+      const GLenum renderbuffer_target = reader.ReadUint32();
+      glFramebufferRenderbuffer(
+          target, attachment, renderbuffer_target,
+          state->renderbuffers.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::BLIT_FRAMEBUFFER: {
+      GLint coordinates[8];
+      for (int i = 0; i < 8; ++i) {
+        coordinates[i] = reader.ReadInt32();
+      }
+      const GLbitfield mask = reader.ReadUint32();
+      glBlitFramebuffer(coordinates[0], coordinates[1], coordinates[2],
+                        coordinates[3], coordinates[4], coordinates[5],
+                        coordinates[6], coordinates[7], mask,
+                        reader.ReadUint32());
+      break;
+    }
+    case GlOpcode::READ_BUFFER:
+      glReadBuffer(reader.ReadUint32());
+      break;
+    case GlOpcode::READ_PIXELS: {
+      const GLint x = reader.ReadInt32();
+      const GLint y = reader.ReadInt32();
+      const GLsizei width = reader.ReadInt32();
+      const GLsizei height = reader.ReadInt32();
+      const GLenum format = reader.ReadUint32();
+      const GLenum type = reader.ReadUint32();
+      const uint32_t kind = reader.ReadUint32();
+      const int64_t offset_or_size = reader.ReadInt64();
+      void* pixels = reinterpret_cast<void*>(
+          static_cast<intptr_t>(offset_or_size));
+      // Client memory: read into a scratch buffer of the recorded size.
+      if (kind == 2) {
+        state->read_pixels.resize(offset_or_size);
+        pixels = state->read_pixels.data();
+      }
+      glReadPixels(x, y, width, height, format, type, pixels);
+      break;
+    }
+    case GlOpcode::GEN_RENDERBUFFERS:
+      GenObjects(&reader, [](GLsizei n, GLuint* names) {
+        glGenRenderbuffers(n, names);
+      }, &state->renderbuffers);
+      break;
+    case GlOpcode::DELETE_RENDERBUFFERS:
+      DeleteObjects(&reader, [](GLsizei n, const GLuint* names) {
+        glDeleteRenderbuffers(n, names);
+      }, &state->renderbuffers);
+      break;
+    case GlOpcode::BIND_RENDERBUFFER: {
+      const GLenum target = reader.ReadUint32();
+      glBindRenderbuffer(target,
+                         state->renderbuffers.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::RENDERBUFFER_STORAGE: {
+      const GLenum target = reader.ReadUint32();
+      const GLenum internal_format = reader.ReadUint32();
+      const GLsizei width = reader.ReadInt32();
+      glRenderbufferStorage(target, internal_format, width,
+                            reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::CREATE_SHADER: {
+      const GLenum type = reader.ReadUint32();
+      const GLuint recorded = reader.ReadUint32();
+      if (!state->shaders.Contains(recorded)) {
+        state->shaders.Insert(recorded, glCreateShader(type));
+      }
+      break;
+    }
+    case GlOpcode::SHADER_SOURCE: {
+      const GLuint shader = state->shaders.Find(reader.ReadUint32());
+      uint32_t size;
+      const GLchar* source =
+          reinterpret_cast<const GLchar*>(reader.ReadBytes(&size));
+      const GLint length = size;
+      glShaderSource(shader, 1, &source, &length);
+      break;
+    }
+    case GlOpcode::COMPILE_SHADER:
+      glCompileShader(state->shaders.Find(reader.ReadUint32()));
+      break;
+    case GlOpcode::DELETE_SHADER: {
+      const GLuint recorded = reader.ReadUint32();
+      glDeleteShader(state->shaders.Find(recorded));
+      state->shaders.Erase(recorded);
+      break;
+    }
+    case GlOpcode::CREATE_PROGRAM: {
+      const GLuint recorded = reader.ReadUint32();
+      if (!state->programs.Contains(recorded)) {
+        state->programs.Insert(recorded, glCreateProgram());
+      }
+      break;
+    }
+    case GlOpcode::ATTACH_SHADER: {
+      const GLuint program = state->programs.Find(reader.ReadUint32());
+      glAttachShader(program, state->shaders.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::LINK_PROGRAM:
+      glLinkProgram(state->programs.Find(reader.ReadUint32()));
+      break;
+    case GlOpcode::DELETE_PROGRAM: {
+      const GLuint recorded = reader.ReadUint32();
+      glDeleteProgram(state->programs.Find(recorded));
+      state->programs.Erase(recorded);
+      break;
+    }
+    case GlOpcode::USE_PROGRAM:
+      state->current_program = reader.ReadUint32();
+      glUseProgram(state->programs.Find(state->current_program));
+      break;
+    case GlOpcode::GET_UNIFORM_LOCATION: {
+      const GLuint recorded_program = reader.ReadUint32();
+      uint32_t size;
+      const uint8_t* name = reader.ReadBytes(&size);
+      const GLint recorded_location = reader.ReadInt32();
+      const std::string name_string(reinterpret_cast<const char*>(name),
+                                    size);
+      state->uniform_locations[ProgramKey(recorded_program,
+                                          recorded_location)] =
+          glGetUniformLocation(state->programs.Find(recorded_program),
+                               name_string.c_str());
+      break;
+    }
+    case GlOpcode::GET_UNIFORM_BLOCK_INDEX: {
+      const GLuint recorded_program = reader.ReadUint32();
+      uint32_t size;
+      const uint8_t* name = reader.ReadBytes(&size);
+      const GLuint recorded_index = reader.ReadUint32();
+      const std::string name_string(reinterpret_cast<const char*>(name),
+                                    size);
+      state->uniform_block_indices[ProgramKey(recorded_program,
+                                              recorded_index)] =
+          glGetUniformBlockIndex(state->programs.Find(recorded_program),
+                                 name_string.c_str());
+      break;
+    }
+    case GlOpcode::UNIFORM_BLOCK_BINDING: {
+      const GLuint recorded_program = reader.ReadUint32();
+      const GLuint recorded_index = reader.ReadUint32();
+      const GLuint binding = reader.ReadUint32();
+      const auto it = state->uniform_block_indices.find(
+          ProgramKey(recorded_program, recorded_index));
+      if (it != state->uniform_block_indices.end()) {
+        glUniformBlockBinding(state->programs.Find(recorded_program),
+                              it->second, binding);
+      }
+      break;
+    }
+    case GlOpcode::UNIFORM_1I:
+    case GlOpcode::UNIFORM_1IV:
+    case GlOpcode::UNIFORM_1F:
+    case GlOpcode::UNIFORM_2F:
+    case GlOpcode::UNIFORM_MATRIX_4FV: {
+      // The locations belong to the program in use; -1 is ignored by GL.
+      const GLint recorded_location = reader.ReadInt32();
+      const auto it = state->uniform_locations.find(
+          ProgramKey(state->current_program, recorded_location));
+      const GLint location =
+          it != state->uniform_locations.end() ? it->second : -1;
+      if (command.opcode == GlOpcode::UNIFORM_1I) {
+        glUniform1i(location, reader.ReadInt32());
+      } else if (command.opcode == GlOpcode::UNIFORM_1IV) {
+        const GLsizei count = reader.ReadInt32();
+        uint32_t size;
+        const GLint* values =
+            reinterpret_cast<const GLint*>(reader.ReadBytes(&size));
+        glUniform1iv(location, count, values);
+      } else if (command.opcode == GlOpcode::UNIFORM_1F) {
+        glUniform1f(location, reader.ReadFloat());
+      } else if (command.opcode == GlOpcode::UNIFORM_2F) {
+        const GLfloat v0 = reader.ReadFloat();
+        glUniform2f(location, v0, reader.ReadFloat());
+      } else {
+        const GLsizei count = reader.ReadInt32();
+        const GLboolean transpose = reader.ReadUint32();
+        uint32_t size;
+        const GLfloat* values =
+            reinterpret_cast<const GLfloat*>(reader.ReadBytes(&size));
+        glUniformMatrix4fv(location, count, transpose, values);
+      }
+      break;
+    }
+    case GlOpcode::VIEWPORT: {
+      const GLint x = reader.ReadInt32();
+      const GLint y = reader.ReadInt32();
+      const GLsizei width = reader.ReadInt32();
+      glViewport(x, y, width, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::VIEWPORT_INDEXED_F: {
+      if (!GLEW_ARB_viewport_array) {
+        ++state->num_skipped_commands;
+        break;
+      }
+      const GLuint index = reader.ReadUint32();
+      const GLfloat x = reader.ReadFloat();
+      const GLfloat y = reader.ReadFloat();
+      const GLfloat width = reader.ReadFloat();
+      glViewportIndexedf(index, x, y, width, reader.ReadFloat());
+      break;
+    }
+    case GlOpcode::SCISSOR: {
+      const GLint x = reader.ReadInt32();
+      const GLint y = reader.ReadInt32();
+      const GLsizei width = reader.ReadInt32();
+      glScissor(x, y, width, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::SCISSOR_INDEXED: {
+      if (!GLEW_ARB_viewport_array) {
+        ++state->num_skipped_commands;
+        break;
+      }
+      const GLuint index = reader.ReadUint32();
+      const GLint left = reader.ReadInt32();
+      const GLint bottom = reader.ReadInt32();
+      const GLsizei width = reader.ReadInt32();
+      glScissorIndexed(index, left, bottom, width, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::ENABLE:
+      glEnable(reader.ReadUint32());
+      break;
+    case GlOpcode::DISABLE:
+      glDisable(reader.ReadUint32());
+      break;
+    case GlOpcode::POLYGON_MODE: {
+      const GLenum face = reader.ReadUint32();
+      glPolygonMode(face, reader.ReadUint32());
+      break;
+    }
+    case GlOpcode::DEPTH_MASK:
+      glDepthMask(reader.ReadUint32());
+      break;
+    case GlOpcode::DEPTH_FUNC:
+      glDepthFunc(reader.ReadUint32());
+      break;
+    case GlOpcode::COLOR_MASK: {
+      GLboolean mask[4];
+      for (int i = 0; i < 4; ++i) {
+        mask[i] = reader.ReadUint32();
+      }
+      glColorMask(mask[0], mask[1], mask[2], mask[3]);
+      break;
+    }
+    case GlOpcode::CLEAR_COLOR: {
+      GLfloat color[4];
+      for (int i = 0; i < 4; ++i) {
+        color[i] = reader.ReadFloat();
+      }
+      glClearColor(color[0], color[1], color[2], color[3]);
+      break;
+    }
+    case GlOpcode::CLEAR_DEPTH:
+      glClearDepth(reader.ReadDouble());
+      break;
+    case GlOpcode::CLEAR:
+      glClear(reader.ReadUint32());
+      break;
+    case GlOpcode::CLIP_CONTROL: {
+      if (!GLEW_ARB_clip_control) {
+        ++state->num_skipped_commands;
+        break;
+      }
+      const GLenum origin = reader.ReadUint32();
+      glClipControl(origin, reader.ReadUint32());
+      break;
+    }
+    case GlOpcode::DRAW_ARRAYS: {
+      const GLenum mode = reader.ReadUint32();
+      const GLint first = reader.ReadInt32();
+      glDrawArrays(mode, first, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::DRAW_ELEMENTS: {
+      const GLenum mode = reader.ReadUint32();
+      const GLsizei count = reader.ReadInt32();
+      const GLenum type = reader.ReadUint32();
+      const intptr_t offset = reader.ReadInt64();
+      glDrawElements(mode, count, type,
+                     reinterpret_cast<const void*>(offset));
+      break;
+    }
+    case GlOpcode::DRAW_ARRAYS_INSTANCED: {
+      const GLenum mode = reader.ReadUint32();
+      const GLint first = reader.ReadInt32();
+      const GLsizei count = reader.ReadInt32();
+      glDrawArraysInstanced(mode, first, count, reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::DRAW_ELEMENTS_INSTANCED: {
+      const GLenum mode = reader.ReadUint32();
+      const GLsizei count = reader.ReadInt32();
+      const GLenum type = reader.ReadUint32();
+      const intptr_t offset = reader.ReadInt64();
+      glDrawElementsInstanced(mode, count, type,
+                              reinterpret_cast<const void*>(offset),
+                              reader.ReadInt32());
+      break;
+    }
+    case GlOpcode::GEN_QUERIES:
+      GenObjects(&reader, [](GLsizei n, GLuint* names) {
+        glGenQueries(n, names);
+      }, &state->queries);
+      break;
+    case GlOpcode::DELETE_QUERIES:
+      DeleteObjects(&reader, [](GLsizei n, const GLuint* names) {
+        glDeleteQueries(n, names);
+      }, &state->queries);
+      break;
+    case GlOpcode::BEGIN_QUERY: {
+      const GLenum target = reader.ReadUint32();
+      glBeginQuery(target, state->queries.Find(reader.ReadUint32()));
+      break;
+    }
+    case GlOpcode::END_QUERY:
+      glEndQuery(reader.ReadUint32());
+      break;
+    case GlOpcode::QUERY_COUNTER: {
+      const GLuint query = state->queries.Find(reader.ReadUint32());
+      glQueryCounter(query, reader.ReadUint32());
+      break;
+    }
+    case GlOpcode::BEGIN_CONDITIONAL_RENDER: {
+      const GLuint query = state->queries.Find(reader.ReadUint32());
+      glBeginConditionalRender(query, reader.ReadUint32());
+      break;
+    }
+    case GlOpcode::END_CONDITIONAL_RENDER:
+      glEndConditionalRender();
+      break;
+  }
+}
+
+// Replays the commands of a frame and presents it.
+void ReplayFrame(const GlCommandReader& reader,
+                 const std::pair<int, int>& frame,
+                 GLFWwindow* window,
+                 ReplayState* state) {
+  const std::vector<GlCommand>& commands = reader.commands();
+  for (int i = frame.first; i < frame.second; ++i) {
+    ReplayCommand(commands[i], state);
+  }
+  if (FLAGS_finish_every_frame) {
+    glFinish();
+  }
+  glfwSwapBuffers(window);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  CS470_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+
+  wvu::GlCommandReader reader;
+  std::string error_info_log;
+  if (!reader.Load(FLAGS_capture, &error_info_log)) {
+    std::cerr << "ERROR: " << error_info_log << "\n";
+    return -1;
+  }
+  if (reader.frames().empty()) {
+    std::cerr << "ERROR: The capture has no frames.\n";
+    return -1;
+  }
+
+  // A hidden window of the size of the capture, with the context that
+  // draw_scene creates.
+  if (!glfwInit()) {
+    return -1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  GLFWwindow* window = glfwCreateWindow(reader.width(), reader.height(),
+                                        "gl_replay", nullptr, nullptr);
+  if (!window) {
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+  // As fast as possible: no vsync.
+  glfwSwapInterval(0);
+  glewExperimental = GL_TRUE;
+  if (glewInit() != GLEW_OK) {
+    std::cerr << "Glew did not initialize properly!" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+
+  // The first pass runs the setup and the frames in the recorded order.
+  ReplayState state;
+  const std::vector<std::pair<int, int> >& frames = reader.frames();
+  const std::vector<GlCommand>& commands = reader.commands();
+  int next_command = 0;
+  for (const std::pair<int, int>& frame : frames) {
+    for (; next_command < frame.first; ++next_command) {
+      ReplayCommand(commands[next_command], &state);
+    }
+    ReplayFrame(reader, frame, window, &state);
+    next_command = frame.second;
+  }
+  glFinish();
+
+  // The timed passes replay the frames alone.
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (int loop = 0; loop < FLAGS_loops; ++loop) {
+    for (const std::pair<int, int>& frame : frames) {
+      ReplayFrame(reader, frame, window, &state);
+    }
+  }
+  glFinish();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::high_resolution_clock::now() - start;
+
+  const int num_frames = FLAGS_loops * frames.size();
+  std::cout << "Replayed " << commands.size() << " commands, "
+            << frames.size() << " frames of " << reader.width() << "x"
+            << reader.height() << ".\n";
+  if (state.num_skipped_commands > 0) {
+    std::cout << "Skipped " << state.num_skipped_commands
+              << " commands unsupported by the context.\n";
+  }
+  if (num_frames > 0) {
+    const double seconds_per_frame = elapsed.count() / num_frames;
+    std::cout << "Frames: " << num_frames << " in " << elapsed.count()
+              << " s: " << 1e3 * seconds_per_frame << " ms/frame, "
+              << 1.0 / seconds_per_frame << " fps.\n";
+  }
+
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,180 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "gl_resource_registry.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+namespace wvu {
+namespace {
+
+const char* const kObjectTypeNames[] = {
+  "buffer",
+  "vertex array",
+  "texture",
+  "renderbuffer",
+  "framebuffer",
+  "program"
+};
+
+}  // namespace
+
+const char* GlObjectTypeName(const GlObjectType type) {
+  const int index = static_cast<int>(type);
+  return (index >= 0 && index < static_cast<int>(GlObjectType::NUM_TYPES)) ?
+      kObjectTypeNames[index] : "unknown";
+}
+
+GlResourceRegistry::GlResourceRegistry() : live_bytes_(0), peak_bytes_(0) {}
+
+GlResourceRegistry* GlResourceRegistry::Instance() {
+  // Never destroyed, so that the owners destroyed at exit can unregister.
+  static GlResourceRegistry* const registry = new GlResourceRegistry;
+  return registry;
+}
+
+void GlResourceRegistry::Register(const GlObjectType type,
+                                  const GLuint name,
+                                  const std::string& owner_tag,
+                                  const std::string& creation_site) {
+  if (name == 0) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  GlResource& resource = resources_[Key(type, name)];
+  live_bytes_ -= resource.num_bytes;
+  resource.type = type;
+  resource.name = name;
+  resource.owner_tag = owner_tag;
+  resource.creation_site = creation_site;
+  resource.num_bytes = 0;
+}
+
+void GlResourceRegistry::SetSize(const GlObjectType type,
+                                 const GLuint name,
+                                 const int64_t num_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = resources_.find(Key(type, name));
+  if (it == resources_.end()) return;
+  live_bytes_ += num_bytes - it->second.num_bytes;
+  it->second.num_bytes = num_bytes;
+  peak_bytes_ = std::max(peak_bytes_, live_bytes_);
+}
+
+void GlResourceRegistry::Unregister(const GlObjectType type,
+                                    const GLuint name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = resources_.find(Key(type, name));
+  if (it == resources_.end()) return;
+  live_bytes_ -= it->second.num_bytes;
+  resources_.erase(it);
+}
+
+int GlResourceRegistry::num_live_objects() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return resources_.size();
+}
+
+int64_t GlResourceRegistry::live_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return live_bytes_;
+}
+
+int64_t GlResourceRegistry::peak_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_bytes_;
+}
+
+std::vector<GlResourceUsage> GlResourceRegistry::UsageByOwner() const {
+  std::unordered_map<std::string, GlResourceUsage> usage_by_owner;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : resources_) {
+      const GlResource& resource = entry.second;
+      GlResourceUsage& usage = usage_by_owner[resource.owner_tag];
+      usage.owner_tag = resource.owner_tag;
+      ++usage.num_objects;
+      usage.num_bytes += resource.num_bytes;
+    }
+  }
+  std::vector<GlResourceUsage> usages;
+  usages.reserve(usage_by_owner.size());
+  for (const auto& entry : usage_by_owner) {
+    usages.push_back(entry.second);
+  }
+  std::sort(usages.begin(), usages.end(),
+            [](const GlResourceUsage& a, const GlResourceUsage& b) {
+              return a.num_bytes != b.num_bytes ? a.num_bytes > b.num_bytes :
+                  a.owner_tag < b.owner_tag;
+            });
+  return usages;
+}
+
+std::vector<GlResource> GlResourceRegistry::LiveResources() const {
+  std::vector<GlResource> live_resources;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_resources.reserve(resources_.size());
+    for (const auto& entry : resources_) {
+      live_resources.push_back(entry.second);
+    }
+  }
+  std::sort(live_resources.begin(), live_resources.end(),
+            [](const GlResource& a, const GlResource& b) {
+              if (a.owner_tag != b.owner_tag) return a.owner_tag < b.owner_tag;
+              if (a.creation_site != b.creation_site) {
+                return a.creation_site < b.creation_site;
+              }
+              return a.name < b.name;
+            });
+  return live_resources;
+}
+
+int GlResourceRegistry::ReportLeaks(std::ostream* out) const {
+  const std::vector<GlResource> leaks = LiveResources();
+  for (const GlResource& leak : leaks) {
+    *out << "  Leaked " << GlObjectTypeName(leak.type) << " " << leak.name
+         << " (" << leak.num_bytes << " bytes) of " << leak.owner_tag
+         << ", created at " << leak.creation_site << "\n";
+  }
+  return leaks.size();
+}
+
+}  // namespace wvu
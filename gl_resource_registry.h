@@ -0,0 +1,164 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GL_RESOURCE_REGISTRY_H_
+#define GL_RESOURCE_REGISTRY_H_
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+
+// Expands to "file:line" of the place where it is used, e.g., to register
+// the creation site of an object.
+#define WVU_GL_STRINGIFY_LINE(line) #line
+#define WVU_GL_LINE_STRING(line) WVU_GL_STRINGIFY_LINE(line)
+#define WVU_GL_CREATION_SITE __FILE__ ":" WVU_GL_LINE_STRING(__LINE__)
+
+namespace wvu {
+enum class GlObjectType {
+  BUFFER,
+  VERTEX_ARRAY,
+  TEXTURE,
+  RENDERBUFFER,
+  FRAMEBUFFER,
+  PROGRAM,
+  NUM_TYPES
+};
+
+// Returns the name of the type, e.g., "buffer".
+const char* GlObjectTypeName(const GlObjectType type);
+
+// An OpenGL object in the registry.
+struct GlResource {
+  GlObjectType type;
+  GLuint name;
+  // The category of the owner, e.g., "model" or "render_target".
+  std::string owner_tag;
+  // The file and line that created the object.
+  std::string creation_site;
+  // The GPU memory of the storage of the object, estimated from its size
+  // and format. Zero for the objects without storage.
+  int64_t num_bytes;
+};
+
+// The live objects of an owner category.
+struct GlResourceUsage {
+  std::string owner_tag;
+  int num_objects = 0;
+  int64_t num_bytes = 0;
+};
+
+// Keeps track of the live OpenGL objects: who created them, where, and how
+// much GPU memory they hold. The owners register their objects after
+// creating them and unregister them before deleting them, so the objects
+// left at shutdown are leaks. The registry only does the bookkeeping; it
+// does not call OpenGL.
+//
+// Example:
+//
+// glGenBuffers(1, &buffer_id_);
+// wvu::GlResourceRegistry* registry = wvu::GlResourceRegistry::Instance();
+// registry->Register(wvu::GlObjectType::BUFFER, buffer_id_, "model",
+//                    WVU_GL_CREATION_SITE);
+// glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+// registry->SetSize(wvu::GlObjectType::BUFFER, buffer_id_, size);
+// ...
+// registry->Unregister(wvu::GlObjectType::BUFFER, buffer_id_);
+// glDeleteBuffers(1, &buffer_id_);
+class GlResourceRegistry {
+ public:
+  GlResourceRegistry();
+
+  // Returns the registry of the process, which the renderer uses.
+  static GlResourceRegistry* Instance();
+
+  // Adds an object. Name zero is ignored, and registering a live object
+  // again replaces it.
+  // Params:
+  //   type  The type of the object.
+  //   name  The OpenGL name of the object.
+  //   owner_tag  The category of the owner.
+  //   creation_site  Where the object was created; see WVU_GL_CREATION_SITE.
+  void Register(const GlObjectType type,
+                const GLuint name,
+                const std::string& owner_tag,
+                const std::string& creation_site);
+
+  // Sets the GPU memory of a registered object, e.g., after allocating its
+  // storage.
+  void SetSize(const GlObjectType type,
+               const GLuint name,
+               const int64_t num_bytes);
+
+  // Removes an object. Unknown objects are ignored.
+  void Unregister(const GlObjectType type, const GLuint name);
+
+  int num_live_objects() const;
+
+  // Returns the GPU memory of the live objects.
+  int64_t live_bytes() const;
+
+  // Returns the largest live_bytes() so far.
+  int64_t peak_bytes() const;
+
+  // Returns the live objects and memory of every owner category, the
+  // largest first.
+  std::vector<GlResourceUsage> UsageByOwner() const;
+
+  // Returns the live objects, ordered by owner and creation site.
+  std::vector<GlResource> LiveResources() const;
+
+  // Writes the live objects, which are leaks at shutdown. Returns their
+  // number.
+  int ReportLeaks(std::ostream* out) const;
+
+ private:
+  // Returns the key of an object in the map.
+  static uint64_t Key(const GlObjectType type, const GLuint name) {
+    return (static_cast<uint64_t>(type) << 32) | name;
+  }
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, GlResource> resources_;
+  int64_t live_bytes_;
+  int64_t peak_bytes_;
+};
+
+}  // namespace wvu
+
+#endif  // GL_RESOURCE_REGISTRY_H_
@@ -0,0 +1,141 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "gpu_query_ring.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "gl_hooks.h"
+
+namespace wvu {
+GpuQueryRing::GpuQueryRing(const GLenum target, const int ring_size) :
+    target_(target), query_ids_(ring_size, 0), tags_(ring_size, 0),
+    pending_(ring_size, false), next_query_(0) {
+  glGenQueries(ring_size, query_ids_.data());
+}
+
+GpuQueryRing::~GpuQueryRing() {
+  glDeleteQueries(query_ids_.size(), query_ids_.data());
+}
+
+void GpuQueryRing::Begin() {
+  Begin(0);
+}
+
+void GpuQueryRing::Begin(const int64_t tag) {
+  // When the ring is full, the oldest result is dropped so that the CPU never
+  // waits for the GPU.
+  pending_[next_query_] = false;
+  tags_[next_query_] = tag;
+  glBeginQuery(target_, query_ids_[next_query_]);
+}
+
+void GpuQueryRing::End() {
+  glEndQuery(target_);
+  pending_[next_query_] = true;
+  next_query_ = (next_query_ + 1) % static_cast<int>(query_ids_.size());
+}
+
+bool GpuQueryRing::LatestResult(GLuint64* result) {
+  return LatestResult(result, nullptr);
+}
+
+bool GpuQueryRing::LatestResult(GLuint64* result, int64_t* tag) {
+  bool has_result = false;
+  // The oldest query is the next one to be issued, and results become
+  // available in the order the queries were issued.
+  const int ring_size = static_cast<int>(query_ids_.size());
+  for (int i = 0; i < ring_size; ++i) {
+    const int query = (next_query_ + i) % ring_size;
+    if (!pending_[query]) continue;
+    GLuint available = 0;
+    glGetQueryObjectuiv(query_ids_[query], GL_QUERY_RESULT_AVAILABLE,
+                        &available);
+    if (!available) break;
+    glGetQueryObjectui64v(query_ids_[query], GL_QUERY_RESULT, result);
+    if (tag != nullptr) {
+      *tag = tags_[query];
+    }
+    pending_[query] = false;
+    has_result = true;
+  }
+  return has_result;
+}
+
+GpuTimestampQueue::GpuTimestampQueue(const int ring_size) :
+    query_ids_(ring_size, 0), tags_(ring_size, 0), pending_(ring_size, false),
+    next_query_(0) {
+  glGenQueries(ring_size, query_ids_.data());
+}
+
+GpuTimestampQueue::~GpuTimestampQueue() {
+  glDeleteQueries(query_ids_.size(), query_ids_.data());
+}
+
+void GpuTimestampQueue::Issue(const int64_t tag) {
+  glQueryCounter(query_ids_[next_query_], GL_TIMESTAMP);
+  tags_[next_query_] = tag;
+  pending_[next_query_] = true;
+  next_query_ = (next_query_ + 1) % static_cast<int>(query_ids_.size());
+}
+
+int GpuTimestampQueue::Poll(
+    std::vector<std::pair<int64_t, GLuint64> >* timestamps) {
+  int num_timestamps = 0;
+  const int ring_size = static_cast<int>(query_ids_.size());
+  for (int i = 0; i < ring_size; ++i) {
+    const int query = (next_query_ + i) % ring_size;
+    if (!pending_[query]) continue;
+    GLuint available = 0;
+    glGetQueryObjectuiv(query_ids_[query], GL_QUERY_RESULT_AVAILABLE,
+                        &available);
+    if (!available) break;
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query_ids_[query], GL_QUERY_RESULT, &nanoseconds);
+    pending_[query] = false;
+    timestamps->push_back(std::make_pair(tags_[query], nanoseconds));
+    ++num_timestamps;
+  }
+  return num_timestamps;
+}
+
+GLuint64 GpuTimestampQueue::CurrentGpuTime() {
+  GLint64 nanoseconds = 0;
+  glGetInteger64v(GL_TIMESTAMP, &nanoseconds);
+  return static_cast<GLuint64>(nanoseconds);
+}
+
+}  // namespace wvu
@@ -0,0 +1,147 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GPU_QUERY_RING_H_
+#define GPU_QUERY_RING_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+namespace wvu {
+// A ring of OpenGL queries of the same target (e.g., GL_TIME_ELAPSED or
+// GL_SAMPLES_PASSED) used to measure something once per frame without
+// stalling. Every frame a different query of the ring is issued, and the
+// results are read a few frames later, only when the GPU made them available.
+//
+// GL_TIME_ELAPSED and 64-bit results require OpenGL 3.3 or ARB_timer_query.
+//
+// Example:
+//
+// wvu::GpuQueryRing gpu_timer(GL_TIME_ELAPSED, 4);
+// while (...) {  // Rendering loop.
+//   gpu_timer.Begin();
+//   ...  // OpenGL calls to measure.
+//   gpu_timer.End();
+//   GLuint64 nanoseconds;
+//   if (gpu_timer.LatestResult(&nanoseconds)) { ... }
+// }
+class GpuQueryRing {
+ public:
+  // Constructor. Requires a current OpenGL context.
+  // Params:
+  //   target  The query target.
+  //   ring_size  The number of queries in flight. Results are available
+  //     after about ring_size - 1 frames.
+  GpuQueryRing(const GLenum target, const int ring_size);
+
+  // Destructor. Deletes the queries.
+  ~GpuQueryRing();
+
+  // Begins the query of the current frame. Only one query per target can be
+  // active at a time.
+  void Begin();
+
+  // Begins the query of the current frame and tags it with what the result
+  // depends on, e.g., the number of pixels that a GL_SAMPLES_PASSED query
+  // covers, which changes with the render resolution.
+  void Begin(const int64_t tag);
+
+  // Ends the query of the current frame.
+  void End();
+
+  // Reads the results that became available since the last call. Returns
+  // true and sets result to the most recent one if there is any.
+  bool LatestResult(GLuint64* result);
+
+  // Same as above, and also sets tag to the tag of the most recent result.
+  bool LatestResult(GLuint64* result, int64_t* tag);
+
+ private:
+  const GLenum target_;
+  std::vector<GLuint> query_ids_;
+  // The tags of the queries; zero for the untagged ones.
+  std::vector<int64_t> tags_;
+  // True for the queries that were issued and not read yet.
+  std::vector<bool> pending_;
+  // Index of the next query to issue, which is also the oldest one.
+  int next_query_;
+};
+
+// A ring of GL_TIMESTAMP queries, each tagged by the caller (e.g., with a
+// frame number), that records when the GPU reaches points of the command
+// stream. Like GpuQueryRing, the results are read without stalling, a few
+// frames later, and the oldest query is dropped when the ring is full.
+//
+// Example:
+//
+// wvu::GpuTimestampQueue gpu_timestamps(8);
+// while (...) {  // Rendering loop.
+//   ...  // Draw.
+//   gpu_timestamps.Issue(frame_number);
+//   std::vector<std::pair<int64_t, GLuint64> > timestamps;
+//   gpu_timestamps.Poll(&timestamps);
+// }
+class GpuTimestampQueue {
+ public:
+  // Constructor. Requires a current OpenGL context.
+  // Params:
+  //   ring_size  The number of timestamps in flight.
+  explicit GpuTimestampQueue(const int ring_size);
+
+  // Destructor. Deletes the queries.
+  ~GpuTimestampQueue();
+
+  // Records the GPU time at which the commands issued so far complete.
+  void Issue(const int64_t tag);
+
+  // Appends the (tag, nanoseconds) pairs that became available, in the order
+  // they were issued. Returns the number of pairs appended.
+  int Poll(std::vector<std::pair<int64_t, GLuint64> >* timestamps);
+
+  // Returns the current GPU time in nanoseconds. It synchronizes with the
+  // GPU, so it is meant to calibrate the GPU clock against a CPU clock once.
+  static GLuint64 CurrentGpuTime();
+
+ private:
+  std::vector<GLuint> query_ids_;
+  std::vector<int64_t> tags_;
+  std::vector<bool> pending_;
+  int next_query_;
+};
+
+}  // namespace wvu
+
+#endif  // GPU_QUERY_RING_H_
@@ -0,0 +1,349 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "hardware_occlusion_culler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "math_kernels.h"
+#include "model.h"
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// Shaders used to render the bounding boxes into the occlusion queries. The
+// color writes are disabled while the boxes are rendered, so the fragment
+// shader does not need to compute anything meaningful.
+const std::string box_vertex_shader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 position;\n"
+    "uniform mat4 box_to_clip;\n"
+    "\n"
+    "void main() {\n"
+    "gl_Position = box_to_clip * vec4(position, 1.0f);\n"
+    "}\n";
+
+const std::string box_fragment_shader_src =
+    "#version 330 core\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "color = vec4(1.0f);\n"
+    "}\n";
+
+// The models not rendered for this many frames are forgotten.
+constexpr int kMaxUnseenFrames = 64;
+
+}  // namespace
+
+HardwareOcclusionCuller::HardwareOcclusionCuller(
+    const int visible_query_interval) :
+    visible_query_interval_(std::max(1, visible_query_interval)),
+    frame_number_(0), box_to_clip_location_(-1),
+    box_vertex_array_object_id_(0), box_vertex_buffer_object_id_(0),
+    box_element_buffer_object_id_(0) {}
+
+HardwareOcclusionCuller::~HardwareOcclusionCuller() {
+  for (const auto& model_and_visibility : visibilities_) {
+    glDeleteQueries(1, &model_and_visibility.second.query_id);
+  }
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  registry->Unregister(GlObjectType::BUFFER, box_element_buffer_object_id_);
+  registry->Unregister(GlObjectType::BUFFER, box_vertex_buffer_object_id_);
+  registry->Unregister(GlObjectType::VERTEX_ARRAY,
+                       box_vertex_array_object_id_);
+  glDeleteBuffers(1, &box_element_buffer_object_id_);
+  glDeleteBuffers(1, &box_vertex_buffer_object_id_);
+  glDeleteVertexArrays(1, &box_vertex_array_object_id_);
+}
+
+bool HardwareOcclusionCuller::Initialize(std::string* error_info_log) {
+  box_shader_program_.LoadVertexShaderFromString(box_vertex_shader_src);
+  box_shader_program_.LoadFragmentShaderFromString(box_fragment_shader_src);
+  if (!box_shader_program_.Create(error_info_log)) {
+    return false;
+  }
+  box_to_clip_location_ =
+      glGetUniformLocation(box_shader_program_.shader_program_id(),
+                           "box_to_clip");
+  // Unit cube from (0, 0, 0) to (1, 1, 1). It is scaled and translated to the
+  // bounding box of every model.
+  GLfloat vertices[8 * 3];
+  for (int corner = 0; corner < 8; ++corner) {
+    vertices[3 * corner] = (corner & 1) ? 1.0f : 0.0f;
+    vertices[3 * corner + 1] = (corner & 2) ? 1.0f : 0.0f;
+    vertices[3 * corner + 2] = (corner & 4) ? 1.0f : 0.0f;
+  }
+  const GLuint indices[36] = {
+    0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+    2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5
+  };
+  glGenVertexArrays(1, &box_vertex_array_object_id_);
+  glGenBuffers(1, &box_vertex_buffer_object_id_);
+  glGenBuffers(1, &box_element_buffer_object_id_);
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  registry->Register(GlObjectType::VERTEX_ARRAY, box_vertex_array_object_id_,
+                     "hardware_occlusion_culler", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER, box_vertex_buffer_object_id_,
+                     "hardware_occlusion_culler", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER, box_element_buffer_object_id_,
+                     "hardware_occlusion_culler", WVU_GL_CREATION_SITE);
+  glBindVertexArray(box_vertex_array_object_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, box_vertex_buffer_object_id_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, box_vertex_buffer_object_id_,
+                    sizeof(vertices));
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                        static_cast<GLvoid*>(0));
+  glEnableVertexAttribArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, box_element_buffer_object_id_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
+               GL_STATIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, box_element_buffer_object_id_,
+                    sizeof(indices));
+  glBindVertexArray(0);
+  return true;
+}
+
+void HardwareOcclusionCuller::CollectQueryResult(
+    ModelVisibility* visibility) {
+  if (!visibility->query_pending) return;
+  GLuint available = 0;
+  glGetQueryObjectuiv(visibility->query_id, GL_QUERY_RESULT_AVAILABLE,
+                      &available);
+  if (!available) {
+    ++stats_.num_pending_results;
+    return;
+  }
+  GLuint samples_passed = 0;
+  glGetQueryObjectuiv(visibility->query_id, GL_QUERY_RESULT, &samples_passed);
+  visibility->visible = samples_passed > 0;
+  visibility->query_pending = false;
+}
+
+bool HardwareOcclusionCuller::IsBoxCrossingNearPlane(
+    const Eigen::Matrix4f& model_view_projection, const Model& model) const {
+  const Eigen::Vector3f& box_min = model.bounding_box_min();
+  const Eigen::Vector3f& box_max = model.bounding_box_max();
+  for (int corner = 0; corner < 8; ++corner) {
+    const Eigen::Vector3f point((corner & 1) ? box_max.x() : box_min.x(),
+                                (corner & 2) ? box_max.y() : box_min.y(),
+                                (corner & 4) ? box_max.z() : box_min.z());
+    const float clip_w = model_view_projection.row(3).head<3>().dot(point) +
+        model_view_projection(3, 3);
+    if (clip_w < kMinClipW) return true;
+  }
+  return false;
+}
+
+void HardwareOcclusionCuller::RenderModels(const ShaderProgram& shader_program,
+                                           const Eigen::Matrix4f& projection,
+                                           const Eigen::Matrix4f& view,
+                                           const std::vector<Model*>& models) {
+  RenderModels(shader_program,
+               [&](const std::vector<Model*>& models_to_draw) {
+                 for (Model* model : models_to_draw) {
+                   model->Draw(shader_program, projection, view);
+                 }
+               },
+               projection, view, models);
+}
+
+void HardwareOcclusionCuller::RenderModels(
+    const ShaderProgram& shader_program,
+    const std::function<void(const std::vector<Model*>&)>& draw_models,
+    const Eigen::Matrix4f& projection,
+    const Eigen::Matrix4f& view,
+    const std::vector<Model*>& models) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  stats_ = HardwareOcclusionStats();
+  stats_.num_models = static_cast<int>(models.size());
+  const Eigen::Matrix4f view_projection = projection * view;
+
+  // Collect the available results and split the models by their visibility
+  // in the previous frames.
+  std::vector<Model*> visible_models;
+  std::vector<Model*> hidden_models;
+  for (Model* model : models) {
+    auto insertion = visibilities_.insert(
+        std::make_pair(model, ModelVisibility()));
+    ModelVisibility& visibility = insertion.first->second;
+    if (insertion.second) {
+      glGenQueries(1, &visibility.query_id);
+      visibility.query_phase =
+          static_cast<int>(visibilities_.size()) % visible_query_interval_;
+    } else if (visibility.model_id != model->id()) {
+      // A new model where a deleted one was. It keeps the query object, but
+      // not the visibility nor the pending result of the deleted model.
+      visibility.query_pending = false;
+      visibility.visible = true;
+    }
+    visibility.model_id = model->id();
+    visibility.last_frame = frame_number_;
+    CollectQueryResult(&visibility);
+    if (visibility.visible) {
+      visible_models.push_back(model);
+    } else {
+      hidden_models.push_back(model);
+    }
+  }
+
+  // With wireframes, the models only write the depth of their edges, so
+  // nothing behind them would be occluded. The visible models then also
+  // write the depth of their filled triangles, without color, so that they
+  // occlude like solid models.
+  GLint polygon_modes[2];
+  glGetIntegerv(GL_POLYGON_MODE, polygon_modes);
+  const auto fill_depth = [&](const std::vector<Model*>& models_to_fill) {
+    if (polygon_modes[0] == GL_FILL || models_to_fill.empty()) return;
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    draw_models(models_to_fill);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glPolygonMode(GL_FRONT_AND_BACK, polygon_modes[0]);
+    stats_.num_depth_fill_models += static_cast<int>(models_to_fill.size());
+  };
+
+  // 1. Draw the visible models, querying a staggered sample of them after
+  // the others.
+  std::vector<Model*> queried_models;
+  std::vector<Model*> unqueried_models;
+  for (Model* model : visible_models) {
+    const ModelVisibility& visibility = visibilities_[model];
+    const bool query_due =
+        (frame_number_ + visibility.query_phase) % visible_query_interval_ == 0;
+    if (query_due && !visibility.query_pending) {
+      queried_models.push_back(model);
+    } else {
+      unqueried_models.push_back(model);
+    }
+  }
+  if (!unqueried_models.empty()) {
+    draw_models(unqueried_models);
+  }
+  fill_depth(unqueried_models);
+  for (Model* model : queried_models) {
+    ModelVisibility& visibility = visibilities_[model];
+    glBeginQuery(GL_SAMPLES_PASSED, visibility.query_id);
+    draw_models(std::vector<Model*>(1, model));
+    glEndQuery(GL_SAMPLES_PASSED);
+    visibility.query_pending = true;
+    ++stats_.num_geometry_queries;
+  }
+  fill_depth(queried_models);
+  stats_.num_visible_draws += static_cast<int>(visible_models.size());
+
+  // 2. Query the bounding boxes of the hidden models against the depth buffer
+  // filled by the visible models. Boxes are rasterized filled and without
+  // writing color or depth.
+  if (!hidden_models.empty()) {
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    box_shader_program_.Use();
+    glBindVertexArray(box_vertex_array_object_id_);
+    for (Model* model : hidden_models) {
+      ModelVisibility& visibility = visibilities_[model];
+      if (visibility.query_pending) continue;
+      const Eigen::Matrix4f model_view_projection =
+          view_projection * model->ComputeModelMatrix();
+      if (IsBoxCrossingNearPlane(model_view_projection, *model)) {
+        visibility.visible = true;
+        continue;
+      }
+      // Map the unit cube to the bounding box of the model.
+      Eigen::Matrix4f box_to_model = Eigen::Matrix4f::Identity();
+      box_to_model.block<3, 3>(0, 0) =
+          (model->bounding_box_max() - model->bounding_box_min()).asDiagonal();
+      box_to_model.block<3, 1>(0, 3) = model->bounding_box_min();
+      const Eigen::Matrix4f box_to_clip = model_view_projection * box_to_model;
+      glUniformMatrix4fv(box_to_clip_location_, 1, GL_FALSE,
+                         box_to_clip.data());
+      glBeginQuery(GL_SAMPLES_PASSED, visibility.query_id);
+      glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+      glEndQuery(GL_SAMPLES_PASSED);
+      visibility.query_pending = true;
+      ++stats_.num_box_queries;
+    }
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glPolygonMode(GL_FRONT_AND_BACK, polygon_modes[0]);
+
+    // 3. Draw the hidden models conditionally on their box queries. The GPU
+    // draws them anyway if the result is not ready, so the CPU never waits.
+    shader_program.Use();
+    std::vector<Model*> unconditional_models;
+    for (Model* model : hidden_models) {
+      const ModelVisibility& visibility = visibilities_[model];
+      if (visibility.query_pending) {
+        glBeginConditionalRender(visibility.query_id, GL_QUERY_NO_WAIT);
+        draw_models(std::vector<Model*>(1, model));
+        glEndConditionalRender();
+        ++stats_.num_conditional_draws;
+      } else {
+        unconditional_models.push_back(model);
+      }
+    }
+    if (!unconditional_models.empty()) {
+      draw_models(unconditional_models);
+    }
+  }
+  ++frame_number_;
+  if (frame_number_ % kMaxUnseenFrames == 0) {
+    PruneVisibilities();
+  }
+  stats_.cpu_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+void HardwareOcclusionCuller::PruneVisibilities() {
+  for (auto it = visibilities_.begin(); it != visibilities_.end();) {
+    if (frame_number_ - it->second.last_frame > kMaxUnseenFrames) {
+      glDeleteQueries(1, &it->second.query_id);
+      it = visibilities_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace wvu
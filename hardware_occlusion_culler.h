@@ -0,0 +1,201 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef HARDWARE_OCCLUSION_CULLER_H_
+#define HARDWARE_OCCLUSION_CULLER_H_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "model.h"
+#include "shader_program.h"
+
+namespace wvu {
+// Statistics of the last rendered frame.
+struct HardwareOcclusionStats {
+  // Number of models rendered.
+  int num_models = 0;
+  // Number of models drawn unconditionally because they were visible in the
+  // previous frame.
+  int num_visible_draws = 0;
+  // Number of models drawn with conditional rendering because they were
+  // hidden in the previous frame.
+  int num_conditional_draws = 0;
+  // Number of occlusion queries issued against bounding boxes.
+  int num_box_queries = 0;
+  // Number of occlusion queries issued against the geometry of visible
+  // models.
+  int num_geometry_queries = 0;
+  // Number of query results that were not available yet and were left for a
+  // later frame.
+  int num_pending_results = 0;
+  // Number of visible models drawn again with filled triangles into the
+  // depth buffer, because the models are drawn as wireframes.
+  int num_depth_fill_models = 0;
+  // CPU time spent in RenderModels().
+  double cpu_seconds = 0.0;
+};
+
+// This class culls occluded models on the GPU using hardware occlusion queries
+// with temporal coherence. The visibility of every model in the previous frame
+// is reused:
+//   1. Models visible in the previous frame are drawn first, which fills the
+//      depth buffer. Only a staggered sample of them is queried every frame
+//      (by wrapping their actual draw in a query) to detect when they become
+//      hidden.
+//   2. Models hidden in the previous frame get a query against their bounding
+//      box, and their draw is wrapped in glBeginConditionalRender() with
+//      GL_QUERY_NO_WAIT. The GPU skips the draw when the box is hidden, and
+//      the CPU never waits for the query result.
+// Query results are collected in later frames only when they are available.
+// The visibility of a model, and its query, is dropped once the model is not
+// rendered for a while. The state is matched by Model::id(), so a model
+// created where a deleted one was starts visible.
+//
+// The depth test must be enabled and the depth buffer cleared before calling
+// RenderModels(). With a polygon mode other than GL_FILL, the wireframes only
+// write the depth of their edges, so the visible models are drawn a second
+// time, filled and without color, into the depth buffer. The models then
+// occlude like solid ones, and the hidden lines of the models behind them are
+// not drawn.
+//
+// Example:
+//
+// wvu::HardwareOcclusionCuller occlusion_culler(4);
+// std::string error_info_log;
+// if (!occlusion_culler.Initialize(&error_info_log)) { ... }
+// while (...) {  // Rendering loop.
+//   ...
+//   shader_program.Use();
+//   occlusion_culler.RenderModels(shader_program, projection, view, models);
+// }
+class HardwareOcclusionCuller {
+ public:
+  // Constructor.
+  // Params:
+  //   visible_query_interval  Models that are visible are re-queried every
+  //     this many frames. Queries are staggered across frames.
+  explicit HardwareOcclusionCuller(const int visible_query_interval);
+
+  // Destructor. Releases the queries and the bounding box buffers.
+  ~HardwareOcclusionCuller();
+
+  // Creates the bounding box shader and buffers. Returns false and fills
+  // error_info_log on failure.
+  bool Initialize(std::string* error_info_log);
+
+  // Draws the models that are not occluded.
+  // Params:
+  //   shader_program  The shader program used to draw the models. It must be
+  //     in use when calling this method.
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  //   models  The models to draw.
+  void RenderModels(const ShaderProgram& shader_program,
+                    const Eigen::Matrix4f& projection,
+                    const Eigen::Matrix4f& view,
+                    const std::vector<Model*>& models);
+
+  // Draws the models that are not occluded with a function that draws a list
+  // of models, e.g., in a batch. The visible models that are not queried are
+  // drawn together, and every queried or conditional model alone.
+  // Params:
+  //   shader_program  The shader program used to draw the models. It must be
+  //     in use when calling this method.
+  //   draw_models  Draws a list of models. It must leave shader_program in
+  //     use.
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  //   models  The models to draw.
+  void RenderModels(
+      const ShaderProgram& shader_program,
+      const std::function<void(const std::vector<Model*>&)>& draw_models,
+      const Eigen::Matrix4f& projection,
+      const Eigen::Matrix4f& view,
+      const std::vector<Model*>& models);
+
+  // Returns the statistics of the last frame.
+  const HardwareOcclusionStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  // Visibility state of a model.
+  struct ModelVisibility {
+    // The id of the model. A new model may be allocated where a deleted one
+    // was, so the state is only valid for the model with this id.
+    uint64_t model_id = 0;
+    // Query object owned by the model.
+    GLuint query_id = 0;
+    // True if the query was issued and its result has not been read yet.
+    bool query_pending = false;
+    // Visibility in the last frame whose query result was read.
+    bool visible = true;
+    // Staggers the re-queries of visible models across frames.
+    int query_phase = 0;
+    // The last frame that rendered the model.
+    int last_frame = 0;
+  };
+
+  // Reads the result of the pending query if it is available.
+  void CollectQueryResult(ModelVisibility* visibility);
+
+  // Forgets the models that were not rendered in the last frames, e.g.,
+  // because they were deleted, and deletes their queries.
+  void PruneVisibilities();
+
+  // Returns true if the bounding box of the model crosses the near plane. The
+  // box faces would be clipped in that case, so the model is always visible.
+  bool IsBoxCrossingNearPlane(const Eigen::Matrix4f& model_view_projection,
+                              const Model& model) const;
+
+  const int visible_query_interval_;
+  int frame_number_;
+  std::unordered_map<const Model*, ModelVisibility> visibilities_;
+  // Shader and unit cube used to render the bounding boxes.
+  ShaderProgram box_shader_program_;
+  GLint box_to_clip_location_;
+  GLuint box_vertex_array_object_id_;
+  GLuint box_vertex_buffer_object_id_;
+  GLuint box_element_buffer_object_id_;
+  HardwareOcclusionStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // HARDWARE_OCCLUSION_CULLER_H_
@@ -0,0 +1,278 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "image_writer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace wvu {
+namespace {
+
+// Copies the i-th row from the top of an RGBA image as RGB bytes.
+void CopyRgbRow(const int width,
+                const int height,
+                const int row_stride,
+                const uint32_t* rgba_pixels,
+                const bool bottom_up,
+                const int y,
+                char* rgb_row) {
+  const int source_y = bottom_up ? height - 1 - y : y;
+  const uint8_t* source = reinterpret_cast<const uint8_t*>(
+      rgba_pixels + source_y * row_stride);
+  for (int x = 0; x < width; ++x) {
+    rgb_row[3 * x] = source[4 * x];
+    rgb_row[3 * x + 1] = source[4 * x + 1];
+    rgb_row[3 * x + 2] = source[4 * x + 2];
+  }
+}
+
+// Lookup table of the CRC-32 of every byte.
+struct Crc32Table {
+  uint32_t values[256];
+
+  Crc32Table() {
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      values[n] = c;
+    }
+  }
+};
+
+// Returns the CRC-32 of a buffer as used by the PNG chunks.
+uint32_t ComputeCrc32(const uint8_t* data, const size_t size) {
+  // Thread-safe initialization: the frames may be written from any thread.
+  static const Crc32Table table;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void AppendBigEndian32(const uint32_t value, std::vector<uint8_t>* bytes) {
+  bytes->push_back(static_cast<uint8_t>(value >> 24));
+  bytes->push_back(static_cast<uint8_t>(value >> 16));
+  bytes->push_back(static_cast<uint8_t>(value >> 8));
+  bytes->push_back(static_cast<uint8_t>(value));
+}
+
+// Writes a PNG chunk: length, type, data and the CRC of the type and data.
+void WritePngChunk(const char* type,
+                   const std::vector<uint8_t>& data,
+                   std::ofstream* out) {
+  std::vector<uint8_t> chunk;
+  chunk.reserve(data.size() + 12);
+  AppendBigEndian32(static_cast<uint32_t>(data.size()), &chunk);
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  AppendBigEndian32(ComputeCrc32(chunk.data() + 4, data.size() + 4),
+                    &chunk);
+  out->write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+// Rounds and clamps a color channel to a byte.
+inline uint8_t ClampToByte(const float value) {
+  return static_cast<uint8_t>(
+      std::min(255.0f, std::max(0.0f, value + 0.5f)));
+}
+
+}  // namespace
+
+bool WritePpm(const std::string& filepath,
+              const int width,
+              const int height,
+              const int row_stride,
+              const uint32_t* rgba_pixels,
+              const bool bottom_up) {
+  std::ofstream out(filepath, std::ios::binary);
+  if (!out.is_open()) {
+    return false;
+  }
+  out << "P6\n" << width << " " << height << "\n255\n";
+  std::vector<char> row(3 * width);
+  for (int y = 0; y < height; ++y) {
+    CopyRgbRow(width, height, row_stride, rgba_pixels, bottom_up, y,
+               row.data());
+    out.write(row.data(), row.size());
+  }
+  return out.good();
+}
+
+bool WritePng(const std::string& filepath,
+              const int width,
+              const int height,
+              const int row_stride,
+              const uint32_t* rgba_pixels,
+              const bool bottom_up) {
+  std::ofstream out(filepath, std::ios::binary);
+  if (!out.is_open()) {
+    return false;
+  }
+  static const uint8_t kSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  out.write(reinterpret_cast<const char*>(kSignature), sizeof(kSignature));
+  // Header: size, 8 bits per channel, RGB, default compression, filtering
+  // and no interlacing.
+  std::vector<uint8_t> header;
+  AppendBigEndian32(width, &header);
+  AppendBigEndian32(height, &header);
+  const uint8_t header_tail[5] = {8, 2, 0, 0, 0};
+  header.insert(header.end(), header_tail, header_tail + 5);
+  WritePngChunk("IHDR", header, &out);
+  // Every row starts with its filter type, zero (none).
+  const size_t row_size = 3 * width + 1;
+  std::vector<uint8_t> raw(row_size * height, 0);
+  for (int y = 0; y < height; ++y) {
+    CopyRgbRow(width, height, row_stride, rgba_pixels, bottom_up, y,
+               reinterpret_cast<char*>(raw.data() + y * row_size + 1));
+  }
+  // A zlib stream of stored deflate blocks of up to 65535 bytes.
+  constexpr size_t kMaxStoredBlockSize = 65535;
+  std::vector<uint8_t> compressed;
+  compressed.reserve(raw.size() + 5 * (raw.size() / kMaxStoredBlockSize + 1) +
+                     6);
+  compressed.push_back(0x78);
+  compressed.push_back(0x01);
+  size_t offset = 0;
+  do {
+    const size_t block_size = std::min(kMaxStoredBlockSize,
+                                       raw.size() - offset);
+    const bool final_block = offset + block_size == raw.size();
+    compressed.push_back(final_block ? 1 : 0);
+    compressed.push_back(static_cast<uint8_t>(block_size));
+    compressed.push_back(static_cast<uint8_t>(block_size >> 8));
+    compressed.push_back(static_cast<uint8_t>(~block_size));
+    compressed.push_back(static_cast<uint8_t>(~block_size >> 8));
+    compressed.insert(compressed.end(), raw.begin() + offset,
+                      raw.begin() + offset + block_size);
+    offset += block_size;
+  } while (offset < raw.size());
+  // Adler-32 checksum of the uncompressed data.
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (const uint8_t byte : raw) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  AppendBigEndian32((b << 16) | a, &compressed);
+  WritePngChunk("IDAT", compressed, &out);
+  WritePngChunk("IEND", std::vector<uint8_t>(), &out);
+  return out.good();
+}
+
+void ConvertRgbaToYuv420(const int width,
+                         const int height,
+                         const int row_stride,
+                         const uint32_t* rgba_pixels,
+                         const bool bottom_up,
+                         std::vector<uint8_t>* y_plane,
+                         std::vector<uint8_t>* u_plane,
+                         std::vector<uint8_t>* v_plane) {
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  y_plane->resize(width * height);
+  u_plane->assign(chroma_width * chroma_height, 0);
+  v_plane->assign(chroma_width * chroma_height, 0);
+  for (int chroma_y = 0; chroma_y < chroma_height; ++chroma_y) {
+    for (int chroma_x = 0; chroma_x < chroma_width; ++chroma_x) {
+      float u_sum = 0.0f;
+      float v_sum = 0.0f;
+      int num_pixels = 0;
+      for (int y = 2 * chroma_y; y < std::min(2 * chroma_y + 2, height);
+           ++y) {
+        const int source_y = bottom_up ? height - 1 - y : y;
+        const uint8_t* row = reinterpret_cast<const uint8_t*>(
+            rgba_pixels + source_y * row_stride);
+        for (int x = 2 * chroma_x; x < std::min(2 * chroma_x + 2, width);
+             ++x) {
+          const float r = row[4 * x];
+          const float g = row[4 * x + 1];
+          const float b = row[4 * x + 2];
+          (*y_plane)[y * width + x] =
+              ClampToByte(0.299f * r + 0.587f * g + 0.114f * b);
+          u_sum += -0.168736f * r - 0.331264f * g + 0.5f * b;
+          v_sum += 0.5f * r - 0.418688f * g - 0.081312f * b;
+          ++num_pixels;
+        }
+      }
+      const int chroma_index = chroma_y * chroma_width + chroma_x;
+      (*u_plane)[chroma_index] = ClampToByte(128.0f + u_sum / num_pixels);
+      (*v_plane)[chroma_index] = ClampToByte(128.0f + v_sum / num_pixels);
+    }
+  }
+}
+
+Y4mWriter::Y4mWriter() : width_(0), height_(0) {}
+
+bool Y4mWriter::Open(const std::string& filepath,
+                     const int width,
+                     const int height,
+                     const int frames_per_second) {
+  out_.open(filepath, std::ios::binary);
+  if (!out_.is_open()) {
+    return false;
+  }
+  width_ = width;
+  height_ = height;
+  out_ << "YUV4MPEG2 W" << width << " H" << height << " F"
+       << frames_per_second << ":1 Ip A1:1 C420jpeg\n";
+  return out_.good();
+}
+
+bool Y4mWriter::WriteFrame(const int row_stride,
+                           const uint32_t* rgba_pixels,
+                           const bool bottom_up) {
+  ConvertRgbaToYuv420(width_, height_, row_stride, rgba_pixels, bottom_up,
+                      &y_plane_, &u_plane_, &v_plane_);
+  out_ << "FRAME\n";
+  out_.write(reinterpret_cast<const char*>(y_plane_.data()), y_plane_.size());
+  out_.write(reinterpret_cast<const char*>(u_plane_.data()), u_plane_.size());
+  out_.write(reinterpret_cast<const char*>(v_plane_.data()), v_plane_.size());
+  return out_.good();
+}
+
+void Y4mWriter::Close() {
+  if (out_.is_open()) {
+    out_.close();
+  }
+}
+
+}  // namespace wvu
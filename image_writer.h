@@ -0,0 +1,145 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef IMAGE_WRITER_H_
+#define IMAGE_WRITER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace wvu {
+// Writes an RGBA image into a binary PPM (P6) file. The alpha channel is
+// dropped. Returns true if successful, and false otherwise.
+// Params:
+//   filepath  The path of the file to write.
+//   width  The width of the image in pixels.
+//   height  The height of the image in pixels.
+//   row_stride  The number of pixels between the starts of two rows.
+//   rgba_pixels  The pixels as RGBA bytes in memory order.
+//   bottom_up  True if the first row is the bottom row of the image (OpenGL
+//     convention). PPM files store the top row first.
+bool WritePpm(const std::string& filepath,
+              const int width,
+              const int height,
+              const int row_stride,
+              const uint32_t* rgba_pixels,
+              const bool bottom_up);
+
+// Writes an RGBA image into an RGB PNG file. The image data is stored in
+// uncompressed deflate blocks, which needs no compression library and keeps
+// the encoding fast enough for frame sequences, at the cost of file size.
+// Returns true if successful, and false otherwise. The parameters are the
+// same as WritePpm().
+bool WritePng(const std::string& filepath,
+              const int width,
+              const int height,
+              const int row_stride,
+              const uint32_t* rgba_pixels,
+              const bool bottom_up);
+
+// Converts an RGBA image into the planes of a YUV 4:2:0 image with the full
+// range BT.601 (JPEG) coefficients. The chroma planes have half the width and
+// height, rounded up, and average 2x2 blocks of pixels. The rows of the planes
+// are stored top row first.
+// Params:
+//   width  The width of the image in pixels.
+//   height  The height of the image in pixels.
+//   row_stride  The number of pixels between the starts of two rows.
+//   rgba_pixels  The pixels as RGBA bytes in memory order.
+//   bottom_up  True if the first row is the bottom row of the image.
+//   y_plane  The luma plane, width x height bytes.
+//   u_plane  The blue-difference plane.
+//   v_plane  The red-difference plane.
+void ConvertRgbaToYuv420(const int width,
+                         const int height,
+                         const int row_stride,
+                         const uint32_t* rgba_pixels,
+                         const bool bottom_up,
+                         std::vector<uint8_t>* y_plane,
+                         std::vector<uint8_t>* u_plane,
+                         std::vector<uint8_t>* v_plane);
+
+// Writes a sequence of RGBA frames into a YUV4MPEG2 (Y4M) video file, which
+// most video tools read and encode.
+//
+// Example:
+//
+// wvu::Y4mWriter writer;
+// if (!writer.Open("session.y4m", 640, 480, 60)) { ... }
+// while (...) {
+//   writer.WriteFrame(row_stride, rgba_pixels, true);
+// }
+// writer.Close();
+class Y4mWriter {
+ public:
+  Y4mWriter();
+
+  // Opens the file and writes the stream header. Returns true if successful.
+  // Params:
+  //   filepath  The path of the file to write.
+  //   width  The width of the frames in pixels.
+  //   height  The height of the frames in pixels.
+  //   frames_per_second  The frame rate stored in the header.
+  bool Open(const std::string& filepath,
+            const int width,
+            const int height,
+            const int frames_per_second);
+
+  // Appends a frame of the size given to Open(). Returns true if successful.
+  bool WriteFrame(const int row_stride,
+                  const uint32_t* rgba_pixels,
+                  const bool bottom_up);
+
+  // Closes the file.
+  void Close();
+
+  bool is_open() const {
+    return out_.is_open();
+  }
+
+ private:
+  std::ofstream out_;
+  int width_;
+  int height_;
+  // Reused planes of the frame being written.
+  std::vector<uint8_t> y_plane_;
+  std::vector<uint8_t> u_plane_;
+  std::vector<uint8_t> v_plane_;
+};
+
+}  // namespace wvu
+
+#endif  // IMAGE_WRITER_H_
@@ -0,0 +1,251 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "input_latency_tracker.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace wvu {
+namespace {
+
+// Returns the upper edge of the histogram bin below which the given fraction
+// of the latencies fall.
+double ComputePercentile(const std::vector<int>& histogram,
+                         const int num_events,
+                         const double fraction,
+                         const double bin_seconds,
+                         const double max_seconds) {
+  const double target = fraction * num_events;
+  int count = 0;
+  for (int bin = 0; bin < static_cast<int>(histogram.size()); ++bin) {
+    count += histogram[bin];
+    if (count > 0 && count >= target) {
+      // The overflow bin has no upper edge.
+      return (bin + 1 < static_cast<int>(histogram.size())) ?
+          std::min((bin + 1) * bin_seconds, max_seconds) : max_seconds;
+    }
+  }
+  return max_seconds;
+}
+
+}  // namespace
+
+const char* InputEventTypeName(const InputEventType type) {
+  switch (type) {
+    case InputEventType::KEY:
+      return "key";
+    case InputEventType::MOUSE_BUTTON:
+      return "mouse_button";
+    case InputEventType::CURSOR_MOTION:
+      return "cursor_motion";
+    case InputEventType::SCROLL:
+      return "scroll";
+    case InputEventType::SYNTHETIC:
+      return "synthetic";
+  }
+  return "unknown";
+}
+
+InputLatencyTracker::InputLatencyTracker(const bool wait_for_gpu,
+                                         const int max_frames_in_flight,
+                                         const double bin_seconds,
+                                         const int num_bins) :
+    wait_for_gpu_(wait_for_gpu), max_frames_in_flight_(max_frames_in_flight),
+    bin_seconds_(bin_seconds), num_bins_(num_bins), next_frame_id_(0),
+    histograms_(kNumInputEventTypes * (num_bins + 1), 0), num_events_(0),
+    num_dropped_events_(0), total_seconds_(0.0), max_seconds_(0.0) {}
+
+void InputLatencyTracker::RecordEvent(const InputEventType type,
+                                      const double timestamp) {
+  Event event;
+  event.type = type;
+  event.timestamp = timestamp;
+  pending_events_.push_back(event);
+}
+
+int64_t InputLatencyTracker::FrameSubmitted() {
+  const int64_t id = next_frame_id_++;
+  // Only the frames that consumed events need to be followed.
+  if (pending_events_.empty()) return id;
+  if (static_cast<int>(frames_.size()) >= max_frames_in_flight_) {
+    num_dropped_events_ += static_cast<int>(frames_.front().events.size());
+    frames_.pop_front();
+  }
+  Frame frame;
+  frame.id = id;
+  frame.events.swap(pending_events_);
+  frame.swap_seconds = 0.0;
+  frame.gpu_seconds = 0.0;
+  frame.swapped = false;
+  frame.finished_on_gpu = false;
+  frames_.push_back(frame);
+  return id;
+}
+
+void InputLatencyTracker::FrameSwapped(const int64_t frame,
+                                       const double seconds) {
+  Frame* in_flight = FindFrame(frame);
+  if (in_flight == nullptr) return;
+  in_flight->swap_seconds = seconds;
+  in_flight->swapped = true;
+  RetireCompletedFrames();
+}
+
+void InputLatencyTracker::FrameFinishedOnGpu(const int64_t frame,
+                                             const double seconds) {
+  Frame* in_flight = FindFrame(frame);
+  if (in_flight == nullptr) return;
+  in_flight->gpu_seconds = seconds;
+  in_flight->finished_on_gpu = true;
+  RetireCompletedFrames();
+}
+
+std::vector<int> InputLatencyTracker::Histogram(
+    const InputEventType* type) const {
+  const int histogram_size = num_bins_ + 1;
+  if (type != nullptr) {
+    const int offset = static_cast<int>(*type) * histogram_size;
+    return std::vector<int>(histograms_.begin() + offset,
+                            histograms_.begin() + offset + histogram_size);
+  }
+  std::vector<int> histogram(histogram_size, 0);
+  for (int i = 0; i < static_cast<int>(histograms_.size()); ++i) {
+    histogram[i % histogram_size] += histograms_[i];
+  }
+  return histogram;
+}
+
+InputLatencyStats InputLatencyTracker::ComputeStats() const {
+  InputLatencyStats stats;
+  stats.num_events = num_events_;
+  stats.num_dropped_events = num_dropped_events_;
+  if (num_events_ == 0) return stats;
+  stats.average_seconds = total_seconds_ / num_events_;
+  stats.max_seconds = max_seconds_;
+  const std::vector<int> histogram = Histogram(nullptr);
+  stats.p50_seconds = ComputePercentile(histogram, num_events_, 0.50,
+                                        bin_seconds_, max_seconds_);
+  stats.p95_seconds = ComputePercentile(histogram, num_events_, 0.95,
+                                        bin_seconds_, max_seconds_);
+  stats.p99_seconds = ComputePercentile(histogram, num_events_, 0.99,
+                                        bin_seconds_, max_seconds_);
+  return stats;
+}
+
+bool InputLatencyTracker::ExportHistogramCsv(
+    const std::string& filepath) const {
+  std::ofstream out(filepath);
+  if (!out.is_open()) {
+    return false;
+  }
+  out << "bin_start_ms";
+  for (int type = 0; type < kNumInputEventTypes; ++type) {
+    out << "," << InputEventTypeName(static_cast<InputEventType>(type));
+  }
+  out << ",all\n";
+  const int histogram_size = num_bins_ + 1;
+  for (int bin = 0; bin < histogram_size; ++bin) {
+    out << 1e3 * bin * bin_seconds_;
+    int count = 0;
+    for (int type = 0; type < kNumInputEventTypes; ++type) {
+      const int type_count = histograms_[type * histogram_size + bin];
+      out << "," << type_count;
+      count += type_count;
+    }
+    out << "," << count << "\n";
+  }
+  return out.good();
+}
+
+InputLatencyTracker::Frame* InputLatencyTracker::FindFrame(
+    const int64_t frame) {
+  for (Frame& in_flight : frames_) {
+    if (in_flight.id == frame) return &in_flight;
+  }
+  return nullptr;
+}
+
+void InputLatencyTracker::RetireCompletedFrames() {
+  std::deque<Frame>::iterator it = frames_.begin();
+  while (it != frames_.end()) {
+    if (!it->swapped || (wait_for_gpu_ && !it->finished_on_gpu)) {
+      ++it;
+      continue;
+    }
+    // The frame is displayed once both the swap and the GPU are done.
+    const double display_seconds = wait_for_gpu_ ?
+        std::max(it->swap_seconds, it->gpu_seconds) : it->swap_seconds;
+    for (const Event& event : it->events) {
+      AddLatency(event.type, display_seconds - event.timestamp);
+    }
+    it = frames_.erase(it);
+  }
+}
+
+void InputLatencyTracker::AddLatency(const InputEventType type,
+                                     const double seconds) {
+  const double latency = std::max(seconds, 0.0);
+  const int bin = std::min(static_cast<int>(latency / bin_seconds_),
+                           num_bins_);
+  ++histograms_[static_cast<int>(type) * (num_bins_ + 1) + bin];
+  ++num_events_;
+  total_seconds_ += latency;
+  max_seconds_ = std::max(max_seconds_, latency);
+}
+
+SyntheticInputInjector::SyntheticInputInjector(const double rate_hz) :
+    period_seconds_(1.0 / rate_hz), next_event_seconds_(0.0),
+    started_(false) {}
+
+int SyntheticInputInjector::Poll(const double now,
+                                 InputLatencyTracker* tracker) {
+  if (!started_) {
+    next_event_seconds_ = now;
+    started_ = true;
+  }
+  int num_events = 0;
+  while (next_event_seconds_ <= now) {
+    tracker->RecordEvent(InputEventType::SYNTHETIC, next_event_seconds_);
+    next_event_seconds_ += period_seconds_;
+    ++num_events;
+  }
+  return num_events;
+}
+
+}  // namespace wvu
@@ -0,0 +1,211 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef INPUT_LATENCY_TRACKER_H_
+#define INPUT_LATENCY_TRACKER_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace wvu {
+// The kinds of input events whose latency is measured.
+enum class InputEventType {
+  KEY = 0,
+  MOUSE_BUTTON,
+  CURSOR_MOTION,
+  SCROLL,
+  // Events generated by SyntheticInputInjector.
+  SYNTHETIC,
+};
+
+constexpr int kNumInputEventTypes = 5;
+
+// Returns the name of the event type, e.g., "key".
+const char* InputEventTypeName(const InputEventType type);
+
+// Statistics of the input-to-display latencies measured so far.
+struct InputLatencyStats {
+  // Number of events whose latency was measured.
+  int num_events = 0;
+  // Number of events dropped because their frame never completed, e.g.,
+  // because too many frames were in flight.
+  int num_dropped_events = 0;
+  double average_seconds = 0.0;
+  double max_seconds = 0.0;
+  // Percentiles estimated from the histogram: the upper edge of the bin that
+  // holds the percentile.
+  double p50_seconds = 0.0;
+  double p95_seconds = 0.0;
+  double p99_seconds = 0.0;
+};
+
+// Measures the latency from each input event to the display of the first
+// frame that consumed it. The events are timestamped when they arrive, and
+// the pending events are tagged with the next frame submitted. The frame is
+// displayed when both its buffer swap returned and, optionally, the GPU
+// finished its commands (measured with a timestamp query, which arrives a few
+// frames later). The latency of every event is added to a histogram per event
+// type.
+//
+// All times are in seconds of the same monotonic clock, e.g., glfwGetTime().
+// The tracker does not depend on GLFW or OpenGL.
+//
+// Example:
+//
+// wvu::InputLatencyTracker tracker(true, 8, 1e-3, 200);
+// ...  // In the input callbacks:
+// tracker.RecordEvent(wvu::InputEventType::KEY, glfwGetTime());
+// while (...) {  // Rendering loop.
+//   glfwPollEvents();
+//   ...  // Render.
+//   const int64_t frame = tracker.FrameSubmitted();
+//   ...  // Issue a GPU timestamp tagged with frame.
+//   glfwSwapBuffers(window);
+//   tracker.FrameSwapped(frame, glfwGetTime());
+//   ...  // For the GPU timestamps that became available:
+//   tracker.FrameFinishedOnGpu(frame, gpu_seconds);
+// }
+class InputLatencyTracker {
+ public:
+  // Constructor.
+  // Params:
+  //   wait_for_gpu  Whether a frame is displayed only after the GPU finished
+  //     it. If false, FrameFinishedOnGpu() is not needed.
+  //   max_frames_in_flight  The number of incomplete frames kept. The events
+  //     of older frames are dropped.
+  //   bin_seconds  The width of a histogram bin.
+  //   num_bins  The number of histogram bins. One more bin holds the
+  //     latencies that do not fit.
+  InputLatencyTracker(const bool wait_for_gpu,
+                      const int max_frames_in_flight,
+                      const double bin_seconds,
+                      const int num_bins);
+
+  // Records an input event at the given time. It is consumed by the next
+  // frame submitted.
+  void RecordEvent(const InputEventType type, const double timestamp);
+
+  // Marks the submission of the commands of a frame, which consumed the
+  // pending events. Call it after the last input sampling of the frame, e.g.,
+  // after late-latching. Returns the frame id.
+  int64_t FrameSubmitted();
+
+  // Records the time at which the buffer swap of the frame returned.
+  void FrameSwapped(const int64_t frame, const double seconds);
+
+  // Records the time at which the GPU finished the commands of the frame.
+  void FrameFinishedOnGpu(const int64_t frame, const double seconds);
+
+  // Returns the histogram of the latencies of an event type, or of all of them
+  // if type is null. The last bin counts the latencies beyond the others.
+  std::vector<int> Histogram(const InputEventType* type) const;
+
+  // Returns the statistics of the latencies of all the event types.
+  InputLatencyStats ComputeStats() const;
+
+  // Writes the histograms into a CSV file with one row per bin and one column
+  // per event type. Returns true if successful, and false otherwise.
+  bool ExportHistogramCsv(const std::string& filepath) const;
+
+  int num_pending_events() const {
+    return static_cast<int>(pending_events_.size());
+  }
+
+  int num_frames_in_flight() const {
+    return static_cast<int>(frames_.size());
+  }
+
+ private:
+  struct Event {
+    InputEventType type;
+    double timestamp;
+  };
+
+  struct Frame {
+    int64_t id;
+    std::vector<Event> events;
+    double swap_seconds;
+    double gpu_seconds;
+    bool swapped;
+    bool finished_on_gpu;
+  };
+
+  // Returns the frame with the given id, or null if it is not in flight.
+  Frame* FindFrame(const int64_t frame);
+
+  // Adds the latencies of the completed frames to the histograms.
+  void RetireCompletedFrames();
+
+  void AddLatency(const InputEventType type, const double seconds);
+
+  const bool wait_for_gpu_;
+  const int max_frames_in_flight_;
+  const double bin_seconds_;
+  const int num_bins_;
+  std::vector<Event> pending_events_;
+  // The frames that consumed events, oldest first.
+  std::deque<Frame> frames_;
+  int64_t next_frame_id_;
+  // One histogram of num_bins_ + 1 bins per event type, stored contiguously.
+  std::vector<int> histograms_;
+  int num_events_;
+  int num_dropped_events_;
+  double total_seconds_;
+  double max_seconds_;
+};
+
+// Generates input events at a fixed rate for measuring the latency without a
+// user, e.g., in headless runs.
+class SyntheticInputInjector {
+ public:
+  // Constructor.
+  // Params:
+  //   rate_hz  The number of events per second.
+  explicit SyntheticInputInjector(const double rate_hz);
+
+  // Records into the tracker the events due between the last call and now,
+  // each timestamped at its due time. Returns the number of events injected.
+  int Poll(const double now, InputLatencyTracker* tracker);
+
+ private:
+  const double period_seconds_;
+  double next_event_seconds_;
+  bool started_;
+};
+
+}  // namespace wvu
+
+#endif  // INPUT_LATENCY_TRACKER_H_
@@ -29,6 +29,7 @@
 #include <linux/input.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 
 typedef struct EventNode
@@ -637,6 +638,30 @@ void _glfwPlatformWaitEvents(void)
     _glfwPlatformPollEvents();
 }
 
+void _glfwPlatformWaitEventsTimeout(double timeout)
+{
+    pthread_mutex_lock(&_glfw.mir.event_mutex);
+
+    if (emptyEventQueue(_glfw.mir.event_queue))
+    {
+        struct timespec time;
+        clock_gettime(CLOCK_REALTIME, &time);
+        time.tv_sec += (long) timeout;
+        time.tv_nsec += (long) ((timeout - (long) timeout) * 1e9);
+        if (time.tv_nsec >= 1000000000L)
+        {
+            time.tv_sec += 1;
+            time.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&_glfw.mir.event_cond, &_glfw.mir.event_mutex,
+                               &time);
+    }
+
+    pthread_mutex_unlock(&_glfw.mir.event_mutex);
+
+    _glfwPlatformPollEvents();
+}
+
 void _glfwPlatformPostEmptyEvent(void)
 {
 }
@@ -1834,6 +1834,19 @@ void _glfwPlatformWaitEvents(void)
     _glfwPlatformPollEvents();
 }
 
+void _glfwPlatformWaitEventsTimeout(double timeout)
+{
+    if (!XPending(_glfw.x11.display))
+    {
+        struct timeval tv;
+        tv.tv_sec = (long) timeout;
+        tv.tv_usec = (long) ((timeout - tv.tv_sec) * 1e6);
+        selectDisplayConnection(&tv);
+    }
+
+    _glfwPlatformPollEvents();
+}
+
 void _glfwPlatformPostEmptyEvent(void)
 {
     XEvent event;
@@ -0,0 +1,386 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Micro-benchmarks of the math kernels: every benchmark runs a kernel over a
+// batch of inputs several times and reports the fastest run, in nanoseconds
+// per item.
+//
+// Usage: math_benchmarks --num_items=65536 --filter=quaternion
+//        math_benchmarks --filter=kernels --simd_level=avx2
+//        math_benchmarks --filter=vertices --num_vertices=1000000
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <gflags/gflags.h>
+
+#include "math_kernels.h"
+#include "quaternion_kernels.h"
+#include "thread_pool.h"
+#include "transformations.h"
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define CS470_GFLAGS_NAMESPACE google
+#else
+#define CS470_GFLAGS_NAMESPACE gflags
+#endif
+
+DEFINE_int32(num_items, 1 << 16, "Items (e.g., poses) per batch.");
+DEFINE_int32(num_vertices, 1 << 22,
+             "Vertices per batch of the vertex transform benchmarks.");
+DEFINE_int32(repetitions, 20,
+             "Runs of every benchmark; the fastest one is reported.");
+DEFINE_string(filter, "",
+              "Runs only the benchmarks whose name contains this string.");
+DEFINE_string(simd_level, "all",
+              "Variant of the math kernels to benchmark: scalar, sse4.2, "
+              "avx2, avx512, or all the supported ones.");
+
+namespace {
+
+// Keeps the compiler from dropping the results of the benchmarks.
+float checksum = 0.0f;
+
+// Runs the benchmark --repetitions times if its name passes the filter, and
+// prints the fastest run and, for memory-bound kernels, its bandwidth.
+// Params:
+//   name  The name of the benchmark.
+//   run  Runs the benchmark once over num_items items.
+//   num_items  The items processed by a run.
+//   bytes_per_item  The bytes read and written per item, or 0 to skip the
+//     bandwidth.
+void RunBandwidthBenchmark(const std::string& name,
+                           const std::function<void()>& run,
+                           const int num_items,
+                           const int bytes_per_item) {
+  if (name.find(FLAGS_filter) == std::string::npos) return;
+  double fastest_seconds = std::numeric_limits<double>::max();
+  for (int i = 0; i < std::max(FLAGS_repetitions, 1); ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    fastest_seconds = std::min(
+        fastest_seconds, std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count());
+  }
+  std::cout << name << ": " << 1e9 * fastest_seconds / num_items
+            << " ns per item";
+  if (bytes_per_item > 0) {
+    std::cout << ", " << 1e-9 * bytes_per_item * num_items / fastest_seconds
+              << " GB/s";
+  }
+  std::cout << "\n";
+}
+
+// Runs the benchmark --repetitions times if its name passes the filter, and
+// prints the fastest run.
+// Params:
+//   name  The name of the benchmark.
+//   run  Runs the benchmark once over num_items items.
+//   num_items  The items processed by a run.
+void RunBenchmark(const std::string& name,
+                  const std::function<void()>& run,
+                  const int num_items) {
+  RunBandwidthBenchmark(name, run, num_items, 0);
+}
+
+// Returns random unit quaternions.
+wvu::QuaternionArray RandomQuaternions(const int size, std::mt19937* random) {
+  std::normal_distribution<float> normal;
+  wvu::QuaternionArray quaternions(size);
+  for (int i = 0; i < size; ++i) {
+    quaternions.Set(i, Eigen::Quaternionf(normal(*random), normal(*random),
+                                          normal(*random), normal(*random))
+                    .normalized());
+  }
+  return quaternions;
+}
+
+// Compares the orientation kernels: the Rodrigues vectors of the models
+// against the quaternions, scalar (Eigen) and batched.
+void RunQuaternionBenchmarks() {
+  const int n = FLAGS_num_items;
+  std::mt19937 random(7);
+  const wvu::QuaternionArray from = RandomQuaternions(n, &random);
+  const wvu::QuaternionArray to = RandomQuaternions(n, &random);
+  std::vector<Eigen::Vector3f> rodrigues(n);
+  std::vector<Eigen::Vector3f> to_rodrigues(n);
+  std::vector<Eigen::Vector3f> interpolated_rodrigues(n);
+  std::vector<Eigen::Quaternionf,
+              Eigen::aligned_allocator<Eigen::Quaternionf>> quaternions(n);
+  for (int i = 0; i < n; ++i) {
+    quaternions[i] = from.Get(i);
+    rodrigues[i] = wvu::ConvertQuaternionToRodrigues(quaternions[i]);
+    to_rodrigues[i] = wvu::ConvertQuaternionToRodrigues(to.Get(i));
+  }
+  std::vector<float> matrices(16 * n);
+  wvu::QuaternionArray result(n);
+
+  RunBenchmark("quaternion/rodrigues_to_matrix", [&]() {
+    // As in Model::ComputeModelMatrix().
+    for (int i = 0; i < n; ++i) {
+      const float angle = rodrigues[i].norm();
+      Eigen::Map<Eigen::Matrix4f> matrix(&matrices[16 * i]);
+      matrix = wvu::ComputeRotationMatrix(rodrigues[i] / angle, angle);
+    }
+    checksum += matrices[0];
+  }, n);
+  RunBenchmark("quaternion/to_matrix_eigen", [&]() {
+    for (int i = 0; i < n; ++i) {
+      Eigen::Map<Eigen::Matrix4f> matrix(&matrices[16 * i]);
+      matrix.setIdentity();
+      matrix.block<3, 3>(0, 0) = quaternions[i].toRotationMatrix();
+    }
+    checksum += matrices[0];
+  }, n);
+  RunBenchmark("quaternion/to_matrix_batch", [&]() {
+    wvu::ConvertQuaternionsToRotationMatrices(from, matrices.data());
+    checksum += matrices[0];
+  }, n);
+  RunBenchmark("quaternion/normalize_batch", [&]() {
+    wvu::NormalizeQuaternions(&result);
+    checksum += result.w()[0];
+  }, n);
+  RunBenchmark("quaternion/multiply_eigen", [&]() {
+    for (int i = 0; i < n; ++i) {
+      result.Set(i, quaternions[i] * to.Get(i));
+    }
+    checksum += result.w()[0];
+  }, n);
+  RunBenchmark("quaternion/multiply_batch", [&]() {
+    wvu::MultiplyQuaternions(from, to, &result);
+    checksum += result.w()[0];
+  }, n);
+  RunBenchmark("quaternion/slerp_rodrigues", [&]() {
+    // Interpolating Rodrigues vectors goes through quaternions and back.
+    for (int i = 0; i < n; ++i) {
+      const Eigen::Quaternionf q0 =
+          wvu::ConvertRodriguesToQuaternion(rodrigues[i]);
+      const Eigen::Quaternionf q1 =
+          wvu::ConvertRodriguesToQuaternion(to_rodrigues[i]);
+      interpolated_rodrigues[i] =
+          wvu::ConvertQuaternionToRodrigues(q0.slerp(0.3f, q1));
+    }
+    checksum += interpolated_rodrigues[0].x();
+  }, n);
+  RunBenchmark("quaternion/slerp_eigen", [&]() {
+    for (int i = 0; i < n; ++i) {
+      result.Set(i, quaternions[i].slerp(0.3f, to.Get(i)));
+    }
+    checksum += result.w()[0];
+  }, n);
+  RunBenchmark("quaternion/slerp_batch", [&]() {
+    wvu::SlerpQuaternions(from, to, 0.3f, &result);
+    checksum += result.w()[0];
+  }, n);
+  RunBenchmark("quaternion/nlerp_batch", [&]() {
+    wvu::NlerpQuaternions(from, to, 0.3f, &result);
+    checksum += result.w()[0];
+  }, n);
+}
+
+// Returns random floats in [-1, 1].
+std::vector<float> RandomFloats(const int size, std::mt19937* random) {
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  std::vector<float> values(size);
+  for (float& value : values) {
+    value = uniform(*random);
+  }
+  return values;
+}
+
+// Compares the variants of the math kernels, see math_kernels.h, on the
+// same inputs.
+// Params:
+//   levels  The variants to run.
+void RunMathKernelBenchmarks(const std::vector<wvu::SimdLevel>& levels) {
+  const int n = FLAGS_num_items;
+  std::mt19937 random(11);
+  const wvu::QuaternionArray orientations = RandomQuaternions(n, &random);
+  const std::vector<float> positions = RandomFloats(3 * n, &random);
+  std::vector<float> box_min = RandomFloats(3 * n, &random);
+  std::vector<float> box_max(box_min);
+  for (float& value : box_max) {
+    value += 0.1f;
+  }
+  const Eigen::Matrix4f view_projection =
+      Eigen::Matrix4f::Random() + 2.0f * Eigen::Matrix4f::Identity();
+  Eigen::Matrix<float, 6, 4> planes = Eigen::Matrix<float, 6, 4>::Random();
+  planes.col(3).setConstant(0.5f);
+  std::vector<float> matrices(16 * n);
+  std::vector<float> products(16 * n);
+  std::vector<float> world_min(3 * n);
+  std::vector<float> world_max(3 * n);
+  std::vector<uint8_t> visible(n);
+
+  for (const wvu::SimdLevel level : levels) {
+    wvu::ForceSimdLevel(level);
+    const std::string prefix =
+        std::string("kernels/") + wvu::SimdLevelName(level) + "/";
+    RunBenchmark(prefix + "compose_transforms", [&]() {
+      wvu::ComposeTransforms(orientations, positions.data(), matrices.data());
+      checksum += matrices[0];
+    }, n);
+    RunBenchmark(prefix + "multiply_matrices", [&]() {
+      wvu::MultiplyMatrices(view_projection, matrices.data(), n,
+                            products.data());
+      checksum += products[0];
+    }, n);
+    RunBenchmark(prefix + "transform_boxes", [&]() {
+      wvu::TransformBoxes(matrices.data(), box_min.data(), box_max.data(), n,
+                          world_min.data(), world_max.data());
+      checksum += world_min[0];
+    }, n);
+    RunBenchmark(prefix + "test_boxes_in_frustum", [&]() {
+      wvu::TestBoxesInFrustum(planes, box_min.data(), box_max.data(), n,
+                              visible.data());
+      checksum += visible[0];
+    }, n);
+    RunBenchmark(prefix + "transform_vertices", [&]() {
+      wvu::TransformVertices(view_projection, positions.data(), n,
+                             world_min.data(), nullptr);
+      checksum += world_min[0];
+    }, n);
+  }
+  wvu::ForceSimdLevel(wvu::DetectSimdLevel());
+}
+
+// Compares the transformations of the vertices of a mesh: Eigen, as in
+// SoftwareRasterizer before the vertex kernels, against the kernels on one
+// thread and on every core. The bandwidth counts the bytes of the vertices
+// read and of the results written.
+// Params:
+//   level  The variant of the kernels to run.
+void RunVertexBenchmarks(const wvu::SimdLevel level) {
+  const int n = FLAGS_num_vertices;
+  wvu::ForceSimdLevel(level);
+  const std::string prefix =
+      std::string("vertices/") + wvu::SimdLevelName(level) + "/";
+  const Eigen::Matrix3Xf vertices = Eigen::Matrix3Xf::Random(3, n);
+  const Eigen::Matrix4f view_projection =
+      Eigen::Matrix4f::Random() + 2.0f * Eigen::Matrix4f::Identity();
+  std::vector<float> transformed(3 * n);
+  std::vector<float> projected(4 * n);
+  std::vector<uint8_t> clip_flags(n);
+  wvu::ThreadPool thread_pool(0);
+  const int affine_bytes = 2 * 3 * sizeof(float);
+  const int projection_bytes = 7 * sizeof(float);
+  const int flag_bytes = projection_bytes + sizeof(uint8_t);
+
+  RunBandwidthBenchmark(prefix + "project_eigen", [&]() {
+    for (int i = 0; i < n; ++i) {
+      Eigen::Map<Eigen::Vector4f> clip(&projected[4 * i]);
+      clip = view_projection.leftCols<3>() * vertices.col(i) +
+          view_projection.col(3);
+    }
+    checksum += projected[0];
+  }, n, projection_bytes);
+  RunBandwidthBenchmark(prefix + "transform_affine", [&]() {
+    wvu::TransformVertices(view_projection, vertices.data(), n,
+                           transformed.data(), nullptr);
+    checksum += transformed[0];
+  }, n, affine_bytes);
+  RunBandwidthBenchmark(prefix + "project", [&]() {
+    wvu::ProjectVertices(view_projection, vertices.data(), n, false,
+                         projected.data(), nullptr, nullptr);
+    checksum += projected[0];
+  }, n, projection_bytes);
+  RunBandwidthBenchmark(prefix + "project_clip_flags", [&]() {
+    wvu::ProjectVertices(view_projection, vertices.data(), n, false,
+                         projected.data(), clip_flags.data(), nullptr);
+    checksum += projected[0] + clip_flags[0];
+  }, n, flag_bytes);
+  RunBandwidthBenchmark(prefix + "project_divide_clip_flags", [&]() {
+    wvu::ProjectVertices(view_projection, vertices.data(), n, true,
+                         projected.data(), clip_flags.data(), nullptr);
+    checksum += projected[0] + clip_flags[0];
+  }, n, flag_bytes);
+  RunBandwidthBenchmark(prefix + "transform_affine_parallel", [&]() {
+    wvu::TransformVertices(view_projection, vertices.data(), n,
+                           transformed.data(), &thread_pool);
+    checksum += transformed[0];
+  }, n, affine_bytes);
+  RunBandwidthBenchmark(prefix + "project_divide_clip_flags_parallel", [&]() {
+    wvu::ProjectVertices(view_projection, vertices.data(), n, true,
+                         projected.data(), clip_flags.data(), &thread_pool);
+    checksum += projected[0] + clip_flags[0];
+  }, n, flag_bytes);
+  wvu::ForceSimdLevel(wvu::DetectSimdLevel());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  CS470_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_num_items <= 0 || FLAGS_num_vertices <= 0) {
+    std::cerr << "ERROR: num_items and num_vertices must be positive.\n";
+    return -1;
+  }
+  std::vector<wvu::SimdLevel> simd_levels;
+  if (FLAGS_simd_level == "all") {
+    for (int i = 0; i < static_cast<int>(wvu::SimdLevel::NUM_LEVELS); ++i) {
+      const wvu::SimdLevel level = static_cast<wvu::SimdLevel>(i);
+      if (wvu::IsSimdLevelSupported(level)) simd_levels.push_back(level);
+    }
+  } else {
+    wvu::SimdLevel level;
+    if (!wvu::ParseSimdLevel(FLAGS_simd_level, &level)) {
+      std::cerr << "ERROR: Unknown simd_level " << FLAGS_simd_level << ".\n";
+      return -1;
+    }
+    if (!wvu::IsSimdLevelSupported(level)) {
+      std::cerr << "ERROR: This CPU does not support simd_level "
+                << FLAGS_simd_level << ".\n";
+      return -1;
+    }
+    simd_levels.push_back(level);
+  }
+  RunQuaternionBenchmarks();
+  RunMathKernelBenchmarks(simd_levels);
+  for (const wvu::SimdLevel level : simd_levels) {
+    RunVertexBenchmarks(level);
+  }
+  // Printed so that the results are used.
+  std::cout << "Checksum: " << checksum << "\n";
+  return 0;
+}
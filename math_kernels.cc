@@ -0,0 +1,253 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "math_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <Eigen/Core>
+
+#if defined(WVU_X86_KERNEL_VARIANTS)
+#include <cpuid.h>
+#endif
+
+#include "math_kernels_table.h"
+#include "quaternion_kernels.h"
+#include "thread_pool.h"
+
+namespace wvu {
+namespace {
+
+constexpr int kNumSimdLevels = static_cast<int>(SimdLevel::NUM_LEVELS);
+
+const char* const kSimdLevelNames[kNumSimdLevels] = {
+  "scalar", "sse4.2", "avx2", "avx512"
+};
+
+#if defined(WVU_X86_KERNEL_VARIANTS)
+const MathKernelTable* const kMathKernelTables[kNumSimdLevels] = {
+  &kScalarMathKernels, &kSse42MathKernels, &kAvx2MathKernels,
+  &kAvx512MathKernels
+};
+
+// Returns the register states that the operating system saves on context
+// switches (XCR0). The AVX registers are unusable unless it saves them.
+uint64_t ReadExtendedControlRegister() {
+  uint32_t eax;
+  uint32_t edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+
+SimdLevel DetectCpuSimdLevel() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_2)) {
+    return SimdLevel::SCALAR;
+  }
+  // XMM and YMM state, then the opmask and ZMM state.
+  constexpr uint64_t kAvxState = 0x6;
+  constexpr uint64_t kAvx512State = 0xe6;
+  const bool has_fma = ecx & bit_FMA;
+  const uint64_t os_state = (ecx & bit_OSXSAVE) && (ecx & bit_AVX) ?
+      ReadExtendedControlRegister() : 0;
+  if (!has_fma || (os_state & kAvxState) != kAvxState ||
+      !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) ||
+      !(ebx & bit_AVX2)) {
+    return SimdLevel::SSE4_2;
+  }
+  if ((os_state & kAvx512State) != kAvx512State || !(ebx & bit_AVX512F)) {
+    return SimdLevel::AVX2;
+  }
+  return SimdLevel::AVX512;
+}
+#else
+const MathKernelTable* const kMathKernelTables[kNumSimdLevels] = {
+  &kScalarMathKernels, nullptr, nullptr, nullptr
+};
+
+SimdLevel DetectCpuSimdLevel() {
+  return SimdLevel::SCALAR;
+}
+#endif  // WVU_X86_KERNEL_VARIANTS
+
+// The level of the kernels in use, or -1 before the first call.
+std::atomic<int> selected_level(-1);
+
+const MathKernelTable& GetMathKernelTable() {
+  return *kMathKernelTables[static_cast<int>(GetSimdLevel())];
+}
+
+// Calls process(first, count) over the vertices [0, num_vertices), in tasks
+// of kVerticesPerTask vertices on the threads of the pool if there are
+// several tasks and a pool.
+void ProcessVertexTasks(const int num_vertices,
+                        ThreadPool* thread_pool,
+                        const std::function<void(int, int)>& process) {
+  const int num_tasks = (num_vertices + kVerticesPerTask - 1) /
+      kVerticesPerTask;
+  if (thread_pool == nullptr || thread_pool->num_threads() == 1 ||
+      num_tasks < 2) {
+    process(0, num_vertices);
+    return;
+  }
+  thread_pool->ParallelFor(0, num_tasks, [&](const int task) {
+    const int first = task * kVerticesPerTask;
+    process(first, std::min(kVerticesPerTask, num_vertices - first));
+  });
+}
+
+}  // namespace
+
+const char* SimdLevelName(const SimdLevel level) {
+  return kSimdLevelNames[static_cast<int>(level)];
+}
+
+bool ParseSimdLevel(const std::string& name, SimdLevel* level) {
+  for (int i = 0; i < kNumSimdLevels; ++i) {
+    if (name == kSimdLevelNames[i]) {
+      *level = static_cast<SimdLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsSimdLevelSupported(const SimdLevel level) {
+  return level < SimdLevel::NUM_LEVELS && level <= DetectSimdLevel();
+}
+
+SimdLevel DetectSimdLevel() {
+  // The CPU does not change while running.
+  static const SimdLevel level = DetectCpuSimdLevel();
+  return level;
+}
+
+SimdLevel GetSimdLevel() {
+  int level = selected_level.load(std::memory_order_relaxed);
+  if (level < 0) {
+    level = static_cast<int>(DetectSimdLevel());
+    // Keep a level that was forced in the meantime.
+    int unselected = -1;
+    if (!selected_level.compare_exchange_strong(unselected, level)) {
+      level = unselected;
+    }
+  }
+  return static_cast<SimdLevel>(level);
+}
+
+bool ForceSimdLevel(const SimdLevel level) {
+  if (!IsSimdLevelSupported(level)) return false;
+  selected_level.store(static_cast<int>(level));
+  return true;
+}
+
+void ComposeTransforms(const QuaternionArray& orientations,
+                       const float* positions,
+                       float* matrices) {
+  GetMathKernelTable().compose_transforms(
+      orientations.w(), orientations.x(), orientations.y(), orientations.z(),
+      positions, orientations.size(), matrices);
+}
+
+void MultiplyMatrices(const Eigen::Matrix4f& lhs,
+                      const float* rhs,
+                      const int count,
+                      float* products) {
+  GetMathKernelTable().multiply_matrices(lhs.data(), rhs, count, products);
+}
+
+void TransformBoxes(const float* matrices,
+                    const float* box_min,
+                    const float* box_max,
+                    const int count,
+                    float* world_min,
+                    float* world_max) {
+  GetMathKernelTable().transform_boxes(matrices, box_min, box_max, count,
+                                       world_min, world_max);
+}
+
+void TestBoxesInFrustum(const Eigen::Matrix<float, 6, 4>& planes,
+                        const float* box_min,
+                        const float* box_max,
+                        const int count,
+                        uint8_t* visible) {
+  GetMathKernelTable().test_boxes_in_frustum(planes.data(), box_min, box_max,
+                                             count, visible);
+}
+
+void TransformVertices(const Eigen::Matrix4f& matrix,
+                       const float* vertices,
+                       const int count,
+                       float* transformed,
+                       ThreadPool* thread_pool) {
+  const MathKernelTable& kernels = GetMathKernelTable();
+  ProcessVertexTasks(count, thread_pool, [&](const int first,
+                                             const int num_vertices) {
+    kernels.transform_vertices(matrix.data(), vertices + 3 * first,
+                               num_vertices, transformed + 3 * first);
+  });
+}
+
+void TransformVertices(const Eigen::Matrix<float, 3, 4>& matrix,
+                       const float* vertices,
+                       const int count,
+                       float* transformed,
+                       ThreadPool* thread_pool) {
+  // The kernels take the column-major layout of 4x4 matrices.
+  Eigen::Matrix4f affine = Eigen::Matrix4f::Identity();
+  affine.topRows<3>() = matrix;
+  TransformVertices(affine, vertices, count, transformed, thread_pool);
+}
+
+void ProjectVertices(const Eigen::Matrix4f& matrix,
+                     const float* vertices,
+                     const int count,
+                     const bool perspective_divide,
+                     float* projected,
+                     uint8_t* clip_flags,
+                     ThreadPool* thread_pool) {
+  const MathKernelTable& kernels = GetMathKernelTable();
+  ProcessVertexTasks(count, thread_pool, [&](const int first,
+                                             const int num_vertices) {
+    kernels.project_vertices(
+        matrix.data(), vertices + 3 * first, num_vertices, perspective_divide,
+        projected + 4 * first,
+        clip_flags == nullptr ? nullptr : clip_flags + first);
+  });
+}
+
+}  // namespace wvu
@@ -0,0 +1,191 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef MATH_KERNELS_H_
+#define MATH_KERNELS_H_
+
+#include <cstdint>
+#include <string>
+#include <Eigen/Core>
+
+#include "quaternion_kernels.h"
+
+namespace wvu {
+
+class ThreadPool;
+
+// Instruction sets of the variants of the math kernels, from the oldest.
+enum class SimdLevel {
+  SCALAR = 0,
+  SSE4_2,
+  AVX2,
+  AVX512,
+  NUM_LEVELS
+};
+
+// Returns the name of the level, e.g., "avx2".
+const char* SimdLevelName(const SimdLevel level);
+
+// Parses the name of a level. Returns false if the name is unknown.
+bool ParseSimdLevel(const std::string& name, SimdLevel* level);
+
+// Returns true if the build has the variant of the level and the CPU (and the
+// operating system) supports its instructions.
+bool IsSimdLevelSupported(const SimdLevel level);
+
+// Returns the best supported level, found with CPUID.
+SimdLevel DetectSimdLevel();
+
+// Returns the level of the kernels in use. The first kernel call selects
+// DetectSimdLevel() unless a level was forced.
+SimdLevel GetSimdLevel();
+
+// Forces the kernels of the level, e.g., to test or to benchmark a variant.
+// Returns false, and keeps the current kernels, if the level is not
+// supported.
+bool ForceSimdLevel(const SimdLevel level);
+
+// Batched math kernels. Every kernel has a variant per instruction set, see
+// math_kernels_impl.h, and calls the one of GetSimdLevel(). The matrices are
+// 4x4 and column-major like Eigen::Matrix4f, i.e., 16 floats each; points
+// and boxes are three floats (x, y, z) each, like Eigen::Vector3f.
+
+// Computes the model matrices of poses: the rotation of the unit quaternion
+// followed by the translation to the position.
+// Params:
+//   orientations  The unit quaternions of the poses.
+//   positions  3 floats per pose.
+//   matrices  16 floats per pose.
+void ComposeTransforms(const QuaternionArray& orientations,
+                       const float* positions,
+                       float* matrices);
+
+// Computes lhs * rhs[i] for a batch of matrices, e.g., the
+// model-view-projection matrices of the models.
+void MultiplyMatrices(const Eigen::Matrix4f& lhs,
+                      const float* rhs,
+                      const int count,
+                      float* products);
+
+// Computes the axis-aligned boxes that enclose the boxes transformed by
+// their matrices, e.g., the world boxes of the models.
+// Params:
+//   matrices  16 floats per box.
+//   box_min, box_max  The corners of the boxes.
+//   count  The number of boxes.
+//   world_min, world_max  The corners of the transformed boxes.
+void TransformBoxes(const float* matrices,
+                    const float* box_min,
+                    const float* box_max,
+                    const int count,
+                    float* world_min,
+                    float* world_max);
+
+// Tests axis-aligned boxes against the frustum planes of a camera, see
+// Camera::frustum_planes(). A box is visible, 1, unless it is entirely
+// outside of a plane; a box that crosses the frustum corners conservatively
+// counts as visible.
+void TestBoxesInFrustum(const Eigen::Matrix<float, 6, 4>& planes,
+                        const float* box_min,
+                        const float* box_max,
+                        const int count,
+                        uint8_t* visible);
+
+// The frustum planes that a vertex in clip coordinates (x, y, z, w) is
+// outside of, e.g., CLIP_LEFT when x < -w. The clip flags of ProjectVertices()
+// combine them; a vertex is inside the frustum when its flags are zero, and a
+// triangle is entirely outside when the flags of its vertices share a bit.
+enum ClipFlag {
+  CLIP_LEFT = 1 << 0,
+  CLIP_RIGHT = 1 << 1,
+  CLIP_BOTTOM = 1 << 2,
+  CLIP_TOP = 1 << 3,
+  CLIP_NEAR = 1 << 4,
+  CLIP_FAR = 1 << 5
+};
+
+// Vertices with a clip w below this value are considered behind the camera,
+// e.g., by the near-plane clipping of the occlusion cullers.
+constexpr float kMinClipW = 1e-5f;
+
+// The vertex kernels below split batches of more than kVerticesPerTask
+// vertices into tasks of that size for the threads of a pool.
+constexpr int kVerticesPerTask = 1 << 14;
+
+// Transforms points by the affine part of a matrix: transformed[i] =
+// (matrix * (vertices[i], 1)).head(3), e.g., the vertices of a model to the
+// world.
+// Params:
+//   matrix  The transformation; its last row is ignored.
+//   vertices  3 floats per vertex, e.g., Model::vertices().data().
+//   count  The number of vertices.
+//   transformed  3 floats per vertex. It must not overlap the vertices.
+//   thread_pool  The threads for large batches, or nullptr to run on the
+//     calling thread only.
+void TransformVertices(const Eigen::Matrix4f& matrix,
+                       const float* vertices,
+                       const int count,
+                       float* transformed,
+                       ThreadPool* thread_pool);
+void TransformVertices(const Eigen::Matrix<float, 3, 4>& matrix,
+                       const float* vertices,
+                       const int count,
+                       float* transformed,
+                       ThreadPool* thread_pool);
+
+// Transforms points to clip coordinates, e.g., the vertices of a model by its
+// model-view-projection matrix.
+// Params:
+//   matrix  The projective transformation.
+//   vertices  3 floats per vertex, e.g., Model::vertices().data().
+//   count  The number of vertices.
+//   perspective_divide  True to output the normalized device coordinates and
+//     the inverse of w, (x / w, y / w, z / w, 1 / w), instead of the clip
+//     coordinates (x, y, z, w). The division is meaningless for the vertices
+//     behind the camera, which have clip flags.
+//   projected  4 floats per vertex.
+//   clip_flags  The ClipFlag bits of every vertex, or nullptr to skip them.
+//   thread_pool  The threads for large batches, or nullptr to run on the
+//     calling thread only.
+void ProjectVertices(const Eigen::Matrix4f& matrix,
+                     const float* vertices,
+                     const int count,
+                     const bool perspective_divide,
+                     float* projected,
+                     uint8_t* clip_flags,
+                     ThreadPool* thread_pool);
+
+}  // namespace wvu
+
+#endif  // MATH_KERNELS_H_
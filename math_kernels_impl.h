@@ -0,0 +1,255 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// The batched math kernels, compiled once per instruction set: every
+// math_kernels_<isa>.cc defines WVU_MATH_KERNEL_TABLE to the name of its table
+// and includes this file, and CMake compiles it with the flags of its
+// instruction set. The loops are written for the compiler to vectorize them
+// with the widest registers of the target. math_kernels.cc picks the table at
+// run time.
+//
+// The kernels must not call the inline functions of other headers, e.g.,
+// std::abs() or Eigen: the linker keeps a single copy of such a function, and
+// that copy may have been compiled for an instruction set the CPU lacks.
+
+#ifndef WVU_MATH_KERNEL_TABLE
+#error "Define WVU_MATH_KERNEL_TABLE before including math_kernels_impl.h."
+#endif
+
+#include <cstdint>
+
+#include "math_kernels.h"
+#include "math_kernels_table.h"
+
+namespace wvu {
+namespace {
+
+// A compiler builtin, unlike std::abs(), is expanded in place.
+float Abs(const float value) {
+#if defined(__GNUC__)
+  return __builtin_fabsf(value);
+#else
+  return value < 0.0f ? -value : value;
+#endif
+}
+
+void ComposeTransformsKernel(const float* __restrict w,
+                             const float* __restrict x,
+                             const float* __restrict y,
+                             const float* __restrict z,
+                             const float* __restrict positions,
+                             const int count,
+                             float* __restrict matrices) {
+  for (int i = 0; i < count; ++i) {
+    float* __restrict matrix = matrices + 16 * i;
+    const float xx = x[i] * x[i], yy = y[i] * y[i], zz = z[i] * z[i];
+    const float xy = x[i] * y[i], xz = x[i] * z[i], yz = y[i] * z[i];
+    const float wx = w[i] * x[i], wy = w[i] * y[i], wz = w[i] * z[i];
+    // Column-major: the rotation of the quaternion, then the translation.
+    matrix[0] = 1.0f - 2.0f * (yy + zz);
+    matrix[1] = 2.0f * (xy + wz);
+    matrix[2] = 2.0f * (xz - wy);
+    matrix[3] = 0.0f;
+    matrix[4] = 2.0f * (xy - wz);
+    matrix[5] = 1.0f - 2.0f * (xx + zz);
+    matrix[6] = 2.0f * (yz + wx);
+    matrix[7] = 0.0f;
+    matrix[8] = 2.0f * (xz + wy);
+    matrix[9] = 2.0f * (yz - wx);
+    matrix[10] = 1.0f - 2.0f * (xx + yy);
+    matrix[11] = 0.0f;
+    matrix[12] = positions[3 * i];
+    matrix[13] = positions[3 * i + 1];
+    matrix[14] = positions[3 * i + 2];
+    matrix[15] = 1.0f;
+  }
+}
+
+void MultiplyMatricesKernel(const float* __restrict lhs,
+                            const float* __restrict rhs,
+                            const int count,
+                            float* __restrict products) {
+  for (int i = 0; i < count; ++i) {
+    const float* __restrict right = rhs + 16 * i;
+    float* __restrict product = products + 16 * i;
+    for (int column = 0; column < 4; ++column) {
+      for (int row = 0; row < 4; ++row) {
+        product[4 * column + row] =
+            lhs[row] * right[4 * column] +
+            lhs[4 + row] * right[4 * column + 1] +
+            lhs[8 + row] * right[4 * column + 2] +
+            lhs[12 + row] * right[4 * column + 3];
+      }
+    }
+  }
+}
+
+void TransformBoxesKernel(const float* __restrict matrices,
+                          const float* __restrict box_min,
+                          const float* __restrict box_max,
+                          const int count,
+                          float* __restrict world_min,
+                          float* __restrict world_max) {
+  for (int i = 0; i < count; ++i) {
+    const float* __restrict matrix = matrices + 16 * i;
+    // The center moves with the matrix; the half extents grow with the
+    // absolute values of the rotation (J. Arvo, "Transforming Axis-Aligned
+    // Bounding Boxes").
+    float center[3];
+    float extent[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      center[axis] = 0.5f * (box_min[3 * i + axis] + box_max[3 * i + axis]);
+      extent[axis] = 0.5f * (box_max[3 * i + axis] - box_min[3 * i + axis]);
+    }
+    for (int row = 0; row < 3; ++row) {
+      const float world_center = matrix[12 + row] +
+          matrix[row] * center[0] + matrix[4 + row] * center[1] +
+          matrix[8 + row] * center[2];
+      const float world_extent = Abs(matrix[row]) * extent[0] +
+          Abs(matrix[4 + row]) * extent[1] + Abs(matrix[8 + row]) * extent[2];
+      world_min[3 * i + row] = world_center - world_extent;
+      world_max[3 * i + row] = world_center + world_extent;
+    }
+  }
+}
+
+void TestBoxesInFrustumKernel(const float* __restrict planes,
+                              const float* __restrict box_min,
+                              const float* __restrict box_max,
+                              const int count,
+                              uint8_t* __restrict visible) {
+  for (int i = 0; i < count; ++i) {
+    visible[i] = 1;
+  }
+  // The planes are the rows of a column-major 6x4 matrix.
+  for (int plane = 0; plane < 6; ++plane) {
+    const float a = planes[plane];
+    const float b = planes[6 + plane];
+    const float c = planes[12 + plane];
+    const float d = planes[18 + plane];
+    // The corner of every box farthest along the normal.
+    const float* __restrict corner_x = a >= 0.0f ? box_max : box_min;
+    const float* __restrict corner_y = b >= 0.0f ? box_max : box_min;
+    const float* __restrict corner_z = c >= 0.0f ? box_max : box_min;
+    for (int i = 0; i < count; ++i) {
+      const float distance = a * corner_x[3 * i] + b * corner_y[3 * i + 1] +
+          c * corner_z[3 * i + 2] + d;
+      visible[i] &= distance >= 0.0f ? 1 : 0;
+    }
+  }
+}
+
+void TransformVerticesKernel(const float* __restrict matrix,
+                             const float* __restrict vertices,
+                             const int count,
+                             float* __restrict transformed) {
+  for (int i = 0; i < count; ++i) {
+    const float x = vertices[3 * i];
+    const float y = vertices[3 * i + 1];
+    const float z = vertices[3 * i + 2];
+    for (int row = 0; row < 3; ++row) {
+      transformed[3 * i + row] = matrix[row] * x + matrix[4 + row] * y +
+          matrix[8 + row] * z + matrix[12 + row];
+    }
+  }
+}
+
+// The loop of ProjectVerticesKernel() for a set of options. Branches in the
+// loop would keep the compiler from vectorizing it.
+template <bool kPerspectiveDivide, bool kHasClipFlags>
+void ProjectVerticesLoop(const float* __restrict matrix,
+                         const float* __restrict vertices,
+                         const int count,
+                         float* __restrict projected,
+                         uint8_t* __restrict clip_flags) {
+  for (int i = 0; i < count; ++i) {
+    const float x = vertices[3 * i];
+    const float y = vertices[3 * i + 1];
+    const float z = vertices[3 * i + 2];
+    float clip[4];
+    for (int row = 0; row < 4; ++row) {
+      clip[row] = matrix[row] * x + matrix[4 + row] * y +
+          matrix[8 + row] * z + matrix[12 + row];
+    }
+    const float w = clip[3];
+    if (kHasClipFlags) {
+      clip_flags[i] = static_cast<uint8_t>(
+          (clip[0] < -w ? CLIP_LEFT : 0) |
+          (clip[0] > w ? CLIP_RIGHT : 0) |
+          (clip[1] < -w ? CLIP_BOTTOM : 0) |
+          (clip[1] > w ? CLIP_TOP : 0) |
+          (clip[2] < -w ? CLIP_NEAR : 0) |
+          (clip[2] > w ? CLIP_FAR : 0));
+    }
+    const float scale = kPerspectiveDivide ? 1.0f / w : 1.0f;
+    projected[4 * i] = clip[0] * scale;
+    projected[4 * i + 1] = clip[1] * scale;
+    projected[4 * i + 2] = clip[2] * scale;
+    projected[4 * i + 3] = kPerspectiveDivide ? scale : w;
+  }
+}
+
+void ProjectVerticesKernel(const float* __restrict matrix,
+                           const float* __restrict vertices,
+                           const int count,
+                           const bool perspective_divide,
+                           float* __restrict projected,
+                           uint8_t* __restrict clip_flags) {
+  if (perspective_divide && clip_flags != nullptr) {
+    ProjectVerticesLoop<true, true>(matrix, vertices, count, projected,
+                                    clip_flags);
+  } else if (perspective_divide) {
+    ProjectVerticesLoop<true, false>(matrix, vertices, count, projected,
+                                     clip_flags);
+  } else if (clip_flags != nullptr) {
+    ProjectVerticesLoop<false, true>(matrix, vertices, count, projected,
+                                     clip_flags);
+  } else {
+    ProjectVerticesLoop<false, false>(matrix, vertices, count, projected,
+                                      clip_flags);
+  }
+}
+
+}  // namespace
+
+extern const MathKernelTable WVU_MATH_KERNEL_TABLE = {
+  &ComposeTransformsKernel,
+  &MultiplyMatricesKernel,
+  &TransformBoxesKernel,
+  &TestBoxesInFrustumKernel,
+  &TransformVerticesKernel,
+  &ProjectVerticesKernel
+};
+
+}  // namespace wvu
@@ -0,0 +1,73 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef MATH_KERNELS_TABLE_H_
+#define MATH_KERNELS_TABLE_H_
+
+#include <cstdint>
+
+namespace wvu {
+
+// The math kernels of an instruction set; see math_kernels.h for what they
+// compute. The matrices are 4x4 and column-major, and the points and boxes
+// are three consecutive floats each.
+struct MathKernelTable {
+  void (*compose_transforms)(const float* w, const float* x, const float* y,
+                             const float* z, const float* positions,
+                             const int count, float* matrices);
+  void (*multiply_matrices)(const float* lhs, const float* rhs,
+                            const int count, float* products);
+  void (*transform_boxes)(const float* matrices, const float* box_min,
+                          const float* box_max, const int count,
+                          float* world_min, float* world_max);
+  void (*test_boxes_in_frustum)(const float* planes, const float* box_min,
+                                const float* box_max, const int count,
+                                uint8_t* visible);
+  void (*transform_vertices)(const float* matrix, const float* vertices,
+                             const int count, float* transformed);
+  void (*project_vertices)(const float* matrix, const float* vertices,
+                           const int count, const bool perspective_divide,
+                           float* projected, uint8_t* clip_flags);
+};
+
+// The variants, defined by math_kernels_impl.h. Only the scalar one exists
+// in the builds without WVU_X86_KERNEL_VARIANTS.
+extern const MathKernelTable kScalarMathKernels;
+extern const MathKernelTable kSse42MathKernels;
+extern const MathKernelTable kAvx2MathKernels;
+extern const MathKernelTable kAvx512MathKernels;
+
+}  // namespace wvu
+
+#endif  // MATH_KERNELS_TABLE_H_
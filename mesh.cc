@@ -0,0 +1,246 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "mesh.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+
+namespace wvu {
+namespace {
+// Computes the axis-aligned bounding box of a 3xN vertex matrix. Empty vertex
+// matrices produce a degenerate box at the origin.
+void ComputeBoundingBox(const Eigen::MatrixXf& vertices,
+                        Eigen::Vector3f* min_corner,
+                        Eigen::Vector3f* max_corner) {
+  if (vertices.cols() == 0) {
+    min_corner->setZero();
+    max_corner->setZero();
+    return;
+  }
+  *min_corner = vertices.rowwise().minCoeff();
+  *max_corner = vertices.rowwise().maxCoeff();
+}
+
+// 64-bit FNV-1a.
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+uint64_t HashBytes(const void* data, const size_t size, uint64_t hash) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+bool HaveSameGeometry(const Mesh& mesh,
+                      const Eigen::MatrixXf& vertices,
+                      const std::vector<GLuint>& indices) {
+  return mesh.has_cpu_geometry() &&
+      mesh.vertices().cols() == vertices.cols() &&
+      mesh.indices() == indices &&
+      std::memcmp(mesh.vertices().data(), vertices.data(),
+                  vertices.size() * sizeof(float)) == 0;
+}
+
+}  // namespace
+
+uint64_t ComputeGeometryHash(const Eigen::MatrixXf& vertices,
+                             const std::vector<GLuint>& indices) {
+  // The sizes separate the vertices from the indices.
+  const uint64_t sizes[2] = {static_cast<uint64_t>(vertices.cols()),
+                             static_cast<uint64_t>(indices.size())};
+  uint64_t hash = HashBytes(sizes, sizeof(sizes), kFnvOffsetBasis);
+  hash = HashBytes(vertices.data(), vertices.size() * sizeof(float), hash);
+  return HashBytes(indices.data(), indices.size() * sizeof(GLuint), hash);
+}
+
+Mesh::Mesh(const Eigen::MatrixXf& vertices,
+           const std::vector<GLuint>& indices) :
+    vertices_(vertices), indices_(indices),
+    num_vertices_(vertices.cols()), num_indices_(indices.size()),
+    content_hash_(ComputeGeometryHash(vertices, indices)),
+    vertex_buffer_object_id_(0), vertex_array_object_id_(0),
+    element_buffer_object_id_(0) {
+  ComputeBoundingBox(vertices_, &bounding_box_min_, &bounding_box_max_);
+}
+
+Mesh::~Mesh() {
+  // Requires the OpenGL context to be current if the vertices are in GPU.
+  ReleaseFromGpu();
+}
+
+bool Mesh::SetIntoGpu() {
+  if (is_in_gpu()) return true;
+  if (!has_cpu_geometry()) return false;
+  // The vertices are stored column-major in a 3xN matrix, so every column is
+  // a contiguous (x, y, z) triplet that can be copied as is.
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  glGenVertexArrays(1, &vertex_array_object_id_);
+  glGenBuffers(1, &vertex_buffer_object_id_);
+  registry->Register(GlObjectType::VERTEX_ARRAY, vertex_array_object_id_,
+                     "mesh", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER, vertex_buffer_object_id_, "mesh",
+                     WVU_GL_CREATION_SITE);
+  glBindVertexArray(vertex_array_object_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_object_id_);
+  const GLsizeiptr vertices_size = vertices_.size() * sizeof(vertices_(0, 0));
+  glBufferData(GL_ARRAY_BUFFER, vertices_size, vertices_.data(),
+               GL_STATIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, vertex_buffer_object_id_,
+                    vertices_size);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                        static_cast<GLvoid*>(0));
+  glEnableVertexAttribArray(0);
+  if (!indices_.empty()) {
+    glGenBuffers(1, &element_buffer_object_id_);
+    registry->Register(GlObjectType::BUFFER, element_buffer_object_id_,
+                       "mesh", WVU_GL_CREATION_SITE);
+    // The EBO binding is recorded in the VAO state.
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer_object_id_);
+    const GLsizeiptr indices_size = indices_.size() * sizeof(indices_[0]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_size, indices_.data(),
+                 GL_STATIC_DRAW);
+    registry->SetSize(GlObjectType::BUFFER, element_buffer_object_id_,
+                      indices_size);
+  }
+  glBindVertexArray(0);
+  return true;
+}
+
+void Mesh::ReleaseFromGpu() {
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  if (element_buffer_object_id_ != 0) {
+    registry->Unregister(GlObjectType::BUFFER, element_buffer_object_id_);
+    glDeleteBuffers(1, &element_buffer_object_id_);
+    element_buffer_object_id_ = 0;
+  }
+  if (vertex_buffer_object_id_ != 0) {
+    registry->Unregister(GlObjectType::BUFFER, vertex_buffer_object_id_);
+    glDeleteBuffers(1, &vertex_buffer_object_id_);
+    vertex_buffer_object_id_ = 0;
+  }
+  if (vertex_array_object_id_ != 0) {
+    registry->Unregister(GlObjectType::VERTEX_ARRAY, vertex_array_object_id_);
+    glDeleteVertexArrays(1, &vertex_array_object_id_);
+    vertex_array_object_id_ = 0;
+  }
+}
+
+int64_t Mesh::gpu_size_in_bytes() const {
+  return static_cast<int64_t>(num_vertices_) * 3 * sizeof(GLfloat) +
+      static_cast<int64_t>(num_indices_) * sizeof(GLuint);
+}
+
+void Mesh::ReleaseCpuGeometry() {
+  // Swapping with empty containers frees their memory.
+  Eigen::MatrixXf().swap(vertices_);
+  std::vector<GLuint>().swap(indices_);
+}
+
+bool Mesh::RestoreCpuGeometry(const Eigen::MatrixXf& vertices,
+                              const std::vector<GLuint>& indices) {
+  if (vertices.cols() != num_vertices_ ||
+      static_cast<int>(indices.size()) != num_indices_ ||
+      ComputeGeometryHash(vertices, indices) != content_hash_) {
+    return false;
+  }
+  vertices_ = vertices;
+  indices_ = indices;
+  return true;
+}
+
+MeshCache::MeshCache() : num_hits_(0), num_misses_(0) {}
+
+std::shared_ptr<Mesh> MeshCache::Get(const Eigen::MatrixXf& vertices,
+                                     const std::vector<GLuint>& indices) {
+  const uint64_t hash = ComputeGeometryHash(vertices, indices);
+  auto range = meshes_by_hash_.equal_range(hash);
+  for (auto it = range.first; it != range.second;) {
+    std::shared_ptr<Mesh> mesh = it->second.lock();
+    if (mesh == nullptr) {
+      it = meshes_by_hash_.erase(it);
+      continue;
+    }
+    // Compare the geometry in case of a collision. A mesh without its CPU
+    // copy is trusted to the hash.
+    if (!mesh->has_cpu_geometry() ||
+        HaveSameGeometry(*mesh, vertices, indices)) {
+      ++num_hits_;
+      return mesh;
+    }
+    ++it;
+  }
+  ++num_misses_;
+  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(vertices, indices);
+  meshes_by_hash_.emplace(hash, mesh);
+  return mesh;
+}
+
+std::shared_ptr<Mesh> MeshCache::GetByAssetId(const std::string& asset_id,
+                                              const GeometryLoader& loader) {
+  auto it = meshes_by_asset_id_.find(asset_id);
+  if (it != meshes_by_asset_id_.end()) {
+    std::shared_ptr<Mesh> mesh = it->second.lock();
+    if (mesh != nullptr) {
+      ++num_hits_;
+      return mesh;
+    }
+  }
+  Eigen::MatrixXf vertices;
+  std::vector<GLuint> indices;
+  if (!loader(&vertices, &indices)) return nullptr;
+  // Two assets with the same geometry share the mesh too.
+  std::shared_ptr<Mesh> mesh = Get(vertices, indices);
+  meshes_by_asset_id_[asset_id] = mesh;
+  return mesh;
+}
+
+int MeshCache::num_live_meshes() const {
+  int num_live_meshes = 0;
+  for (const auto& hash_and_mesh : meshes_by_hash_) {
+    if (!hash_and_mesh.second.expired()) ++num_live_meshes;
+  }
+  return num_live_meshes;
+}
+
+}  // namespace wvu
@@ -0,0 +1,221 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+namespace wvu {
+// The geometry of a model: its vertices, its indices and their GPU buffers.
+// The geometry does not change after the construction, so the models with
+// the same geometry share a mesh through a std::shared_ptr, and its buffers
+// are uploaded once. The buffers are deleted with the last reference.
+//
+// The CPU copy of the geometry can be freed once uploaded and restored
+// later, e.g., by the residency manager, but never replaced by another one.
+class Mesh {
+ public:
+  // Constructor.
+  // Params:
+  //   vertices  The 3xN vertices.
+  //   indices  Indices for EBO; empty to draw the vertices in order.
+  Mesh(const Eigen::MatrixXf& vertices, const std::vector<GLuint>& indices);
+
+  // Destructor. Deletes the buffers in GPU, so the OpenGL context must be
+  // current if SetIntoGpu() was called.
+  ~Mesh();
+
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+
+  // Sets the VAO, VBO and EBO from the CPU copy of the geometry. Does nothing
+  // if they are set already. Returns false without uploading if the CPU copy
+  // was released and the buffers are not set.
+  bool SetIntoGpu();
+
+  // Deletes the VAO, VBO and EBO. SetIntoGpu() uploads them again from the
+  // CPU copy of the geometry.
+  void ReleaseFromGpu();
+
+  // Returns true if the VAO, VBO and EBO are set.
+  bool is_in_gpu() const {
+    return vertex_array_object_id_ != 0;
+  }
+
+  // Returns the bytes of the VBO and the EBO.
+  int64_t gpu_size_in_bytes() const;
+
+  // Frees the CPU copy of the vertices and the indices, e.g., after the
+  // upload of a static mesh. The bounding box and the counts remain, so the
+  // models can still be culled and drawn from the GPU buffers. vertices() and
+  // indices() are empty until RestoreCpuGeometry() restores them.
+  void ReleaseCpuGeometry();
+
+  // Restores the CPU copy of the geometry, e.g., from a MeshPack. Returns
+  // false, and restores nothing, if the geometry is not the one of the mesh.
+  bool RestoreCpuGeometry(const Eigen::MatrixXf& vertices,
+                          const std::vector<GLuint>& indices);
+
+  // Returns true if the CPU copy of the geometry is present.
+  bool has_cpu_geometry() const {
+    return vertices_.cols() == num_vertices_;
+  }
+
+  // Returns the CPU copy of the geometry.
+  const Eigen::MatrixXf& vertices() const {
+    return vertices_;
+  }
+
+  const std::vector<GLuint>& indices() const {
+    return indices_;
+  }
+
+  // Return the number of vertices and indices, also without the CPU copy of
+  // the geometry.
+  int num_vertices() const {
+    return num_vertices_;
+  }
+
+  int num_indices() const {
+    return num_indices_;
+  }
+
+  // Returns the corners of the axis-aligned bounding box of the vertices.
+  const Eigen::Vector3f& bounding_box_min() const {
+    return bounding_box_min_;
+  }
+
+  const Eigen::Vector3f& bounding_box_max() const {
+    return bounding_box_max_;
+  }
+
+  // Returns the hash of the vertices and the indices.
+  uint64_t content_hash() const {
+    return content_hash_;
+  }
+
+  GLuint vertex_buffer_object_id() const {
+    return vertex_buffer_object_id_;
+  }
+
+  GLuint vertex_array_object_id() const {
+    return vertex_array_object_id_;
+  }
+
+  GLuint element_buffer_object_id() const {
+    return element_buffer_object_id_;
+  }
+
+ private:
+  Eigen::MatrixXf vertices_;
+  std::vector<GLuint> indices_;
+  // Sizes of the geometry, kept when the CPU copy is released.
+  int num_vertices_;
+  int num_indices_;
+  Eigen::Vector3f bounding_box_min_;
+  Eigen::Vector3f bounding_box_max_;
+  uint64_t content_hash_;
+  GLuint vertex_buffer_object_id_;
+  GLuint vertex_array_object_id_;
+  GLuint element_buffer_object_id_;
+};
+
+// Computes the hash of a geometry, as in Mesh::content_hash().
+uint64_t ComputeGeometryHash(const Eigen::MatrixXf& vertices,
+                             const std::vector<GLuint>& indices);
+
+// Deduplicates the meshes by content or by asset id. The cache only keeps weak
+// references, so a mesh is freed with its last model, and a later request
+// creates it again.
+//
+// Example:
+//
+// wvu::MeshCache mesh_cache;
+// for (...) {
+//   // The boxes of the same size share a mesh.
+//   models.push_back(new wvu::Model(orientation, position,
+//                                   mesh_cache.Get(box_vertices, box_indices)));
+// }
+class MeshCache {
+ public:
+  // Loads the geometry of an asset. Returns true if successful.
+  typedef std::function<bool(Eigen::MatrixXf* vertices,
+                             std::vector<GLuint>* indices)> GeometryLoader;
+
+  MeshCache();
+
+  // Returns the live mesh with this geometry, or a new one.
+  std::shared_ptr<Mesh> Get(const Eigen::MatrixXf& vertices,
+                            const std::vector<GLuint>& indices);
+
+  // Returns the live mesh of an asset, or loads its geometry and returns a new
+  // one. Returns null if the loader fails.
+  // Params:
+  //   asset_id  The name of the asset, e.g., its path.
+  //   loader  Reads the geometry of the asset; only called on a miss.
+  std::shared_ptr<Mesh> GetByAssetId(const std::string& asset_id,
+                                     const GeometryLoader& loader);
+
+  // Returns the number of cached meshes that are still referenced.
+  int num_live_meshes() const;
+
+  // Returns the number of requests that returned a live mesh, and the number
+  // of the ones that created a mesh.
+  int num_hits() const {
+    return num_hits_;
+  }
+
+  int num_misses() const {
+    return num_misses_;
+  }
+
+ private:
+  // Several meshes may have the same hash.
+  std::unordered_multimap<uint64_t, std::weak_ptr<Mesh>> meshes_by_hash_;
+  std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes_by_asset_id_;
+  int num_hits_;
+  int num_misses_;
+};
+
+}  // namespace wvu
+
+#endif  // MESH_H_
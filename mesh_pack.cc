@@ -0,0 +1,188 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "mesh_pack.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "mesh.h"
+
+namespace wvu {
+namespace {
+
+constexpr char kMagic[8] = {'W', 'V', 'U', 'M', 'E', 'S', 'H', '1'};
+// Offset, number of vertices and number of indices of a mesh.
+constexpr size_t kEntrySize = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+}  // namespace
+
+MeshPack::MeshPack() : num_bytes_read_(0) {}
+
+bool MeshPack::Write(const std::string& filepath,
+                     const std::vector<const Mesh*>& meshes,
+                     std::string* error_info_log) {
+  std::ofstream out(filepath, std::ios::binary);
+  if (!out.is_open()) {
+    if (error_info_log) {
+      *error_info_log = "Could not open " + filepath + " for writing.";
+    }
+    return false;
+  }
+  const uint32_t num_meshes = meshes.size();
+  out.write(kMagic, sizeof(kMagic));
+  out.write(reinterpret_cast<const char*>(&num_meshes), sizeof(num_meshes));
+  // The table of contents, then the data.
+  uint64_t offset =
+      sizeof(kMagic) + sizeof(num_meshes) + num_meshes * kEntrySize;
+  for (const Mesh* mesh : meshes) {
+    if (!mesh->has_cpu_geometry()) {
+      if (error_info_log) {
+        *error_info_log = "A mesh has no CPU copy of its geometry.";
+      }
+      return false;
+    }
+    const uint32_t num_vertices = mesh->num_vertices();
+    const uint32_t num_indices = mesh->num_indices();
+    out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    out.write(reinterpret_cast<const char*>(&num_vertices),
+              sizeof(num_vertices));
+    out.write(reinterpret_cast<const char*>(&num_indices),
+              sizeof(num_indices));
+    offset += num_vertices * 3 * sizeof(float) + num_indices * sizeof(GLuint);
+  }
+  for (const Mesh* mesh : meshes) {
+    out.write(reinterpret_cast<const char*>(mesh->vertices().data()),
+              mesh->vertices().size() * sizeof(float));
+    out.write(reinterpret_cast<const char*>(mesh->indices().data()),
+              mesh->indices().size() * sizeof(GLuint));
+  }
+  if (!out.good()) {
+    if (error_info_log) {
+      *error_info_log = "Could not write " + filepath + ".";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool MeshPack::Open(const std::string& filepath,
+                    std::string* error_info_log) {
+  in_.close();
+  meshes_.clear();
+  in_.open(filepath, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  uint32_t num_meshes = 0;
+  in_.read(magic, sizeof(magic));
+  in_.read(reinterpret_cast<char*>(&num_meshes), sizeof(num_meshes));
+  if (!in_.good() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    if (error_info_log) {
+      *error_info_log = filepath + " is not a mesh pack.";
+    }
+    in_.close();
+    return false;
+  }
+  // The counts of a truncated or corrupt pack must not size the tables, so
+  // they are checked against the size of the file first.
+  const std::streamoff table_offset = in_.tellg();
+  in_.seekg(0, std::ios::end);
+  const uint64_t file_size = static_cast<uint64_t>(in_.tellg());
+  in_.seekg(table_offset);
+  if (num_meshes * kEntrySize >
+      file_size - static_cast<uint64_t>(table_offset)) {
+    if (error_info_log) {
+      *error_info_log = "The table of contents of " + filepath +
+          " is truncated.";
+    }
+    in_.close();
+    return false;
+  }
+  meshes_.resize(num_meshes);
+  for (MeshEntry& mesh : meshes_) {
+    in_.read(reinterpret_cast<char*>(&mesh.offset), sizeof(mesh.offset));
+    in_.read(reinterpret_cast<char*>(&mesh.num_vertices),
+             sizeof(mesh.num_vertices));
+    in_.read(reinterpret_cast<char*>(&mesh.num_indices),
+             sizeof(mesh.num_indices));
+  }
+  if (!in_.good()) {
+    if (error_info_log) {
+      *error_info_log = "The table of contents of " + filepath +
+          " is truncated.";
+    }
+    meshes_.clear();
+    in_.close();
+    return false;
+  }
+  // Read() sizes the geometry by the entries, so they must lie in the file.
+  for (const MeshEntry& mesh : meshes_) {
+    const uint64_t mesh_size =
+        static_cast<uint64_t>(mesh.num_vertices) * 3 * sizeof(float) +
+        static_cast<uint64_t>(mesh.num_indices) * sizeof(GLuint);
+    if (mesh.offset > file_size || mesh_size > file_size - mesh.offset) {
+      if (error_info_log) {
+        *error_info_log = "A mesh of " + filepath + " is out of the file.";
+      }
+      meshes_.clear();
+      in_.close();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MeshPack::Read(const int index,
+                    Eigen::MatrixXf* vertices,
+                    std::vector<GLuint>* indices) {
+  if (!in_.is_open() || index < 0 || index >= num_meshes()) return false;
+  const MeshEntry& mesh = meshes_[index];
+  vertices->resize(3, mesh.num_vertices);
+  indices->resize(mesh.num_indices);
+  const size_t vertices_size = vertices->size() * sizeof(float);
+  const size_t indices_size = indices->size() * sizeof(GLuint);
+  in_.clear();
+  in_.seekg(mesh.offset);
+  in_.read(reinterpret_cast<char*>(vertices->data()), vertices_size);
+  in_.read(reinterpret_cast<char*>(indices->data()), indices_size);
+  if (!in_.good()) return false;
+  num_bytes_read_ += vertices_size + indices_size;
+  return true;
+}
+
+}  // namespace wvu
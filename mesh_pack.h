@@ -0,0 +1,110 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef MESH_PACK_H_
+#define MESH_PACK_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+namespace wvu {
+class Mesh;
+
+// A file with the geometry of many meshes, from which a mesh is read back
+// without loading the others, e.g., to restore the GPU buffers of a mesh
+// whose CPU copy was dropped. The file is a table of contents (the offset and
+// sizes of every mesh) followed by the vertices and the indices of the
+// meshes, in the byte order of the host.
+//
+// Example:
+//
+// std::string error_info_log;
+// if (!wvu::MeshPack::Write("scene.pack", meshes, &error_info_log)) { ... }
+// wvu::MeshPack mesh_pack;
+// if (!mesh_pack.Open("scene.pack", &error_info_log)) { ... }
+// Eigen::MatrixXf vertices;
+// std::vector<GLuint> indices;
+// if (mesh_pack.Read(3, &vertices, &indices)) { ... }
+class MeshPack {
+ public:
+  MeshPack();
+
+  // Writes the geometry of the meshes into a pack. The meshes need their CPU
+  // copy of the geometry. Returns true if successful.
+  // Params:
+  //   filepath  The path of the pack.
+  //   meshes  The meshes to write.
+  //   error_info_log  The reason of the failure.
+  static bool Write(const std::string& filepath,
+                    const std::vector<const Mesh*>& meshes,
+                    std::string* error_info_log);
+
+  // Opens a pack and reads its table of contents. Returns true if
+  // successful.
+  bool Open(const std::string& filepath, std::string* error_info_log);
+
+  int num_meshes() const {
+    return meshes_.size();
+  }
+
+  // Reads the geometry of a mesh. Returns false if the pack is not open, the
+  // index is out of range or the file is truncated.
+  bool Read(const int index,
+            Eigen::MatrixXf* vertices,
+            std::vector<GLuint>* indices);
+
+  // Returns the bytes read by Read() so far.
+  int64_t num_bytes_read() const {
+    return num_bytes_read_;
+  }
+
+ private:
+  struct MeshEntry {
+    uint64_t offset;
+    uint32_t num_vertices;
+    uint32_t num_indices;
+  };
+
+  std::ifstream in_;
+  std::vector<MeshEntry> meshes_;
+  int64_t num_bytes_read_;
+};
+
+}  // namespace wvu
+
+#endif  // MESH_PACK_H_
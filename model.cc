@@ -34,108 +34,172 @@
 
 #include "model.h"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
-#include <GL/glew.h>
 
+#include "gl_hooks.h"
+#include "mesh.h"
 #include "shader_program.h"
 #include "transformations.h"
 
 namespace wvu {
+namespace {
+// The versions of all the models come from this counter, so a model never
+// repeats a version of another one.
+std::atomic<uint64_t> last_model_version(0);
+
+uint64_t NextModelVersion() {
+  return ++last_model_version;
+}
+
+// The ids of the models. Unlike its address, the id of a deleted model is
+// never given to another one.
+std::atomic<uint64_t> last_model_id(0);
+
+}  // namespace
+
 Model::Model(const Eigen::Vector3f& orientation,
              const Eigen::Vector3f& position,
-             const Eigen::MatrixXf& vertices) {
-  orientation_ = orientation;
-  position_ = position;
-  vertices_ = vertices;
-  vertex_buffer_object_id_ = 0;
-  vertex_array_object_id_ = 0;
-  element_buffer_object_id_ = 0;
-}
+             const Eigen::MatrixXf& vertices) :
+    Model(orientation, position,
+          std::make_shared<Mesh>(vertices, std::vector<GLuint>())) {}
 
 Model::Model(const Eigen::Vector3f& orientation,
              const Eigen::Vector3f& position,
              const Eigen::MatrixXf& vertices,
-             const std::vector<GLuint>& indices) {
+             const std::vector<GLuint>& indices) :
+    Model(orientation, position, std::make_shared<Mesh>(vertices, indices)) {}
+
+Model::Model(const Eigen::Vector3f& orientation,
+             const Eigen::Vector3f& position,
+             std::shared_ptr<Mesh> mesh) {
   orientation_ = orientation;
+  has_quaternion_orientation_ = false;
+  is_converted_orientation_current_ = false;
   position_ = position;
-  vertices_ = vertices;
-  indices_ = indices;
-  vertex_buffer_object_id_ = 0;
-  vertex_array_object_id_ = 0;
-  element_buffer_object_id_ = 0;
-}
-
-Model::~Model() {
-  // TODO: Delete the buffers in GPU.
+  mesh_ = std::move(mesh);
+  id_ = ++last_model_id;
+  version_ = NextModelVersion();
 }
 
 // Builds the model matrix from the orientation and position members.
 Eigen::Matrix4f Model::ComputeModelMatrix() {
-  // TODO: Implment me!
-  return Eigen::Matrix4f::Random();
+  Eigen::Matrix4f translation = ComputeTranslationMatrix(position_);
+  if (has_quaternion_orientation_) {
+    translation.block<3, 3>(0, 0) = orientation_quaternion_.toRotationMatrix();
+    return translation;
+  }
+  // The orientation is a Rodrigues vector: its norm is the rotation angle.
+  const float angle = orientation_.norm();
+  if (angle < 1e-8f) {
+    return translation;
+  }
+  return translation * ComputeRotationMatrix(orientation_ / angle, angle);
 }
 
 // Setters set members by *copying* input parameters.
 void Model::set_orientation(const Eigen::Vector3f& orientation) {
   orientation_ = orientation;
+  has_quaternion_orientation_ = false;
+  is_converted_orientation_current_ = false;
+  version_ = NextModelVersion();
+}
+
+void Model::set_orientation_quaternion(const Eigen::Quaternionf& orientation) {
+  orientation_quaternion_ = orientation.normalized();
+  has_quaternion_orientation_ = true;
+  is_converted_orientation_current_ = false;
+  version_ = NextModelVersion();
 }
 
 // Setters set members by *copying* input parameters.
 void Model::set_position(const Eigen::Vector3f& position) {
   position_ = position;
+  version_ = NextModelVersion();
 }
 
+// The caller may modify the member through the pointer, so the version
+// changes conservatively.
 Eigen::Vector3f* Model::mutable_orientation() {
+  orientation();
+  has_quaternion_orientation_ = false;
+  is_converted_orientation_current_ = false;
+  version_ = NextModelVersion();
   return &orientation_;
 }
 
 Eigen::Vector3f* Model::mutable_position() {
+  version_ = NextModelVersion();
   return &position_;
 }
 
 const Eigen::Vector3f& Model::orientation() {
+  if (has_quaternion_orientation_ && !is_converted_orientation_current_) {
+    orientation_ = ConvertQuaternionToRodrigues(orientation_quaternion_);
+    is_converted_orientation_current_ = true;
+  }
   return orientation_;
 }
 
+Eigen::Quaternionf Model::orientation_quaternion() {
+  if (!has_quaternion_orientation_ && !is_converted_orientation_current_) {
+    orientation_quaternion_ = ConvertRodriguesToQuaternion(orientation_);
+    is_converted_orientation_current_ = true;
+  }
+  return orientation_quaternion_;
+}
+
 const Eigen::Vector3f& Model::position() {
   return position_;
 }
 
 const Eigen::MatrixXf& Model::vertices() const {
-  return vertices_;
+  return mesh_->vertices();
 }
 
 const std::vector<GLuint>& Model::indices() const {
-  return indices_;
+  return mesh_->indices();
+}
+
+const Eigen::Vector3f& Model::bounding_box_min() const {
+  return mesh_->bounding_box_min();
+}
+
+const Eigen::Vector3f& Model::bounding_box_max() const {
+  return mesh_->bounding_box_max();
 }
 
 const GLuint Model::vertex_buffer_object_id() const {
-  return vertex_buffer_object_id_;
+  return mesh_->vertex_buffer_object_id();
 }
 
 const GLuint Model::vertex_buffer_object_id() {
-  return vertex_buffer_object_id_;
+  return mesh_->vertex_buffer_object_id();
 }
 
 const GLuint Model::vertex_array_object_id() const {
-  return vertex_array_object_id_;
+  return mesh_->vertex_array_object_id();
 }
 
 const GLuint Model::vertex_array_object_id() {
-  return vertex_array_object_id_;
+  return mesh_->vertex_array_object_id();
 }
 
 const GLuint Model::element_buffer_object_id() const {
-  return element_buffer_object_id_;
+  return mesh_->element_buffer_object_id();
 }
 
 const GLuint Model::element_buffer_object_id() {
-  return element_buffer_object_id_;
+  return mesh_->element_buffer_object_id();
 }
 
-void Model::SetVerticesIntoGpu() {
-  // TODO: Implement me!
+bool Model::SetVerticesIntoGpu() {
+  return mesh_->SetIntoGpu();
 }
 
 void Model::Draw(const ShaderProgram& shader_program,
@@ -143,7 +207,22 @@ void Model::Draw(const ShaderProgram& shader_program,
                  const Eigen::Matrix4f& view) {
   // The model transformation must be computed using ComputeModelMatrix().
   const Eigen::Matrix4f model = ComputeModelMatrix();
-  // TODO: Implement me!
+  // Eigen stores matrices in column-major order, which is what OpenGL expects.
+  const GLuint program_id = shader_program.shader_program_id();
+  const GLint model_location = glGetUniformLocation(program_id, "model");
+  const GLint view_location = glGetUniformLocation(program_id, "view");
+  const GLint projection_location =
+      glGetUniformLocation(program_id, "projection");
+  glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
+  glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
+  glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
+  glBindVertexArray(mesh_->vertex_array_object_id());
+  if (mesh_->num_indices() == 0) {
+    glDrawArrays(GL_TRIANGLES, 0, mesh_->num_vertices());
+  } else {
+    glDrawElements(GL_TRIANGLES, mesh_->num_indices(), GL_UNSIGNED_INT, 0);
+  }
+  glBindVertexArray(0);
 }
 
 }  // namespace wvu
@@ -37,14 +37,22 @@
 #ifndef MODEL_H_
 #define MODEL_H_
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 #include <GL/glew.h>
 
+#include "mesh.h"
 #include "shader_program.h"
 
 namespace wvu {
-// Class that holds the necessary information of a 3D model in OpenGL.
+// Class that holds the necessary information of a 3D model in OpenGL: the
+// pose of the object and a reference to its geometry, which other models may
+// share. The orientation is stored either as a Rodrigues vector or, after
+// set_orientation_quaternion(), as a unit quaternion; the other form is
+// converted on demand.
 class Model {
 public:
   // Constructor.
@@ -69,16 +77,24 @@ public:
         const Eigen::MatrixXf& vertices,
         const std::vector<GLuint>& indices);
 
-  // Destructor.
-  // NOTE: Destructors need to be called when instances of this class are
-  // created in the heap by using new operator.
-  ~Model();
+  // Constructor. Models with the same geometry share the mesh, see
+  // MeshCache.
+  // Params
+  //  orientation  Axis of rotation whose norm is the angle
+  //     (aka Rodrigues vector).
+  //  position  The position of the object in the world.
+  //  mesh  The geometry of the object.
+  Model(const Eigen::Vector3f& orientation,
+        const Eigen::Vector3f& position,
+        std::shared_ptr<Mesh> mesh);
 
   // Builds the model matrix from the orientation and position members.
   Eigen::Matrix4f ComputeModelMatrix();
 
-  // Sets the VAO, VBO and EBO.
-  void SetVerticesIntoGpu();
+  // Sets the VAO, VBO and EBO of the mesh. Does nothing if they are set
+  // already, e.g., by another model with the same mesh. Returns false if the
+  // mesh is not in GPU and its CPU geometry was released.
+  bool SetVerticesIntoGpu();
 
   // Draws the model. Executes OpenGL calls to render the set VAO.
   // Params:
@@ -93,6 +109,11 @@ public:
   // vector: angle-axis vector where the angle is the norm of the vector.
   void set_orientation(const Eigen::Vector3f& orientation);
 
+  // Sets the orientation as a unit quaternion, which becomes the storage of
+  // the orientation: ComputeModelMatrix() then needs no trigonometry, and
+  // poses are cheap to interpolate; see quaternion_kernels.h.
+  void set_orientation_quaternion(const Eigen::Quaternionf& orientation);
+
   // Sets the position of the model.
   void set_position(const Eigen::Vector3f& position);
 
@@ -101,7 +122,8 @@ public:
   // if we want to modify directly the members. However, this
   // is a matter of design.
 
-  // Returns a mutable orientation vector.
+  // Returns a mutable orientation vector. The Rodrigues vector becomes the
+  // storage of the orientation.
   Eigen::Vector3f* mutable_orientation();
 
   // Returns a mutable position.
@@ -111,15 +133,57 @@ public:
   // Gets the orientation or pose of the object in the world.
   const Eigen::Vector3f& orientation();
 
+  // Gets the orientation as a unit quaternion.
+  Eigen::Quaternionf orientation_quaternion();
+
+  // Returns true if the orientation is stored as a quaternion.
+  bool has_quaternion_orientation() const {
+    return has_quaternion_orientation_;
+  }
+
   // Gets the position of the object in the world.
   const Eigen::Vector3f& position();
 
+  // Returns the geometry of the model.
+  const std::shared_ptr<Mesh>& mesh() const {
+    return mesh_;
+  }
+
   // Returns a const reference of the vertices.
   const Eigen::MatrixXf& vertices() const;
 
   // Returns a const reference of the indices for an EBO.
   const std::vector<GLuint>& indices() const;
 
+  // Return the number of vertices and indices, also without the CPU copy of
+  // the geometry.
+  int num_vertices() const {
+    return mesh_->num_vertices();
+  }
+
+  int num_indices() const {
+    return mesh_->num_indices();
+  }
+
+  // Returns the corners of the axis-aligned bounding box of the vertices in
+  // the object (model) coordinate frame.
+  const Eigen::Vector3f& bounding_box_min() const;
+  const Eigen::Vector3f& bounding_box_max() const;
+
+  // Returns a counter that changes every time the pose of the model may
+  // have changed. Renderers compare it to skip redrawing unchanged scenes.
+  // The counter is shared by all the models, so no two models, even one
+  // created where another was deleted, have the same version.
+  uint64_t version() const {
+    return version_;
+  }
+
+  // Returns an id that no other model has, even one created where this one
+  // was deleted. Copies of a model share its id.
+  uint64_t id() const {
+    return id_;
+  }
+
   // Returns the VBO id associated to this model.
   const GLuint vertex_buffer_object_id();
   const GLuint vertex_buffer_object_id() const;
@@ -136,20 +200,23 @@ private:
   // Attributes.
   // The convention we will use is to define a '_' after the name
   // of the attribute.
-  // Orientation or pose of the object in the world.
+  // Orientation or pose of the object in the world, as a Rodrigues vector
+  // and as a unit quaternion. The quaternion is not aligned so that models
+  // can be allocated with plain new.
   Eigen::Vector3f orientation_;
+  Eigen::Quaternion<float, Eigen::DontAlign> orientation_quaternion_;
+  // Whether the quaternion is the storage of the orientation, and whether
+  // the other form matches it.
+  bool has_quaternion_orientation_;
+  bool is_converted_orientation_current_;
   // Position of the object in the world.
   Eigen::Vector3f position_;
-  // Vertex matrix.
-  Eigen::MatrixXf vertices_;
-  // Indices for EBO.
-  std::vector<GLuint> indices_;
-  // Vertex buffer object id.
-  GLuint vertex_buffer_object_id_;
-  // Vertex array object id.
-  GLuint vertex_array_object_id_;
-  // Element buffer object id.
-  GLuint element_buffer_object_id_;
+  // Vertices, indices and their buffers in GPU.
+  std::shared_ptr<Mesh> mesh_;
+  // Unique id.
+  uint64_t id_;
+  // Pose version counter.
+  uint64_t version_;
 };
 
 }  // namespace wvu
@@ -0,0 +1,82 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "model_bounds.h"
+
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+
+#include "camera.h"
+#include "math_kernels.h"
+#include "model.h"
+
+namespace wvu {
+
+void ModelBounds::Update(const std::vector<Model*>& models) {
+  models_ = models;
+  const int num_models = size();
+  orientations_.Resize(num_models);
+  positions_.resize(3 * num_models);
+  box_min_.resize(3 * num_models);
+  box_max_.resize(3 * num_models);
+  model_matrices_.resize(16 * num_models);
+  world_min_.resize(3 * num_models);
+  world_max_.resize(3 * num_models);
+  for (int i = 0; i < num_models; ++i) {
+    Model* model = models_[i];
+    // The conversion of a Rodrigues orientation is cached by the model.
+    orientations_.Set(i, model->orientation_quaternion());
+    const Eigen::Vector3f& position = model->position();
+    const Eigen::Vector3f& box_min = model->bounding_box_min();
+    const Eigen::Vector3f& box_max = model->bounding_box_max();
+    for (int axis = 0; axis < 3; ++axis) {
+      positions_[3 * i + axis] = position[axis];
+      box_min_[3 * i + axis] = box_min[axis];
+      box_max_[3 * i + axis] = box_max[axis];
+    }
+  }
+  ComposeTransforms(orientations_, positions_.data(), model_matrices_.data());
+  TransformBoxes(model_matrices_.data(), box_min_.data(), box_max_.data(),
+                 num_models, world_min_.data(), world_max_.data());
+}
+
+void ModelBounds::TestInFrustum(const Camera& camera,
+                                std::vector<uint8_t>* in_frustum) const {
+  in_frustum->resize(size());
+  TestBoxesInFrustum(camera.frustum_planes(), world_min_.data(),
+                     world_max_.data(), size(), in_frustum->data());
+}
+
+}  // namespace wvu
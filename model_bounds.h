@@ -0,0 +1,113 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef MODEL_BOUNDS_H_
+#define MODEL_BOUNDS_H_
+
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+
+#include "quaternion_kernels.h"
+
+namespace wvu {
+class Camera;
+class Model;
+
+// The model matrices and world bounding boxes of a set of models, computed
+// once per frame with the batched math kernels (see math_kernels.h) instead
+// of per model and per test. The matrices are composed from the quaternion
+// orientations of the models, and the world boxes are the axis-aligned boxes
+// enclosing the transformed bounding boxes, so the frustum tests are
+// slightly more conservative than Camera::IsBoxInFrustum().
+//
+// Example:
+//
+// wvu::ModelBounds model_bounds;
+// while (...) {  // Rendering loop.
+//   model_bounds.Update(models_to_draw);
+//   model_bounds.TestInFrustum(camera, &in_frustum);
+//   for (int i = 0; i < model_bounds.size(); ++i) {
+//     if (in_frustum[i]) { ... }
+//   }
+// }
+class ModelBounds {
+ public:
+  // Computes the model matrices and the world boxes of the models, which
+  // must outlive the next Update().
+  void Update(const std::vector<Model*>& models);
+
+  // Tests the world boxes against the view frustum of the camera.
+  // Params:
+  //   camera  The camera.
+  //   in_frustum  Resized to size(); 1 for the boxes that intersect the
+  //     frustum.
+  void TestInFrustum(const Camera& camera,
+                     std::vector<uint8_t>* in_frustum) const;
+
+  // Returns the number of models of the last Update().
+  int size() const {
+    return static_cast<int>(models_.size());
+  }
+
+  Model* model(const int index) const {
+    return models_[index];
+  }
+
+  // Returns the model matrix of a model; the matrices are 16 consecutive
+  // floats each, column-major.
+  Eigen::Map<const Eigen::Matrix4f> model_matrix(const int index) const {
+    return Eigen::Map<const Eigen::Matrix4f>(&model_matrices_[16 * index]);
+  }
+
+  const float* model_matrices() const {
+    return model_matrices_.data();
+  }
+
+ private:
+  std::vector<Model*> models_;
+  // The poses and the object boxes gathered from the models.
+  QuaternionArray orientations_;
+  std::vector<float> positions_;
+  std::vector<float> box_min_;
+  std::vector<float> box_max_;
+  // The results of the kernels.
+  std::vector<float> model_matrices_;
+  std::vector<float> world_min_;
+  std::vector<float> world_max_;
+};
+
+}  // namespace wvu
+
+#endif  // MODEL_BOUNDS_H_
@@ -0,0 +1,295 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "multi_view_renderer.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+
+namespace wvu {
+namespace {
+// Vertex shader shared by every technique. Instance i of a draw renders the
+// view view_indices[i]. The version line and the technique defines are
+// prepended by BuildVertexShaderSource().
+const std::string multi_view_vertex_shader_body =
+    "#if defined(VIEWPORT_INDEX_IN_VERTEX_SHADER)\n"
+    "#extension GL_ARB_shader_viewport_layer_array : require\n"
+    "#endif\n"
+    "layout (location = 0) in vec3 position;\n"
+    "uniform mat4 model;\n"
+    "uniform mat4 view_projections[8];\n"
+    "uniform int view_indices[8];\n"
+    "#if defined(VIEWPORT_INDEX_IN_GEOMETRY_SHADER)\n"
+    "flat out int vertex_view_index;\n"
+    "#endif\n"
+    "\n"
+    "void main() {\n"
+    "int view_index = view_indices[gl_InstanceID];\n"
+    "gl_Position = view_projections[view_index] * model *\n"
+    "    vec4(position, 1.0f);\n"
+    "#if defined(VIEWPORT_INDEX_IN_VERTEX_SHADER)\n"
+    "gl_ViewportIndex = view_index;\n"
+    "#elif defined(VIEWPORT_INDEX_IN_GEOMETRY_SHADER)\n"
+    "vertex_view_index = view_index;\n"
+    "#endif\n"
+    "}\n";
+
+// Pass-through geometry shader that routes every triangle to the viewport of
+// its view.
+const std::string multi_view_geometry_shader_src =
+    "#version 330 core\n"
+    "#extension GL_ARB_viewport_array : require\n"
+    "layout (triangles) in;\n"
+    "layout (triangle_strip, max_vertices = 3) out;\n"
+    "flat in int vertex_view_index[];\n"
+    "\n"
+    "void main() {\n"
+    "for (int i = 0; i < 3; ++i) {\n"
+    "  gl_Position = gl_in[i].gl_Position;\n"
+    "  gl_ViewportIndex = vertex_view_index[0];\n"
+    "  EmitVertex();\n"
+    "}\n"
+    "EndPrimitive();\n"
+    "}\n";
+
+// Same constant color as the default fragment shader of the scene.
+const std::string multi_view_fragment_shader_src =
+    "#version 330 core\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "color = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
+    "}\n";
+
+// Returns the vertex shader source of the technique.
+std::string BuildVertexShaderSource(const MultiViewTechnique technique) {
+  std::string source = "#version 330 core\n";
+  switch (technique) {
+    case MultiViewTechnique::VERTEX_SHADER_VIEWPORT_INDEX:
+      source += "#define VIEWPORT_INDEX_IN_VERTEX_SHADER\n";
+      break;
+    case MultiViewTechnique::GEOMETRY_SHADER_VIEWPORT_INDEX:
+      source += "#define VIEWPORT_INDEX_IN_GEOMETRY_SHADER\n";
+      break;
+    case MultiViewTechnique::PER_VIEW_VIEWPORT:
+      break;
+  }
+  return source + multi_view_vertex_shader_body;
+}
+
+}  // namespace
+
+constexpr int MultiViewRenderer::kMaxViews;
+
+std::string MultiViewTechniqueName(const MultiViewTechnique technique) {
+  switch (technique) {
+    case MultiViewTechnique::VERTEX_SHADER_VIEWPORT_INDEX:
+      return "vertex shader viewport index";
+    case MultiViewTechnique::GEOMETRY_SHADER_VIEWPORT_INDEX:
+      return "geometry shader viewport index";
+    case MultiViewTechnique::PER_VIEW_VIEWPORT:
+      return "per-view viewport";
+  }
+  return "unknown";
+}
+
+MultiViewRenderer::MultiViewRenderer()
+    : technique_(MultiViewTechnique::PER_VIEW_VIEWPORT),
+      model_location_(-1),
+      view_projections_location_(-1),
+      view_indices_location_(-1) {}
+
+bool MultiViewRenderer::Initialize(const bool allow_instancing,
+                                   std::string* error_info_log) {
+  technique_ = MultiViewTechnique::PER_VIEW_VIEWPORT;
+  if (allow_instancing && GLEW_ARB_viewport_array) {
+    technique_ = GLEW_ARB_shader_viewport_layer_array ?
+        MultiViewTechnique::VERTEX_SHADER_VIEWPORT_INDEX :
+        MultiViewTechnique::GEOMETRY_SHADER_VIEWPORT_INDEX;
+  }
+  shader_program_.LoadVertexShaderFromString(
+      BuildVertexShaderSource(technique_));
+  shader_program_.LoadFragmentShaderFromString(multi_view_fragment_shader_src);
+  if (technique_ == MultiViewTechnique::GEOMETRY_SHADER_VIEWPORT_INDEX) {
+    shader_program_.LoadGeometryShaderFromString(
+        multi_view_geometry_shader_src);
+  }
+  if (!shader_program_.Create(error_info_log)) return false;
+  const GLuint program_id = shader_program_.shader_program_id();
+  model_location_ = glGetUniformLocation(program_id, "model");
+  view_projections_location_ =
+      glGetUniformLocation(program_id, "view_projections");
+  view_indices_location_ = glGetUniformLocation(program_id, "view_indices");
+  return true;
+}
+
+void MultiViewRenderer::CullModels(const std::vector<RenderView>& views,
+                                   const std::vector<Model*>& models,
+                                   std::vector<uint8_t>* view_masks) {
+  stats_ = MultiViewStats();
+  const int num_views =
+      std::min(static_cast<int>(views.size()), kMaxViews);
+  stats_.num_views = num_views;
+  view_masks->assign(models.size(), 0);
+  if (num_views == 0) return;
+  // The model matrices and the world boxes are computed once for all the
+  // views.
+  model_bounds_.Update(models);
+  in_view_frustums_.resize(num_views);
+  for (int view = 0; view < num_views; ++view) {
+    model_bounds_.TestInFrustum(*views[view].camera,
+                                &in_view_frustums_[view]);
+  }
+  for (int i = 0; i < static_cast<int>(models.size()); ++i) {
+    uint8_t view_mask = 0;
+    for (int view = 0; view < num_views; ++view) {
+      if (in_view_frustums_[view][i]) {
+        view_mask |= 1 << view;
+        ++stats_.num_visible_model_views;
+      }
+    }
+    (*view_masks)[i] = view_mask;
+    ++stats_.num_models_tested;
+  }
+}
+
+void MultiViewRenderer::Render(const std::vector<RenderView>& views,
+                               const std::vector<Model*>& models) {
+  CullModels(views, models, &view_masks_);
+  const int num_views = stats_.num_views;
+  if (num_views == 0) return;
+
+  shader_program_.Use();
+  // Upload the view-projection matrices of every view at once. The cameras
+  // cache them, so this does not recompute anything.
+  std::vector<GLfloat> view_projections(16 * num_views);
+  for (int view = 0; view < num_views; ++view) {
+    const Eigen::Matrix4f& view_projection =
+        views[view].camera->view_projection_matrix();
+    std::copy(view_projection.data(), view_projection.data() + 16,
+              view_projections.begin() + 16 * view);
+  }
+  glUniformMatrix4fv(view_projections_location_, num_views, GL_FALSE,
+                     view_projections.data());
+
+  GLint saved_viewport[4];
+  glGetIntegerv(GL_VIEWPORT, saved_viewport);
+  GLint saved_scissor_box[4];
+  glGetIntegerv(GL_SCISSOR_BOX, saved_scissor_box);
+  GLint saved_scissor_test = GL_FALSE;
+  glGetIntegerv(GL_SCISSOR_TEST, &saved_scissor_test);
+  const bool instanced =
+      technique_ != MultiViewTechnique::PER_VIEW_VIEWPORT;
+  if (instanced) {
+    // Every view has its own viewport and scissor rectangle, so the instances
+    // cannot draw outside of their view.
+    for (int view = 0; view < num_views; ++view) {
+      const RenderView& render_view = views[view];
+      glViewportIndexedf(view, render_view.x, render_view.y,
+                         render_view.width, render_view.height);
+      glScissorIndexed(view, render_view.x, render_view.y, render_view.width,
+                       render_view.height);
+    }
+    glEnable(GL_SCISSOR_TEST);
+  }
+
+  // The instanced techniques draw every model once for the views that see
+  // it; the fallback collects the models per view.
+  std::vector<std::vector<int> > models_per_view(instanced ? 0 : num_views);
+  std::vector<GLint> view_indices;
+  view_indices.reserve(num_views);
+  for (int i = 0; i < static_cast<int>(models.size()); ++i) {
+    if (view_masks_[i] == 0) continue;
+    view_indices.clear();
+    for (int view = 0; view < num_views; ++view) {
+      if (view_masks_[i] & (1 << view)) {
+        view_indices.push_back(view);
+      }
+    }
+    if (instanced) {
+      DrawModel(*models[i], model_bounds_.model_matrix(i), view_indices);
+    } else {
+      for (const GLint view : view_indices) {
+        models_per_view[view].push_back(i);
+      }
+    }
+  }
+
+  if (!instanced) {
+    for (int view = 0; view < num_views; ++view) {
+      const RenderView& render_view = views[view];
+      glViewport(render_view.x, render_view.y, render_view.width,
+                 render_view.height);
+      view_indices.assign(1, view);
+      for (const int i : models_per_view[view]) {
+        DrawModel(*models[i], model_bounds_.model_matrix(i), view_indices);
+      }
+    }
+  }
+
+  // Restore the state. glViewport() and glScissor() set every viewport and
+  // scissor rectangle of the arrays to the ones of the first index.
+  if (instanced) {
+    glScissor(saved_scissor_box[0], saved_scissor_box[1],
+              saved_scissor_box[2], saved_scissor_box[3]);
+    if (saved_scissor_test == GL_FALSE) {
+      glDisable(GL_SCISSOR_TEST);
+    }
+  }
+  glViewport(saved_viewport[0], saved_viewport[1], saved_viewport[2],
+             saved_viewport[3]);
+  glBindVertexArray(0);
+}
+
+void MultiViewRenderer::DrawModel(const Model& model,
+                                  const Eigen::Matrix4f& model_matrix,
+                                  const std::vector<GLint>& view_indices) {
+  const GLsizei num_instances = static_cast<GLsizei>(view_indices.size());
+  glUniformMatrix4fv(model_location_, 1, GL_FALSE, model_matrix.data());
+  glUniform1iv(view_indices_location_, num_instances, view_indices.data());
+  glBindVertexArray(model.vertex_array_object_id());
+  if (model.num_indices() == 0) {
+    glDrawArraysInstanced(GL_TRIANGLES, 0, model.num_vertices(),
+                          num_instances);
+  } else {
+    glDrawElementsInstanced(GL_TRIANGLES, model.num_indices(),
+                            GL_UNSIGNED_INT, 0, num_instances);
+  }
+  ++stats_.num_draw_calls;
+}
+
+}  // namespace wvu
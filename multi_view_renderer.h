@@ -0,0 +1,178 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef MULTI_VIEW_RENDERER_H_
+#define MULTI_VIEW_RENDERER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "camera.h"
+#include "model.h"
+#include "model_bounds.h"
+#include "shader_program.h"
+
+namespace wvu {
+// A view of the scene: a camera and the rectangle of the framebuffer where it
+// renders, e.g., one half of a split screen or one eye of a stereo pair.
+struct RenderView {
+  // The camera of the view. Not owned.
+  const Camera* camera = nullptr;
+  // Lower left corner and size of the viewport in pixels.
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Ways of submitting the geometry of several views.
+enum class MultiViewTechnique {
+  // One instanced draw per model; the vertex shader writes gl_ViewportIndex.
+  // Requires ARB_shader_viewport_layer_array.
+  VERTEX_SHADER_VIEWPORT_INDEX = 0,
+  // One instanced draw per model; a pass-through geometry shader writes
+  // gl_ViewportIndex. Requires ARB_viewport_array.
+  GEOMETRY_SHADER_VIEWPORT_INDEX = 1,
+  // One draw per model and view, changing glViewport between the views. The
+  // culling still takes a single traversal.
+  PER_VIEW_VIEWPORT = 2
+};
+
+// Statistics of the last rendered frame.
+struct MultiViewStats {
+  // Number of views rendered.
+  int num_views = 0;
+  // Number of models tested against the view frustums.
+  int num_models_tested = 0;
+  // Number of (model, view) pairs that passed the frustum test.
+  int num_visible_model_views = 0;
+  // Number of draw calls issued.
+  int num_draw_calls = 0;
+};
+
+// This class renders the same models from several views per frame. The
+// models are culled against every view frustum in a single traversal: the
+// model matrix is computed once per model, and the views that see the model
+// are collected into a list. With the instanced techniques, each model is
+// then drawn once with one instance per view that sees it, so the CPU cost
+// grows with the number of models rather than with the number of views.
+// The rasterizer clips every instance to its own viewport.
+//
+// Example:
+//
+// wvu::MultiViewRenderer multi_view_renderer;
+// std::string error_info_log;
+// if (!multi_view_renderer.Initialize(true, &error_info_log)) { ... }
+// std::vector<wvu::RenderView> views(2);
+// ...  // Set up the cameras and viewports of the views.
+// while (...) {  // Rendering loop.
+//   ...  // Clear the framebuffer.
+//   multi_view_renderer.Render(views, models);
+// }
+class MultiViewRenderer {
+ public:
+  // Maximum number of views rendered at once. OpenGL guarantees at least 16
+  // viewports with ARB_viewport_array, and the views of a model fit in the
+  // 8 bits of its view mask.
+  static constexpr int kMaxViews = 8;
+
+  MultiViewRenderer();
+
+  // Selects the technique supported by the OpenGL context and compiles its
+  // shaders. Requires a current OpenGL context. Returns true if successful.
+  // Params:
+  //   allow_instancing  If false, uses PER_VIEW_VIEWPORT.
+  //   error_info_log  The shader compilation errors.
+  bool Initialize(const bool allow_instancing, std::string* error_info_log);
+
+  // Renders the models from every view. The framebuffer is not cleared. The
+  // models must have their vertices in the GPU. The viewport and the scissor
+  // state are restored afterwards.
+  // Params:
+  //   views  The views to render, at most kMaxViews.
+  //   models  The models to render.
+  void Render(const std::vector<RenderView>& views,
+              const std::vector<Model*>& models);
+
+  // Culls the models against every view frustum in a single traversal, as
+  // Render() does, and fills the statistics but the draw calls. Does not
+  // need an OpenGL context.
+  // Params:
+  //   views  The views, at most kMaxViews.
+  //   models  The models to cull.
+  //   view_masks  Resized to the number of models. Bit v of the mask of a
+  //     model is set if view v sees the model.
+  void CullModels(const std::vector<RenderView>& views,
+                  const std::vector<Model*>& models,
+                  std::vector<uint8_t>* view_masks);
+
+  // Returns the technique selected by Initialize().
+  MultiViewTechnique technique() const {
+    return technique_;
+  }
+
+  // Returns the statistics of the last frame.
+  const MultiViewStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  // Draws the model once per view listed in view_indices.
+  void DrawModel(const Model& model,
+                 const Eigen::Matrix4f& model_matrix,
+                 const std::vector<GLint>& view_indices);
+
+  MultiViewTechnique technique_;
+  ShaderProgram shader_program_;
+  // Uniform locations.
+  GLint model_location_;
+  GLint view_projections_location_;
+  GLint view_indices_location_;
+  MultiViewStats stats_;
+  // The model matrices and world boxes of the models, computed once for all
+  // the views, and the frustum tests of every view.
+  ModelBounds model_bounds_;
+  std::vector<std::vector<uint8_t> > in_view_frustums_;
+  // The views that see every model, one bit per view.
+  std::vector<uint8_t> view_masks_;
+};
+
+// Returns the name of the technique.
+std::string MultiViewTechniqueName(const MultiViewTechnique technique);
+
+}  // namespace wvu
+
+#endif  // MULTI_VIEW_RENDERER_H_
@@ -0,0 +1,276 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Eigen/Core>
+
+#include "math_kernels.h"
+#include "model.h"
+#include "software_rasterizer.h"
+#include "thread_pool.h"
+
+namespace wvu {
+namespace {
+// Returns the seconds elapsed since start.
+double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+OcclusionCuller::OcclusionCuller(const int width,
+                                 const int height,
+                                 ThreadPool* thread_pool) :
+    rasterizer_(width, height, false, thread_pool), thread_pool_(thread_pool),
+    view_projection_(Eigen::Matrix4f::Identity()) {
+  // Allocate the pyramid down to a single texel.
+  int level_width = width;
+  int level_height = height;
+  while (true) {
+    level_widths_.push_back(level_width);
+    level_heights_.push_back(level_height);
+    depth_levels_.emplace_back(level_width * level_height, 1.0f);
+    if (level_width == 1 && level_height == 1) break;
+    level_width = std::max(1, (level_width + 1) / 2);
+    level_height = std::max(1, (level_height + 1) / 2);
+  }
+}
+
+void OcclusionCuller::AddOccluder(Model* model) {
+  Occluder occluder;
+  occluder.model = model;
+  occluder.use_proxy = false;
+  occluders_.push_back(occluder);
+  occluder_models_.insert(model);
+}
+
+void OcclusionCuller::AddOccluder(Model* model,
+                                  const Eigen::MatrixXf& proxy_vertices,
+                                  const std::vector<GLuint>& proxy_indices) {
+  Occluder occluder;
+  occluder.model = model;
+  occluder.use_proxy = true;
+  occluder.proxy_vertices = proxy_vertices;
+  occluder.proxy_indices = proxy_indices;
+  occluders_.push_back(occluder);
+  occluder_models_.insert(model);
+}
+
+void OcclusionCuller::ClearOccluders() {
+  occluders_.clear();
+  occluder_models_.clear();
+}
+
+void OcclusionCuller::RenderOccluders(const Eigen::Matrix4f& projection,
+                                      const Eigen::Matrix4f& view) {
+  view_projection_ = projection * view;
+  const std::chrono::steady_clock::time_point rasterization_start =
+      std::chrono::steady_clock::now();
+  rasterizer_.Clear();
+  for (Occluder& occluder : occluders_) {
+    const Eigen::Matrix4f model_view_projection =
+        view_projection_ * occluder.model->ComputeModelMatrix();
+    if (occluder.use_proxy) {
+      rasterizer_.AddTriangles(model_view_projection,
+                               occluder.proxy_vertices,
+                               occluder.proxy_indices);
+    } else {
+      rasterizer_.AddTriangles(model_view_projection,
+                               occluder.model->vertices(),
+                               occluder.model->indices());
+    }
+  }
+  rasterizer_.Rasterize();
+  stats_.num_occluder_triangles = rasterizer_.num_triangles();
+  stats_.rasterization_seconds = SecondsSince(rasterization_start);
+
+  const std::chrono::steady_clock::time_point hierarchical_z_start =
+      std::chrono::steady_clock::now();
+  BuildHierarchicalDepth();
+  stats_.hierarchical_z_seconds = SecondsSince(hierarchical_z_start);
+}
+
+void OcclusionCuller::BuildHierarchicalDepth() {
+  // Copy the depth buffer without the row padding.
+  std::vector<float>& level_zero = depth_levels_[0];
+  for (int y = 0; y < level_heights_[0]; ++y) {
+    const float* source_row =
+        &rasterizer_.depth_buffer()[y * rasterizer_.row_stride()];
+    std::copy(source_row, source_row + level_widths_[0],
+              level_zero.begin() + y * level_widths_[0]);
+  }
+  // Every texel keeps the farthest depth of the (up to four) texels below it.
+  for (int level = 1; level < static_cast<int>(depth_levels_.size());
+       ++level) {
+    const std::vector<float>& source = depth_levels_[level - 1];
+    std::vector<float>& destination = depth_levels_[level];
+    const int source_width = level_widths_[level - 1];
+    const int source_height = level_heights_[level - 1];
+    const int width = level_widths_[level];
+    thread_pool_->ParallelFor(0, level_heights_[level], [&](const int y) {
+      const int y0 = 2 * y;
+      const int y1 = std::min(y0 + 1, source_height - 1);
+      for (int x = 0; x < width; ++x) {
+        const int x0 = 2 * x;
+        const int x1 = std::min(x0 + 1, source_width - 1);
+        destination[y * width + x] = std::max(
+            std::max(source[y0 * source_width + x0],
+                     source[y0 * source_width + x1]),
+            std::max(source[y1 * source_width + x0],
+                     source[y1 * source_width + x1]));
+      }
+    });
+  }
+}
+
+float OcclusionCuller::FarthestDepth(const int level,
+                                     const int min_x, const int min_y,
+                                     const int max_x, const int max_y) const {
+  const std::vector<float>& depths = depth_levels_[level];
+  const int width = level_widths_[level];
+  float farthest_depth = 0.0f;
+  for (int y = min_y >> level; y <= (max_y >> level); ++y) {
+    for (int x = min_x >> level; x <= (max_x >> level); ++x) {
+      farthest_depth = std::max(farthest_depth, depths[y * width + x]);
+    }
+  }
+  return farthest_depth;
+}
+
+bool OcclusionCuller::IsOccluded(Model* model) const {
+  return IsBoxOccluded(view_projection_ * model->ComputeModelMatrix(),
+                       model->bounding_box_min(), model->bounding_box_max());
+}
+
+bool OcclusionCuller::IsBoxOccluded(
+    const Eigen::Matrix4f& model_view_projection,
+    const Eigen::Vector3f& box_min,
+    const Eigen::Vector3f& box_max) const {
+  // Project the eight corners of the bounding box.
+  Eigen::Vector3f ndc_min =
+      Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+  Eigen::Vector3f ndc_max =
+      Eigen::Vector3f::Constant(-std::numeric_limits<float>::max());
+  for (int corner = 0; corner < 8; ++corner) {
+    const Eigen::Vector3f point((corner & 1) ? box_max.x() : box_min.x(),
+                                (corner & 2) ? box_max.y() : box_min.y(),
+                                (corner & 4) ? box_max.z() : box_min.z());
+    const Eigen::Vector4f clip = model_view_projection.leftCols<3>() * point +
+        model_view_projection.col(3);
+    // Boxes crossing the near plane are conservatively visible.
+    if (clip.w() < kMinClipW) return false;
+    const Eigen::Vector3f ndc = clip.head<3>() / clip.w();
+    ndc_min = ndc_min.cwiseMin(ndc);
+    ndc_max = ndc_max.cwiseMax(ndc);
+  }
+  // Boxes outside of the screen are left to the frustum culling.
+  if (ndc_max.x() < -1.0f || ndc_min.x() > 1.0f ||
+      ndc_max.y() < -1.0f || ndc_min.y() > 1.0f) {
+    return false;
+  }
+  const int width = level_widths_[0];
+  const int height = level_heights_[0];
+  const int min_x = std::max(
+      0, static_cast<int>(std::floor((ndc_min.x() + 1.0f) * 0.5f * width)));
+  const int max_x = std::min(
+      width - 1,
+      static_cast<int>(std::floor((ndc_max.x() + 1.0f) * 0.5f * width)));
+  const int min_y = std::max(
+      0, static_cast<int>(std::floor((ndc_min.y() + 1.0f) * 0.5f * height)));
+  const int max_y = std::min(
+      height - 1,
+      static_cast<int>(std::floor((ndc_max.y() + 1.0f) * 0.5f * height)));
+  const float nearest_box_depth = (ndc_min.z() + 1.0f) * 0.5f;
+
+  // Pick the level where the rectangle covers about two texels per axis so
+  // that the test reads at most nine texels.
+  const int extent = std::max(max_x - min_x, max_y - min_y) + 1;
+  int level = 0;
+  while ((extent >> level) > 2 &&
+         level + 1 < static_cast<int>(depth_levels_.size())) {
+    ++level;
+  }
+  return nearest_box_depth >
+      FarthestDepth(level, min_x, min_y, max_x, max_y);
+}
+
+void OcclusionCuller::CullModels(const std::vector<Model*>& models,
+                                 std::vector<Model*>* visible_models) {
+  model_matrices_.resize(16 * models.size());
+  for (int i = 0; i < static_cast<int>(models.size()); ++i) {
+    Eigen::Map<Eigen::Matrix4f> model_matrix(&model_matrices_[16 * i]);
+    model_matrix = models[i]->ComputeModelMatrix();
+  }
+  CullModels(models, model_matrices_.data(), visible_models);
+}
+
+void OcclusionCuller::CullModels(const std::vector<Model*>& models,
+                                 const float* model_matrices,
+                                 std::vector<Model*>* visible_models) {
+  const std::chrono::steady_clock::time_point test_start =
+      std::chrono::steady_clock::now();
+  const int num_models = static_cast<int>(models.size());
+  model_view_projections_.resize(16 * num_models);
+  MultiplyMatrices(view_projection_, model_matrices, num_models,
+                   model_view_projections_.data());
+  visible_models->clear();
+  stats_.num_models_tested = 0;
+  stats_.num_models_culled = 0;
+  for (int i = 0; i < num_models; ++i) {
+    Model* model = models[i];
+    if (occluder_models_.count(model) > 0) {
+      visible_models->push_back(model);
+      continue;
+    }
+    ++stats_.num_models_tested;
+    const Eigen::Map<const Eigen::Matrix4f> model_view_projection(
+        &model_view_projections_[16 * i]);
+    if (IsBoxOccluded(model_view_projection, model->bounding_box_min(),
+                      model->bounding_box_max())) {
+      ++stats_.num_models_culled;
+    } else {
+      visible_models->push_back(model);
+    }
+  }
+  stats_.test_seconds = SecondsSince(test_start);
+}
+
+}  // namespace wvu
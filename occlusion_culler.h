@@ -0,0 +1,189 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef OCCLUSION_CULLER_H_
+#define OCCLUSION_CULLER_H_
+
+#include <unordered_set>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "model.h"
+#include "software_rasterizer.h"
+#include "thread_pool.h"
+
+namespace wvu {
+// Statistics of the last culled frame.
+struct OcclusionCullingStats {
+  // Number of occluder triangles rasterized.
+  int num_occluder_triangles = 0;
+  // Number of models tested against the hierarchical depth buffer.
+  int num_models_tested = 0;
+  // Number of models found to be hidden behind the occluders.
+  int num_models_culled = 0;
+  // Time spent rasterizing the occluders.
+  double rasterization_seconds = 0.0;
+  // Time spent building the hierarchical depth buffer.
+  double hierarchical_z_seconds = 0.0;
+  // Time spent testing the model bounds.
+  double test_seconds = 0.0;
+
+  // Returns the percentage of the tested models that were culled.
+  float CulledPercentage() const {
+    if (num_models_tested == 0) return 0.0f;
+    return 100.0f * num_models_culled / num_models_tested;
+  }
+};
+
+// This class culls models hidden behind occluders on the CPU. Every frame, the
+// occluders (a small set of large models, or simplified proxies for them) are
+// rendered by a software rasterizer into a low resolution depth buffer. A
+// hierarchical depth (Hi-Z) pyramid is built from it, where every texel holds
+// the farthest depth of the texels it covers. A model is occluded when the
+// nearest depth of its bounding box is farther than the Hi-Z texels covering
+// its projected bounding box.
+//
+// Example:
+//
+// wvu::OcclusionCuller occlusion_culler(160, 120, &thread_pool);
+// occlusion_culler.AddOccluder(wall_model);
+// while (...) {  // Rendering loop.
+//   occlusion_culler.RenderOccluders(projection, view);
+//   occlusion_culler.CullModels(models_to_draw, &visible_models);
+//   ...
+// }
+class OcclusionCuller {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  // Constructor.
+  // Params:
+  //   width  The width of the occlusion depth buffer.
+  //   height  The height of the occlusion depth buffer.
+  //   thread_pool  The threads used for rasterization. Not owned.
+  OcclusionCuller(const int width, const int height, ThreadPool* thread_pool);
+
+  // Registers a model whose own triangles are rendered as an occluder. The
+  // model is not owned and must outlive this instance.
+  void AddOccluder(Model* model);
+
+  // Registers a model that occludes using a simplified proxy mesh. The proxy
+  // must be contained in the model and be expressed in its object frame.
+  // Params:
+  //   model  The occluder model. Not owned.
+  //   proxy_vertices  The 3xN vertices of the proxy.
+  //   proxy_indices  The triangle list indices of the proxy.
+  void AddOccluder(Model* model,
+                   const Eigen::MatrixXf& proxy_vertices,
+                   const std::vector<GLuint>& proxy_indices);
+
+  // Removes all the occluders.
+  void ClearOccluders();
+
+  // Rasterizes the occluders and builds the hierarchical depth buffer.
+  // Params:
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  void RenderOccluders(const Eigen::Matrix4f& projection,
+                       const Eigen::Matrix4f& view);
+
+  // Returns true if the bounding box of the model is hidden behind the
+  // occluders rendered by the last call to RenderOccluders().
+  bool IsOccluded(Model* model) const;
+
+  // Copies the models that are not occluded into visible_models and updates
+  // the statistics. Occluders are always considered visible.
+  void CullModels(const std::vector<Model*>& models,
+                  std::vector<Model*>* visible_models);
+
+  // Same as above with the model matrices of the models computed already,
+  // e.g., by ModelBounds: 16 floats per model, column-major. The
+  // model-view-projection matrices are computed in a batch.
+  void CullModels(const std::vector<Model*>& models,
+                  const float* model_matrices,
+                  std::vector<Model*>* visible_models);
+
+  // Returns the statistics of the last frame.
+  const OcclusionCullingStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  // An occluder and the mesh to rasterize for it.
+  struct Occluder {
+    Model* model;
+    bool use_proxy;
+    Eigen::MatrixXf proxy_vertices;
+    std::vector<GLuint> proxy_indices;
+  };
+
+  // Returns true if the box is hidden behind the occluders.
+  // Params:
+  //   model_view_projection  The transformation of the box to clip
+  //     coordinates.
+  //   box_min, box_max  The corners of the box in its object frame.
+  bool IsBoxOccluded(const Eigen::Matrix4f& model_view_projection,
+                     const Eigen::Vector3f& box_min,
+                     const Eigen::Vector3f& box_max) const;
+
+  // Builds the Hi-Z pyramid from the rasterized depth buffer.
+  void BuildHierarchicalDepth();
+
+  // Returns the farthest depth of the Hi-Z level texels in the given
+  // inclusive rectangle of level-zero pixels.
+  float FarthestDepth(const int level,
+                      const int min_x, const int min_y,
+                      const int max_x, const int max_y) const;
+
+  SoftwareRasterizer rasterizer_;
+  ThreadPool* thread_pool_;
+  std::vector<Occluder> occluders_;
+  std::unordered_set<const Model*> occluder_models_;
+  // Scratch storage for the model matrices and the model-view-projection
+  // matrices of the models to cull.
+  std::vector<float> model_matrices_;
+  std::vector<float> model_view_projections_;
+  // Hi-Z pyramid. Level zero has the resolution of the rasterizer.
+  std::vector<std::vector<float> > depth_levels_;
+  std::vector<int> level_widths_;
+  std::vector<int> level_heights_;
+  // Projection * view of the last rendered frame.
+  Eigen::Matrix4f view_projection_;
+  OcclusionCullingStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // OCCLUSION_CULLER_H_
@@ -0,0 +1,436 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "quaternion_kernels.h"
+
+#include <cmath>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wvu {
+namespace {
+
+// Terms of the polynomial of the spherical linear interpolation; see
+// D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP". The series
+// of sin(t a) / sin(a) in cos(a) - 1 is truncated after kNumSlerpTerms terms,
+// and the last one is scaled by kSlerpCorrection to make up for the rest.
+constexpr int kNumSlerpTerms = 8;
+constexpr float kSlerpCorrection = 1.85298109240830f;
+
+// The term i multiplies the previous one by (u_i t^2 - v_i) (cos(a) - 1).
+struct SlerpCoefficients {
+  float u[kNumSlerpTerms];
+  float v[kNumSlerpTerms];
+
+  SlerpCoefficients() {
+    for (int i = 1; i <= kNumSlerpTerms; ++i) {
+      const float correction = i == kNumSlerpTerms ? kSlerpCorrection : 1.0f;
+      u[i - 1] = correction / (i * (2.0f * i + 1.0f));
+      v[i - 1] = correction * i / (2.0f * i + 1.0f);
+    }
+  }
+};
+
+const SlerpCoefficients& GetSlerpCoefficients() {
+  static const SlerpCoefficients coefficients;
+  return coefficients;
+}
+
+// Returns sin(t a) / sin(a), where cos_minus_one is cos(a) - 1.
+float SlerpWeight(const float t, const float cos_minus_one) {
+  const SlerpCoefficients& coefficients = GetSlerpCoefficients();
+  const float t_squared = t * t;
+  float weight = 1.0f;
+  for (int i = kNumSlerpTerms - 1; i >= 0; --i) {
+    weight = 1.0f + (coefficients.u[i] * t_squared - coefficients.v[i]) *
+        cos_minus_one * weight;
+  }
+  return t * weight;
+}
+
+// Single-quaternion versions of the kernels, for the remainder of the
+// batches and for the builds without SSE2.
+
+void Normalize(const int i, float* w, float* x, float* y, float* z) {
+  const float inverse_norm =
+      1.0f / std::sqrt(w[i] * w[i] + x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+  w[i] *= inverse_norm;
+  x[i] *= inverse_norm;
+  y[i] *= inverse_norm;
+  z[i] *= inverse_norm;
+}
+
+void Multiply(const int i, const QuaternionArray& lhs,
+              const QuaternionArray& rhs, QuaternionArray* products) {
+  const float lw = lhs.w()[i], lx = lhs.x()[i], ly = lhs.y()[i],
+      lz = lhs.z()[i];
+  const float rw = rhs.w()[i], rx = rhs.x()[i], ry = rhs.y()[i],
+      rz = rhs.z()[i];
+  products->w()[i] = lw * rw - lx * rx - ly * ry - lz * rz;
+  products->x()[i] = lw * rx + lx * rw + ly * rz - lz * ry;
+  products->y()[i] = lw * ry - lx * rz + ly * rw + lz * rx;
+  products->z()[i] = lw * rz + lx * ry - ly * rx + lz * rw;
+}
+
+float Dot(const int i, const QuaternionArray& a, const QuaternionArray& b) {
+  return a.w()[i] * b.w()[i] + a.x()[i] * b.x()[i] + a.y()[i] * b.y()[i] +
+      a.z()[i] * b.z()[i];
+}
+
+// Stores from[i] * from_weight + to[i] * to_weight.
+void Blend(const int i, const QuaternionArray& from, const float from_weight,
+           const QuaternionArray& to, const float to_weight,
+           QuaternionArray* blended) {
+  blended->w()[i] = from.w()[i] * from_weight + to.w()[i] * to_weight;
+  blended->x()[i] = from.x()[i] * from_weight + to.x()[i] * to_weight;
+  blended->y()[i] = from.y()[i] * from_weight + to.y()[i] * to_weight;
+  blended->z()[i] = from.z()[i] * from_weight + to.z()[i] * to_weight;
+}
+
+void Nlerp(const int i, const QuaternionArray& from, const QuaternionArray& to,
+           const float t, QuaternionArray* interpolated) {
+  // q and -q are the same rotation; the shortest path goes to the closest.
+  const float to_weight = Dot(i, from, to) < 0.0f ? -t : t;
+  Blend(i, from, 1.0f - t, to, to_weight, interpolated);
+  Normalize(i, interpolated->w(), interpolated->x(), interpolated->y(),
+            interpolated->z());
+}
+
+void Slerp(const int i, const QuaternionArray& from, const QuaternionArray& to,
+           const float t, QuaternionArray* interpolated) {
+  const float dot = Dot(i, from, to);
+  const float cos_minus_one = std::abs(dot) - 1.0f;
+  const float to_weight = SlerpWeight(t, cos_minus_one);
+  Blend(i, from, SlerpWeight(1.0f - t, cos_minus_one), to,
+        dot < 0.0f ? -to_weight : to_weight, interpolated);
+}
+
+void ConvertToRotationMatrix(const int i, const QuaternionArray& quaternions,
+                             float* matrix) {
+  const float w = quaternions.w()[i], x = quaternions.x()[i],
+      y = quaternions.y()[i], z = quaternions.z()[i];
+  // Column-major.
+  matrix[0] = 1.0f - 2.0f * (y * y + z * z);
+  matrix[1] = 2.0f * (x * y + w * z);
+  matrix[2] = 2.0f * (x * z - w * y);
+  matrix[3] = 0.0f;
+  matrix[4] = 2.0f * (x * y - w * z);
+  matrix[5] = 1.0f - 2.0f * (x * x + z * z);
+  matrix[6] = 2.0f * (y * z + w * x);
+  matrix[7] = 0.0f;
+  matrix[8] = 2.0f * (x * z + w * y);
+  matrix[9] = 2.0f * (y * z - w * x);
+  matrix[10] = 1.0f - 2.0f * (x * x + y * y);
+  matrix[11] = 0.0f;
+  matrix[12] = 0.0f;
+  matrix[13] = 0.0f;
+  matrix[14] = 0.0f;
+  matrix[15] = 1.0f;
+}
+
+#if defined(__SSE2__)
+// Four quaternions, one component per register.
+struct Quaternion4 {
+  __m128 w;
+  __m128 x;
+  __m128 y;
+  __m128 z;
+};
+
+Quaternion4 Load(const int i, const QuaternionArray& quaternions) {
+  Quaternion4 q;
+  q.w = _mm_loadu_ps(quaternions.w() + i);
+  q.x = _mm_loadu_ps(quaternions.x() + i);
+  q.y = _mm_loadu_ps(quaternions.y() + i);
+  q.z = _mm_loadu_ps(quaternions.z() + i);
+  return q;
+}
+
+void Store(const int i, const Quaternion4& q, QuaternionArray* quaternions) {
+  _mm_storeu_ps(quaternions->w() + i, q.w);
+  _mm_storeu_ps(quaternions->x() + i, q.x);
+  _mm_storeu_ps(quaternions->y() + i, q.y);
+  _mm_storeu_ps(quaternions->z() + i, q.z);
+}
+
+__m128 Dot4(const Quaternion4& a, const Quaternion4& b) {
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.w), _mm_mul_ps(a.x, b.x)),
+                    _mm_add_ps(_mm_mul_ps(a.y, b.y), _mm_mul_ps(a.z, b.z)));
+}
+
+// Returns 1 / sqrt(value): the hardware estimate refined by a Newton step,
+// which brings it to almost full precision.
+__m128 InverseSqrt4(const __m128 value) {
+  const __m128 estimate = _mm_rsqrt_ps(value);
+  const __m128 half_value_estimate_squared = _mm_mul_ps(
+      _mm_mul_ps(_mm_set1_ps(0.5f), value), _mm_mul_ps(estimate, estimate));
+  return _mm_mul_ps(estimate,
+                    _mm_sub_ps(_mm_set1_ps(1.5f), half_value_estimate_squared));
+}
+
+Quaternion4 Normalize4(const Quaternion4& q) {
+  const __m128 inverse_norm = InverseSqrt4(Dot4(q, q));
+  Quaternion4 normalized;
+  normalized.w = _mm_mul_ps(q.w, inverse_norm);
+  normalized.x = _mm_mul_ps(q.x, inverse_norm);
+  normalized.y = _mm_mul_ps(q.y, inverse_norm);
+  normalized.z = _mm_mul_ps(q.z, inverse_norm);
+  return normalized;
+}
+
+Quaternion4 Blend4(const Quaternion4& from, const __m128 from_weight,
+                   const Quaternion4& to, const __m128 to_weight) {
+  Quaternion4 blended;
+  blended.w = _mm_add_ps(_mm_mul_ps(from.w, from_weight),
+                         _mm_mul_ps(to.w, to_weight));
+  blended.x = _mm_add_ps(_mm_mul_ps(from.x, from_weight),
+                         _mm_mul_ps(to.x, to_weight));
+  blended.y = _mm_add_ps(_mm_mul_ps(from.y, from_weight),
+                         _mm_mul_ps(to.y, to_weight));
+  blended.z = _mm_add_ps(_mm_mul_ps(from.z, from_weight),
+                         _mm_mul_ps(to.z, to_weight));
+  return blended;
+}
+
+__m128 SlerpWeight4(const float t, const __m128 cos_minus_one) {
+  const SlerpCoefficients& coefficients = GetSlerpCoefficients();
+  const float t_squared = t * t;
+  const __m128 one = _mm_set1_ps(1.0f);
+  __m128 weight = one;
+  for (int i = kNumSlerpTerms - 1; i >= 0; --i) {
+    const __m128 factor = _mm_set1_ps(coefficients.u[i] * t_squared -
+                                      coefficients.v[i]);
+    weight = _mm_add_ps(
+        one, _mm_mul_ps(_mm_mul_ps(factor, cos_minus_one), weight));
+  }
+  return _mm_mul_ps(_mm_set1_ps(t), weight);
+}
+
+// Returns the sign bits of value.
+__m128 SignBits4(const __m128 value) {
+  return _mm_and_ps(value, _mm_set1_ps(-0.0f));
+}
+#endif  // __SSE2__
+
+// Number of quaternions processed four at a time.
+int NumVectorized(const int size) {
+#if defined(__SSE2__)
+  return size & ~3;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace
+
+void QuaternionArray::Resize(const int size) {
+  w_.resize(size, 1.0f);
+  x_.resize(size, 0.0f);
+  y_.resize(size, 0.0f);
+  z_.resize(size, 0.0f);
+}
+
+void QuaternionArray::Set(const int index,
+                          const Eigen::Quaternionf& quaternion) {
+  w_[index] = quaternion.w();
+  x_[index] = quaternion.x();
+  y_[index] = quaternion.y();
+  z_[index] = quaternion.z();
+}
+
+Eigen::Quaternionf QuaternionArray::Get(const int index) const {
+  return Eigen::Quaternionf(w_[index], x_[index], y_[index], z_[index]);
+}
+
+void NormalizeQuaternions(QuaternionArray* quaternions) {
+  const int size = quaternions->size();
+  const int num_vectorized = NumVectorized(size);
+#if defined(__SSE2__)
+  for (int i = 0; i < num_vectorized; i += 4) {
+    Store(i, Normalize4(Load(i, *quaternions)), quaternions);
+  }
+#endif
+  for (int i = num_vectorized; i < size; ++i) {
+    Normalize(i, quaternions->w(), quaternions->x(), quaternions->y(),
+              quaternions->z());
+  }
+}
+
+bool MultiplyQuaternions(const QuaternionArray& lhs,
+                         const QuaternionArray& rhs,
+                         QuaternionArray* products) {
+  if (lhs.size() != rhs.size()) return false;
+  const int size = lhs.size();
+  products->Resize(size);
+  const int num_vectorized = NumVectorized(size);
+#if defined(__SSE2__)
+  for (int i = 0; i < num_vectorized; i += 4) {
+    const Quaternion4 l = Load(i, lhs);
+    const Quaternion4 r = Load(i, rhs);
+    Quaternion4 product;
+    product.w = _mm_sub_ps(
+        _mm_sub_ps(_mm_mul_ps(l.w, r.w), _mm_mul_ps(l.x, r.x)),
+        _mm_add_ps(_mm_mul_ps(l.y, r.y), _mm_mul_ps(l.z, r.z)));
+    product.x = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(l.w, r.x), _mm_mul_ps(l.x, r.w)),
+        _mm_sub_ps(_mm_mul_ps(l.y, r.z), _mm_mul_ps(l.z, r.y)));
+    product.y = _mm_add_ps(
+        _mm_sub_ps(_mm_mul_ps(l.w, r.y), _mm_mul_ps(l.x, r.z)),
+        _mm_add_ps(_mm_mul_ps(l.y, r.w), _mm_mul_ps(l.z, r.x)));
+    product.z = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(l.w, r.z), _mm_mul_ps(l.x, r.y)),
+        _mm_sub_ps(_mm_mul_ps(l.z, r.w), _mm_mul_ps(l.y, r.x)));
+    Store(i, product, products);
+  }
+#endif
+  for (int i = num_vectorized; i < size; ++i) {
+    Multiply(i, lhs, rhs, products);
+  }
+  return true;
+}
+
+bool NlerpQuaternions(const QuaternionArray& from,
+                      const QuaternionArray& to,
+                      const float t,
+                      QuaternionArray* interpolated) {
+  if (from.size() != to.size()) return false;
+  const int size = from.size();
+  interpolated->Resize(size);
+  const int num_vectorized = NumVectorized(size);
+#if defined(__SSE2__)
+  const __m128 from_weight = _mm_set1_ps(1.0f - t);
+  const __m128 to_weight = _mm_set1_ps(t);
+  for (int i = 0; i < num_vectorized; i += 4) {
+    const Quaternion4 q0 = Load(i, from);
+    const Quaternion4 q1 = Load(i, to);
+    // Flip the sign of the weight of the quaternions on the long path.
+    const __m128 signed_to_weight =
+        _mm_xor_ps(to_weight, SignBits4(Dot4(q0, q1)));
+    Store(i, Normalize4(Blend4(q0, from_weight, q1, signed_to_weight)),
+          interpolated);
+  }
+#endif
+  for (int i = num_vectorized; i < size; ++i) {
+    Nlerp(i, from, to, t, interpolated);
+  }
+  return true;
+}
+
+bool SlerpQuaternions(const QuaternionArray& from,
+                      const QuaternionArray& to,
+                      const float t,
+                      QuaternionArray* interpolated) {
+  if (from.size() != to.size()) return false;
+  const int size = from.size();
+  interpolated->Resize(size);
+  const int num_vectorized = NumVectorized(size);
+#if defined(__SSE2__)
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int i = 0; i < num_vectorized; i += 4) {
+    const Quaternion4 q0 = Load(i, from);
+    const Quaternion4 q1 = Load(i, to);
+    const __m128 dot = Dot4(q0, q1);
+    const __m128 sign = SignBits4(dot);
+    const __m128 cos_minus_one = _mm_sub_ps(_mm_xor_ps(dot, sign), one);
+    const __m128 from_weight = SlerpWeight4(1.0f - t, cos_minus_one);
+    const __m128 to_weight =
+        _mm_xor_ps(SlerpWeight4(t, cos_minus_one), sign);
+    Store(i, Blend4(q0, from_weight, q1, to_weight), interpolated);
+  }
+#endif
+  for (int i = num_vectorized; i < size; ++i) {
+    Slerp(i, from, to, t, interpolated);
+  }
+  return true;
+}
+
+void ConvertQuaternionsToRotationMatrices(const QuaternionArray& quaternions,
+                                          float* matrices) {
+  const int size = quaternions.size();
+  const int num_vectorized = NumVectorized(size);
+#if defined(__SSE2__)
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 last_column = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+  for (int i = 0; i < num_vectorized; i += 4) {
+    const Quaternion4 q = Load(i, quaternions);
+    const __m128 xx = _mm_mul_ps(q.x, q.x);
+    const __m128 yy = _mm_mul_ps(q.y, q.y);
+    const __m128 zz = _mm_mul_ps(q.z, q.z);
+    const __m128 xy = _mm_mul_ps(q.x, q.y);
+    const __m128 xz = _mm_mul_ps(q.x, q.z);
+    const __m128 yz = _mm_mul_ps(q.y, q.z);
+    const __m128 wx = _mm_mul_ps(q.w, q.x);
+    const __m128 wy = _mm_mul_ps(q.w, q.y);
+    const __m128 wz = _mm_mul_ps(q.w, q.z);
+    // Entry (row, column) of the four matrices.
+    __m128 m00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+    __m128 m10 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+    __m128 m20 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+    __m128 m01 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+    __m128 m11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+    __m128 m21 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+    __m128 m02 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+    __m128 m12 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+    __m128 m22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+    // Transpose every column from one register per entry to one register
+    // per matrix.
+    __m128 m30 = zero, m31 = zero, m32 = zero;
+    _MM_TRANSPOSE4_PS(m00, m10, m20, m30);
+    _MM_TRANSPOSE4_PS(m01, m11, m21, m31);
+    _MM_TRANSPOSE4_PS(m02, m12, m22, m32);
+    const __m128 columns[4][3] = {
+      {m00, m01, m02}, {m10, m11, m12}, {m20, m21, m22}, {m30, m31, m32}
+    };
+    for (int k = 0; k < 4; ++k) {
+      float* matrix = matrices + 16 * (i + k);
+      _mm_storeu_ps(matrix, columns[k][0]);
+      _mm_storeu_ps(matrix + 4, columns[k][1]);
+      _mm_storeu_ps(matrix + 8, columns[k][2]);
+      _mm_storeu_ps(matrix + 12, last_column);
+    }
+  }
+#endif
+  for (int i = num_vectorized; i < size; ++i) {
+    ConvertToRotationMatrix(i, quaternions, matrices + 16 * i);
+  }
+}
+
+}  // namespace wvu
@@ -0,0 +1,118 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef QUATERNION_KERNELS_H_
+#define QUATERNION_KERNELS_H_
+
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace wvu {
+
+// Quaternions in structure-of-arrays layout, so that the batch kernels below
+// load the same component of four quaternions with a single vector load. The
+// i-th quaternion is w()[i] + x()[i] i + y()[i] j + z()[i] k.
+class QuaternionArray {
+ public:
+  explicit QuaternionArray(const int size = 0) {
+    Resize(size);
+  }
+
+  // Resizes the array; the new quaternions are the identity.
+  void Resize(const int size);
+
+  int size() const {
+    return static_cast<int>(w_.size());
+  }
+
+  void Set(const int index, const Eigen::Quaternionf& quaternion);
+  Eigen::Quaternionf Get(const int index) const;
+
+  float* w() { return w_.data(); }
+  float* x() { return x_.data(); }
+  float* y() { return y_.data(); }
+  float* z() { return z_.data(); }
+  const float* w() const { return w_.data(); }
+  const float* x() const { return x_.data(); }
+  const float* y() const { return y_.data(); }
+  const float* z() const { return z_.data(); }
+
+ private:
+  std::vector<float> w_;
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+};
+
+// Batch kernels over arrays of quaternions, e.g., the orientations of the
+// poses of an animation. They process four quaternions at a time with SSE2
+// when available. The output may be one of the inputs. The kernels of two
+// arrays require inputs of equal size; they return false and leave the
+// output unchanged otherwise.
+
+// Normalizes the quaternions, which must not be zero.
+void NormalizeQuaternions(QuaternionArray* quaternions);
+
+// Computes the products lhs[i] * rhs[i], i.e., the rotation rhs[i] followed
+// by lhs[i].
+bool MultiplyQuaternions(const QuaternionArray& lhs,
+                         const QuaternionArray& rhs,
+                         QuaternionArray* products);
+
+// Interpolates from the unit quaternions from[i] (t = 0) to to[i] (t = 1)
+// along the shortest path. The normalized linear interpolation is cheaper,
+// but its angular velocity is not constant; the spherical linear
+// interpolation approximates sin() with a polynomial, and its coefficients
+// are within 2e-5 of the exact ones.
+bool NlerpQuaternions(const QuaternionArray& from,
+                      const QuaternionArray& to,
+                      const float t,
+                      QuaternionArray* interpolated);
+bool SlerpQuaternions(const QuaternionArray& from,
+                      const QuaternionArray& to,
+                      const float t,
+                      QuaternionArray* interpolated);
+
+// Converts the unit quaternions into 4x4 rotation matrices, stored one after
+// the other in column-major order like Eigen::Matrix4f.
+// Params:
+//   quaternions  The unit quaternions.
+//   matrices  16 floats per quaternion.
+void ConvertQuaternionsToRotationMatrices(const QuaternionArray& quaternions,
+                                          float* matrices);
+
+}  // namespace wvu
+
+#endif  // QUATERNION_KERNELS_H_
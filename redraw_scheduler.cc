@@ -0,0 +1,79 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "redraw_scheduler.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+namespace wvu {
+
+uint64_t ComputeSceneVersion(const std::vector<Model*>& models) {
+  // No two models have the same version, so a hash of the versions in order
+  // changes when a model moves, and when a model is added, removed or
+  // replaced, e.g., by a new model with a version that has not changed yet.
+  // A sum of the versions would miss the new models and could cancel a
+  // removal with a change. The hash is FNV-1a over the versions.
+  uint64_t scene_version = 14695981039346656037ull ^ models.size();
+  for (const Model* model : models) {
+    scene_version = (scene_version ^ model->version()) * 1099511628211ull;
+  }
+  return scene_version;
+}
+
+RedrawScheduler::RedrawScheduler()
+    : dirty_(true),
+      animating_(false),
+      rendered_scene_version_(0),
+      rendered_camera_version_(0),
+      num_frames_rendered_(0),
+      num_frames_skipped_(0) {}
+
+bool RedrawScheduler::NeedsRedraw(const uint64_t scene_version,
+                                  const uint64_t camera_version) const {
+  return dirty_ || animating_ || scene_version != rendered_scene_version_ ||
+      camera_version != rendered_camera_version_;
+}
+
+void RedrawScheduler::FrameRendered(const uint64_t scene_version,
+                                    const uint64_t camera_version) {
+  rendered_scene_version_ = scene_version;
+  rendered_camera_version_ = camera_version;
+  dirty_ = false;
+  ++num_frames_rendered_;
+}
+
+}  // namespace wvu
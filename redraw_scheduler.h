@@ -0,0 +1,118 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef REDRAW_SCHEDULER_H_
+#define REDRAW_SCHEDULER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+namespace wvu {
+// Returns a version of the scene that changes every time the pose of any of
+// the models may have changed, or the list of models changed.
+uint64_t ComputeSceneVersion(const std::vector<Model*>& models);
+
+// Decides when an on-demand renderer has to redraw. A frame is dirty when the
+// scene or camera versions differ from the ones of the last rendered frame,
+// when something invalidated it (e.g., a window event), or while an animation
+// runs. Otherwise the renderer can sleep until the next event.
+//
+// Example:
+//
+// wvu::RedrawScheduler redraw_scheduler;
+// while (...) {  // Rendering loop.
+//   const uint64_t scene_version = wvu::ComputeSceneVersion(models);
+//   if (redraw_scheduler.NeedsRedraw(scene_version, camera.version())) {
+//     ...  // Render and swap the buffers.
+//     redraw_scheduler.FrameRendered(scene_version, camera.version());
+//     glfwPollEvents();
+//   } else {
+//     redraw_scheduler.FrameSkipped();
+//     glfwWaitEventsTimeout(timeout);
+//   }
+// }
+class RedrawScheduler {
+ public:
+  // Constructor. The first frame is always dirty.
+  RedrawScheduler();
+
+  // Marks the next frame as dirty, e.g., after a window event.
+  void Invalidate() {
+    dirty_ = true;
+  }
+
+  // While animating, every frame is dirty.
+  void set_animating(const bool animating) {
+    animating_ = animating;
+  }
+
+  // Returns true if the next frame has to be rendered.
+  // Params:
+  //   scene_version  The current version of the scene.
+  //   camera_version  The current version of the camera.
+  bool NeedsRedraw(const uint64_t scene_version,
+                   const uint64_t camera_version) const;
+
+  // Records the versions of the frame just rendered and clears the dirty
+  // state.
+  void FrameRendered(const uint64_t scene_version,
+                     const uint64_t camera_version);
+
+  // Records a wake-up that did not need to render a frame.
+  void FrameSkipped() {
+    ++num_frames_skipped_;
+  }
+
+  // Returns the number of frames rendered and skipped so far.
+  int num_frames_rendered() const {
+    return num_frames_rendered_;
+  }
+  int num_frames_skipped() const {
+    return num_frames_skipped_;
+  }
+
+ private:
+  bool dirty_;
+  bool animating_;
+  uint64_t rendered_scene_version_;
+  uint64_t rendered_camera_version_;
+  int num_frames_rendered_;
+  int num_frames_skipped_;
+};
+
+}  // namespace wvu
+
+#endif  // REDRAW_SCHEDULER_H_
@@ -0,0 +1,68 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "render_order.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+
+#include "model.h"
+
+namespace wvu {
+void SortModelsFrontToBack(const Eigen::Matrix4f& view,
+                           std::vector<Model*>* models) {
+  // Compute the sorting keys once, since they require the model matrices.
+  std::vector<std::pair<float, Model*> > keyed_models;
+  keyed_models.reserve(models->size());
+  for (Model* model : *models) {
+    const Eigen::Vector3f center =
+        0.5f * (model->bounding_box_min() + model->bounding_box_max());
+    const Eigen::Matrix4f model_view = view * model->ComputeModelMatrix();
+    const Eigen::Vector3f camera_center =
+        model_view.block<3, 3>(0, 0) * center + model_view.block<3, 1>(0, 3);
+    keyed_models.emplace_back(camera_center.squaredNorm(), model);
+  }
+  std::sort(keyed_models.begin(), keyed_models.end(),
+            [](const std::pair<float, Model*>& lhs,
+               const std::pair<float, Model*>& rhs) {
+              return lhs.first < rhs.first;
+            });
+  for (int i = 0; i < static_cast<int>(keyed_models.size()); ++i) {
+    (*models)[i] = keyed_models[i].second;
+  }
+}
+
+}  // namespace wvu
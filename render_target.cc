@@ -0,0 +1,150 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "render_target.h"
+
+#include <cstdint>
+#include <string>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+
+namespace wvu {
+
+RenderTarget::RenderTarget()
+    : width_(0),
+      height_(0),
+      framebuffer_id_(0),
+      color_texture_id_(0),
+      depth_renderbuffer_id_(0) {}
+
+RenderTarget::~RenderTarget() {
+  Release();
+}
+
+bool RenderTarget::Create(const int width,
+                          const int height,
+                          std::string* error_info_log) {
+  Release();
+  width_ = width;
+  height_ = height;
+  // RGBA8 color, and 24-bit depth stored in 32 bits by most drivers.
+  const int64_t attachment_size = static_cast<int64_t>(width) * height * 4;
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  glGenTextures(1, &color_texture_id_);
+  registry->Register(GlObjectType::TEXTURE, color_texture_id_,
+                     "render_target", WVU_GL_CREATION_SITE);
+  registry->SetSize(GlObjectType::TEXTURE, color_texture_id_,
+                    attachment_size);
+  glBindTexture(GL_TEXTURE_2D, color_texture_id_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenRenderbuffers(1, &depth_renderbuffer_id_);
+  registry->Register(GlObjectType::RENDERBUFFER, depth_renderbuffer_id_,
+                     "render_target", WVU_GL_CREATION_SITE);
+  registry->SetSize(GlObjectType::RENDERBUFFER, depth_renderbuffer_id_,
+                    attachment_size);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer_id_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &framebuffer_id_);
+  registry->Register(GlObjectType::FRAMEBUFFER, framebuffer_id_,
+                     "render_target", WVU_GL_CREATION_SITE);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         color_texture_id_, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_renderbuffer_id_);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    if (error_info_log) {
+      *error_info_log = "The render target framebuffer is incomplete.";
+    }
+    Release();
+    return false;
+  }
+  return true;
+}
+
+void RenderTarget::Bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id_);
+  glViewport(0, 0, width_, height_);
+}
+
+void RenderTarget::Bind(const int viewport_width,
+                        const int viewport_height) const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id_);
+  glViewport(0, 0, viewport_width, viewport_height);
+}
+
+void RenderTarget::BlitToFramebuffer(const GLuint framebuffer_id,
+                                     const int width,
+                                     const int height) const {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_id_);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_id);
+  const GLenum filter =
+      (width == width_ && height == height_) ? GL_NEAREST : GL_LINEAR;
+  glBlitFramebuffer(0, 0, width_, height_, 0, 0, width, height,
+                    GL_COLOR_BUFFER_BIT, filter);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::Release() {
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  if (framebuffer_id_ != 0) {
+    registry->Unregister(GlObjectType::FRAMEBUFFER, framebuffer_id_);
+    glDeleteFramebuffers(1, &framebuffer_id_);
+    framebuffer_id_ = 0;
+  }
+  if (color_texture_id_ != 0) {
+    registry->Unregister(GlObjectType::TEXTURE, color_texture_id_);
+    glDeleteTextures(1, &color_texture_id_);
+    color_texture_id_ = 0;
+  }
+  if (depth_renderbuffer_id_ != 0) {
+    registry->Unregister(GlObjectType::RENDERBUFFER, depth_renderbuffer_id_);
+    glDeleteRenderbuffers(1, &depth_renderbuffer_id_);
+    depth_renderbuffer_id_ = 0;
+  }
+}
+
+}  // namespace wvu
@@ -0,0 +1,117 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef RENDER_TARGET_H_
+#define RENDER_TARGET_H_
+
+#include <string>
+#include <GL/glew.h>
+
+namespace wvu {
+// An offscreen framebuffer object with a color texture and a depth buffer.
+// Unlike the back buffer of the window, whose contents are undefined after a
+// swap, the contents of a render target persist across frames, so a frame can
+// redraw part of it and keep the rest.
+//
+// Example:
+//
+// wvu::RenderTarget render_target;
+// std::string error_info_log;
+// if (!render_target.Create(640, 480, &error_info_log)) { ... }
+// while (...) {  // Rendering loop.
+//   render_target.Bind();
+//   ...  // Draw.
+//   render_target.BlitToFramebuffer(0, 640, 480);
+// }
+class RenderTarget {
+ public:
+  RenderTarget();
+
+  // Destructor. Deletes the OpenGL objects.
+  ~RenderTarget();
+
+  // Creates the framebuffer. Requires a current OpenGL context. Returns true
+  // if successful.
+  // Params:
+  //   width  The width of the framebuffer in pixels.
+  //   height  The height of the framebuffer in pixels.
+  //   error_info_log  The reason of the failure.
+  bool Create(const int width, const int height, std::string* error_info_log);
+
+  // Binds the framebuffer for drawing and reading, and sets the viewport to
+  // cover it.
+  void Bind() const;
+
+  // Binds the framebuffer and sets the viewport to its bottom-left region of
+  // the given size, e.g., to render at a lower resolution.
+  void Bind(const int viewport_width, const int viewport_height) const;
+
+  // Copies the color of the render target into another framebuffer, scaling
+  // it to the given size. Leaves the window framebuffer bound.
+  // Params:
+  //   framebuffer_id  The destination framebuffer; zero is the window.
+  //   width  The width of the destination.
+  //   height  The height of the destination.
+  void BlitToFramebuffer(const GLuint framebuffer_id,
+                         const int width,
+                         const int height) const;
+
+  // Getters.
+  GLuint framebuffer_id() const {
+    return framebuffer_id_;
+  }
+  GLuint color_texture_id() const {
+    return color_texture_id_;
+  }
+  int width() const {
+    return width_;
+  }
+  int height() const {
+    return height_;
+  }
+
+ private:
+  // Deletes the OpenGL objects.
+  void Release();
+
+  int width_;
+  int height_;
+  GLuint framebuffer_id_;
+  GLuint color_texture_id_;
+  GLuint depth_renderbuffer_id_;
+};
+
+}  // namespace wvu
+
+#endif  // RENDER_TARGET_H_
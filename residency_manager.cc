@@ -0,0 +1,145 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "residency_manager.h"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "mesh.h"
+#include "mesh_pack.h"
+#include "model.h"
+
+namespace wvu {
+
+ModelResidencyManager::ModelResidencyManager(const int64_t budget_bytes,
+                                             const bool drop_cpu_geometry,
+                                             MeshPack* mesh_pack) :
+    budget_bytes_(budget_bytes),
+    drop_cpu_geometry_(drop_cpu_geometry && mesh_pack != nullptr),
+    mesh_pack_(mesh_pack),
+    resident_bytes_(0),
+    frame_(0) {}
+
+void ModelResidencyManager::AddMesh(Mesh* mesh, const int pack_index) {
+  MeshEntry& entry = entries_[mesh];
+  entry.pack_index = pack_index;
+  entry.last_visible_frame = -1;
+  entry.is_resident = mesh->is_in_gpu();
+  if (entry.is_resident) {
+    entry.lru_position = lru_.insert(lru_.end(), mesh);
+    resident_bytes_ += mesh->gpu_size_in_bytes();
+  }
+}
+
+void ModelResidencyManager::MakeResident(std::vector<Model*>* models) {
+  ++frame_;
+  std::vector<Model*> resident_models;
+  resident_models.reserve(models->size());
+  for (Model* model : *models) {
+    Mesh* mesh = model->mesh().get();
+    auto entry_it = entries_.find(mesh);
+    if (entry_it == entries_.end()) {
+      // Not handled by the manager.
+      if (mesh->is_in_gpu()) resident_models.push_back(model);
+      continue;
+    }
+    MeshEntry& entry = entry_it->second;
+    // Another model with the same mesh was visible already.
+    if (entry.last_visible_frame == frame_) {
+      if (entry.is_resident) resident_models.push_back(model);
+      continue;
+    }
+    entry.last_visible_frame = frame_;
+    if (entry.is_resident) {
+      ++stats_.num_hits;
+      lru_.splice(lru_.begin(), lru_, entry.lru_position);
+    } else {
+      ++stats_.num_misses;
+      if (!Upload(mesh, &entry)) continue;
+    }
+    resident_models.push_back(model);
+  }
+  models->swap(resident_models);
+
+  // Evict from the least recently visible end, but never a visible mesh.
+  while (resident_bytes_ > budget_bytes_ && !lru_.empty()) {
+    Mesh* mesh = lru_.back();
+    MeshEntry& entry = entries_[mesh];
+    if (entry.last_visible_frame == frame_) break;
+    Evict(mesh, &entry);
+  }
+  if (resident_bytes_ > budget_bytes_) ++stats_.num_frames_over_budget;
+}
+
+bool ModelResidencyManager::Upload(Mesh* mesh, MeshEntry* entry) {
+  if (!mesh->has_cpu_geometry()) {
+    if (mesh_pack_ == nullptr || entry->pack_index < 0) return false;
+    Eigen::MatrixXf vertices;
+    std::vector<GLuint> indices;
+    if (!mesh_pack_->Read(entry->pack_index, &vertices, &indices) ||
+        !mesh->RestoreCpuGeometry(vertices, indices)) {
+      return false;
+    }
+    ++stats_.num_pack_reads;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  if (!mesh->SetIntoGpu()) return false;
+  const auto end = std::chrono::steady_clock::now();
+  stats_.upload_seconds += std::chrono::duration<double>(end - start).count();
+  const int64_t size_in_bytes = mesh->gpu_size_in_bytes();
+  stats_.num_bytes_uploaded += size_in_bytes;
+  resident_bytes_ += size_in_bytes;
+  entry->is_resident = true;
+  entry->lru_position = lru_.insert(lru_.begin(), mesh);
+  if (drop_cpu_geometry_ && entry->pack_index >= 0) {
+    mesh->ReleaseCpuGeometry();
+  }
+  return true;
+}
+
+void ModelResidencyManager::Evict(Mesh* mesh, MeshEntry* entry) {
+  resident_bytes_ -= mesh->gpu_size_in_bytes();
+  mesh->ReleaseFromGpu();
+  lru_.erase(entry->lru_position);
+  entry->is_resident = false;
+  ++stats_.num_evictions;
+}
+
+}  // namespace wvu
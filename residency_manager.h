@@ -0,0 +1,161 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef RESIDENCY_MANAGER_H_
+#define RESIDENCY_MANAGER_H_
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace wvu {
+class Mesh;
+class MeshPack;
+class Model;
+
+// Statistics of the residency manager.
+struct ResidencyStats {
+  // Meshes of the visible models whose buffers were in the GPU already.
+  int num_hits = 0;
+  // Meshes of the visible models that had to be uploaded.
+  int num_misses = 0;
+  // Meshes whose buffers were deleted to stay within the budget.
+  int num_evictions = 0;
+  // Meshes read back from the pack because their CPU copy was dropped.
+  int num_pack_reads = 0;
+  // Bytes uploaded to the GPU and the time spent uploading them.
+  int64_t num_bytes_uploaded = 0;
+  double upload_seconds = 0.0;
+  // Frames whose visible models alone did not fit within the budget.
+  int num_frames_over_budget = 0;
+};
+
+// Keeps the GPU buffers of the meshes of the models within a memory budget.
+// The buffers of a mesh are uploaded the first frame a model with the mesh is
+// visible, and the least recently visible meshes are evicted when the budget
+// is exceeded. The meshes visible in the current frame are never evicted, so
+// the budget is exceeded when they do not fit together. A mesh shared by
+// several models is uploaded and counted once.
+//
+// An evicted mesh is uploaded again from its CPU copy of the geometry. If the
+// manager drops the CPU copies, it reads the geometry back from a mesh pack
+// instead, and frees it once uploaded.
+//
+// Example:
+//
+// wvu::ModelResidencyManager residency(256 << 20, true, &mesh_pack);
+// for (int i = 0; i < meshes.size(); ++i) residency.AddMesh(meshes[i], i);
+// while (...) {  // Rendering loop.
+//   std::vector<wvu::Model*> models_to_draw = CullModels(...);
+//   residency.MakeResident(&models_to_draw);
+//   ...  // Draw models_to_draw.
+// }
+class ModelResidencyManager {
+ public:
+  // Params:
+  //   budget_bytes  The bytes the buffers of the meshes may use in the GPU.
+  //   drop_cpu_geometry  Frees the CPU copy of the geometry after an upload.
+  //     Requires a mesh pack.
+  //   mesh_pack  The pack with the geometry of the meshes; may be null when
+  //     the CPU copies are kept.
+  ModelResidencyManager(const int64_t budget_bytes,
+                        const bool drop_cpu_geometry,
+                        MeshPack* mesh_pack);
+
+  // Adds a mesh whose buffers the manager handles. Uploads nothing.
+  // Params:
+  //   mesh  The mesh; it must outlive the manager.
+  //   pack_index  The index of the mesh in the pack, or -1.
+  void AddMesh(Mesh* mesh, const int pack_index);
+
+  // Uploads the meshes of the visible models that are not in the GPU and
+  // evicts the least recently visible ones while over the budget. Removes the
+  // models whose mesh could not be uploaded from the list. The meshes not
+  // added to the manager are left as they are. Must be called with the OpenGL
+  // context current.
+  // Params:
+  //   models  The models visible in the current frame.
+  void MakeResident(std::vector<Model*>* models);
+
+  // Returns the bytes of the resident buffers.
+  int64_t resident_bytes() const {
+    return resident_bytes_;
+  }
+
+  int num_resident_meshes() const {
+    return lru_.size();
+  }
+
+  int64_t budget_bytes() const {
+    return budget_bytes_;
+  }
+
+  const ResidencyStats& stats() const {
+    return stats_;
+  }
+
+  void ResetStats() {
+    stats_ = ResidencyStats();
+  }
+
+ private:
+  struct MeshEntry {
+    int pack_index;
+    // Frame in which a model with the mesh was last visible.
+    int64_t last_visible_frame;
+    // Position in lru_ if resident.
+    std::list<Mesh*>::iterator lru_position;
+    bool is_resident;
+  };
+
+  // Uploads the buffers of a mesh. Returns false if its geometry is not
+  // available.
+  bool Upload(Mesh* mesh, MeshEntry* entry);
+  void Evict(Mesh* mesh, MeshEntry* entry);
+
+  const int64_t budget_bytes_;
+  const bool drop_cpu_geometry_;
+  MeshPack* mesh_pack_;
+  std::unordered_map<Mesh*, MeshEntry> entries_;
+  // Resident meshes, the most recently visible first.
+  std::list<Mesh*> lru_;
+  int64_t resident_bytes_;
+  int64_t frame_;
+  ResidencyStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // RESIDENCY_MANAGER_H_
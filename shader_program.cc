@@ -38,7 +38,9 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <GL/glew.h>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
 
 namespace wvu {
 namespace {
@@ -48,7 +50,8 @@ constexpr int kNumCharsInfoLog = 512;
 // Enumeration to select the shader types.
 enum ShaderType {
   VERTEX = 0,
-  FRAGMENT = 1
+  FRAGMENT = 1,
+  GEOMETRY = 2
 };
 
 // Compiles a shader that is contained in shader_src C++ string. The shader type
@@ -67,6 +70,9 @@ GLuint CompileShader(const std::string& shader_src,
     case FRAGMENT:
       shader_id = glCreateShader(GL_FRAGMENT_SHADER);
       break;
+    case GEOMETRY:
+      shader_id = glCreateShader(GL_GEOMETRY_SHADER);
+      break;
   }
   // Retrieving the pointer to the C string wrapped by shader_src.
   // This is to comply with the signature of glShaderSource() function.
@@ -98,11 +104,13 @@ GLuint CompileShader(const std::string& shader_src,
 }
 
 // Creates a shader program. This function requires the ids of the vertex and
-// fragment shaders which were successfully compiled. The function can return
+// fragment shaders which were successfully compiled. The geometry shader id is
+// zero when the program has no geometry shader. The function can return
 // the error info log string in case of a failure. The function returns the
 // shader program id if successfull, and returns zero otherwise.
 GLuint CreateShaderProgram(const GLuint vertex_shader,
                            const GLuint fragment_shader,
+                           const GLuint geometry_shader,
                            std::string* info_log) {
   // Create a program id.
   const GLuint shader_program = glCreateProgram();
@@ -110,6 +118,10 @@ GLuint CreateShaderProgram(const GLuint vertex_shader,
   glAttachShader(shader_program, vertex_shader);
   // Attach to the program the fragment shader.
   glAttachShader(shader_program, fragment_shader);
+  // Attach to the program the geometry shader, if any.
+  if (geometry_shader != 0) {
+    glAttachShader(shader_program, geometry_shader);
+  }
   // Link the both shaders to get a shader program.
   glLinkProgram(shader_program);
   // Check if the operation was successful.
@@ -125,6 +137,7 @@ GLuint CreateShaderProgram(const GLuint vertex_shader,
       glGetProgramInfoLog(shader_program, kNumCharsInfoLog, nullptr,
                           &info_log->front());
     }
+    glDeleteProgram(shader_program);
     return 0;
   }
   return shader_program;
@@ -133,10 +146,14 @@ GLuint CreateShaderProgram(const GLuint vertex_shader,
 // Releases the resources allocated for compilation of shaders.
 // Clear the shader sources strings.
 void ReleaseShaderResources(const GLuint vertex_shader,
-                            const GLuint fragment_shader) {
+                            const GLuint fragment_shader,
+                            const GLuint geometry_shader) {
   // Delete shaders and set them to 0.
   glDeleteShader(vertex_shader);
   glDeleteShader(fragment_shader);
+  if (geometry_shader != 0) {
+    glDeleteShader(geometry_shader);
+  }
 }
 
 // Loads a shader source from a file. The function receives the filepath
@@ -175,6 +192,12 @@ bool ShaderProgram::LoadFragmentShaderFromString(
   return true;
 }
 
+bool ShaderProgram::LoadGeometryShaderFromString(
+    const std::string& geometry_shader_source) {
+  geometry_shader_src_ = geometry_shader_source;
+  return true;
+}
+
 bool ShaderProgram::LoadVertexShaderFromFile(
     const std::string& vertex_shader_path) {
   return LoadShaderFromFile(vertex_shader_path, &vertex_shader_src_);
@@ -203,6 +226,12 @@ bool ShaderProgram::Create(std::string* error_info_log) {
     }
     return false;
   }
+  if (!BuildGeometryShader(&info_log)) {
+    if (error_info_log) {
+      *error_info_log = info_log;
+    }
+    return false;
+  }
   if (!LinkProgram(&info_log)) {
     if (error_info_log) {
       *error_info_log = info_log;
@@ -210,6 +239,9 @@ bool ShaderProgram::Create(std::string* error_info_log) {
     return false;
   }
   created_ = true;
+  GlResourceRegistry::Instance()->Register(
+      GlObjectType::PROGRAM, shader_program_id_, "shader_program",
+      WVU_GL_CREATION_SITE);
   return true;
 }
 
@@ -223,11 +255,22 @@ bool ShaderProgram::BuildFragmentShader(std::string* info_log) {
   return fragment_shader_ != 0;
 }
 
+bool ShaderProgram::BuildGeometryShader(std::string* info_log) {
+  // The geometry shader is optional.
+  if (geometry_shader_src_.empty()) {
+    geometry_shader_ = 0;
+    return true;
+  }
+  geometry_shader_ = CompileShader(geometry_shader_src_, GEOMETRY, info_log);
+  return geometry_shader_ != 0;
+}
+
 bool ShaderProgram::LinkProgram(std::string* info_log) {
   shader_program_id_ = CreateShaderProgram(vertex_shader_,
                                            fragment_shader_,
+                                           geometry_shader_,
                                            info_log);
-  ReleaseShaderResources(vertex_shader_, fragment_shader_);
+  ReleaseShaderResources(vertex_shader_, fragment_shader_, geometry_shader_);
   return shader_program_id_ != 0;
 }
 
@@ -36,7 +36,9 @@
 #define GLUTILS_SHADER_PROGRAM_H_
 
 #include <string>
-#include <GL/glew.h>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
 
 namespace wvu {
 // This class helps with the compilation of vertex and fragment shaders. The
@@ -96,13 +98,24 @@ class ShaderProgram {
   ShaderProgram() :
       // Initializing member attributes.
       vertex_shader_src_(""), fragment_shader_src_(""),
-      vertex_shader_(0), fragment_shader_(0), shader_program_id_(0),
-      created_(false) {}
+      geometry_shader_src_(""),
+      vertex_shader_(0), fragment_shader_(0), geometry_shader_(0),
+      shader_program_id_(0), created_(false) {}
   // Destructor. Invoked automatically once the instance goes out of scope.
   virtual ~ShaderProgram() {
+    Release();
+  }
+
+  // Deletes the shader program, e.g., before the OpenGL context that owns it
+  // is destroyed.
+  void Release() {
     if (created_) {
       // Once the shader program is not needed, we tell OpenGL to delete it.
+      GlResourceRegistry::Instance()->Unregister(GlObjectType::PROGRAM,
+                                                 shader_program_id_);
       glDeleteProgram(shader_program_id_);
+      shader_program_id_ = 0;
+      created_ = false;
     }
   }
 
@@ -126,6 +139,14 @@ class ShaderProgram {
   //     source.
   bool LoadFragmentShaderFromString(const std::string& fragment_shader_source);
 
+  // Loads an optional geometry shader source code from a string. The geometry
+  // shader runs between the vertex and fragment shaders. Returns true if
+  // successful, and false otherwise.
+  // Parameters:
+  //   geometry_shader_source  The C++ string containing the geometry shader
+  //     source.
+  bool LoadGeometryShaderFromString(const std::string& geometry_shader_source);
+
   // Loads a vertex shader from a file. Returns true if
   // successful, and false otherwise.
   // Parameters:
@@ -143,9 +164,11 @@ class ShaderProgram {
   //    log is copied into error_info_log pointer.
   // 2. Compiles the fragment shader. If an error occurrs, the error information
   //    log is copied into error_info_log pointer.
-  // 3. Links the shaders to form a shader program. If an error occurrs, the
+  // 3. Compiles the geometry shader if one was loaded. If an error occurrs,
+  //    the error information log is copied into error_info_log pointer.
+  // 4. Links the shaders to form a shader program. If an error occurrs, the
   //    error information log is copied into error_info_log pointer.
-  // 4. Cleans up temporary variables.
+  // 5. Cleans up temporary variables.
   // The function returns false when the creation of the program fails, and
   // returns true otherwise.
   //
@@ -169,6 +192,8 @@ class ShaderProgram {
   bool BuildVertexShader(std::string* info_log);
   // Compiles the fragment shader.
   bool BuildFragmentShader(std::string* info_log);
+  // Compiles the geometry shader.
+  bool BuildGeometryShader(std::string* info_log);
   // Links the shaders to form a shader program.
   bool LinkProgram(std::string* info_log);
 
@@ -177,10 +202,14 @@ class ShaderProgram {
   std::string vertex_shader_src_;
   // Fragment shader program source.
   std::string fragment_shader_src_;
+  // Geometry shader program source. Empty when there is no geometry shader.
+  std::string geometry_shader_src_;
   // Vertex shader id.
   GLuint vertex_shader_;
   // Fragment shader id.
   GLuint fragment_shader_;
+  // Geometry shader id. Zero when there is no geometry shader.
+  GLuint geometry_shader_;
   // Program shader id.
   GLuint shader_program_id_;
   // Created state variable. True when this shader program is created, and false
@@ -0,0 +1,367 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "software_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "math_kernels.h"
+#include "thread_pool.h"
+
+namespace wvu {
+namespace {
+// Size of the square screen tiles. Must be a multiple of four so that the SIMD
+// groups of pixels never straddle two tiles.
+constexpr int kTileSize = 32;
+
+// Packs a color with components in [0, 1] into RGBA bytes in memory order.
+uint32_t PackColor(const Eigen::Vector4f& color) {
+  uint32_t packed_color = 0;
+  for (int i = 0; i < 4; ++i) {
+    const float component = std::min(1.0f, std::max(0.0f, color[i]));
+    packed_color |= static_cast<uint32_t>(component * 255.0f + 0.5f) << (8 * i);
+  }
+  return packed_color;
+}
+
+// Rounds up to the next multiple of four.
+inline int RoundUpToMultipleOfFour(const int value) {
+  return (value + 3) & ~3;
+}
+
+// Returns true when the three clip coordinates are outside of the same
+// frustum plane, i.e., the triangle can be trivially rejected.
+bool IsTriviallyOutside(const Eigen::Vector4f& clip0,
+                        const Eigen::Vector4f& clip1,
+                        const Eigen::Vector4f& clip2) {
+  for (int axis = 0; axis < 3; ++axis) {
+    if (clip0[axis] > clip0.w() && clip1[axis] > clip1.w() &&
+        clip2[axis] > clip2.w()) {
+      return true;
+    }
+    if (clip0[axis] < -clip0.w() && clip1[axis] < -clip1.w() &&
+        clip2[axis] < -clip2.w()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+SoftwareRasterizer::SoftwareRasterizer(const int width,
+                                       const int height,
+                                       const bool has_color_buffer,
+                                       ThreadPool* thread_pool) :
+    width_(width), height_(height),
+    row_stride_(RoundUpToMultipleOfFour(width)),
+    num_tiles_x_((width + kTileSize - 1) / kTileSize),
+    num_tiles_y_((height + kTileSize - 1) / kTileSize),
+    thread_pool_(thread_pool),
+    clear_color_(PackColor(Eigen::Vector4f(0.0f, 0.0f, 0.0f, 1.0f))),
+    color_(PackColor(Eigen::Vector4f::Ones())) {
+  depth_buffer_.resize(row_stride_ * height_, 1.0f);
+  if (has_color_buffer) {
+    color_buffer_.resize(row_stride_ * height_, clear_color_);
+  }
+  tile_bins_.resize(num_tiles_x_ * num_tiles_y_);
+}
+
+void SoftwareRasterizer::set_clear_color(const Eigen::Vector4f& clear_color) {
+  clear_color_ = PackColor(clear_color);
+}
+
+void SoftwareRasterizer::set_color(const Eigen::Vector4f& color) {
+  color_ = PackColor(color);
+}
+
+void SoftwareRasterizer::Clear() {
+  std::fill(depth_buffer_.begin(), depth_buffer_.end(), 1.0f);
+  std::fill(color_buffer_.begin(), color_buffer_.end(), clear_color_);
+  triangles_.clear();
+  for (std::vector<int>& bin : tile_bins_) {
+    bin.clear();
+  }
+}
+
+void SoftwareRasterizer::AddTriangles(
+    const Eigen::Matrix4f& model_view_projection,
+    const Eigen::MatrixXf& vertices,
+    const std::vector<GLuint>& indices) {
+  // Transform every vertex once, since indexed meshes share vertices.
+  const int num_vertices = static_cast<int>(vertices.cols());
+  if (num_vertices == 0) return;
+  clip_vertices_.resize(num_vertices);
+  clip_flags_.resize(num_vertices);
+  ProjectVertices(model_view_projection, vertices.data(), num_vertices, false,
+                  clip_vertices_[0].data(), clip_flags_.data(), thread_pool_);
+  if (indices.empty()) {
+    for (int i = 0; i + 2 < num_vertices; i += 3) {
+      AddTriangle(i, i + 1, i + 2);
+    }
+    return;
+  }
+  for (int i = 0; i + 2 < static_cast<int>(indices.size()); i += 3) {
+    AddTriangle(indices[i], indices[i + 1], indices[i + 2]);
+  }
+}
+
+void SoftwareRasterizer::AddTriangle(const int index0,
+                                     const int index1,
+                                     const int index2) {
+  // Skip the clipping of the triangles outside of a frustum plane.
+  if ((clip_flags_[index0] & clip_flags_[index1] & clip_flags_[index2]) != 0) {
+    return;
+  }
+  ClipTriangle(clip_vertices_[index0], clip_vertices_[index1],
+               clip_vertices_[index2]);
+}
+
+void SoftwareRasterizer::ClipTriangle(const Eigen::Vector4f& clip0,
+                                      const Eigen::Vector4f& clip1,
+                                      const Eigen::Vector4f& clip2) {
+  // Signed distances to the near plane (z = -w in clip coordinates).
+  const Eigen::Vector4f* input[3] = { &clip0, &clip1, &clip2 };
+  const float distances[3] = {
+    clip0.z() + clip0.w(), clip1.z() + clip1.w(), clip2.z() + clip2.w()
+  };
+  if (distances[0] >= 0.0f && distances[1] >= 0.0f && distances[2] >= 0.0f) {
+    SetUpTriangle(clip0, clip1, clip2);
+    return;
+  }
+  // Sutherland-Hodgman against a single plane: a triangle becomes at most a
+  // quadrilateral.
+  Eigen::Vector4f polygon[4];
+  int num_vertices = 0;
+  for (int i = 0; i < 3; ++i) {
+    const int j = (i + 1) % 3;
+    if (distances[i] >= 0.0f) {
+      polygon[num_vertices++] = *input[i];
+    }
+    if ((distances[i] >= 0.0f) != (distances[j] >= 0.0f)) {
+      const float t = distances[i] / (distances[i] - distances[j]);
+      polygon[num_vertices++] = *input[i] + t * (*input[j] - *input[i]);
+    }
+  }
+  for (int i = 1; i + 1 < num_vertices; ++i) {
+    SetUpTriangle(polygon[0], polygon[i], polygon[i + 1]);
+  }
+}
+
+void SoftwareRasterizer::SetUpTriangle(const Eigen::Vector4f& clip0,
+                                       const Eigen::Vector4f& clip1,
+                                       const Eigen::Vector4f& clip2) {
+  if (clip0.w() < kMinClipW || clip1.w() < kMinClipW ||
+      clip2.w() < kMinClipW) {
+    return;
+  }
+  if (IsTriviallyOutside(clip0, clip1, clip2)) return;
+
+  // Perspective divide and viewport transformation.
+  const Eigen::Vector4f* clip[3] = { &clip0, &clip1, &clip2 };
+  Eigen::Vector3f screen[3];
+  for (int i = 0; i < 3; ++i) {
+    const float inverse_w = 1.0f / clip[i]->w();
+    screen[i].x() = (clip[i]->x() * inverse_w + 1.0f) * 0.5f * width_;
+    screen[i].y() = (clip[i]->y() * inverse_w + 1.0f) * 0.5f * height_;
+    screen[i].z() = (clip[i]->z() * inverse_w + 1.0f) * 0.5f;
+  }
+
+  // Make the triangle counter-clockwise so that inside pixels have positive
+  // edge functions.
+  float area = (screen[1].x() - screen[0].x()) * (screen[2].y() - screen[0].y())
+      - (screen[1].y() - screen[0].y()) * (screen[2].x() - screen[0].x());
+  if (area < 0.0f) {
+    std::swap(screen[1], screen[2]);
+    area = -area;
+  }
+  if (area < 1e-8f) return;
+
+  ScreenTriangle triangle;
+  triangle.color = color_;
+  // Bounding box clamped to the screen.
+  const float min_x = std::min(screen[0].x(),
+                               std::min(screen[1].x(), screen[2].x()));
+  const float max_x = std::max(screen[0].x(),
+                               std::max(screen[1].x(), screen[2].x()));
+  const float min_y = std::min(screen[0].y(),
+                               std::min(screen[1].y(), screen[2].y()));
+  const float max_y = std::max(screen[0].y(),
+                               std::max(screen[1].y(), screen[2].y()));
+  triangle.min_x = std::max(0, static_cast<int>(std::floor(min_x)));
+  triangle.max_x = std::min(width_ - 1, static_cast<int>(std::floor(max_x)));
+  triangle.min_y = std::max(0, static_cast<int>(std::floor(min_y)));
+  triangle.max_y = std::min(height_ - 1, static_cast<int>(std::floor(max_y)));
+  if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+    return;
+  }
+
+  // Edge function of the edge opposite to the vertex i. For the edge (a, b):
+  // E(p) = (a.y - b.y) * p.x + (b.x - a.x) * p.y + (a.x * b.y - a.y * b.x).
+  for (int i = 0; i < 3; ++i) {
+    const Eigen::Vector3f& a = screen[(i + 1) % 3];
+    const Eigen::Vector3f& b = screen[(i + 2) % 3];
+    triangle.edge_a[i] = a.y() - b.y();
+    triangle.edge_b[i] = b.x() - a.x();
+    triangle.edge_c[i] = a.x() * b.y() - a.y() * b.x();
+  }
+  // The normalized edge functions are the barycentric coordinates, so the
+  // depth is a plane in screen space.
+  const float inverse_area = 1.0f / area;
+  triangle.depth_a = triangle.depth_b = triangle.depth_c = 0.0f;
+  for (int i = 0; i < 3; ++i) {
+    const float weight = screen[i].z() * inverse_area;
+    triangle.depth_a += weight * triangle.edge_a[i];
+    triangle.depth_b += weight * triangle.edge_b[i];
+    triangle.depth_c += weight * triangle.edge_c[i];
+  }
+
+  // Bin the triangle into every tile its bounding box overlaps.
+  const int triangle_index = static_cast<int>(triangles_.size());
+  triangles_.push_back(triangle);
+  for (int tile_y = triangle.min_y / kTileSize;
+       tile_y <= triangle.max_y / kTileSize; ++tile_y) {
+    for (int tile_x = triangle.min_x / kTileSize;
+         tile_x <= triangle.max_x / kTileSize; ++tile_x) {
+      tile_bins_[tile_y * num_tiles_x_ + tile_x].push_back(triangle_index);
+    }
+  }
+}
+
+void SoftwareRasterizer::Rasterize() {
+  thread_pool_->ParallelFor(0, num_tiles_x_ * num_tiles_y_,
+                            [this](const int tile_index) {
+    RasterizeTile(tile_index);
+  });
+}
+
+void SoftwareRasterizer::RasterizeTile(const int tile_index) {
+  const int tile_x0 = (tile_index % num_tiles_x_) * kTileSize;
+  const int tile_y0 = (tile_index / num_tiles_x_) * kTileSize;
+  const int tile_x1 = std::min(tile_x0 + kTileSize, width_) - 1;
+  const int tile_y1 = std::min(tile_y0 + kTileSize, height_) - 1;
+  for (const int triangle_index : tile_bins_[tile_index]) {
+    const ScreenTriangle& triangle = triangles_[triangle_index];
+    // Start at a multiple of four. Since the tiles start at multiples of four
+    // and rows are padded, the groups of four pixels stay inside the tile.
+    const int x0 = std::max(triangle.min_x, tile_x0) & ~3;
+    const int x1 = std::min(triangle.max_x, tile_x1);
+    const int y0 = std::max(triangle.min_y, tile_y0);
+    const int y1 = std::min(triangle.max_y, tile_y1);
+#if defined(__SSE2__)
+    const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 edge_a0 = _mm_set1_ps(triangle.edge_a[0]);
+    const __m128 edge_a1 = _mm_set1_ps(triangle.edge_a[1]);
+    const __m128 edge_a2 = _mm_set1_ps(triangle.edge_a[2]);
+    const __m128 depth_a = _mm_set1_ps(triangle.depth_a);
+    const __m128i color = _mm_set1_epi32(static_cast<int>(triangle.color));
+#endif
+    const bool write_color = !color_buffer_.empty();
+    for (int y = y0; y <= y1; ++y) {
+      const float pixel_y = y + 0.5f;
+      const float edge_row0 = triangle.edge_b[0] * pixel_y + triangle.edge_c[0];
+      const float edge_row1 = triangle.edge_b[1] * pixel_y + triangle.edge_c[1];
+      const float edge_row2 = triangle.edge_b[2] * pixel_y + triangle.edge_c[2];
+      const float depth_row = triangle.depth_b * pixel_y + triangle.depth_c;
+      float* depth_row_ptr = &depth_buffer_[y * row_stride_];
+      uint32_t* color_row_ptr =
+          write_color ? &color_buffer_[y * row_stride_] : nullptr;
+#if defined(__SSE2__)
+      const __m128 edge_row0_4 = _mm_set1_ps(edge_row0);
+      const __m128 edge_row1_4 = _mm_set1_ps(edge_row1);
+      const __m128 edge_row2_4 = _mm_set1_ps(edge_row2);
+      const __m128 depth_row_4 = _mm_set1_ps(depth_row);
+      for (int x = x0; x <= x1; x += 4) {
+        const __m128 pixel_x =
+            _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane_offsets);
+        const __m128 edge0 =
+            _mm_add_ps(_mm_mul_ps(edge_a0, pixel_x), edge_row0_4);
+        const __m128 edge1 =
+            _mm_add_ps(_mm_mul_ps(edge_a1, pixel_x), edge_row1_4);
+        const __m128 edge2 =
+            _mm_add_ps(_mm_mul_ps(edge_a2, pixel_x), edge_row2_4);
+        const __m128 inside =
+            _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero),
+                                  _mm_cmpge_ps(edge1, zero)),
+                       _mm_cmpge_ps(edge2, zero));
+        if (_mm_movemask_ps(inside) == 0) continue;
+        const __m128 depth =
+            _mm_add_ps(_mm_mul_ps(depth_a, pixel_x), depth_row_4);
+        const __m128 old_depth = _mm_loadu_ps(depth_row_ptr + x);
+        const __m128 closer =
+            _mm_and_ps(inside, _mm_cmplt_ps(depth, old_depth));
+        _mm_storeu_ps(depth_row_ptr + x,
+                      _mm_or_ps(_mm_and_ps(closer, depth),
+                                _mm_andnot_ps(closer, old_depth)));
+        if (write_color) {
+          __m128i* color_ptr =
+              reinterpret_cast<__m128i*>(color_row_ptr + x);
+          const __m128i closer_mask = _mm_castps_si128(closer);
+          const __m128i old_color = _mm_loadu_si128(color_ptr);
+          _mm_storeu_si128(color_ptr,
+                           _mm_or_si128(_mm_and_si128(closer_mask, color),
+                                        _mm_andnot_si128(closer_mask,
+                                                         old_color)));
+        }
+      }
+#else
+      for (int x = x0; x <= x1; ++x) {
+        const float pixel_x = x + 0.5f;
+        if (triangle.edge_a[0] * pixel_x + edge_row0 < 0.0f ||
+            triangle.edge_a[1] * pixel_x + edge_row1 < 0.0f ||
+            triangle.edge_a[2] * pixel_x + edge_row2 < 0.0f) {
+          continue;
+        }
+        const float depth = triangle.depth_a * pixel_x + depth_row;
+        if (depth < depth_row_ptr[x]) {
+          depth_row_ptr[x] = depth;
+          if (write_color) {
+            color_row_ptr[x] = triangle.color;
+          }
+        }
+      }
+#endif
+    }
+  }
+}
+
+}  // namespace wvu
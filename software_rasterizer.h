@@ -0,0 +1,202 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef SOFTWARE_RASTERIZER_H_
+#define SOFTWARE_RASTERIZER_H_
+
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "thread_pool.h"
+
+namespace wvu {
+// A tiled, multithreaded triangle rasterizer that runs on the CPU and writes
+// into a depth buffer and, optionally, a color buffer. Triangles are
+// transformed, clipped against the near plane and binned into screen tiles by
+// AddTriangles(), and Rasterize() processes the tiles in parallel (every tile
+// is owned by a single thread, so no synchronization is needed). Within a
+// tile, triangles are processed in submission order. Pixels are processed in
+// groups of four using SSE when available.
+//
+// The buffers follow the OpenGL conventions: the row zero is the bottom row
+// of the screen and depth values go from 0 (near plane) to 1 (far plane).
+// Colors are stored as RGBA bytes in memory order.
+//
+// Example:
+//
+// wvu::SoftwareRasterizer rasterizer(160, 120, false, &thread_pool);
+// rasterizer.Clear();
+// rasterizer.AddTriangles(projection * view * model_matrix,
+//                         model->vertices(), model->indices());
+// rasterizer.Rasterize();
+// const float depth = rasterizer.depth(x, y);
+class SoftwareRasterizer {
+ public:
+  // Constructor.
+  // Params:
+  //   width  The width of the depth buffer in pixels.
+  //   height  The height of the depth buffer in pixels.
+  //   has_color_buffer  True to also rasterize colors.
+  //   thread_pool  The threads used to rasterize. Not owned.
+  SoftwareRasterizer(const int width,
+                     const int height,
+                     const bool has_color_buffer,
+                     ThreadPool* thread_pool);
+
+  // Clears the depth buffer to the far plane, the color buffer to the clear
+  // color and discards binned triangles.
+  void Clear();
+
+  // Sets the color used by Clear(). Components are in [0, 1].
+  void set_clear_color(const Eigen::Vector4f& clear_color);
+
+  // Sets the color of the triangles added from now on. Components are in
+  // [0, 1].
+  void set_color(const Eigen::Vector4f& color);
+
+  // Transforms the triangles of a mesh into screen space, clips them against
+  // the near plane and bins them.
+  // Params:
+  //   model_view_projection  Transformation from object to clip coordinates.
+  //   vertices  The 3xN vertex matrix of the mesh.
+  //   indices  Triangle list indices. When empty, every three consecutive
+  //     vertices form a triangle.
+  void AddTriangles(const Eigen::Matrix4f& model_view_projection,
+                    const Eigen::MatrixXf& vertices,
+                    const std::vector<GLuint>& indices);
+
+  // Rasterizes all the binned triangles into the depth buffer.
+  void Rasterize();
+
+  // Returns the depth of the pixel at (x, y).
+  float depth(const int x, const int y) const {
+    return depth_buffer_[y * row_stride_ + x];
+  }
+
+  // Returns the depth buffer. Rows are row_stride() floats apart.
+  const std::vector<float>& depth_buffer() const {
+    return depth_buffer_;
+  }
+
+  // Returns the color buffer. Rows are row_stride() pixels apart. Empty if the
+  // rasterizer has no color buffer.
+  const std::vector<uint32_t>& color_buffer() const {
+    return color_buffer_;
+  }
+
+  int row_stride() const {
+    return row_stride_;
+  }
+
+  int width() const {
+    return width_;
+  }
+
+  int height() const {
+    return height_;
+  }
+
+  // Returns the number of triangles binned since the last Clear().
+  int num_triangles() const {
+    return static_cast<int>(triangles_.size());
+  }
+
+ private:
+  // A triangle in screen space set up for rasterization. The edge functions
+  // and the depth are planes of the form a * x + b * y + c.
+  struct ScreenTriangle {
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float depth_a;
+    float depth_b;
+    float depth_c;
+    uint32_t color;
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+  };
+
+  // Clips and sets up the triangle of the transformed vertices of the mesh
+  // being added, unless it is entirely outside of a frustum plane.
+  void AddTriangle(const int index0, const int index1, const int index2);
+
+  // Clips a triangle in clip coordinates against the near plane and sets up
+  // the resulting triangles.
+  void ClipTriangle(const Eigen::Vector4f& clip0,
+                    const Eigen::Vector4f& clip1,
+                    const Eigen::Vector4f& clip2);
+
+  // Sets up a triangle in front of the near plane and bins it into the tiles.
+  void SetUpTriangle(const Eigen::Vector4f& clip0,
+                     const Eigen::Vector4f& clip1,
+                     const Eigen::Vector4f& clip2);
+
+  // Rasterizes the triangles binned into a tile.
+  void RasterizeTile(const int tile_index);
+
+  // Dimensions of the buffer.
+  const int width_;
+  const int height_;
+  // Rows are padded to a multiple of four pixels for SIMD access.
+  const int row_stride_;
+  // Number of tiles along each axis.
+  const int num_tiles_x_;
+  const int num_tiles_y_;
+  // Worker threads. Not owned.
+  ThreadPool* thread_pool_;
+  // Depth buffer.
+  std::vector<float> depth_buffer_;
+  // Color buffer. Empty when colors are not rasterized.
+  std::vector<uint32_t> color_buffer_;
+  // Packed clear color and current triangle color.
+  uint32_t clear_color_;
+  uint32_t color_;
+  // Triangles ready for rasterization.
+  std::vector<ScreenTriangle> triangles_;
+  // Indices of the triangles overlapping each tile.
+  std::vector<std::vector<int> > tile_bins_;
+  // Scratch storage for the transformed vertices.
+  std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> >
+      clip_vertices_;
+  // The ClipFlag bits of the transformed vertices.
+  std::vector<uint8_t> clip_flags_;
+};
+
+}  // namespace wvu
+
+#endif  // SOFTWARE_RASTERIZER_H_
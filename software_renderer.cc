@@ -0,0 +1,152 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "software_renderer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "image_writer.h"
+#include "model.h"
+#include "software_rasterizer.h"
+
+namespace wvu {
+namespace {
+// Returns the seconds elapsed since start.
+double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+SoftwareRenderer::SoftwareRenderer(const int width,
+                                   const int height,
+                                   ThreadPool* thread_pool) :
+    rasterizer_(width, height, true, thread_pool), texture_id_(0),
+    framebuffer_id_(0) {
+  // Same color as the default fragment shader.
+  rasterizer_.set_color(Eigen::Vector4f(1.0f, 0.5f, 0.2f, 1.0f));
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  if (framebuffer_id_ != 0) {
+    registry->Unregister(GlObjectType::FRAMEBUFFER, framebuffer_id_);
+    glDeleteFramebuffers(1, &framebuffer_id_);
+  }
+  if (texture_id_ != 0) {
+    registry->Unregister(GlObjectType::TEXTURE, texture_id_);
+    glDeleteTextures(1, &texture_id_);
+  }
+}
+
+void SoftwareRenderer::BeginFrame() {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  rasterizer_.Clear();
+  stats_.setup_seconds = SecondsSince(start);
+}
+
+void SoftwareRenderer::Draw(Model* model,
+                            const Eigen::Matrix4f& projection,
+                            const Eigen::Matrix4f& view) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  rasterizer_.AddTriangles(projection * view * model->ComputeModelMatrix(),
+                           model->vertices(), model->indices());
+  stats_.setup_seconds += SecondsSince(start);
+}
+
+void SoftwareRenderer::EndFrame() {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  rasterizer_.Rasterize();
+  stats_.rasterization_seconds = SecondsSince(start);
+  stats_.num_triangles = rasterizer_.num_triangles();
+}
+
+bool SoftwareRenderer::SaveFrameAsPpm(const std::string& filepath) const {
+  return WritePpm(filepath, rasterizer_.width(), rasterizer_.height(),
+                  rasterizer_.row_stride(), rasterizer_.color_buffer().data(),
+                  true);
+}
+
+void SoftwareRenderer::BlitToFramebuffer(const GLuint framebuffer_id,
+                                         const int width,
+                                         const int height) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (texture_id_ == 0) {
+    GlResourceRegistry* registry = GlResourceRegistry::Instance();
+    glGenTextures(1, &texture_id_);
+    registry->Register(GlObjectType::TEXTURE, texture_id_, "software_renderer",
+                       WVU_GL_CREATION_SITE);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, rasterizer_.width(),
+                 rasterizer_.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    registry->SetSize(GlObjectType::TEXTURE, texture_id_,
+                      4 * static_cast<int64_t>(rasterizer_.width()) *
+                          rasterizer_.height());
+    glGenFramebuffers(1, &framebuffer_id_);
+    registry->Register(GlObjectType::FRAMEBUFFER, framebuffer_id_,
+                       "software_renderer", WVU_GL_CREATION_SITE);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_id_);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, texture_id_, 0);
+  }
+  // Upload the color buffer. Its rows are padded to the row stride.
+  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, rasterizer_.row_stride());
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, rasterizer_.width(),
+                  rasterizer_.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                  rasterizer_.color_buffer().data());
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // Both buffers are bottom-up, so no flip is needed.
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_id_);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_id);
+  glBlitFramebuffer(0, 0, rasterizer_.width(), rasterizer_.height(),
+                    0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  stats_.blit_seconds = SecondsSince(start);
+}
+
+}  // namespace wvu
@@ -0,0 +1,143 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef SOFTWARE_RENDERER_H_
+#define SOFTWARE_RENDERER_H_
+
+#include <string>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "model.h"
+#include "software_rasterizer.h"
+#include "thread_pool.h"
+
+namespace wvu {
+// Statistics of the last rendered frame.
+struct SoftwareRendererStats {
+  // Number of triangles that reached the rasterizer after clipping.
+  int num_triangles = 0;
+  // Time spent transforming, clipping and binning the triangles.
+  double setup_seconds = 0.0;
+  // Time spent rasterizing the tiles.
+  double rasterization_seconds = 0.0;
+  // Time spent copying the frame to an OpenGL framebuffer.
+  double blit_seconds = 0.0;
+};
+
+// A render backend that draws the models on the CPU. It consumes the same
+// vertices, indices, model, view and projection matrices as Model::Draw(),
+// and shades every fragment with a constant color like the default fragment
+// shader. The frame can be saved to disk, or blitted to an OpenGL framebuffer
+// when a context is available. No OpenGL context is needed otherwise, so it
+// runs on machines without a GPU.
+//
+// Example:
+//
+// wvu::SoftwareRenderer renderer(640, 480, &thread_pool);
+// while (...) {  // Rendering loop.
+//   renderer.BeginFrame();
+//   for (Model* model : models) {
+//     renderer.Draw(model, projection, view);
+//   }
+//   renderer.EndFrame();
+//   renderer.BlitToFramebuffer(0, window_width, window_height);
+// }
+// renderer.SaveFrameAsPpm("/tmp/frame.ppm");
+class SoftwareRenderer {
+ public:
+  // Constructor.
+  // Params:
+  //   width  The width of the framebuffer in pixels.
+  //   height  The height of the framebuffer in pixels.
+  //   thread_pool  The threads used to rasterize. Not owned.
+  SoftwareRenderer(const int width, const int height, ThreadPool* thread_pool);
+
+  // Destructor. Releases the OpenGL objects used by BlitToFramebuffer().
+  ~SoftwareRenderer();
+
+  // Clears the framebuffer.
+  void BeginFrame();
+
+  // Draws a model. Follows the contract of Model::Draw().
+  // Params:
+  //   model  The model to draw. Its vertices do not need to be in the GPU.
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  void Draw(Model* model,
+            const Eigen::Matrix4f& projection,
+            const Eigen::Matrix4f& view);
+
+  // Rasterizes the models drawn since BeginFrame().
+  void EndFrame();
+
+  // Saves the last frame into a PPM file. Returns true if successful.
+  bool SaveFrameAsPpm(const std::string& filepath) const;
+
+  // Copies the last frame into an OpenGL framebuffer, scaling it to the given
+  // size. Requires a current OpenGL context.
+  // Params:
+  //   framebuffer_id  The destination framebuffer; zero is the window.
+  //   width  The width of the destination.
+  //   height  The height of the destination.
+  void BlitToFramebuffer(const GLuint framebuffer_id,
+                         const int width,
+                         const int height);
+
+  // Sets the color of the models drawn from now on. Components are in [0, 1].
+  void set_color(const Eigen::Vector4f& color) {
+    rasterizer_.set_color(color);
+  }
+
+  // Returns the rasterizer, whose buffers hold the last frame.
+  const SoftwareRasterizer& rasterizer() const {
+    return rasterizer_;
+  }
+
+  // Returns the statistics of the last frame.
+  const SoftwareRendererStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  SoftwareRasterizer rasterizer_;
+  // Texture and framebuffer used to blit the frame. Created on first use.
+  GLuint texture_id_;
+  GLuint framebuffer_id_;
+  SoftwareRendererStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // SOFTWARE_RENDERER_H_
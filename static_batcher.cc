@@ -0,0 +1,268 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "static_batcher.h"
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+
+#include "camera.h"
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "math_kernels.h"
+#include "model.h"
+#include "shader_program.h"
+#include "thread_pool.h"
+
+namespace wvu {
+namespace {
+
+// The part of a chunk rebuilt by a model.
+struct TransformJob {
+  int chunk_index;
+  Model* model;
+  int first_vertex;
+  int first_index;
+};
+
+}  // namespace
+
+StaticBatcher::StaticBatcher(const float chunk_size, ThreadPool* thread_pool) :
+    chunk_size_(chunk_size), thread_pool_(thread_pool) {}
+
+StaticBatcher::~StaticBatcher() {
+  for (auto& key_and_chunk : chunks_) {
+    DeleteBuffers(&key_and_chunk.second);
+  }
+}
+
+StaticBatcher::ChunkKey StaticBatcher::ComputeChunkKey(
+    Model* model, const int batch_key) const {
+  const Eigen::Vector3f& position = model->position();
+  return ChunkKey(batch_key,
+                  static_cast<int>(std::floor(position.x() / chunk_size_)),
+                  static_cast<int>(std::floor(position.y() / chunk_size_)),
+                  static_cast<int>(std::floor(position.z() / chunk_size_)));
+}
+
+void StaticBatcher::AddModel(Model* model, const int batch_key) {
+  if (chunk_of_model_.count(model) > 0) return;
+  const ChunkKey key = ComputeChunkKey(model, batch_key);
+  Chunk& chunk = chunks_[key];
+  chunk.models.push_back(model);
+  chunk.needs_rebuild = true;
+  chunk_of_model_[model] = key;
+}
+
+bool StaticBatcher::RemoveModel(Model* model) {
+  auto key_it = chunk_of_model_.find(model);
+  if (key_it == chunk_of_model_.end()) return false;
+  Chunk& chunk = chunks_[key_it->second];
+  for (size_t i = 0; i < chunk.models.size(); ++i) {
+    if (chunk.models[i] == model) {
+      chunk.models[i] = chunk.models.back();
+      chunk.models.pop_back();
+      break;
+    }
+  }
+  chunk.needs_rebuild = true;
+  chunk_of_model_.erase(key_it);
+  return true;
+}
+
+void StaticBatcher::Update() {
+  // Drop the empty chunks and collect the ones to rebuild.
+  std::vector<Chunk*> chunks_to_rebuild;
+  for (auto it = chunks_.begin(); it != chunks_.end();) {
+    Chunk& chunk = it->second;
+    if (chunk.models.empty()) {
+      DeleteBuffers(&chunk);
+      it = chunks_.erase(it);
+      continue;
+    }
+    if (chunk.needs_rebuild) chunks_to_rebuild.push_back(&chunk);
+    ++it;
+  }
+  if (chunks_to_rebuild.empty()) return;
+  const auto start = std::chrono::steady_clock::now();
+
+  // Lay out the vertices and the indices of every model in the merged arrays
+  // of its chunk. The models without their CPU geometry are skipped.
+  std::vector<TransformJob> jobs;
+  std::vector<Eigen::MatrixXf> merged_vertices(chunks_to_rebuild.size());
+  std::vector<std::vector<GLuint>> merged_indices(chunks_to_rebuild.size());
+  for (size_t i = 0; i < chunks_to_rebuild.size(); ++i) {
+    int num_vertices = 0;
+    int num_indices = 0;
+    for (Model* model : chunks_to_rebuild[i]->models) {
+      if (!model->mesh()->has_cpu_geometry()) continue;
+      jobs.push_back({static_cast<int>(i), model, num_vertices, num_indices});
+      num_vertices += model->num_vertices();
+      num_indices += model->indices().empty() ? model->num_vertices() :
+          model->num_indices();
+    }
+    merged_vertices[i].resize(3, num_vertices);
+    merged_indices[i].resize(num_indices);
+  }
+
+  // Pre-transform the vertices into the world frame. The kernel runs on the
+  // calling thread, since ParallelFor() is not reentrant.
+  thread_pool_->ParallelFor(0, jobs.size(), [&](const int i) {
+    const TransformJob& job = jobs[i];
+    const Eigen::Matrix4f model_matrix = job.model->ComputeModelMatrix();
+    const Eigen::MatrixXf& vertices = job.model->vertices();
+    TransformVertices(model_matrix, vertices.data(),
+                      static_cast<int>(vertices.cols()),
+                      merged_vertices[job.chunk_index].data() +
+                      3 * job.first_vertex,
+                      nullptr);
+    GLuint* indices = merged_indices[job.chunk_index].data() + job.first_index;
+    const std::vector<GLuint>& model_indices = job.model->indices();
+    if (model_indices.empty()) {
+      for (int j = 0; j < vertices.cols(); ++j) {
+        indices[j] = job.first_vertex + j;
+      }
+    } else {
+      for (size_t j = 0; j < model_indices.size(); ++j) {
+        indices[j] = job.first_vertex + model_indices[j];
+      }
+    }
+  });
+
+  // Upload the merged buffers.
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  for (size_t i = 0; i < chunks_to_rebuild.size(); ++i) {
+    Chunk& chunk = *chunks_to_rebuild[i];
+    const Eigen::MatrixXf& vertices = merged_vertices[i];
+    const std::vector<GLuint>& indices = merged_indices[i];
+    if (chunk.vertex_array_object_id == 0) {
+      glGenVertexArrays(1, &chunk.vertex_array_object_id);
+      glGenBuffers(1, &chunk.vertex_buffer_object_id);
+      glGenBuffers(1, &chunk.element_buffer_object_id);
+      registry->Register(GlObjectType::VERTEX_ARRAY,
+                         chunk.vertex_array_object_id, "static_batcher",
+                         WVU_GL_CREATION_SITE);
+      registry->Register(GlObjectType::BUFFER, chunk.vertex_buffer_object_id,
+                         "static_batcher", WVU_GL_CREATION_SITE);
+      registry->Register(GlObjectType::BUFFER,
+                         chunk.element_buffer_object_id, "static_batcher",
+                         WVU_GL_CREATION_SITE);
+      glBindVertexArray(chunk.vertex_array_object_id);
+      glBindBuffer(GL_ARRAY_BUFFER, chunk.vertex_buffer_object_id);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                            static_cast<GLvoid*>(0));
+      glEnableVertexAttribArray(0);
+      // The EBO binding is recorded in the VAO state.
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.element_buffer_object_id);
+    } else {
+      glBindVertexArray(chunk.vertex_array_object_id);
+      glBindBuffer(GL_ARRAY_BUFFER, chunk.vertex_buffer_object_id);
+    }
+    const GLsizeiptr vertices_size = vertices.size() * sizeof(GLfloat);
+    const GLsizeiptr indices_size = indices.size() * sizeof(GLuint);
+    glBufferData(GL_ARRAY_BUFFER, vertices_size, vertices.data(),
+                 GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_size, indices.data(),
+                 GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    registry->SetSize(GlObjectType::BUFFER, chunk.vertex_buffer_object_id,
+                      vertices_size);
+    registry->SetSize(GlObjectType::BUFFER, chunk.element_buffer_object_id,
+                      indices_size);
+    chunk.num_indices = indices.size();
+    if (vertices.cols() > 0) {
+      chunk.bounding_box_min = vertices.rowwise().minCoeff();
+      chunk.bounding_box_max = vertices.rowwise().maxCoeff();
+    }
+    chunk.needs_rebuild = false;
+    ++stats_.num_rebuilt_chunks;
+    stats_.num_bytes_uploaded += vertices_size + indices_size;
+  }
+  const auto end = std::chrono::steady_clock::now();
+  stats_.rebuild_seconds += std::chrono::duration<double>(end - start).count();
+}
+
+void StaticBatcher::Draw(const int batch_key,
+                         const ShaderProgram& shader_program,
+                         const Camera& camera) {
+  // The vertices are in the world frame already.
+  const Eigen::Matrix4f identity = Eigen::Matrix4f::Identity();
+  const GLuint program_id = shader_program.shader_program_id();
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "model"), 1, GL_FALSE,
+                     identity.data());
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "view"), 1, GL_FALSE,
+                     camera.view_matrix().data());
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "projection"), 1,
+                     GL_FALSE, camera.projection_matrix().data());
+  // The chunks of a batch key are contiguous in the map.
+  auto it = chunks_.lower_bound(ChunkKey(batch_key, INT_MIN, INT_MIN, INT_MIN));
+  for (; it != chunks_.end() && std::get<0>(it->first) == batch_key; ++it) {
+    const Chunk& chunk = it->second;
+    if (chunk.num_indices == 0) continue;
+    if (!camera.IsBoxInFrustum(identity, chunk.bounding_box_min,
+                               chunk.bounding_box_max)) {
+      ++stats_.num_culled_chunks;
+      continue;
+    }
+    glBindVertexArray(chunk.vertex_array_object_id);
+    glDrawElements(GL_TRIANGLES, chunk.num_indices, GL_UNSIGNED_INT, 0);
+    ++stats_.num_draw_calls;
+  }
+  glBindVertexArray(0);
+}
+
+void StaticBatcher::DeleteBuffers(Chunk* chunk) {
+  if (chunk->vertex_array_object_id == 0) return;
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  registry->Unregister(GlObjectType::BUFFER, chunk->element_buffer_object_id);
+  registry->Unregister(GlObjectType::BUFFER, chunk->vertex_buffer_object_id);
+  registry->Unregister(GlObjectType::VERTEX_ARRAY,
+                       chunk->vertex_array_object_id);
+  glDeleteBuffers(1, &chunk->element_buffer_object_id);
+  glDeleteBuffers(1, &chunk->vertex_buffer_object_id);
+  glDeleteVertexArrays(1, &chunk->vertex_array_object_id);
+  chunk->vertex_array_object_id = 0;
+  chunk->vertex_buffer_object_id = 0;
+  chunk->element_buffer_object_id = 0;
+  chunk->num_indices = 0;
+}
+
+}  // namespace wvu
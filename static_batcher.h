@@ -0,0 +1,162 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef STATIC_BATCHER_H_
+#define STATIC_BATCHER_H_
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+namespace wvu {
+class Camera;
+class Model;
+class ShaderProgram;
+class ThreadPool;
+
+// Statistics of the static batcher.
+struct StaticBatchStats {
+  // Draw calls issued and chunks outside of the view frustum.
+  int num_draw_calls = 0;
+  int num_culled_chunks = 0;
+  // Chunks rebuilt, the bytes they uploaded and the time it took.
+  int num_rebuilt_chunks = 0;
+  int64_t num_bytes_uploaded = 0;
+  double rebuild_seconds = 0.0;
+};
+
+// Merges static models into a few large buffers so that they are drawn with
+// a few draw calls instead of one per model. The models are grouped by a
+// batch key, e.g., their material or shader program, and by the cell of a
+// uniform grid that contains their position. Every group, or chunk, keeps its
+// vertices in world coordinates, pre-transformed on the thread pool with the
+// model matrices, and is culled against the view frustum as a whole.
+//
+// Adding or removing a model only rebuilds its chunk, in the next Update().
+// A model must not move while batched; remove it and add it again instead.
+// The models need their CPU copy of the geometry when their chunk is
+// rebuilt.
+//
+// Example:
+//
+// wvu::StaticBatcher static_batcher(2.0f, &thread_pool);
+// for (Model* prop : props) static_batcher.AddModel(prop, kPropsMaterial);
+// static_batcher.Update();
+// while (...) {  // Rendering loop.
+//   shader_program.Use();
+//   static_batcher.Draw(kPropsMaterial, shader_program, camera);
+// }
+class StaticBatcher {
+ public:
+  // Params:
+  //   chunk_size  The edge of the cubic cells of the grid, in world units.
+  //   thread_pool  The threads that transform the vertices.
+  StaticBatcher(const float chunk_size, ThreadPool* thread_pool);
+
+  // Destructor. Deletes the buffers in GPU, so the OpenGL context must be
+  // current if Update() was called.
+  ~StaticBatcher();
+
+  // Adds a static model to the chunk of its position. Does nothing if the
+  // model is batched already.
+  // Params:
+  //   model  The model; it must outlive the batcher or be removed first.
+  //   batch_key  The models with different keys are never merged.
+  void AddModel(Model* model, const int batch_key);
+
+  // Removes a model. Returns false if it was not batched.
+  bool RemoveModel(Model* model);
+
+  // Rebuilds the chunks whose models changed since the last call. Must be
+  // called with the OpenGL context current.
+  void Update();
+
+  // Draws the chunks of a batch key that intersect the view frustum, with
+  // one draw call per chunk. The shader program must be in use; it receives
+  // an identity model matrix.
+  void Draw(const int batch_key,
+            const ShaderProgram& shader_program,
+            const Camera& camera);
+
+  // Returns the number of batched models and of chunks.
+  int num_models() const {
+    return chunk_of_model_.size();
+  }
+
+  int num_chunks() const {
+    return chunks_.size();
+  }
+
+  const StaticBatchStats& stats() const {
+    return stats_;
+  }
+
+  void ResetStats() {
+    stats_ = StaticBatchStats();
+  }
+
+ private:
+  // Batch key and grid cell.
+  typedef std::tuple<int, int, int, int> ChunkKey;
+
+  struct Chunk {
+    std::vector<Model*> models;
+    bool needs_rebuild = true;
+    GLuint vertex_array_object_id = 0;
+    GLuint vertex_buffer_object_id = 0;
+    GLuint element_buffer_object_id = 0;
+    GLsizei num_indices = 0;
+    // Bounding box of the merged vertices in the world frame.
+    Eigen::Vector3f bounding_box_min = Eigen::Vector3f::Zero();
+    Eigen::Vector3f bounding_box_max = Eigen::Vector3f::Zero();
+  };
+
+  ChunkKey ComputeChunkKey(Model* model, const int batch_key) const;
+  void DeleteBuffers(Chunk* chunk);
+
+  const float chunk_size_;
+  ThreadPool* thread_pool_;
+  // Ordered, so the chunks are drawn in the same order every frame.
+  std::map<ChunkKey, Chunk> chunks_;
+  std::unordered_map<Model*, ChunkKey> chunk_of_model_;
+  StaticBatchStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // STATIC_BATCHER_H_
@@ -0,0 +1,122 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace wvu {
+ThreadPool::ThreadPool(const int num_threads) :
+    function_(nullptr), next_index_(0), end_(0), job_generation_(0),
+    num_pending_workers_(0), stop_(false) {
+  int total_threads = num_threads;
+  if (total_threads <= 0) {
+    total_threads =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  // The calling thread is one of the working threads.
+  for (int i = 1; i < total_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  job_available_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(const int begin,
+                             const int end,
+                             const std::function<void(int)>& function) {
+  if (begin >= end) return;
+  // Small jobs or single threaded pools run inline.
+  if (workers_.empty() || end - begin == 1) {
+    for (int i = begin; i < end; ++i) {
+      function(i);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function_ = &function;
+    next_index_ = begin;
+    end_ = end;
+    num_pending_workers_ = static_cast<int>(workers_.size());
+    ++job_generation_;
+  }
+  job_available_.notify_all();
+  RunCurrentJob();
+  // Wait until every worker is done so that the function can go out of scope.
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_done_.wait(lock, [this]() { return num_pending_workers_ == 0; });
+  function_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+  unsigned int last_job_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_available_.wait(lock, [this, last_job_generation]() {
+        return stop_ || job_generation_ != last_job_generation;
+      });
+      if (stop_) return;
+      last_job_generation = job_generation_;
+    }
+    RunCurrentJob();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --num_pending_workers_;
+    }
+    job_done_.notify_one();
+  }
+}
+
+void ThreadPool::RunCurrentJob() {
+  const std::function<void(int)>& function = *function_;
+  for (int i = next_index_++; i < end_; i = next_index_++) {
+    function(i);
+  }
+}
+
+}  // namespace wvu
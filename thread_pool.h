@@ -0,0 +1,111 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wvu {
+// A small pool of persistent worker threads used to parallelize per-frame CPU
+// work (e.g., rasterizing tiles or transforming vertices) without paying the
+// cost of spawning threads every frame.
+//
+// Example:
+//
+// wvu::ThreadPool thread_pool(0);  // One thread per hardware core.
+// thread_pool.ParallelFor(0, num_tiles, [&](const int tile) {
+//   RasterizeTile(tile);
+// });
+//
+// NOTE: ParallelFor() is not reentrant; the function must not call
+// ParallelFor() on the same pool.
+class ThreadPool {
+ public:
+  // Constructor.
+  // Params:
+  //   num_threads  The total number of threads working on a ParallelFor()
+  //     call, including the calling thread. Zero uses one thread per hardware
+  //     core.
+  explicit ThreadPool(const int num_threads);
+
+  // Destructor. Stops and joins the worker threads.
+  ~ThreadPool();
+
+  // Calls function(i) for every i in [begin, end) using all the threads of the
+  // pool. The call blocks until every index has been processed.
+  void ParallelFor(const int begin,
+                   const int end,
+                   const std::function<void(int)>& function);
+
+  // Returns the number of threads working on a ParallelFor() call.
+  int num_threads() const {
+    return static_cast<int>(workers_.size()) + 1;
+  }
+
+ private:
+  // Main loop of the worker threads.
+  void WorkerLoop();
+
+  // Processes indices of the current job until none are left.
+  void RunCurrentJob();
+
+  // Worker threads. The thread calling ParallelFor() also does work.
+  std::vector<std::thread> workers_;
+  // Protects the job description and the counters below.
+  std::mutex mutex_;
+  // Signals the workers that a new job is available or that they must stop.
+  std::condition_variable job_available_;
+  // Signals the calling thread that all the workers finished the job.
+  std::condition_variable job_done_;
+  // The current job.
+  const std::function<void(int)>* function_;
+  std::atomic<int> next_index_;
+  int end_;
+  // Incremented on every job so that workers run each job exactly once.
+  unsigned int job_generation_;
+  // Number of workers that have not finished the current job.
+  int num_pending_workers_;
+  // True when the workers must exit.
+  bool stop_;
+};
+
+}  // namespace wvu
+
+#endif  // THREAD_POOL_H_
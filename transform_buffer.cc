@@ -0,0 +1,192 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "transform_buffer.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "model.h"
+
+namespace wvu {
+namespace {
+
+// Texels and floats of a model matrix.
+constexpr int kTexelsPerMatrix = 4;
+constexpr int kFloatsPerMatrix = 16;
+// Changed matrices closer than this many handles are uploaded in one range,
+// with the unchanged ones between them.
+constexpr int kMaxRangeGap = 4;
+// Matrices of the buffer when it is created.
+constexpr int kInitialCapacity = 256;
+
+}  // namespace
+
+TransformBuffer::TransformBuffer(const int max_texture_buffer_size) :
+    max_models_(max_texture_buffer_size / kTexelsPerMatrix),
+    buffer_id_(0),
+    texture_id_(0),
+    capacity_(0) {}
+
+TransformBuffer::~TransformBuffer() {
+  if (texture_id_ == 0) return;
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  registry->Unregister(GlObjectType::TEXTURE, texture_id_);
+  registry->Unregister(GlObjectType::BUFFER, buffer_id_);
+  glDeleteTextures(1, &texture_id_);
+  glDeleteBuffers(1, &buffer_id_);
+}
+
+bool TransformBuffer::Initialize(std::string* error_info_log) {
+  if (max_models_ <= 0) {
+    if (error_info_log) {
+      *error_info_log = "The transform buffer needs room for a matrix.";
+    }
+    return false;
+  }
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  glGenBuffers(1, &buffer_id_);
+  glGenTextures(1, &texture_id_);
+  registry->Register(GlObjectType::BUFFER, buffer_id_, "transform_buffer",
+                     WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::TEXTURE, texture_id_, "transform_buffer",
+                     WVU_GL_CREATION_SITE);
+  capacity_ = std::min(kInitialCapacity, max_models_);
+  const GLsizeiptr size = capacity_ * kFloatsPerMatrix * sizeof(GLfloat);
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer_id_);
+  glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, buffer_id_, size);
+  glBindTexture(GL_TEXTURE_BUFFER, texture_id_);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer_id_);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  return true;
+}
+
+int TransformBuffer::Add(Model* model) {
+  const auto found = handles_.find(model);
+  if (found != handles_.end()) return found->second;
+  int handle;
+  if (!free_handles_.empty()) {
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+  } else if (static_cast<int>(slots_.size()) < max_models_) {
+    handle = static_cast<int>(slots_.size());
+    slots_.emplace_back();
+    matrices_.resize(slots_.size() * kFloatsPerMatrix, 0.0f);
+  } else {
+    return -1;
+  }
+  Slot& slot = slots_[handle];
+  slot.model = model;
+  slot.version = 0;
+  slot.is_uploaded = false;
+  handles_[model] = handle;
+  return handle;
+}
+
+void TransformBuffer::Remove(const Model* model) {
+  const auto found = handles_.find(model);
+  if (found == handles_.end()) return;
+  slots_[found->second].model = nullptr;
+  free_handles_.push_back(found->second);
+  handles_.erase(found);
+}
+
+int TransformBuffer::handle(const Model* model) const {
+  const auto found = handles_.find(model);
+  return found == handles_.end() ? -1 : found->second;
+}
+
+void TransformBuffer::Update() {
+  // Collect the changed matrices in the order of their handles.
+  std::vector<int> changed_handles;
+  for (int handle = 0; handle < static_cast<int>(slots_.size()); ++handle) {
+    Slot& slot = slots_[handle];
+    if (slot.model == nullptr ||
+        (slot.is_uploaded && slot.version == slot.model->version())) {
+      continue;
+    }
+    const Eigen::Matrix4f model_matrix = slot.model->ComputeModelMatrix();
+    std::copy(model_matrix.data(), model_matrix.data() + kFloatsPerMatrix,
+              matrices_.begin() + handle * kFloatsPerMatrix);
+    slot.version = slot.model->version();
+    slot.is_uploaded = true;
+    changed_handles.push_back(handle);
+  }
+  if (changed_handles.empty()) return;
+  stats_.num_changed_matrices += changed_handles.size();
+
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer_id_);
+  if (static_cast<int>(slots_.size()) > capacity_) {
+    // Grow the buffer and upload all the matrices; the texture keeps
+    // viewing the buffer.
+    capacity_ = std::min(std::max(2 * capacity_,
+                                  static_cast<int>(slots_.size())),
+                         max_models_);
+    const GLsizeiptr size = capacity_ * kFloatsPerMatrix * sizeof(GLfloat);
+    glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    const GLsizeiptr used_size = matrices_.size() * sizeof(GLfloat);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, used_size, matrices_.data());
+    GlResourceRegistry::Instance()->SetSize(GlObjectType::BUFFER, buffer_id_,
+                                            size);
+    ++stats_.num_upload_ranges;
+    stats_.num_bytes_uploaded += used_size;
+  } else {
+    size_t begin = 0;
+    while (begin < changed_handles.size()) {
+      size_t end = begin + 1;
+      while (end < changed_handles.size() &&
+             changed_handles[end] - changed_handles[end - 1] <= kMaxRangeGap) {
+        ++end;
+      }
+      const int first_handle = changed_handles[begin];
+      const int num_matrices = changed_handles[end - 1] - first_handle + 1;
+      const GLsizeiptr size = num_matrices * kFloatsPerMatrix * sizeof(GLfloat);
+      glBufferSubData(GL_TEXTURE_BUFFER,
+                      first_handle * kFloatsPerMatrix * sizeof(GLfloat), size,
+                      matrices_.data() + first_handle * kFloatsPerMatrix);
+      ++stats_.num_upload_ranges;
+      stats_.num_bytes_uploaded += size;
+      begin = end;
+    }
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+}  // namespace wvu
@@ -0,0 +1,145 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef TRANSFORM_BUFFER_H_
+#define TRANSFORM_BUFFER_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+
+namespace wvu {
+class Model;
+
+// Statistics of the transform buffer.
+struct TransformBufferStats {
+  // Matrices of the models that moved or were added, and the ranges of the
+  // buffer they were uploaded in.
+  int num_changed_matrices = 0;
+  int num_upload_ranges = 0;
+  // Bytes uploaded, which include the unchanged matrices between the
+  // changed ones of a range, and the whole buffer when it grows.
+  int64_t num_bytes_uploaded = 0;
+};
+
+// Keeps the model matrices of a set of models in GPU memory, in a texture
+// buffer that shaders index by the handle of a model: the matrix of handle h
+// is the four columns at texels 4 h to 4 h + 3. Update() uploads only the
+// matrices of the models whose version changed since the previous Update(),
+// see Model::version(), so the uploads follow the motion of the scene rather
+// than its size. The changed matrices are sorted by handle and uploaded in
+// ranges; nearby changes share a range.
+//
+// Example:
+//
+// wvu::TransformBuffer transform_buffer(max_texture_buffer_size);
+// if (!transform_buffer.Initialize(&error_info_log)) { ... }
+// for (Model* model : models) transform_buffer.Add(model);
+// while (...) {  // Rendering loop.
+//   transform_buffer.Update();
+//   glBindTexture(GL_TEXTURE_BUFFER, transform_buffer.texture_id());
+//   ...
+// }
+class TransformBuffer {
+ public:
+  // Params:
+  //   max_texture_buffer_size  The most texels of a texture buffer, i.e.,
+  //     GL_MAX_TEXTURE_BUFFER_SIZE. Limits the number of models.
+  explicit TransformBuffer(const int max_texture_buffer_size);
+
+  // Destructor. Deletes the buffer and the texture, so the OpenGL context
+  // must be current if Initialize() was called.
+  ~TransformBuffer();
+
+  // Creates the buffer and the texture. Returns true if successful.
+  bool Initialize(std::string* error_info_log);
+
+  // Adds the model, whose matrix is uploaded by the next Update(). Returns
+  // the handle of the model, or -1 if the buffer is full. Adding a model
+  // again returns its handle.
+  int Add(Model* model);
+
+  // Removes the model. Its handle may be given to another model.
+  void Remove(const Model* model);
+
+  // Returns the handle of the model, or -1 if it was not added.
+  int handle(const Model* model) const;
+
+  // Uploads the matrices of the models that moved or were added.
+  void Update();
+
+  // Returns the texture buffer of the matrices (GL_RGBA32F).
+  GLuint texture_id() const {
+    return texture_id_;
+  }
+
+  // Returns the number of models in the buffer.
+  int num_models() const {
+    return static_cast<int>(handles_.size());
+  }
+
+  const TransformBufferStats& stats() const {
+    return stats_;
+  }
+
+  void ResetStats() {
+    stats_ = TransformBufferStats();
+  }
+
+ private:
+  // A handle: its model, if any, and the version of its uploaded matrix.
+  struct Slot {
+    Model* model;
+    uint64_t version;
+    bool is_uploaded;
+  };
+
+  const int max_models_;
+  GLuint buffer_id_;
+  GLuint texture_id_;
+  // Models in the buffer object, i.e., its size in matrices.
+  int capacity_;
+  std::vector<Slot> slots_;
+  std::vector<int> free_handles_;
+  std::unordered_map<const Model*, int> handles_;
+  // Copy of the matrices in the buffer.
+  std::vector<GLfloat> matrices_;
+  TransformBufferStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // TRANSFORM_BUFFER_H_
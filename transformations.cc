@@ -33,15 +33,20 @@
 // Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
 
 #include "transformations.h"
+
+#define _USE_MATH_DEFINES  // For using M_PI.
+#include <cmath>
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 
 namespace wvu {
 // Compute translation transformation matrix.
 // Params:
 //   offset  The translation offset vector.
 Eigen::Matrix4f ComputeTranslationMatrix(const Eigen::Vector3f& offset) {
-  // TODO: Implement me!
-  return Eigen::Matrix4f::Random();
+  Eigen::Matrix4f translation = Eigen::Matrix4f::Identity();
+  translation.block<3, 1>(0, 3) = offset;
+  return translation;
 }
 
 // Compute rotation transformation matrix.
@@ -50,24 +55,68 @@ Eigen::Matrix4f ComputeTranslationMatrix(const Eigen::Vector3f& offset) {
 //   angle_in_radians  Angle in radians.
 Eigen::Matrix4f ComputeRotationMatrix(const Eigen::Vector3f& rotation_axis,
                                       const float angle_in_radians) {
-  // TODO: Implement me!
-  return Eigen::Matrix4f::Random();
+  // Rodrigues' formula: R = cos(t) I + sin(t) [k]_x + (1 - cos(t)) k k^T.
+  const Eigen::Vector3f axis = rotation_axis.normalized();
+  const float cos_angle = std::cos(angle_in_radians);
+  const float sin_angle = std::sin(angle_in_radians);
+  Eigen::Matrix3f cross_product_matrix;
+  cross_product_matrix << 0.0f, -axis.z(), axis.y(),
+      axis.z(), 0.0f, -axis.x(),
+      -axis.y(), axis.x(), 0.0f;
+  Eigen::Matrix4f rotation = Eigen::Matrix4f::Identity();
+  rotation.block<3, 3>(0, 0) =
+      cos_angle * Eigen::Matrix3f::Identity() +
+      sin_angle * cross_product_matrix +
+      (1.0f - cos_angle) * axis * axis.transpose();
+  return rotation;
+}
+
+// Converts a Rodrigues vector into a unit quaternion.
+// Params:
+//   rodrigues  The Rodrigues vector.
+Eigen::Quaternionf ConvertRodriguesToQuaternion(
+    const Eigen::Vector3f& rodrigues) {
+  // q = (cos(t / 2), sin(t / 2) k), where t is the norm of the vector and k
+  // its direction. For small angles, sin(t / 2) / t tends to 1 / 2.
+  const float angle = rodrigues.norm();
+  const float half_angle = 0.5f * angle;
+  const float scale = angle < 1e-8f ? 0.5f : std::sin(half_angle) / angle;
+  return Eigen::Quaternionf(std::cos(half_angle), scale * rodrigues.x(),
+                            scale * rodrigues.y(), scale * rodrigues.z());
+}
+
+// Converts a unit quaternion into a Rodrigues vector.
+// Params:
+//   quaternion  The unit quaternion.
+Eigen::Vector3f ConvertQuaternionToRodrigues(
+    const Eigen::Quaternionf& quaternion) {
+  // q and -q are the same rotation; the one with w >= 0 has an angle of at
+  // most pi.
+  const float sign = quaternion.w() < 0.0f ? -1.0f : 1.0f;
+  const Eigen::Vector3f axis_sin_half_angle = sign * quaternion.vec();
+  const float sin_half_angle = axis_sin_half_angle.norm();
+  if (sin_half_angle < 1e-8f) {
+    return 2.0f * axis_sin_half_angle;
+  }
+  const float angle =
+      2.0f * std::atan2(sin_half_angle, sign * quaternion.w());
+  return (angle / sin_half_angle) * axis_sin_half_angle;
 }
 
 // Compute scaling transformation matrix.
 // Params:
 //   scale  Scale factor.
 Eigen::Matrix4f ComputeScalingMatrix(const float scale) {
-  // TODO: Implement me!
-  return Eigen::Matrix4f::Random();
+  Eigen::Matrix4f scaling = Eigen::Matrix4f::Identity();
+  scaling.block<3, 3>(0, 0) *= scale;
+  return scaling;
 }
 
 // Converts angles in degrees to radians.
 // Parameters:
 //   angle_in_degrees  The angle in degrees.
 float ConvertDegreesToRadians(const float angle_in_degrees) {
-  // TODO: Implement me!
-  return 0.0f;
+  return angle_in_degrees * static_cast<float>(M_PI) / 180.0f;
 }
 
 }  // namespace wvu
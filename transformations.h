@@ -33,6 +33,7 @@
 // Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 
 namespace wvu {
 // Compute translation transformation matrix.
@@ -47,6 +48,20 @@ Eigen::Matrix4f ComputeTranslationMatrix(const Eigen::Vector3f& offset);
 Eigen::Matrix4f ComputeRotationMatrix(const Eigen::Vector3f& rotation_axis,
                                       const float angle_in_radians);
 
+// Converts a Rodrigues vector (the rotation axis scaled by the angle) into a
+// unit quaternion.
+// Params:
+//   rodrigues  The Rodrigues vector.
+Eigen::Quaternionf ConvertRodriguesToQuaternion(
+    const Eigen::Vector3f& rodrigues);
+
+// Converts a unit quaternion into a Rodrigues vector with an angle in
+// [0, pi].
+// Params:
+//   quaternion  The unit quaternion.
+Eigen::Vector3f ConvertQuaternionToRodrigues(
+    const Eigen::Quaternionf& quaternion);
+
 // Compute scaling transformation matrix.
 // Params:
 //   scale  Scale factor.
@@ -0,0 +1,158 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "upscaler.h"
+
+#include <string>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "render_target.h"
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// Vertex shader of a triangle that covers the viewport. The texture
+// coordinates span [0, 1] over the viewport.
+const std::string full_screen_vertex_shader_src =
+    "#version 330 core\n"
+    "out vec2 uv;\n"
+    "\n"
+    "void main() {\n"
+    "uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "gl_Position = vec4(2.0f * uv - 1.0f, 0.0f, 1.0f);\n"
+    "}\n";
+
+// Fragment shader of the SHARPEN filter. The taps are clamped to the centers
+// of the border texels of the rendered region, since the texels beyond it
+// hold stale contents.
+const std::string sharpen_fragment_shader_src =
+    "#version 330 core\n"
+    "in vec2 uv;\n"
+    "uniform sampler2D source;\n"
+    "uniform vec2 region_size;\n"
+    "uniform vec2 texel_size;\n"
+    "uniform float sharpness;\n"
+    "out vec4 color;\n"
+    "vec3 Tap(vec2 st) {\n"
+    "return texture(source, clamp(st, 0.5f * texel_size,\n"
+    "                             region_size - 0.5f * texel_size)).rgb;\n"
+    "}\n"
+    "void main() {\n"
+    "vec2 st = uv * region_size;\n"
+    "vec3 center = Tap(st);\n"
+    "vec3 neighbors = Tap(st + vec2(texel_size.x, 0.0f)) +\n"
+    "                 Tap(st - vec2(texel_size.x, 0.0f)) +\n"
+    "                 Tap(st + vec2(0.0f, texel_size.y)) +\n"
+    "                 Tap(st - vec2(0.0f, texel_size.y));\n"
+    "vec3 sharpened = center + sharpness * (center - 0.25f * neighbors);\n"
+    "color = vec4(clamp(sharpened, 0.0f, 1.0f), 1.0f);\n"
+    "}\n";
+
+}  // namespace
+
+bool ParseUpscaleFilter(const std::string& name, UpscaleFilter* filter) {
+  if (name == "bilinear") {
+    *filter = UpscaleFilter::BILINEAR;
+  } else if (name == "sharpen") {
+    *filter = UpscaleFilter::SHARPEN;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Upscaler::Upscaler() : vertex_array_object_id_(0), sharpness_(0.5f) {}
+
+Upscaler::~Upscaler() {
+  if (vertex_array_object_id_ != 0) {
+    GlResourceRegistry::Instance()->Unregister(GlObjectType::VERTEX_ARRAY,
+                                               vertex_array_object_id_);
+    glDeleteVertexArrays(1, &vertex_array_object_id_);
+  }
+}
+
+bool Upscaler::Initialize(std::string* error_info_log) {
+  sharpen_shader_program_.LoadVertexShaderFromString(
+      full_screen_vertex_shader_src);
+  sharpen_shader_program_.LoadFragmentShaderFromString(
+      sharpen_fragment_shader_src);
+  if (!sharpen_shader_program_.Create(error_info_log)) return false;
+  glGenVertexArrays(1, &vertex_array_object_id_);
+  GlResourceRegistry::Instance()->Register(
+      GlObjectType::VERTEX_ARRAY, vertex_array_object_id_, "upscaler",
+      WVU_GL_CREATION_SITE);
+  return true;
+}
+
+void Upscaler::Upscale(const UpscaleFilter filter,
+                       const RenderTarget& source,
+                       const int source_width,
+                       const int source_height,
+                       const GLuint framebuffer_id,
+                       const int width,
+                       const int height) const {
+  if (filter == UpscaleFilter::BILINEAR) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source.framebuffer_id());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_id);
+    glBlitFramebuffer(0, 0, source_width, source_height, 0, 0, width, height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id);
+    glViewport(0, 0, width, height);
+    return;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id);
+  glViewport(0, 0, width, height);
+  // Every pixel is overwritten, so neither depth nor a clear is needed.
+  glDisable(GL_DEPTH_TEST);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  sharpen_shader_program_.Use();
+  const GLuint program_id = sharpen_shader_program_.shader_program_id();
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source.color_texture_id());
+  glUniform1i(glGetUniformLocation(program_id, "source"), 0);
+  glUniform2f(glGetUniformLocation(program_id, "region_size"),
+              static_cast<float>(source_width) / source.width(),
+              static_cast<float>(source_height) / source.height());
+  glUniform2f(glGetUniformLocation(program_id, "texel_size"),
+              1.0f / source.width(), 1.0f / source.height());
+  glUniform1f(glGetUniformLocation(program_id, "sharpness"), sharpness_);
+  glBindVertexArray(vertex_array_object_id_);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glEnable(GL_DEPTH_TEST);
+}
+
+}  // namespace wvu
@@ -0,0 +1,119 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef UPSCALER_H_
+#define UPSCALER_H_
+
+#include <string>
+#include <GL/glew.h>
+
+#include "render_target.h"
+#include "shader_program.h"
+
+namespace wvu {
+// Filters that upscale a low-resolution frame to the window.
+enum class UpscaleFilter {
+  // A bilinear blit of the framebuffer. It needs no shader, but softens the
+  // edges.
+  BILINEAR = 0,
+  // A full-screen pass that samples bilinearly and then sharpens with an
+  // unsharp mask of the four neighboring source texels, which restores some
+  // of the contrast lost by the upscaling.
+  SHARPEN = 1
+};
+
+// Parses an upscale filter name: bilinear or sharpen. Returns false if the
+// name is unknown.
+bool ParseUpscaleFilter(const std::string& name, UpscaleFilter* filter);
+
+// Upscales the bottom-left region of a render target to a framebuffer.
+//
+// Example:
+//
+// wvu::Upscaler upscaler;
+// std::string error_info_log;
+// if (!upscaler.Initialize(&error_info_log)) { ... }
+// while (...) {  // Rendering loop.
+//   render_target.Bind(scaled_width, scaled_height);
+//   ...  // Draw.
+//   upscaler.Upscale(wvu::UpscaleFilter::SHARPEN, render_target,
+//                    scaled_width, scaled_height, 0, window_width,
+//                    window_height);
+// }
+class Upscaler {
+ public:
+  Upscaler();
+
+  // Destructor. Deletes the OpenGL objects.
+  ~Upscaler();
+
+  // Compiles the sharpening shader. Requires a current OpenGL context.
+  // Returns false and fills error_info_log on failure.
+  bool Initialize(std::string* error_info_log);
+
+  // Upscales the region [0, source_width) x [0, source_height) of the render
+  // target to cover the destination framebuffer. Leaves the destination
+  // framebuffer bound with a viewport that covers it.
+  // Params:
+  //   filter  The upscale filter.
+  //   source  The render target holding the low-resolution frame.
+  //   source_width  The width of the rendered region in pixels.
+  //   source_height  The height of the rendered region in pixels.
+  //   framebuffer_id  The destination framebuffer; zero is the window.
+  //   width  The width of the destination.
+  //   height  The height of the destination.
+  void Upscale(const UpscaleFilter filter,
+               const RenderTarget& source,
+               const int source_width,
+               const int source_height,
+               const GLuint framebuffer_id,
+               const int width,
+               const int height) const;
+
+  // Sets the strength of the SHARPEN filter; zero is plain bilinear.
+  void set_sharpness(const float sharpness) {
+    sharpness_ = sharpness;
+  }
+
+ private:
+  ShaderProgram sharpen_shader_program_;
+  // The full-screen triangle is generated from gl_VertexID, but the core
+  // profile still needs a vertex array object bound to draw.
+  GLuint vertex_array_object_id_;
+  float sharpness_;
+};
+
+}  // namespace wvu
+
+#endif  // UPSCALER_H_
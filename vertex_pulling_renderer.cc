@@ -0,0 +1,352 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "vertex_pulling_renderer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader_program.h"
+#include "transform_buffer.h"
+
+namespace wvu {
+namespace {
+
+// Floats per vertex of the meshes: the position.
+constexpr int kFloatsPerVertex = 3;
+// Integers per record of the draw table.
+constexpr int kIntsPerDrawRecord = 4;
+
+// Names of the samplers, in the order of the arenas.
+const char* const kSamplerNames[] = {
+  "vertices", "indices", "draws", "draw_transforms"
+};
+// The model matrices come from the transform buffer, after the arenas.
+const char kModelMatricesSamplerName[] = "model_matrices";
+
+// Texel formats of the arenas.
+const GLenum kTexelFormats[] = {
+  GL_R32F, GL_R32UI, GL_RGBA32I, GL_R32I
+};
+
+}  // namespace
+
+// The draws are sorted by their first vertex, so the draw of a vertex is the
+// last one that starts at or before it.
+const char VertexPullingRenderer::kVertexShaderSource[] =
+    "#version 330 core\n"
+    "uniform samplerBuffer vertices;\n"
+    "uniform usamplerBuffer indices;\n"
+    "uniform isamplerBuffer draws;\n"
+    "uniform isamplerBuffer draw_transforms;\n"
+    "uniform samplerBuffer model_matrices;\n"
+    "uniform int num_draws;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 projection;\n"
+    "\n"
+    "void main() {\n"
+    "  int low = 0;\n"
+    "  int high = num_draws - 1;\n"
+    "  while (low < high) {\n"
+    "    int middle = (low + high + 1) / 2;\n"
+    "    if (texelFetch(draws, middle).x <= gl_VertexID) {\n"
+    "      low = middle;\n"
+    "    } else {\n"
+    "      high = middle - 1;\n"
+    "    }\n"
+    "  }\n"
+    "  ivec4 draw = texelFetch(draws, low);\n"
+    "  int vertex = gl_VertexID - draw.x;\n"
+    "  if (draw.y >= 0) {\n"
+    "    vertex = int(texelFetch(indices, draw.y + vertex).x);\n"
+    "  }\n"
+    "  int first_float = draw.z + vertex * draw.w;\n"
+    "  vec3 position = vec3(texelFetch(vertices, first_float).x,\n"
+    "                       texelFetch(vertices, first_float + 1).x,\n"
+    "                       texelFetch(vertices, first_float + 2).x);\n"
+    "  int matrix = 4 * texelFetch(draw_transforms, low).x;\n"
+    "  mat4 model = mat4(texelFetch(model_matrices, matrix),\n"
+    "                    texelFetch(model_matrices, matrix + 1),\n"
+    "                    texelFetch(model_matrices, matrix + 2),\n"
+    "                    texelFetch(model_matrices, matrix + 3));\n"
+    "  gl_Position = projection * view * model * vec4(position, 1.0f);\n"
+    "}\n";
+
+VertexPullingRenderer::VertexPullingRenderer(
+    const int max_texture_buffer_size, TransformBuffer* transform_buffer) :
+    max_texture_buffer_size_(max_texture_buffer_size),
+    transform_buffer_(transform_buffer),
+    vertex_array_object_id_(0),
+    buffer_ids_(),
+    texture_ids_(),
+    num_dropped_floats_(0),
+    num_dropped_indices_(0),
+    arenas_changed_(false) {}
+
+VertexPullingRenderer::~VertexPullingRenderer() {
+  if (vertex_array_object_id_ == 0) return;
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  for (int i = 0; i < NUM_ARENAS; ++i) {
+    registry->Unregister(GlObjectType::TEXTURE, texture_ids_[i]);
+    registry->Unregister(GlObjectType::BUFFER, buffer_ids_[i]);
+  }
+  registry->Unregister(GlObjectType::VERTEX_ARRAY, vertex_array_object_id_);
+  glDeleteTextures(NUM_ARENAS, texture_ids_);
+  glDeleteBuffers(NUM_ARENAS, buffer_ids_);
+  glDeleteVertexArrays(1, &vertex_array_object_id_);
+}
+
+bool VertexPullingRenderer::Initialize(std::string* error_info_log) {
+  if (max_texture_buffer_size_ <= 0) {
+    if (error_info_log) {
+      *error_info_log = "The texture buffers need a positive size.";
+    }
+    return false;
+  }
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  // The core profile draws with a vertex array object bound, even without
+  // vertex attributes.
+  glGenVertexArrays(1, &vertex_array_object_id_);
+  registry->Register(GlObjectType::VERTEX_ARRAY, vertex_array_object_id_,
+                     "vertex_pulling", WVU_GL_CREATION_SITE);
+  glGenBuffers(NUM_ARENAS, buffer_ids_);
+  glGenTextures(NUM_ARENAS, texture_ids_);
+  for (int i = 0; i < NUM_ARENAS; ++i) {
+    registry->Register(GlObjectType::BUFFER, buffer_ids_[i], "vertex_pulling",
+                       WVU_GL_CREATION_SITE);
+    registry->Register(GlObjectType::TEXTURE, texture_ids_[i],
+                       "vertex_pulling", WVU_GL_CREATION_SITE);
+    // The texture keeps viewing the buffer when its storage is replaced.
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer_ids_[i]);
+    glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, texture_ids_[i]);
+    glTexBuffer(GL_TEXTURE_BUFFER, kTexelFormats[i], buffer_ids_[i]);
+  }
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  return true;
+}
+
+bool VertexPullingRenderer::AddMesh(const std::shared_ptr<Mesh>& mesh_ptr) {
+  const Mesh& mesh = *mesh_ptr;
+  const auto record_it = meshes_.find(&mesh);
+  if (record_it != meshes_.end()) {
+    if (!record_it->second.mesh.expired()) return true;
+    // The record of a deleted mesh at the same address.
+    DropDeletedMeshes();
+  }
+  if (!mesh.has_cpu_geometry()) return false;
+  const int64_t mesh_floats =
+      static_cast<int64_t>(kFloatsPerVertex) * mesh.num_vertices();
+  const auto fits = [&]() {
+    return static_cast<int64_t>(vertex_arena_.size()) + mesh_floats <=
+        max_texture_buffer_size_ &&
+        static_cast<int64_t>(index_arena_.size()) + mesh.num_indices() <=
+        max_texture_buffer_size_;
+  };
+  if (!fits()) {
+    CompactArenas();
+    if (!fits()) return false;
+  }
+  MeshRecord record;
+  record.mesh = mesh_ptr;
+  record.first_float = static_cast<int>(vertex_arena_.size());
+  record.stride = kFloatsPerVertex;
+  record.num_vertices = mesh.num_vertices();
+  record.first_index =
+      mesh.num_indices() == 0 ? -1 : static_cast<int>(index_arena_.size());
+  record.num_indices = mesh.num_indices();
+  // The vertices are the columns of a column-major matrix, i.e., they are
+  // contiguous already.
+  const Eigen::MatrixXf& vertices = mesh.vertices();
+  vertex_arena_.insert(vertex_arena_.end(), vertices.data(),
+                       vertices.data() + vertices.size());
+  index_arena_.insert(index_arena_.end(), mesh.indices().begin(),
+                      mesh.indices().end());
+  meshes_[&mesh] = record;
+  arenas_changed_ = true;
+  return true;
+}
+
+void VertexPullingRenderer::DropDeletedMeshes() {
+  for (auto it = meshes_.begin(); it != meshes_.end();) {
+    const MeshRecord& record = it->second;
+    if (record.mesh.expired()) {
+      num_dropped_floats_ +=
+          static_cast<int64_t>(record.stride) * record.num_vertices;
+      num_dropped_indices_ += record.num_indices;
+      it = meshes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (num_dropped_floats_ > 0 &&
+      2 * num_dropped_floats_ >= static_cast<int64_t>(vertex_arena_.size())) {
+    CompactArenas();
+  }
+}
+
+void VertexPullingRenderer::CompactArenas() {
+  if (num_dropped_floats_ == 0 && num_dropped_indices_ == 0) return;
+  // The arenas keep the CPU copy of the geometry, so the meshes may have
+  // released theirs.
+  std::vector<GLfloat> vertex_arena;
+  std::vector<GLuint> index_arena;
+  vertex_arena.reserve(vertex_arena_.size() - num_dropped_floats_);
+  index_arena.reserve(index_arena_.size() - num_dropped_indices_);
+  for (auto& mesh_and_record : meshes_) {
+    MeshRecord& record = mesh_and_record.second;
+    const int num_floats = record.stride * record.num_vertices;
+    const int first_float = static_cast<int>(vertex_arena.size());
+    vertex_arena.insert(vertex_arena.end(),
+                        vertex_arena_.begin() + record.first_float,
+                        vertex_arena_.begin() + record.first_float +
+                        num_floats);
+    record.first_float = first_float;
+    if (record.first_index >= 0) {
+      const int first_index = static_cast<int>(index_arena.size());
+      index_arena.insert(index_arena.end(),
+                         index_arena_.begin() + record.first_index,
+                         index_arena_.begin() + record.first_index +
+                         record.num_indices);
+      record.first_index = first_index;
+    }
+  }
+  vertex_arena_.swap(vertex_arena);
+  index_arena_.swap(index_arena);
+  num_dropped_floats_ = 0;
+  num_dropped_indices_ = 0;
+  arenas_changed_ = true;
+}
+
+void VertexPullingRenderer::UploadBuffer(const Arena arena,
+                                         const GLsizeiptr size,
+                                         const void* data,
+                                         const GLenum usage) {
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer_ids_[arena]);
+  glBufferData(GL_TEXTURE_BUFFER, size, data, usage);
+  GlResourceRegistry::Instance()->SetSize(GlObjectType::BUFFER,
+                                          buffer_ids_[arena], size);
+  stats_.num_bytes_uploaded += size;
+}
+
+void VertexPullingRenderer::UploadArenas() {
+  if (!arenas_changed_) return;
+  UploadBuffer(VERTICES, vertex_arena_.size() * sizeof(GLfloat),
+               vertex_arena_.data(), GL_STATIC_DRAW);
+  UploadBuffer(INDICES, index_arena_.size() * sizeof(GLuint),
+               index_arena_.data(), GL_STATIC_DRAW);
+  arenas_changed_ = false;
+}
+
+void VertexPullingRenderer::Draw(const ShaderProgram& shader_program,
+                                 const Eigen::Matrix4f& projection,
+                                 const Eigen::Matrix4f& view,
+                                 const std::vector<Model*>& models) {
+  DropDeletedMeshes();
+  // Add all the meshes before reading their records: adding a mesh that does
+  // not fit compacts the arenas, which moves the meshes added before it.
+  draw_models_.clear();
+  for (Model* model : models) {
+    if (AddMesh(model->mesh())) {
+      draw_models_.push_back(model);
+    } else {
+      // A model that is not drawn must not keep its matrix uploaded.
+      transform_buffer_->Remove(model);
+      ++stats_.num_skipped_models;
+    }
+  }
+  // Build the draw table.
+  draw_records_.clear();
+  draw_transforms_.clear();
+  int num_draw_vertices = 0;
+  for (Model* model : draw_models_) {
+    const int transform_handle = transform_buffer_->Add(model);
+    if (transform_handle < 0) {
+      ++stats_.num_skipped_models;
+      continue;
+    }
+    const MeshRecord& record = meshes_.at(model->mesh().get());
+    draw_records_.push_back(num_draw_vertices);
+    draw_records_.push_back(record.first_index);
+    draw_records_.push_back(record.first_float);
+    draw_records_.push_back(record.stride);
+    draw_transforms_.push_back(transform_handle);
+    num_draw_vertices += record.first_index < 0 ? record.num_vertices :
+        record.num_indices;
+  }
+  const int num_draws =
+      static_cast<int>(draw_records_.size()) / kIntsPerDrawRecord;
+  if (num_draws == 0) return;
+  UploadArenas();
+  transform_buffer_->Update();
+  // The tables change every frame, so their storage is orphaned.
+  UploadBuffer(DRAWS, draw_records_.size() * sizeof(GLint),
+               draw_records_.data(), GL_STREAM_DRAW);
+  UploadBuffer(DRAW_TRANSFORMS, draw_transforms_.size() * sizeof(GLint),
+               draw_transforms_.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  const GLuint program_id = shader_program.shader_program_id();
+  for (int i = 0; i < NUM_ARENAS; ++i) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_BUFFER, texture_ids_[i]);
+    glUniform1i(glGetUniformLocation(program_id, kSamplerNames[i]), i);
+  }
+  glActiveTexture(GL_TEXTURE0 + NUM_ARENAS);
+  glBindTexture(GL_TEXTURE_BUFFER, transform_buffer_->texture_id());
+  glUniform1i(glGetUniformLocation(program_id, kModelMatricesSamplerName),
+              NUM_ARENAS);
+  glUniform1i(glGetUniformLocation(program_id, "num_draws"), num_draws);
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "view"), 1, GL_FALSE,
+                     view.data());
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "projection"), 1,
+                     GL_FALSE, projection.data());
+  glBindVertexArray(vertex_array_object_id_);
+  glDrawArrays(GL_TRIANGLES, 0, num_draw_vertices);
+  glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE0);
+
+  ++stats_.num_draw_calls;
+  stats_.num_pulled_models += num_draws;
+  stats_.num_pulled_vertices += num_draw_vertices;
+}
+
+}  // namespace wvu
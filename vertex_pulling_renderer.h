@@ -0,0 +1,237 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef VERTEX_PULLING_RENDERER_H_
+#define VERTEX_PULLING_RENDERER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+namespace wvu {
+class Mesh;
+class Model;
+class ShaderProgram;
+class TransformBuffer;
+
+// Statistics of the vertex pulling renderer.
+struct VertexPullingStats {
+  // Draw calls, and the models and vertices they pulled.
+  int num_draw_calls = 0;
+  int num_pulled_models = 0;
+  int64_t num_pulled_vertices = 0;
+  // Models skipped because their mesh had no CPU geometry to add to the
+  // arenas, or did not fit.
+  int num_skipped_models = 0;
+  // Bytes written into the arenas and the draw tables, without the model
+  // matrices; see TransformBufferStats.
+  int64_t num_bytes_uploaded = 0;
+};
+
+// Draws models of different meshes with a single draw call and no vertex
+// attributes. The vertices and the indices of all the meshes live in two
+// arenas, texture buffers the vertex shader reads with texelFetch(). Every
+// frame, the renderer writes a table with one record per model: where its
+// vertices start in the draw, where its mesh is in the arenas, and the handle
+// of its model matrix in a TransformBuffer. The draw is a single
+// glDrawArrays() over the vertices of all the models; the shader finds the
+// record of each vertex by a binary search of gl_VertexID, fetches its index,
+// its position and its model matrix, and transforms it.
+//
+// Pulling trades the draw calls and the vertex array switches of the models
+// for a few texel fetches per vertex, so it pays off for scenes with many
+// small models. The vertex shader is kVertexShaderSource; the fragment shader
+// is up to the caller.
+//
+// Example:
+//
+// wvu::TransformBuffer transform_buffer(max_texture_buffer_size);
+// wvu::VertexPullingRenderer renderer(max_texture_buffer_size,
+//                                     &transform_buffer);
+// if (!renderer.Initialize(&error_info_log)) { ... }
+// wvu::ShaderProgram shader_program;
+// shader_program.LoadVertexShaderFromString(
+//     wvu::VertexPullingRenderer::kVertexShaderSource);
+// ...
+// while (...) {  // Rendering loop.
+//   shader_program.Use();
+//   renderer.Draw(shader_program, projection, view, visible_models);
+// }
+class VertexPullingRenderer {
+ public:
+  // Vertex shader that pulls the vertices.
+  static const char kVertexShaderSource[];
+
+  // Params:
+  //   max_texture_buffer_size  The most texels of a texture buffer, i.e.,
+  //     GL_MAX_TEXTURE_BUFFER_SIZE. Limits the floats of the vertex arena
+  //     and the indices of the index arena.
+  //   transform_buffer  The model matrices. Draw() adds its models to it
+  //     and updates it.
+  VertexPullingRenderer(const int max_texture_buffer_size,
+                        TransformBuffer* transform_buffer);
+
+  // Destructor. Deletes the buffers and the textures, so the OpenGL context
+  // must be current if Initialize() was called.
+  ~VertexPullingRenderer();
+
+  // Creates the buffers and the textures. Returns true if successful.
+  bool Initialize(std::string* error_info_log);
+
+  // Copies the geometry of the mesh into the arenas, which are uploaded by
+  // the next Draw(). Draw() adds the meshes of its models, so this only adds
+  // them ahead of time. Returns false if the mesh has no CPU geometry or
+  // does not fit in the arenas. The renderer does not keep the mesh alive;
+  // the geometry of a deleted mesh is dropped from the arenas.
+  bool AddMesh(const std::shared_ptr<Mesh>& mesh);
+
+  // Draws the models with one draw call. The shader program must be in use.
+  // Params:
+  //   shader_program  The shader program that is currently in use, built
+  //     with kVertexShaderSource.
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  //   models  The models to draw. The models that do not fit in the
+  //     arenas or in the transform buffer are skipped.
+  void Draw(const ShaderProgram& shader_program,
+            const Eigen::Matrix4f& projection,
+            const Eigen::Matrix4f& view,
+            const std::vector<Model*>& models);
+
+  // Returns the number of meshes in the arenas, including the deleted
+  // meshes that the next Draw() drops.
+  int num_meshes() const {
+    return static_cast<int>(meshes_.size());
+  }
+
+  // Returns the floats of the vertex arena and the indices of the index
+  // arena, including the space of the dropped meshes until it is compacted.
+  int vertex_arena_size() const {
+    return static_cast<int>(vertex_arena_.size());
+  }
+  int index_arena_size() const {
+    return static_cast<int>(index_arena_.size());
+  }
+
+  // Returns the arenas, whose contents the next Draw() uploads if they
+  // changed.
+  const std::vector<GLfloat>& vertex_arena() const {
+    return vertex_arena_;
+  }
+  const std::vector<GLuint>& index_arena() const {
+    return index_arena_;
+  }
+
+  // Returns the draw table of the last Draw(): four ints per drawn model, in
+  // the layout of draw_records_.
+  const std::vector<GLint>& draw_records() const {
+    return draw_records_;
+  }
+
+  const VertexPullingStats& stats() const {
+    return stats_;
+  }
+
+  void ResetStats() {
+    stats_ = VertexPullingStats();
+  }
+
+ private:
+  // Where a mesh is in the arenas.
+  struct MeshRecord {
+    // The mesh. A new mesh may be allocated where a deleted one was, so the
+    // record is only valid while this has not expired.
+    std::weak_ptr<const Mesh> mesh;
+    // First float of its vertices in the vertex arena, and floats per
+    // vertex. The position is the first three floats of a vertex.
+    int first_float;
+    int stride;
+    int num_vertices;
+    // First index in the index arena, or -1 if the mesh is not indexed.
+    int first_index;
+    int num_indices;
+  };
+
+  // The buffers and their texture views, in the order of the samplers.
+  enum Arena {
+    VERTICES = 0,
+    INDICES,
+    DRAWS,
+    DRAW_TRANSFORMS,
+    NUM_ARENAS
+  };
+
+  // Drops the records of the deleted meshes, and compacts the arenas when
+  // the space of the dropped meshes is at least the space of the others.
+  void DropDeletedMeshes();
+
+  // Moves the geometry of the meshes to the start of the arenas.
+  void CompactArenas();
+
+  // Uploads the vertex and the index arenas if meshes were added.
+  void UploadArenas();
+
+  // Replaces the contents of a buffer.
+  void UploadBuffer(const Arena arena, const GLsizeiptr size,
+                    const void* data, const GLenum usage);
+
+  const int max_texture_buffer_size_;
+  TransformBuffer* transform_buffer_;
+  GLuint vertex_array_object_id_;
+  GLuint buffer_ids_[NUM_ARENAS];
+  GLuint texture_ids_[NUM_ARENAS];
+  std::unordered_map<const Mesh*, MeshRecord> meshes_;
+  std::vector<GLfloat> vertex_arena_;
+  std::vector<GLuint> index_arena_;
+  // The floats and the indices of the dropped meshes in the arenas.
+  int64_t num_dropped_floats_;
+  int64_t num_dropped_indices_;
+  bool arenas_changed_;
+  // The models of the frame whose meshes are in the arenas.
+  std::vector<Model*> draw_models_;
+  // The draw table of the frame: a record per model (its first vertex in the
+  // draw, its first index, its first float and its stride) and the handle of
+  // its model matrix.
+  std::vector<GLint> draw_records_;
+  std::vector<GLint> draw_transforms_;
+  VertexPullingStats stats_;
+};
+
+}  // namespace wvu
+
+#endif  // VERTEX_PULLING_RENDERER_H_
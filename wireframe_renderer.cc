@@ -0,0 +1,306 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "wireframe_renderer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gl_hooks.h"
+#include "gl_resource_registry.h"
+#include "model.h"
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// Vertex shader of the barycentric mode. Since the triangles are not indexed,
+// the i-th vertex of every triangle has gl_VertexID % 3 == i and gets the i-th
+// barycentric coordinate set to one.
+const std::string barycentric_vertex_shader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 position;\n"
+    "uniform mat4 model;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 projection;\n"
+    "out vec3 barycentric;\n"
+    "\n"
+    "void main() {\n"
+    "barycentric = vec3(0.0f);\n"
+    "barycentric[gl_VertexID % 3] = 1.0f;\n"
+    "gl_Position = projection * view * model * vec4(position, 1.0f);\n"
+    "}\n";
+
+// Fragment shader of the barycentric mode. The distance to the closest edge
+// is the smallest barycentric coordinate, which fwidth() converts to pixels.
+const std::string barycentric_fragment_shader_src =
+    "#version 330 core\n"
+    "in vec3 barycentric;\n"
+    "uniform float line_width;\n"
+    "uniform bool hidden_line_removal;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "vec3 pixel_distance = barycentric / fwidth(barycentric);\n"
+    "float edge_distance = min(min(pixel_distance.x, pixel_distance.y),\n"
+    "                          pixel_distance.z);\n"
+    "float coverage = 1.0f - smoothstep(0.5f * line_width - 0.5f,\n"
+    "                                   0.5f * line_width + 0.5f,\n"
+    "                                   edge_distance);\n"
+    "if (coverage <= 0.0f && !hidden_line_removal) discard;\n"
+    "color = vec4(coverage * vec3(1.0f, 0.5f, 0.2f), 1.0f);\n"
+    "}\n";
+
+// Shaders of the edge lines mode.
+const std::string lines_vertex_shader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 position;\n"
+    "uniform mat4 model;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 projection;\n"
+    "\n"
+    "void main() {\n"
+    "gl_Position = projection * view * model * vec4(position, 1.0f);\n"
+    "}\n";
+
+const std::string lines_fragment_shader_src =
+    "#version 330 core\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "color = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
+    "}\n";
+
+// Returns the index of the i-th vertex of the triangle list.
+inline GLuint TriangleListIndex(const std::vector<GLuint>& indices,
+                                const int i) {
+  return indices.empty() ? static_cast<GLuint>(i) : indices[i];
+}
+
+}  // namespace
+
+bool ParseWireframeMode(const std::string& name, WireframeMode* mode) {
+  if (name == "polygon_mode") {
+    *mode = WireframeMode::POLYGON_MODE;
+  } else if (name == "barycentric") {
+    *mode = WireframeMode::BARYCENTRIC;
+  } else if (name == "edge_lines") {
+    *mode = WireframeMode::EDGE_LINES;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<GLuint> ComputeUniqueEdgeIndices(const std::vector<GLuint>& indices,
+                                             const int num_vertices) {
+  const int num_indices = indices.empty() ?
+      num_vertices : static_cast<int>(indices.size());
+  const int num_triangle_vertices = num_indices - num_indices % 3;
+  // Every edge is keyed by its sorted vertex indices.
+  std::unordered_set<uint64_t> unique_edges;
+  std::vector<GLuint> edge_indices;
+  for (int i = 0; i < num_triangle_vertices; i += 3) {
+    for (int j = 0; j < 3; ++j) {
+      const GLuint a = TriangleListIndex(indices, i + j);
+      const GLuint b = TriangleListIndex(indices, i + (j + 1) % 3);
+      const uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) |
+          std::max(a, b);
+      if (unique_edges.insert(key).second) {
+        edge_indices.push_back(a);
+        edge_indices.push_back(b);
+      }
+    }
+  }
+  return edge_indices;
+}
+
+WireframeRenderer::WireframeRenderer() :
+    line_width_(1.0f), hidden_line_removal_(false) {}
+
+WireframeRenderer::~WireframeRenderer() {
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  for (const auto& mesh_and_buffers : buffers_) {
+    const WireframeBuffers& buffers = mesh_and_buffers.second;
+    registry->Unregister(GlObjectType::BUFFER,
+                         buffers.triangles_vertex_buffer_object_id);
+    registry->Unregister(GlObjectType::VERTEX_ARRAY,
+                         buffers.triangles_vertex_array_object_id);
+    registry->Unregister(GlObjectType::BUFFER,
+                         buffers.edges_vertex_buffer_object_id);
+    registry->Unregister(GlObjectType::BUFFER,
+                         buffers.edges_element_buffer_object_id);
+    registry->Unregister(GlObjectType::VERTEX_ARRAY,
+                         buffers.edges_vertex_array_object_id);
+    glDeleteBuffers(1, &buffers.triangles_vertex_buffer_object_id);
+    glDeleteVertexArrays(1, &buffers.triangles_vertex_array_object_id);
+    glDeleteBuffers(1, &buffers.edges_vertex_buffer_object_id);
+    glDeleteBuffers(1, &buffers.edges_element_buffer_object_id);
+    glDeleteVertexArrays(1, &buffers.edges_vertex_array_object_id);
+  }
+}
+
+bool WireframeRenderer::Initialize(std::string* error_info_log) {
+  barycentric_shader_program_.LoadVertexShaderFromString(
+      barycentric_vertex_shader_src);
+  barycentric_shader_program_.LoadFragmentShaderFromString(
+      barycentric_fragment_shader_src);
+  if (!barycentric_shader_program_.Create(error_info_log)) return false;
+  lines_shader_program_.LoadVertexShaderFromString(lines_vertex_shader_src);
+  lines_shader_program_.LoadFragmentShaderFromString(
+      lines_fragment_shader_src);
+  return lines_shader_program_.Create(error_info_log);
+}
+
+void WireframeRenderer::PrepareModel(Model* model) {
+  const Mesh* mesh = model->mesh().get();
+  if (buffers_.count(mesh) > 0) return;
+  WireframeBuffers& buffers = buffers_[mesh];
+  const Eigen::MatrixXf& vertices = model->vertices();
+  const std::vector<GLuint>& indices = model->indices();
+  const int num_indices = indices.empty() ?
+      static_cast<int>(vertices.cols()) : static_cast<int>(indices.size());
+  const int num_triangle_vertices = num_indices - num_indices % 3;
+
+  // Unindexed copy of the triangles.
+  Eigen::MatrixXf triangle_vertices(3, num_triangle_vertices);
+  for (int i = 0; i < num_triangle_vertices; ++i) {
+    triangle_vertices.col(i) = vertices.col(TriangleListIndex(indices, i));
+  }
+  buffers.num_triangle_vertices = num_triangle_vertices;
+  GlResourceRegistry* registry = GlResourceRegistry::Instance();
+  glGenVertexArrays(1, &buffers.triangles_vertex_array_object_id);
+  glGenBuffers(1, &buffers.triangles_vertex_buffer_object_id);
+  registry->Register(GlObjectType::VERTEX_ARRAY,
+                     buffers.triangles_vertex_array_object_id,
+                     "wireframe_renderer", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER,
+                     buffers.triangles_vertex_buffer_object_id,
+                     "wireframe_renderer", WVU_GL_CREATION_SITE);
+  glBindVertexArray(buffers.triangles_vertex_array_object_id);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers.triangles_vertex_buffer_object_id);
+  glBufferData(GL_ARRAY_BUFFER,
+               triangle_vertices.size() * sizeof(GLfloat),
+               triangle_vertices.data(),
+               GL_STATIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER,
+                    buffers.triangles_vertex_buffer_object_id,
+                    triangle_vertices.size() * sizeof(GLfloat));
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                        static_cast<GLvoid*>(0));
+  glEnableVertexAttribArray(0);
+
+  const std::vector<GLuint> edge_indices =
+      ComputeUniqueEdgeIndices(indices, static_cast<int>(vertices.cols()));
+  buffers.num_edge_indices = static_cast<GLsizei>(edge_indices.size());
+  // The edges index their own copy of the vertices, since the residency
+  // manager may evict the buffer of the mesh and upload it under a new name.
+  glGenVertexArrays(1, &buffers.edges_vertex_array_object_id);
+  glGenBuffers(1, &buffers.edges_vertex_buffer_object_id);
+  glGenBuffers(1, &buffers.edges_element_buffer_object_id);
+  registry->Register(GlObjectType::VERTEX_ARRAY,
+                     buffers.edges_vertex_array_object_id,
+                     "wireframe_renderer", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER,
+                     buffers.edges_vertex_buffer_object_id,
+                     "wireframe_renderer", WVU_GL_CREATION_SITE);
+  registry->Register(GlObjectType::BUFFER,
+                     buffers.edges_element_buffer_object_id,
+                     "wireframe_renderer", WVU_GL_CREATION_SITE);
+  glBindVertexArray(buffers.edges_vertex_array_object_id);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers.edges_vertex_buffer_object_id);
+  glBufferData(GL_ARRAY_BUFFER,
+               vertices.size() * sizeof(GLfloat),
+               vertices.data(),
+               GL_STATIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER, buffers.edges_vertex_buffer_object_id,
+                    vertices.size() * sizeof(GLfloat));
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                        static_cast<GLvoid*>(0));
+  glEnableVertexAttribArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.edges_element_buffer_object_id);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               edge_indices.size() * sizeof(GLuint),
+               edge_indices.data(),
+               GL_STATIC_DRAW);
+  registry->SetSize(GlObjectType::BUFFER,
+                    buffers.edges_element_buffer_object_id,
+                    edge_indices.size() * sizeof(GLuint));
+  glBindVertexArray(0);
+}
+
+void WireframeRenderer::SetTransformUniforms(
+    const ShaderProgram& shader_program,
+    const Eigen::Matrix4f& model,
+    const Eigen::Matrix4f& projection,
+    const Eigen::Matrix4f& view) const {
+  const GLuint program_id = shader_program.shader_program_id();
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "model"), 1, GL_FALSE,
+                     model.data());
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "view"), 1, GL_FALSE,
+                     view.data());
+  glUniformMatrix4fv(glGetUniformLocation(program_id, "projection"), 1,
+                     GL_FALSE, projection.data());
+}
+
+void WireframeRenderer::Draw(const WireframeMode mode,
+                             Model* model,
+                             const Eigen::Matrix4f& projection,
+                             const Eigen::Matrix4f& view) {
+  const auto buffers_it = buffers_.find(model->mesh().get());
+  if (buffers_it == buffers_.end()) return;
+  const WireframeBuffers& buffers = buffers_it->second;
+  const Eigen::Matrix4f model_matrix = model->ComputeModelMatrix();
+  if (mode == WireframeMode::BARYCENTRIC) {
+    barycentric_shader_program_.Use();
+    SetTransformUniforms(barycentric_shader_program_, model_matrix, projection,
+                         view);
+    const GLuint program_id = barycentric_shader_program_.shader_program_id();
+    glUniform1f(glGetUniformLocation(program_id, "line_width"), line_width_);
+    glUniform1i(glGetUniformLocation(program_id, "hidden_line_removal"),
+                hidden_line_removal_ ? 1 : 0);
+    glBindVertexArray(buffers.triangles_vertex_array_object_id);
+    glDrawArrays(GL_TRIANGLES, 0, buffers.num_triangle_vertices);
+  } else if (mode == WireframeMode::EDGE_LINES) {
+    lines_shader_program_.Use();
+    SetTransformUniforms(lines_shader_program_, model_matrix, projection,
+                         view);
+    glBindVertexArray(buffers.edges_vertex_array_object_id);
+    glDrawElements(GL_LINES, buffers.num_edge_indices, GL_UNSIGNED_INT, 0);
+  }
+  glBindVertexArray(0);
+}
+
+}  // namespace wvu
@@ -0,0 +1,158 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef WIREFRAME_RENDERER_H_
+#define WIREFRAME_RENDERER_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <GL/glew.h>
+
+#include "model.h"
+#include "shader_program.h"
+
+namespace wvu {
+// Ways of rendering the models as wireframes.
+enum class WireframeMode {
+  // Filled triangles rasterized as lines with glPolygonMode(). This is the
+  // classic approach, but it is slow on many drivers (e.g., llvmpipe) and it
+  // provides no control over the line width or the hidden lines.
+  POLYGON_MODE = 0,
+  // Filled triangles whose fragment shader draws the edges from the distance
+  // to them, computed from barycentric coordinates. The barycentric
+  // coordinates are derived from gl_VertexID on an unindexed copy of the
+  // vertices, so no extra vertex attribute is needed.
+  BARYCENTRIC = 1,
+  // Every unique edge drawn once as GL_LINES from a precomputed edge index
+  // buffer into a copy of the vertices of the mesh.
+  EDGE_LINES = 2
+};
+
+// Parses a wireframe mode name: polygon_mode, barycentric or edge_lines.
+// Returns false if the name is unknown.
+bool ParseWireframeMode(const std::string& name, WireframeMode* mode);
+
+// Returns the vertex index pairs of the unique edges of a triangle list, so
+// that the edges shared by two triangles are drawn once with GL_LINES.
+// Params:
+//   indices  The triangle list indices. When empty, every num_vertices
+//     consecutive vertices are the triangle list.
+//   num_vertices  The number of vertices of the mesh.
+std::vector<GLuint> ComputeUniqueEdgeIndices(const std::vector<GLuint>& indices,
+                                             const int num_vertices);
+
+// This class renders models as wireframes with the shader-based modes. The
+// GPU buffers needed by every mode are built once per mesh by
+// PrepareModel(), so the models that share a mesh share them too.
+//
+// Example:
+//
+// wvu::WireframeRenderer wireframe_renderer;
+// std::string error_info_log;
+// if (!wireframe_renderer.Initialize(&error_info_log)) { ... }
+// wireframe_renderer.PrepareModel(model);
+// while (...) {  // Rendering loop.
+//   wireframe_renderer.Draw(wvu::WireframeMode::BARYCENTRIC, model,
+//                           projection, view);
+// }
+class WireframeRenderer {
+ public:
+  WireframeRenderer();
+
+  // Destructor. Releases the GPU buffers of the prepared meshes.
+  ~WireframeRenderer();
+
+  // Compiles the shaders. Returns false and fills error_info_log on failure.
+  bool Initialize(std::string* error_info_log);
+
+  // Builds the unindexed vertex buffer, and the vertex and the unique edge
+  // index buffers of the mesh of the model, unless another model with the
+  // mesh did already. The buffers do not depend on the ones of the mesh,
+  // which may be evicted, but the model must have its CPU geometry.
+  void PrepareModel(Model* model);
+
+  // Draws a prepared model. POLYGON_MODE is not handled by this class.
+  // Params:
+  //   mode  BARYCENTRIC or EDGE_LINES.
+  //   model  The model to draw.
+  //   projection  The camera projection matrix.
+  //   view  The camera pose matrix (world -> camera transformation matrix).
+  void Draw(const WireframeMode mode,
+            Model* model,
+            const Eigen::Matrix4f& projection,
+            const Eigen::Matrix4f& view);
+
+  // Sets the width of the lines in pixels for the BARYCENTRIC mode.
+  void set_line_width(const float line_width) {
+    line_width_ = line_width;
+  }
+
+  // When true, the BARYCENTRIC mode fills the triangles with the background
+  // color so that the lines behind them are hidden.
+  void set_hidden_line_removal(const bool hidden_line_removal) {
+    hidden_line_removal_ = hidden_line_removal;
+  }
+
+ private:
+  // GPU buffers of a prepared model.
+  struct WireframeBuffers {
+    // Unindexed copy of the triangles.
+    GLuint triangles_vertex_array_object_id = 0;
+    GLuint triangles_vertex_buffer_object_id = 0;
+    GLsizei num_triangle_vertices = 0;
+    // Unique edges indexing a copy of the vertices of the model.
+    GLuint edges_vertex_array_object_id = 0;
+    GLuint edges_vertex_buffer_object_id = 0;
+    GLuint edges_element_buffer_object_id = 0;
+    GLsizei num_edge_indices = 0;
+  };
+
+  // Sets the model, view and projection uniforms of a shader program.
+  void SetTransformUniforms(const ShaderProgram& shader_program,
+                            const Eigen::Matrix4f& model,
+                            const Eigen::Matrix4f& projection,
+                            const Eigen::Matrix4f& view) const;
+
+  ShaderProgram barycentric_shader_program_;
+  ShaderProgram lines_shader_program_;
+  std::unordered_map<const Mesh*, WireframeBuffers> buffers_;
+  float line_width_;
+  bool hidden_line_removal_;
+};
+
+}  // namespace wvu
+
+#endif  // WIREFRAME_RENDERER_H_